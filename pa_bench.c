@@ -0,0 +1,698 @@
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ *******************************************************************************
+ * The 'make bench' driver.
+ *
+ * 'make demo' needs the network (and a font that may not be there anymore), so
+ * it's no good for timing anything.  This builds its own inputs instead, the
+ * same ones every time --
+ *   - chapters of different lengths and tag densities (the tags are added by a
+ *     generated sed script, like the demo's),
+ *   - solid and noisy RGB backgrounds at 1920x1080 and 3840x2160,
+ * then runs the whole 'pngass' pipeline over them a few times for each size
+ * and reports the pages/sec, where the time went (from '--stats-json'), and
+ * the renders per page.  Only the system's default fonts are used (through
+ * fontconfig, '--text-face=Sans').
+ *
+ * With '--baseline=FILE', the results are compared against a saved run (see
+ * 'make bench-baseline').
+ *
+ *   gcc -O3 -I. pa_bench.c rw_textfile.c -lpng -o pa_bench
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <png.h>
+
+#include "pa_misc.h"
+#include "rw_textfile.h"
+
+#ifndef realloc
+#warning "realloc() is not a macro..."
+#endif
+
+#undef BENCH_DEFAULT_DIR
+#define BENCH_DEFAULT_DIR   "./BENCH"
+#undef BENCH_DEFAULT_RUNS
+#define BENCH_DEFAULT_RUNS  (3)
+#undef BENCH_SEED
+#define BENCH_SEED          (0x1b873593u)  /* any non-0 value, but never change it */
+
+#undef BENCH_MAX_KEYS
+#define BENCH_MAX_KEYS      (16)
+#undef BENCH_MAX_RUNS
+#define BENCH_MAX_RUNS      (32)
+
+/**
+ *******************************************************************************
+ * The synthetic chapters -- 'words' is the chapter's length, 'tags' is the
+ * percent of its words that the sed script will wrap with override tags, and
+ * 'long_tokens' is the percent that are long unbreakable runs (which are what
+ * make the fold engine work the hardest).
+ */
+static struct {
+    unsigned int  words;
+    unsigned int  tags;
+    unsigned int  long_tokens;
+} const chapters[] = {
+    {   600,  0, 0 },
+    {  2500,  2, 0 },
+    {  4000,  8, 1 },
+    {  8000,  4, 0 },
+    {  3000, 30, 2 },
+    { 12000, 12, 1 },
+};
+
+static struct {
+    char const   *name;
+    unsigned int  width;
+    unsigned int  height;
+} const sizes[] = {
+    { "1080p", 1920, 1080 },
+    { "4k",    3840, 2160 },
+};
+
+static char const *const words[] = {
+    "the", "a", "and", "of", "to", "was", "he", "she", "it", "that", "in",
+    "his", "her", "with", "for", "on", "as", "had", "at", "but", "not", "they",
+    "Satou", "Arisa", "Mia", "Liza", "Pochi", "Tama", "Nana", "Lulu", "Zena",
+    "goblin", "lizardman", "dungeon", "merchant", "market", "labyrinth",
+    "magic", "sword", "skill", "level", "window", "map", "noble", "city",
+    "looked", "said", "walked", "smiled", "answered", "noticed", "decided",
+    "quickly", "quietly", "carefully", "really", "suddenly", "already",
+    "beautiful", "ancient", "mysterious", "delicious", "strange", "little",
+};
+
+/**
+ *******************************************************************************
+ * One row of results (the median run for a background size).
+ */
+typedef struct bench_keys_t {
+    size_t  cnt;
+    char    name [ BENCH_MAX_KEYS ][ 32 ];
+    double  value[ BENCH_MAX_KEYS ];
+} bench_keys_t;
+
+typedef struct bench_result_t {
+    double        pages;
+    double        wall_ms;
+    double        cpu_ms;
+    double        renders;
+    bench_keys_t  phases;
+} bench_result_t;
+
+static uint32_t     bench_rand         ( uint32_t *seed );
+static rc_e         make_inputs        ( char const *const dir );
+static rc_e         make_chapter       ( char const *const filename, size_t idx, uint32_t *seed );
+static rc_e         make_background    ( char const *const filename, unsigned int width, unsigned int height, int noise, uint32_t *seed );
+static void         empty_dir          ( char const *const dir );
+static rc_e         run_pngass         ( char **argv, char const *const log );
+static rc_e         read_stats         ( char const *const filename, bench_result_t * );
+static char const  *find_run_key       ( char const *const json, char const *const key );
+static size_t       read_object        ( char const *p, bench_keys_t * );
+static void         print_result       ( char const *const size, bench_result_t const * );
+static void         compare_baseline   ( char const *const filename, char const *const size, bench_result_t const * );
+static void         save_baseline      ( FILE *file, char const *const size, bench_result_t const * );
+static int          cmpr_wall_ms       ( void const *, void const * );
+
+
+/**
+ *******************************************************************************
+ */
+int main( int argc, char **argv )
+{
+    enum {
+        ARG_PNGASS = 2,
+        ARG_DIR,
+        ARG_RUNS,
+        ARG_BASELINE,
+        ARG_SAVE_BASELINE,
+        ARG_TEMPLATES_DIR,
+    };
+    static struct option const long_options[] = {
+        { "pngass",          required_argument, 0, ARG_PNGASS        },
+        { "dir",             required_argument, 0, ARG_DIR           },
+        { "runs",            required_argument, 0, ARG_RUNS          },
+        { "baseline",        required_argument, 0, ARG_BASELINE      },
+        { "save-baseline",   no_argument,       0, ARG_SAVE_BASELINE },
+        { "templates-dir",   required_argument, 0, ARG_TEMPLATES_DIR },
+        { 0,                 0,                 0, 0                 }
+    };
+    struct {
+        char const     *pngass;
+        char const     *dir;
+        char const     *baseline;
+        char const     *templates_dir;
+        int             runs;
+        int             save;
+        int             die;
+        FILE           *save_file;
+        bench_result_t  results[ BENCH_MAX_RUNS ];
+    } w = {
+        .pngass        = "./pngass",
+        .dir           = BENCH_DEFAULT_DIR,
+        .baseline      = NULL,
+        .templates_dir = "TEMPLATEs",
+        .runs          = BENCH_DEFAULT_RUNS,
+        .save          = 0,
+        .die           = 0,
+        .save_file     = NULL,
+    };
+    int  c;
+    char extra[ 4 ];
+
+
+    while ( -1 != (c = getopt_long( argc, argv, "", long_options, NULL )) ) {
+        switch ( c ) {
+        case ARG_PNGASS :
+            w.pngass = optarg;
+            break;
+        case ARG_DIR :
+            w.dir = optarg;
+            break;
+        case ARG_RUNS :
+            if ( 1 != sscanf(optarg, "%d%3c", &w.runs, extra) || w.runs < 1 || w.runs > BENCH_MAX_RUNS ) {
+                fprintf(stderr, "ERROR :: '--runs=%s' must be 1 to %d.\n", optarg, BENCH_MAX_RUNS);
+                w.die = 1;
+            }
+            break;
+        case ARG_BASELINE :
+            w.baseline = optarg;
+            break;
+        case ARG_SAVE_BASELINE :
+            w.save = 1;
+            break;
+        case ARG_TEMPLATES_DIR :
+            w.templates_dir = optarg;
+            break;
+        default :
+            w.die = 1;
+            break;
+        }
+    }
+    if ( w.save && NULL == w.baseline ) {
+        fprintf(stderr, "ERROR :: '--save-baseline' needs a '--baseline=FILE'.\n");
+        w.die = 1;
+    }
+    if ( w.die ) {
+        fprintf(stderr, "usage: %s [--pngass=PATH] [--dir=DIR] [--runs=N] [--baseline=FILE [--save-baseline]]"
+                        " [--templates-dir=DIR] [-- pngass options...]\n", argv[ 0 ]);
+        exit( EXIT_FAILURE );
+    }
+
+    if ( RC_TRUE != make_inputs( w.dir ) ) {
+        exit( EXIT_FAILURE );
+    }
+
+    if ( w.save && NULL == (w.save_file = fopen(w.baseline, "w")) ) {
+        fprintf(stderr, "ERROR :: can't write the baseline to '%s' -- error %d, %s\n", w.baseline, errno, strerror(errno));
+        exit( EXIT_FAILURE );
+    }
+
+    /*
+     ***************************************************************************
+     * Anything after the options (e.g., '-- --jobs=4') goes to 'pngass'.
+     */
+    for ( size_t ss = 0; ss < sizeof (sizes) / sizeof (sizes[ 0 ]); ss++ ) {
+        char  arg[ 16 ][ 1024 ];
+        char *args[ 16 + argc ];
+        char  log[ 512 ];
+        char  stats[ 512 ];
+        char  out[ 512 ];
+        int   na = 0;
+
+        snprintf(out, sizeof (out), "%s/out", w.dir);
+        snprintf(log, sizeof (log), "%s/pngass-%s.log", w.dir, sizes[ ss ].name);
+        snprintf(stats, sizeof (stats), "%s/stats-%s.json", w.dir, sizes[ ss ].name);
+
+        args[ na++ ] = (char *) w.pngass;
+        snprintf(arg[ na ], sizeof (arg[ 0 ]), "--template=%s/left_template.ass", w.templates_dir);          args[ na ] = arg[ na ]; na++;
+        snprintf(arg[ na ], sizeof (arg[ 0 ]), "--template=%s/right_template.ass", w.templates_dir);         args[ na ] = arg[ na ]; na++;
+        snprintf(arg[ na ], sizeof (arg[ 0 ]), "--header-template=%s/header.ass", w.templates_dir);          args[ na ] = arg[ na ]; na++;
+        snprintf(arg[ na ], sizeof (arg[ 0 ]), "--dest-dir=%s", out);                                        args[ na ] = arg[ na ]; na++;
+        snprintf(arg[ na ], sizeof (arg[ 0 ]), "--input-glob=%s/txt/*.txt", w.dir);                          args[ na ] = arg[ na ]; na++;
+        snprintf(arg[ na ], sizeof (arg[ 0 ]), "--png-glob=%s/bg/%s-*.png", w.dir, sizes[ ss ].name);        args[ na ] = arg[ na ]; na++;
+        snprintf(arg[ na ], sizeof (arg[ 0 ]), "--script-file=%s/bench.sed", w.dir);                         args[ na ] = arg[ na ]; na++;
+        snprintf(arg[ na ], sizeof (arg[ 0 ]), "--stats-json=%s", stats);                                     args[ na ] = arg[ na ]; na++;
+        args[ na++ ] = "-B";
+        args[ na++ ] = "12";
+        args[ na++ ] = "--line-spacing=5.0";
+        args[ na++ ] = "--text-size=38";
+        args[ na++ ] = "--pad-paragraph=56";
+        args[ na++ ] = "--text-face=Sans";
+        for ( int ii = optind; ii < argc; ii++ ) {
+            args[ na++ ] = argv[ ii ];
+        }
+        args[ na ] = NULL;
+
+        fprintf(stderr, "Running :: %s, %d time%s ...\n", sizes[ ss ].name, w.runs, (1 == w.runs) ? "" : "s");
+        for ( int run = 0; run < w.runs; run++ ) {
+            empty_dir( out );
+            if (   RC_TRUE != run_pngass( args, log )
+                || RC_TRUE != read_stats( stats, &w.results[ run ] )
+                || 0 == w.results[ run ].pages ) {
+                fprintf(stderr, "ERROR :: the %s run failed, see '%s'.\n", sizes[ ss ].name, log);
+                exit( EXIT_FAILURE );
+            }
+        }
+
+        /*
+         ***********************************************************************
+         * Report the median run (by its wall clock time).
+         */
+        qsort( w.results, w.runs, sizeof (bench_result_t), cmpr_wall_ms );
+        print_result( sizes[ ss ].name, &w.results[ w.runs / 2 ] );
+        if ( w.save ) {
+            save_baseline( w.save_file, sizes[ ss ].name, &w.results[ w.runs / 2 ] );
+        }
+        else if ( NULL != w.baseline ) {
+            compare_baseline( w.baseline, sizes[ ss ].name, &w.results[ w.runs / 2 ] );
+        }
+    }
+
+    if ( NULL != w.save_file ) {
+        fclose( w.save_file );
+        fprintf(stderr, "Saved the baseline to '%s'.\n", w.baseline);
+    }
+
+    exit( EXIT_SUCCESS );
+}
+
+
+/**
+ *******************************************************************************
+ * xorshift32, so the inputs don't depend on the C library's 'rand()'.
+ */
+static uint32_t bench_rand( uint32_t *seed )
+{
+    uint32_t x = *seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return ( *seed = x );
+}
+
+
+/**
+ *******************************************************************************
+ * The inputs are only made if they're not there already (they're the same
+ * every time, and a noisy 4K PNG takes a while to compress).
+ */
+static rc_e make_inputs( char const *const dir )
+{
+    char      path[ 512 ];
+    uint32_t  seed = BENCH_SEED;
+    struct    stat st;
+    FILE     *file;
+
+    char const *const subdirs[] = { "", "/txt", "/bg", "/out" };
+    for ( size_t ii = 0; ii < sizeof (subdirs) / sizeof (subdirs[ 0 ]); ii++ ) {
+        snprintf(path, sizeof (path), "%s%s", dir, subdirs[ ii ]);
+        if ( 0 != mkdir(path, 0755) && EEXIST != errno ) {
+            fprintf(stderr, "ERROR :: can't make '%s' -- error %d, %s\n", path, errno, strerror(errno));
+            return ( RC_FALSE );
+        }
+    }
+
+    /*
+     ***************************************************************************
+     * The sed script -- '_word_' is italics, '*word*' is bold, and a scene
+     * break is a bigger, coloured, diamond (the demo's is a decorative font).
+     * 'pngass' runs it with '--regexp-extended'.
+     */
+    snprintf(path, sizeof (path), "%s/bench.sed", dir);
+    if ( NULL == (file = fopen(path, "w")) ) {
+        fprintf(stderr, "ERROR :: can't write '%s' -- error %d, %s\n", path, errno, strerror(errno));
+        return ( RC_FALSE );
+    }
+    fprintf(file, "# Generated by pa_bench, the 'make bench' sed script.\n");
+    fprintf(file, ":a;N;$!ba;s#\\n\\n◇\\n\\n#\\n{\\\\1c\\&H333647\\&\\\\fs80}◇{@@1c@@@@size@@}\\n#g\n");
+    fprintf(file, "s#_([^_ ]*)_#{\\\\i1}\\1{\\\\i0}#g\n");
+    fprintf(file, "s#[*]([^* ]*)[*]#{\\\\b1}\\1{\\\\b0}#g\n");
+    fclose( file );
+
+    for ( size_t idx = 0; idx < sizeof (chapters) / sizeof (chapters[ 0 ]); idx++ ) {
+        snprintf(path, sizeof (path), "%s/txt/ch%02zu.txt", dir, idx + 1);
+        if ( RC_TRUE != make_chapter( path, idx, &seed ) ) {
+            return ( RC_FALSE );
+        }
+    }
+
+    for ( size_t ss = 0; ss < sizeof (sizes) / sizeof (sizes[ 0 ]); ss++ ) {
+        for ( int noise = 0; noise < 2; noise++ ) {
+            snprintf(path, sizeof (path), "%s/bg/%s-%d-%s.png", dir, sizes[ ss ].name, noise, (noise) ? "noise" : "solid");
+            if ( 0 == stat(path, &st) ) {
+                continue;
+            }
+            fprintf(stderr, "Making :: '%s' ...\n", path);
+            if ( RC_TRUE != make_background( path, sizes[ ss ].width, sizes[ ss ].height, noise, &seed ) ) {
+                return ( RC_FALSE );
+            }
+        }
+    }
+
+    return ( RC_TRUE );
+}
+
+
+/**
+ *******************************************************************************
+ * A chapter title, then paragraphs of "words" with the odd scene break.
+ */
+static rc_e make_chapter( char const *const filename, size_t idx, uint32_t *seed )
+{
+    size_t const  nwords = sizeof (words) / sizeof (words[ 0 ]);
+    unsigned int  paragraph = 0;
+    FILE         *file;
+
+    if ( NULL == (file = fopen(filename, "w")) ) {
+        fprintf(stderr, "ERROR :: can't write '%s' -- error %d, %s\n", filename, errno, strerror(errno));
+        return ( RC_FALSE );
+    }
+
+    fprintf(file, "Chapter %zu. The Benchmark, Part %zu\n\n", idx + 1, idx + 1);
+    for ( unsigned int ii = 0; ii < chapters[ idx ].words; ii++ ) {
+        char const  *word = words[ bench_rand( seed ) % nwords ];
+        unsigned int roll = bench_rand( seed ) % 100;
+
+        if ( 0 == paragraph ) {
+            paragraph = 40 + bench_rand( seed ) % 120;
+            if ( ii ) {
+                fprintf(file, (0 == bench_rand( seed ) % 12) ? ".\n\n◇\n\n" : ".\n\n");
+            }
+        }
+        else {
+            fputc(' ', file);
+        }
+        paragraph--;
+
+        if ( roll < chapters[ idx ].long_tokens ) {
+            for ( unsigned int jj = 0, len = 30 + bench_rand( seed ) % 60; jj < len; jj++ ) {
+                fputc("abcdefghijklmnopqrstuvwxyz-/."[ bench_rand( seed ) % 29 ], file);
+            }
+        }
+        else if ( roll < chapters[ idx ].long_tokens + chapters[ idx ].tags ) {
+            fprintf(file, (roll & 1) ? "_%s_" : "*%s*", word);
+        }
+        else {
+            fputs(word, file);
+        }
+    }
+    fprintf(file, ".\n");
+
+    if ( 0 != fclose( file ) ) {
+        fprintf(stderr, "ERROR :: can't write '%s' -- error %d, %s\n", filename, errno, strerror(errno));
+        return ( RC_FALSE );
+    }
+
+    return ( RC_TRUE );
+}
+
+
+/**
+ *******************************************************************************
+ * A light, readable, background -- either solid or with some noise (which is
+ * what most real backgrounds look like to zlib).
+ */
+static rc_e make_background( char const *const filename, unsigned int width, unsigned int height, int noise, uint32_t *seed )
+{
+    png_image      image;
+    size_t         stride = 3 * (size_t) width;
+    unsigned char *pixels = malloc( stride * height );
+
+    for ( size_t yy = 0; yy < height; yy++ ) {
+        unsigned char *row = pixels + yy * stride;
+        for ( size_t xx = 0; xx < width; xx++ ) {
+            int n = (noise) ? (int) (bench_rand( seed ) % 24) - 12 : 0;
+            row[ 3 * xx + 0 ] = 0xe8 + n / 2;
+            row[ 3 * xx + 1 ] = 0xe0 + n / 2;
+            row[ 3 * xx + 2 ] = 0xd0 + n / 2;
+        }
+    }
+
+    memset( &image, '\0', sizeof (image) );
+    image.version = PNG_IMAGE_VERSION;
+    image.width   = width;
+    image.height  = height;
+    image.format  = PNG_FORMAT_RGB;
+
+    int rc = png_image_write_to_file( &image, filename, 0, pixels, stride, NULL );
+    if ( 0 == rc ) {
+        fprintf(stderr, "ERROR :: can't write '%s' -- %s\n", filename, image.message);
+    }
+    png_image_free( &image );
+    free( pixels );
+
+    return ( (rc) ? RC_TRUE : RC_FALSE );
+}
+
+
+/**
+ *******************************************************************************
+ * Each run starts with an empty '--dest-dir'.
+ */
+static void empty_dir( char const *const dir )
+{
+    char           path[ 1024 ];
+    struct dirent *ent;
+    DIR           *dp = opendir( dir );
+
+    if ( NULL == dp ) {
+        return ;
+    }
+    while ( NULL != (ent = readdir( dp )) ) {
+        if ( '.' != ent->d_name[ 0 ] ) {
+            snprintf(path, sizeof (path), "%s/%s", dir, ent->d_name);
+            unlink( path );
+        }
+    }
+    closedir( dp );
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * 'pngass' is chatty (every page's text in PASS #2), so all of its output
+ * goes to 'log'.
+ */
+static rc_e run_pngass( char **argv, char const *const log )
+{
+    int   status;
+    pid_t pid;
+
+    fflush( stdout );
+    fflush( stderr );
+    if ( 0 == (pid = fork()) ) {
+        if ( NULL == freopen(log, "w", stdout) || -1 == dup2(fileno(stdout), fileno(stderr)) ) {
+            _exit( 127 );
+        }
+        execv( argv[ 0 ], argv );
+        fprintf(stderr, "ERROR :: can't run '%s' -- error %d, %s\n", argv[ 0 ], errno, strerror(errno));
+        _exit( 127 );
+    }
+    if ( -1 == pid || -1 == waitpid( pid, &status, 0 ) ) {
+        fprintf(stderr, "ERROR :: can't run '%s' -- error %d, %s\n", argv[ 0 ], errno, strerror(errno));
+        return ( RC_FALSE );
+    }
+
+    return ( (WIFEXITED(status) && 0 == WEXITSTATUS(status)) ? RC_TRUE : RC_FALSE );
+}
+
+
+/**
+ *******************************************************************************
+ * Just enough of a JSON reader for the run's totals in '--stats-json' (they
+ * are the keys at the top level, indented by two spaces).
+ */
+static rc_e read_stats( char const *const filename, bench_result_t *result )
+{
+    bench_keys_t  counts = { .cnt = 0 };
+    char const   *p;
+    size_t        len;
+    char         *json = read_textfile( filename, &len );
+
+    if ( NULL == json ) {
+        return ( RC_FALSE );
+    }
+
+    memset( result, '\0', sizeof (bench_result_t) );
+    if (   NULL == (p = find_run_key( json, "page_count" )) || 1 != sscanf(p, "%lf", &result->pages)
+        || NULL == (p = find_run_key( json, "wall_ms" ))    || 1 != sscanf(p, "%lf", &result->wall_ms)
+        || NULL == (p = find_run_key( json, "cpu_ms" ))     || 1 != sscanf(p, "%lf", &result->cpu_ms)
+        || NULL == (p = find_run_key( json, "phases_ms" ))  || 0 == read_object( p, &result->phases )
+        || NULL == (p = find_run_key( json, "fold_counts")) || 0 == read_object( p, &counts )
+       ) {
+        fprintf(stderr, "ERROR :: '%s' isn't a '--stats-json' report.\n", filename);
+        free( json );
+        return ( RC_FALSE );
+    }
+
+    for ( size_t ii = 0; ii < counts.cnt; ii++ ) {
+        if ( STR_MATCH == strcmp(counts.name[ ii ], "renders") ) {
+            result->renders = counts.value[ ii ];
+        }
+    }
+    free( json );
+
+    return ( RC_TRUE );
+}
+
+
+/**
+ *******************************************************************************
+ */
+static char const *find_run_key( char const *const json, char const *const key )
+{
+    char        needle[ 64 ];
+    char const *p;
+
+    snprintf(needle, sizeof (needle), "\n  \"%s\": ", key);
+    if ( NULL == (p = strstr(json, needle)) ) {
+        return ( NULL );
+    }
+
+    return ( p + strlen(needle) );
+}
+
+
+/**
+ *******************************************************************************
+ * A flat '{ "name": number, ... }', returns the # of keys read.
+ */
+static size_t read_object( char const *p, bench_keys_t *keys )
+{
+    int  n;
+
+    if ( '{' != *p++ ) {
+        return ( 0 );
+    }
+    for ( keys->cnt = 0; keys->cnt < BENCH_MAX_KEYS; keys->cnt++ ) {
+        if ( 2 != sscanf(p, " \"%31[^\"]\": %lf%n", keys->name[ keys->cnt ], &keys->value[ keys->cnt ], &n) ) {
+            break;
+        }
+        p += n;
+        if ( ',' == *p ) {
+            p++;
+        }
+    }
+
+    return ( keys->cnt );
+}
+
+
+/**
+ *******************************************************************************
+ */
+static void print_result( char const *const size, bench_result_t const *result )
+{
+
+    printf("%-6s :: %4.0f pages, %8.1f ms wall, %8.1f ms cpu, %6.2f pages/sec, %5.1f renders/page\n",
+           size, result->pages, result->wall_ms, result->cpu_ms,
+           (result->wall_ms > 0) ? 1000.0 * result->pages / result->wall_ms : 0.0,
+           (result->pages > 0) ? result->renders / result->pages : 0.0);
+    printf("%-6s    (the phases are summed over all of the threads, so they can add up to more than the wall time)\n", "");
+    for ( size_t ii = 0; ii < result->phases.cnt; ii++ ) {
+        printf("%-6s    %-12s %10.1f ms %5.1f%%\n", "", result->phases.name[ ii ], result->phases.value[ ii ],
+               (result->wall_ms > 0) ? 100.0 * result->phases.value[ ii ] / result->wall_ms : 0.0);
+    }
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * The baseline is a line per size and value --
+ *   1080p pages_per_sec 3.52
+ */
+static void save_baseline( FILE *file, char const *const size, bench_result_t const *result )
+{
+
+    fprintf(file, "%s pages_per_sec %.3f\n", size, (result->wall_ms > 0) ? 1000.0 * result->pages / result->wall_ms : 0.0);
+    fprintf(file, "%s wall_ms %.3f\n", size, result->wall_ms);
+    fprintf(file, "%s renders_per_page %.3f\n", size, (result->pages > 0) ? result->renders / result->pages : 0.0);
+    for ( size_t ii = 0; ii < result->phases.cnt; ii++ ) {
+        fprintf(file, "%s %s_ms %.3f\n", size, result->phases.name[ ii ], result->phases.value[ ii ]);
+    }
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+static void compare_baseline( char const *const filename, char const *const size, bench_result_t const *result )
+{
+    char    line[ 256 ];
+    char    b_size[ 32 ];
+    char    b_name[ 64 ];
+    double  b_value;
+    double  value;
+    FILE   *file = fopen(filename, "r");
+
+    if ( NULL == file ) {
+        printf("%-6s    (no baseline in '%s', see 'make bench-baseline')\n", "", filename);
+        return ;
+    }
+
+    while ( NULL != fgets(line, sizeof (line), file) ) {
+        if ( 3 != sscanf(line, "%31s %63s %lf", b_size, b_name, &b_value) || STR_MATCH != strcmp(b_size, size) ) {
+            continue;
+        }
+        if ( STR_MATCH == strcmp(b_name, "pages_per_sec") ) {
+            value = (result->wall_ms > 0) ? 1000.0 * result->pages / result->wall_ms : 0.0;
+        }
+        else if ( STR_MATCH == strcmp(b_name, "wall_ms") ) {
+            value = result->wall_ms;
+        }
+        else if ( STR_MATCH == strcmp(b_name, "renders_per_page") ) {
+            value = (result->pages > 0) ? result->renders / result->pages : 0.0;
+        }
+        else {
+            continue;  /* the phases are there for reference */
+        }
+        printf("%-6s    vs. baseline :: %-16s %10.3f -> %10.3f (%+.1f%%)\n", "", b_name, b_value, value,
+               (b_value > 0) ? 100.0 * (value - b_value) / b_value : 0.0);
+    }
+    fclose( file );
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+static int cmpr_wall_ms( void const *a, void const *b )
+{
+    double const x = ((bench_result_t const *) a)->wall_ms;
+    double const y = ((bench_result_t const *) b)->wall_ms;
+
+    return ( (x > y) - (x < y) );
+}
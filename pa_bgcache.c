@@ -0,0 +1,876 @@
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _GNU_SOURCE     /* asprintf() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "pa_misc.h"
+#include "pa_bgcache.h"
+
+#ifndef realloc
+#warning "realloc() is not a macro..."
+#endif
+
+#undef ST_MTIM
+#ifdef PA_ARCH_DARWIN
+   #define ST_MTIM( st_ )  ((st_).st_mtimespec)
+#else
+   #define ST_MTIM( st_ )  ((st_).st_mtim)  /* POSIX 2008 */
+#endif  /* PA_ARCH_DARWIN */
+
+/**
+ *******************************************************************************
+ * A decoded background image.  'last_used' is a tick from the cache's clock,
+ * the entry with the smallest tick is the one that's evicted.  The cache is
+ * locked since the '--jobs' workers share it, but NOT while an image is being
+ * read (two workers may both read a missing image, only the first is kept).
+ */
+typedef struct bg_entry_t {
+    char         *filename;
+    pa_image_t   *image;
+    size_t        size;
+    unsigned long last_used;
+} bg_entry_t;
+
+/**
+ *******************************************************************************
+ * An original image's comments, or why they couldn't be read ('comments' is
+ * NULL).  These are small, so they're never evicted.
+ */
+typedef struct cm_entry_t {
+    char         *filename;
+    comments_t   *comments;
+    char         *err_desc;
+} cm_entry_t;
+
+/**
+ *******************************************************************************
+ * A '--bg-cache-dir' frame file is this, the comments (a '\0' terminated key
+ * then its value, 'cnt' times), zeros up to 'data_offset' (a page boundary,
+ * so the pixels can be mapped on their own), then the RGB24 pixels.  Like a
+ * fold cache file, it's only ever read back on the same machine, so it's in
+ * the native byte order.
+ */
+typedef struct raw_header_t {
+    char      magic[ 8 ];  /* "PARGB" and the version */
+    uint64_t  key;
+    uint32_t  width;
+    uint32_t  height;
+    uint32_t  cnt;
+    uint32_t  comments_len;
+    uint64_t  data_offset;
+} raw_header_t;
+
+#undef PA_RAWCACHE_VERSION
+#define PA_RAWCACHE_VERSION  (1)
+
+#undef PA_RAWCACHE_ALIGN
+#define PA_RAWCACHE_ALIGN  (4096)
+
+/**
+ *******************************************************************************
+ * What 'save_raw_image()' hands to 'write_raw_image()'.
+ */
+typedef struct raw_file_t {
+    raw_header_t       header;
+    comments_t        *comments;
+    pa_image_t const  *image;
+    size_t             size;
+} raw_file_t;
+
+/**
+ *******************************************************************************
+ * A '--prefetch' background, decoded (or being decoded) for the page 'seq'
+ * of the render sequence.  The slots are all for different backgrounds.  If
+ * it couldn't be decoded, 'image' is NULL and the page decodes it (and says
+ * why it can't), the slot just keeps the helper from trying it again.
+ */
+typedef struct pf_slot_t {
+    char const   *filename;  /* one of 'pf.filenames' */
+    size_t        seq;
+    pa_image_t   *image;
+    size_t        size;
+    int           busy;      /* it's being decoded */
+} pf_slot_t;
+
+struct pa_bgcache_t {
+    size_t        budget;   /* in bytes, 0 :: don't cache */
+    size_t        used;
+    size_t        bytes_read;  /* from the image files */
+    unsigned long clock;
+    bg_filter_t   filter;
+    char         *raw_dir;  /* '--bg-cache-dir', NULL :: none */
+
+    bg_entry_t   *entries;
+    unsigned int  cnt;
+    unsigned int  max;
+
+    cm_entry_t   *cm_entries;
+    unsigned int  cm_cnt;
+    unsigned int  cm_max;
+
+            /**
+             ******************************************************************
+             * '--prefetch' :: the helper thread decodes the backgrounds of
+             * the next 'depth' pages after the page 'seq' into the 'slots',
+             * while 'used' (with the one being decoded) is under 'budget'.
+             * 'cond' is signalled whenever any of this changes.
+             */
+    struct {
+        pthread_t       thread;
+        pthread_cond_t  cond;
+        int             running;
+        int             quit;
+        strptrary_t     filenames;  /* the render sequence is 'seq % cnt' */
+        unsigned int    depth;
+        size_t          budget;
+        size_t          used;
+        size_t          est;        /* the last background's size */
+        int             started;    /* 'seq' is set */
+        size_t          seq;
+        pf_slot_t      *slots;      /* 'depth' of them */
+        unsigned int    slot_cnt;
+    } pf;
+
+    pthread_mutex_t lock;
+};
+
+static void evict_bg_entry( pa_bgcache_t *, unsigned int idx );
+static rc_e read_bg_image( pa_bgcache_t *, char const *const filename, char const *const *keys, pa_image_t **imagep );
+static uint64_t get_raw_key( pa_bgcache_t *, char const *const filename );
+static rc_e load_raw_image( char const *const raw_name, uint64_t key, pa_image_t **imagep );
+static rc_e save_raw_image( char const *const raw_name, uint64_t key, pa_image_t const *image );
+static rc_e write_raw_image( FILE *, void * );
+static void *prefetch_thread( void *arg );
+static int  find_pf_slot( pa_bgcache_t *, char const *const filename );
+static void drop_pf_slot( pa_bgcache_t *, int idx );
+
+
+/**
+ *******************************************************************************
+ */
+pa_bgcache_t *new_pa_bgcache( size_t budget_mb, bg_filter_t const *filter, char const *const raw_dir )
+{
+    pa_bgcache_t *bgcache = calloc( 1, sizeof (pa_bgcache_t) );
+
+    bgcache->budget  = budget_mb << 20;
+    bgcache->filter  = *filter;
+    bgcache->raw_dir = (NULL == raw_dir) ? NULL : strdup( raw_dir );
+    bgcache->entries = NULL;
+    bgcache->cm_entries = NULL;
+    bgcache->pf.running = 0;
+    pthread_mutex_init( &bgcache->lock, NULL );
+
+    return ( bgcache );
+}
+
+
+/**
+ *******************************************************************************
+ * Return (in 'imagep') a copy of the decoded (and filtered) background image
+ * 'filename' that the caller owns, reading and caching the image if it's not
+ * already cached.
+ *
+ * If the image can't be read, then the return and 'imagep' are the same as
+ * from 'read_png_image()' (i.e., 'imagep' may have the error's description).
+ * If there's no memory for the copy, RC_FALSE is returned and 'imagep' is NULL.
+ */
+rc_e get_bgcache_image( pa_bgcache_t *bgcache, char const *const filename, char const *const *keys, pa_image_t **imagep )
+{
+    struct {
+        pa_image_t  *image;
+        size_t       size;
+        unsigned int idx;
+        unsigned int lru;
+        int          pf_idx;
+        rc_e         rc;
+    } w = {
+        .image = NULL,
+    };
+
+
+    pthread_mutex_lock( &bgcache->lock );
+    for ( w.idx = 0; w.idx < bgcache->cnt; w.idx++ ) {
+        if ( STR_MATCH == strcmp( filename, bgcache->entries[ w.idx ].filename ) ) {
+            bgcache->entries[ w.idx ].last_used = ++bgcache->clock;
+            *imagep = clone_pa_image( bgcache->entries[ w.idx ].image );
+            pthread_mutex_unlock( &bgcache->lock );
+
+            return ( (NULL != *imagep) ? RC_TRUE : RC_FALSE );
+        }
+    }
+
+    /*
+     ***************************************************************************
+     * Prefetched?  Then wait for it if it's still being decoded, and take it.
+     */
+    while ( -1 != (w.pf_idx = find_pf_slot( bgcache, filename )) && bgcache->pf.slots[ w.pf_idx ].busy ) {
+        pthread_cond_wait( &bgcache->pf.cond, &bgcache->lock );
+    }
+    if ( -1 != w.pf_idx ) {
+        w.image = bgcache->pf.slots[ w.pf_idx ].image;
+        bgcache->pf.slots[ w.pf_idx ].image = NULL;
+        drop_pf_slot( bgcache, w.pf_idx );
+    }
+    pthread_mutex_unlock( &bgcache->lock );
+
+    if ( NULL == w.image ) {
+        w.rc = read_bg_image( bgcache, filename, keys, &w.image );
+        if ( RC_TRUE != w.rc ) {
+            *imagep = w.image;
+            return ( w.rc );
+        }
+
+        pthread_mutex_lock( &bgcache->lock );
+        bgcache->bytes_read += get_image_file_bytes( w.image );
+        pthread_mutex_unlock( &bgcache->lock );
+    }
+
+    /*
+     ***************************************************************************
+     * Too big to ever fit (or caching is off)?  Then the caller can have it.
+     */
+    w.size = get_image_data_size( w.image );
+    if ( w.size > bgcache->budget ) {
+        *imagep = w.image;
+        return ( RC_TRUE );
+    }
+
+    pthread_mutex_lock( &bgcache->lock );
+    for ( w.idx = 0; w.idx < bgcache->cnt; w.idx++ ) {
+        if ( STR_MATCH == strcmp( filename, bgcache->entries[ w.idx ].filename ) ) {
+            pthread_mutex_unlock( &bgcache->lock );  /* another worker's read */
+
+            *imagep = w.image;
+            return ( RC_TRUE );
+        }
+    }
+
+    while ( bgcache->used + w.size > bgcache->budget ) {
+        w.lru = 0;
+        for ( w.idx = 1; w.idx < bgcache->cnt; w.idx++ ) {
+            if ( bgcache->entries[ w.idx ].last_used < bgcache->entries[ w.lru ].last_used ) {
+                w.lru = w.idx;
+            }
+        }
+        evict_bg_entry( bgcache, w.lru );
+    }
+
+    if ( bgcache->cnt == bgcache->max ) {
+        bgcache->max += 16;
+        bgcache->entries = realloc( bgcache->entries, bgcache->max * sizeof (bg_entry_t) );
+    }
+    bgcache->entries[ bgcache->cnt++ ] = (bg_entry_t) {
+        .filename  = strdup( filename ),
+        .image     = w.image,
+        .size      = w.size,
+        .last_used = ++bgcache->clock,
+    };
+    bgcache->used += w.size;
+
+    *imagep = clone_pa_image( w.image );
+    pthread_mutex_unlock( &bgcache->lock );
+
+    return ( (NULL != *imagep) ? RC_TRUE : RC_FALSE );
+}
+
+
+/**
+ *******************************************************************************
+ * '--prefetch=K[,MB]' :: start the helper thread that decodes the backgrounds
+ * of the next 'depth' pages (see 'prefetch_bgcache()'), holding no more than
+ * 'budget_mb' of them (but always at least one).  The render sequence is the
+ * 'filenames' over and over.  The backgrounds are read with the IGNORE_KEYS,
+ * the same as the backgrounds that aren't prefetched.
+ */
+void start_bgcache_prefetch( pa_bgcache_t *bgcache, char const *const *filenames, size_t cnt, unsigned depth, size_t budget_mb )
+{
+
+    if ( 0 == depth || 0 == cnt || bgcache->pf.running ) {
+        return ;
+    }
+
+    bgcache->pf.filenames = (strptrary_t) { .pathnames = NULL, };
+    for ( size_t idx = 0; idx < cnt; idx++ ) {
+        add_strptrary( &bgcache->pf.filenames, filenames[ idx ] );
+    }
+    bgcache->pf.depth    = depth;
+    bgcache->pf.budget   = budget_mb << 20;
+    bgcache->pf.used     = 0;
+    bgcache->pf.est      = 0;
+    bgcache->pf.quit     = 0;
+    bgcache->pf.started  = 0;
+    bgcache->pf.slots    = calloc( depth, sizeof (pf_slot_t) );
+    bgcache->pf.slot_cnt = 0;
+    pthread_cond_init( &bgcache->pf.cond, NULL );
+
+    if ( 0 == pthread_create( &bgcache->pf.thread, NULL, prefetch_thread, bgcache ) ) {
+        bgcache->pf.running = 1;
+    }
+    else {
+        fprintf(stderr, "WARNING :: can't start the '--prefetch' thread, NOT prefetching.\n");
+        cleanup_strptrary( &bgcache->pf.filenames );
+        (free)( bgcache->pf.slots );
+        pthread_cond_destroy( &bgcache->pf.cond );
+    }
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * The page 'seq' of the render sequence is about to get its background, so
+ * the helper can drop what it prefetched for the pages before it and move on
+ * to the pages after it.  Does nothing if there's no '--prefetch'.
+ */
+void prefetch_bgcache( pa_bgcache_t *bgcache, size_t seq )
+{
+
+    if ( bgcache->pf.running ) {
+        pthread_mutex_lock( &bgcache->lock );
+        bgcache->pf.seq     = seq;
+        bgcache->pf.started = 1;
+        pthread_cond_broadcast( &bgcache->pf.cond );
+        pthread_mutex_unlock( &bgcache->lock );
+    }
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * The '--prefetch' helper.  The next page whose background isn't already
+ * cached or prefetched is decoded (unlocked), unless the slots are full.
+ */
+static void *prefetch_thread( void *arg )
+{
+    pa_bgcache_t *bgcache = arg;
+    struct {
+        char const  *filename;
+        size_t       seq;
+        pa_image_t  *image;
+        int          idx;
+        rc_e         rc;
+    } w;
+
+
+    pthread_mutex_lock( &bgcache->lock );
+    while ( 0 == bgcache->pf.quit ) {
+
+        /*
+         ***********************************************************************
+         * Drop what's been passed by (i.e., was in the cache after all).
+         */
+        for ( w.idx = bgcache->pf.slot_cnt - 1; w.idx >= 0; w.idx-- ) {
+            if ( bgcache->pf.slots[ w.idx ].seq < bgcache->pf.seq && 0 == bgcache->pf.slots[ w.idx ].busy ) {
+                drop_pf_slot( bgcache, w.idx );
+            }
+        }
+
+        w.filename = NULL;
+        if ( bgcache->pf.started && bgcache->pf.slot_cnt < bgcache->pf.depth
+                && (0 == bgcache->pf.slot_cnt || bgcache->pf.used + bgcache->pf.est <= bgcache->pf.budget) ) {
+            for ( w.seq = bgcache->pf.seq + 1; w.seq <= bgcache->pf.seq + bgcache->pf.depth; w.seq++ ) {
+                w.filename = bgcache->pf.filenames.pathnames[ w.seq % bgcache->pf.filenames.cnt ];
+                for ( w.idx = 0; w.idx < (int) bgcache->cnt; w.idx++ ) {
+                    if ( STR_MATCH == strcmp( w.filename, bgcache->entries[ w.idx ].filename ) ) {
+                        break;
+                    }
+                }
+                if ( w.idx == (int) bgcache->cnt && -1 == find_pf_slot( bgcache, w.filename ) ) {
+                    break;
+                }
+                w.filename = NULL;
+            }
+        }
+        if ( NULL == w.filename ) {
+            pthread_cond_wait( &bgcache->pf.cond, &bgcache->lock );
+            continue;
+        }
+
+        bgcache->pf.slots[ bgcache->pf.slot_cnt++ ] = (pf_slot_t) {
+            .filename = w.filename,
+            .seq      = w.seq,
+            .image    = NULL,
+            .size     = bgcache->pf.est,
+            .busy     = 1,
+        };
+        bgcache->pf.used += bgcache->pf.est;
+        pthread_mutex_unlock( &bgcache->lock );
+
+        w.image = NULL;
+        w.rc = read_bg_image( bgcache, w.filename, IGNORE_KEYS, &w.image );
+
+        pthread_mutex_lock( &bgcache->lock );
+        w.idx = find_pf_slot( bgcache, w.filename );
+        bgcache->pf.slots[ w.idx ].busy = 0;
+        if ( RC_TRUE == w.rc ) {
+            bgcache->bytes_read += get_image_file_bytes( w.image );
+            bgcache->pf.est      = get_image_data_size( w.image );
+            bgcache->pf.used    += bgcache->pf.est - bgcache->pf.slots[ w.idx ].size;
+            bgcache->pf.slots[ w.idx ].size  = bgcache->pf.est;
+            bgcache->pf.slots[ w.idx ].image = w.image;
+        }
+        else {
+            cleanup_pa_image( &w.image );
+            bgcache->pf.used -= bgcache->pf.slots[ w.idx ].size;
+            bgcache->pf.slots[ w.idx ].size = 0;
+        }
+        pthread_cond_broadcast( &bgcache->pf.cond );
+    }
+    pthread_mutex_unlock( &bgcache->lock );
+
+    return ( NULL );
+}
+
+
+/**
+ *******************************************************************************
+ * The prefetch slot for 'filename', or -1.  The cache must be locked.
+ */
+static int find_pf_slot( pa_bgcache_t *bgcache, char const *const filename )
+{
+
+    for ( unsigned int idx = 0; idx < bgcache->pf.slot_cnt; idx++ ) {
+        if ( STR_MATCH == strcmp( filename, bgcache->pf.slots[ idx ].filename ) ) {
+            return ( idx );
+        }
+    }
+
+    return ( -1 );
+}
+
+
+/**
+ *******************************************************************************
+ * Remove the prefetch slot 'idx' (and its image, if it's still there).  The
+ * cache must be locked.
+ */
+static void drop_pf_slot( pa_bgcache_t *bgcache, int idx )
+{
+    pf_slot_t *slot = &bgcache->pf.slots[ idx ];
+
+    bgcache->pf.used -= slot->size;
+    cleanup_pa_image( &slot->image );
+
+    bgcache->pf.slot_cnt--;
+    bgcache->pf.slots[ idx ] = bgcache->pf.slots[ bgcache->pf.slot_cnt ];
+    pthread_cond_broadcast( &bgcache->pf.cond );
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * Read (and filter) the background 'filename'.  With a '--bg-cache-dir', its
+ * frame file is used if there's one, else it's decoded and its frame saved
+ * for the next run.
+ */
+static rc_e read_bg_image( pa_bgcache_t *bgcache, char const *const filename, char const *const *keys, pa_image_t **imagep )
+{
+    struct {
+        char      *raw_name;
+        uint64_t   key;
+        rc_e       rc;
+    } w = {
+        .raw_name = NULL,
+        .key      = 0,
+    };
+
+
+    if ( NULL != bgcache->raw_dir && 0 != (w.key = get_raw_key( bgcache, filename )) ) {
+        asprintf(&w.raw_name, "%s%s%016" PRIx64 ".rgb24", bgcache->raw_dir, PA_PATH_SEP, w.key);
+        if ( RC_TRUE == load_raw_image( w.raw_name, w.key, imagep ) ) {
+            (free)( w.raw_name );
+            return ( RC_TRUE );
+        }
+    }
+
+    w.rc = read_png_image( filename, imagep, keys, READ_WHOLE_IMAGE );
+    if ( RC_TRUE == w.rc && 0 != bgcache->filter.colorize ) {
+        w.rc = colorize_pa_image( *imagep, bgcache->filter.rgb, bgcache->filter.colorize );
+    }
+    if ( RC_TRUE == w.rc && NULL != w.raw_name ) {
+        save_raw_image( w.raw_name, w.key, *imagep );
+    }
+    (free)( w.raw_name );
+
+    return ( w.rc );
+}
+
+
+/**
+ *******************************************************************************
+ * A frame file's key, a hash of the background's real path, its size and
+ * mtime (so an edited background is decoded again), and the filter.  Returns
+ * 0 if the background can't be stat()ed, then it's just decoded.
+ */
+static uint64_t get_raw_key( pa_bgcache_t *bgcache, char const *const filename )
+{
+    struct {
+        char         path[ PATH_MAX ];
+        struct stat  st;
+        uint64_t     key;
+        uint32_t     version;
+    } w = {
+        .key     = FNV1A_64_INIT,
+        .version = PA_RAWCACHE_VERSION,
+    };
+
+
+    if ( NULL == realpath( filename, w.path ) || 0 != stat( w.path, &w.st ) ) {
+        return ( 0 );
+    }
+
+    w.key = fnv1a_64( w.key, &w.version, sizeof (w.version) );
+    w.key = fnv1a_64( w.key, w.path, strlen( w.path ) + 1 );
+    w.key = fnv1a_64( w.key, &w.st.st_size, sizeof (w.st.st_size) );
+    w.key = fnv1a_64( w.key, &ST_MTIM( w.st ).tv_sec, sizeof (ST_MTIM( w.st ).tv_sec) );
+    w.key = fnv1a_64( w.key, &ST_MTIM( w.st ).tv_nsec, sizeof (ST_MTIM( w.st ).tv_nsec) );
+    w.key = fnv1a_64( w.key, &bgcache->filter.colorize, sizeof (bgcache->filter.colorize) );
+    w.key = fnv1a_64( w.key, bgcache->filter.rgb, sizeof (bgcache->filter.rgb) );
+
+    return ( w.key );
+}
+
+
+/**
+ *******************************************************************************
+ * mmap() the frame file (read-only and shared, so every pngass that's using
+ * it shares the page cache) and copy its pixels into a new image.  Returns
+ * RC_TRUE if there's a file for 'key' and it's whole.
+ */
+static rc_e load_raw_image( char const *const raw_name, uint64_t key, pa_image_t **imagep )
+{
+    struct {
+        int                  fd;
+        struct stat          st;
+        unsigned char       *map;
+        raw_header_t const  *header;
+        char const          *kv;
+        char const          *kv_end;
+        comments_t          *comments;
+        rc_e                 rc;
+    } w = {
+        .map      = MAP_FAILED,
+        .comments = NULL,
+        .rc       = RC_FALSE,
+    };
+
+
+    if ( -1 == (w.fd = open( raw_name, O_RDONLY )) ) {
+        return ( RC_FALSE );
+    }
+
+    if ( 0 == fstat( w.fd, &w.st ) && (size_t) w.st.st_size >= sizeof (raw_header_t) ) {
+        w.map = mmap( NULL, w.st.st_size, PROT_READ, MAP_SHARED, w.fd, 0 );
+    }
+    close( w.fd );
+
+    if ( MAP_FAILED != w.map )
+    do {
+        char magic[ 8 ] = { '\0' };
+
+        w.header = (raw_header_t const *) w.map;
+        snprintf(magic, sizeof (magic), "PARGB%c", '0' + PA_RAWCACHE_VERSION);
+        if (   0 != memcmp( w.header->magic, magic, sizeof (magic) )
+            || w.header->key != key
+            || 0 == w.header->width || w.header->width > 65535
+            || 0 == w.header->height || w.header->height > 65535
+            || w.header->data_offset < sizeof (raw_header_t) + w.header->comments_len
+            || (uint64_t) w.st.st_size != w.header->data_offset + (uint64_t) w.header->width * 3 * w.header->height
+           ) {
+            break;
+        }
+
+        w.kv     = (char const *) (w.header + 1);
+        w.kv_end = w.kv + w.header->comments_len;
+        w.comments = calloc( 1, sizeof (comments_t) );
+        for ( uint32_t idx = 0; idx < w.header->cnt; idx++ ) {
+            char const *val;
+
+            if ( NULL == (val = memchr( w.kv, '\0', w.kv_end - w.kv )) || w.kv_end == ++val
+                    || NULL == memchr( val, '\0', w.kv_end - val ) ) {
+                break;
+            }
+            add_comments( w.comments, w.kv, val );
+            w.kv = val + strlen( val ) + 1;
+        }
+        if ( w.comments->cnt != w.header->cnt ) {
+            cleanup_comments( &w.comments );
+            break;
+        }
+
+        madvise( w.map, w.st.st_size, MADV_SEQUENTIAL );
+        *imagep = new_rgb24_image( w.header->width, w.header->height, w.map + w.header->data_offset,
+                                   w.comments, w.st.st_size - w.header->data_offset );
+        w.rc = (NULL != *imagep) ? RC_TRUE : RC_FALSE;
+    } while ( 0 );
+
+    if ( MAP_FAILED != w.map ) {
+        munmap( w.map, w.st.st_size );
+    }
+    if ( RC_TRUE != w.rc ) {
+        fprintf(stderr, "WARNING :: ignoring '%s', it's not a valid background cache file.\n", raw_name);
+    }
+
+    return ( w.rc );
+}
+
+
+/**
+ *******************************************************************************
+ * Write the frame file (see 'write_file_renamed()', a reader never sees a
+ * partial file).
+ */
+static rc_e save_raw_image( char const *const raw_name, uint64_t key, pa_image_t const *image )
+{
+    struct {
+        raw_file_t     file;
+        rc_e           rc;
+    } w = {
+        .file = {
+            .comments = get_png_comments( image ),
+            .image    = image,
+            .size     = get_image_data_size( image ),
+        },
+    };
+    raw_header_t *header = &w.file.header;
+
+
+    memset( header, '\0', sizeof (raw_header_t) );
+    snprintf(header->magic, sizeof (header->magic), "PARGB%c", '0' + PA_RAWCACHE_VERSION);
+    header->key    = key;
+    header->width  = get_image_width( (pa_image_t *) image );
+    header->height = get_image_height( (pa_image_t *) image );
+    header->cnt    = (NULL == w.file.comments) ? 0 : w.file.comments->cnt;
+    for ( uint32_t idx = 0; idx < header->cnt; idx++ ) {
+        header->comments_len += strlen( w.file.comments->kvs[ idx ].key ) + 1 + strlen( w.file.comments->kvs[ idx ].val ) + 1;
+    }
+    header->data_offset = (sizeof (raw_header_t) + header->comments_len + PA_RAWCACHE_ALIGN - 1)
+                                                 / PA_RAWCACHE_ALIGN * PA_RAWCACHE_ALIGN;
+
+    w.rc = write_file_renamed( raw_name, write_raw_image, &w.file );
+    if ( RC_TRUE != w.rc ) {
+        fprintf(stderr, "WARNING :: can't write the background cache file '%s'.\n", raw_name);
+    }
+
+    return ( w.rc );
+}
+
+
+/**
+ *******************************************************************************
+ */
+static rc_e write_raw_image( FILE *file, void *data )
+{
+    raw_file_t const *raw_file = data;
+
+    if ( 1 != fwrite( &raw_file->header, sizeof (raw_header_t), 1, file ) ) {
+        return ( RC_FALSE );
+    }
+    for ( uint32_t idx = 0; idx < raw_file->header.cnt; idx++ ) {
+        char const *key = raw_file->comments->kvs[ idx ].key;
+        char const *val = raw_file->comments->kvs[ idx ].val;
+
+        if (   1 != fwrite( key, strlen( key ) + 1, 1, file )
+            || 1 != fwrite( val, strlen( val ) + 1, 1, file )
+           ) {
+            return ( RC_FALSE );
+        }
+    }
+    if (   0 == fseek( file, raw_file->header.data_offset, SEEK_SET )
+        && raw_file->size == fwrite( get_image_data( raw_file->image ), 1, raw_file->size, file )
+       ) {
+        return ( RC_TRUE );
+    }
+
+    return ( RC_FALSE );
+}
+
+
+/**
+ *******************************************************************************
+ * Return (in 'commentsp') a copy of the comments of the image 'filename' that
+ * the caller owns, reading only its text chunks the first time it's asked for.
+ *
+ * If the comments can't be read, RC_FALSE is returned (every time) and, if
+ * 'err_descp' isn't NULL, a copy of the reason that the caller owns.
+ */
+rc_e get_bgcache_comments( pa_bgcache_t *bgcache, char const *const filename, char const *const *keys,
+                           comments_t **commentsp, char **err_descp )
+{
+    auto rc_e found( cm_entry_t const * );
+    struct {
+        pa_image_t  *image;
+        cm_entry_t   entry;
+        unsigned int idx;
+        rc_e         rc;
+    } w = {
+        .image = NULL,
+    };
+
+
+    pthread_mutex_lock( &bgcache->lock );
+    for ( w.idx = 0; w.idx < bgcache->cm_cnt; w.idx++ ) {
+        if ( STR_MATCH == strcmp( filename, bgcache->cm_entries[ w.idx ].filename ) ) {
+            w.rc = found( &bgcache->cm_entries[ w.idx ] );
+            pthread_mutex_unlock( &bgcache->lock );
+
+            return ( w.rc );
+        }
+    }
+    pthread_mutex_unlock( &bgcache->lock );
+
+    w.rc = read_png_image( filename, &w.image, keys, READ_ONLY_COMMENTS );
+    w.entry = (cm_entry_t) {
+        .filename = strdup( filename ),
+        .comments = (RC_TRUE == w.rc) ? dup_comments( get_png_comments( w.image ) ) : NULL,
+        .err_desc = strdup( (RC_TRUE == w.rc || NULL == get_err_desc( w.image )) ? "" : get_err_desc( w.image ) ),
+    };
+
+    pthread_mutex_lock( &bgcache->lock );
+    if ( NULL != w.image ) {
+        bgcache->bytes_read += get_image_file_bytes( w.image );
+    }
+    cleanup_pa_image( &w.image );
+
+    for ( w.idx = 0; w.idx < bgcache->cm_cnt; w.idx++ ) {
+        if ( STR_MATCH == strcmp( filename, bgcache->cm_entries[ w.idx ].filename ) ) {
+            break;  /* another worker's read */
+        }
+    }
+    if ( w.idx == bgcache->cm_cnt ) {
+        if ( bgcache->cm_cnt == bgcache->cm_max ) {
+            bgcache->cm_max += 16;
+            bgcache->cm_entries = realloc( bgcache->cm_entries, bgcache->cm_max * sizeof (cm_entry_t) );
+        }
+        bgcache->cm_entries[ bgcache->cm_cnt++ ] = w.entry;
+    }
+    else {
+        (free)( w.entry.filename );
+        cleanup_comments( &w.entry.comments );
+        (free)( w.entry.err_desc );
+    }
+
+    w.rc = found( &bgcache->cm_entries[ w.idx ] );
+    pthread_mutex_unlock( &bgcache->lock );
+
+    return ( w.rc );
+
+    rc_e found( cm_entry_t const *entry )
+    {
+        if ( NULL == entry->comments ) {
+            *commentsp = NULL;
+            if ( NULL != err_descp ) {
+                *err_descp = strdup( entry->err_desc );
+            }
+            return ( RC_FALSE );
+        }
+
+        *commentsp = dup_comments( entry->comments );
+        return ( RC_TRUE );
+    }
+}
+
+
+/**
+ *******************************************************************************
+ * The # of bytes read from the background image files so far.
+ */
+size_t get_bgcache_bytes_read( pa_bgcache_t *bgcache )
+{
+    size_t bytes_read;
+
+    pthread_mutex_lock( &bgcache->lock );
+    bytes_read = bgcache->bytes_read;
+    pthread_mutex_unlock( &bgcache->lock );
+
+    return ( bytes_read );
+}
+
+
+/**
+ *******************************************************************************
+ */
+static void evict_bg_entry( pa_bgcache_t *bgcache, unsigned int idx )
+{
+    bg_entry_t *entry = &bgcache->entries[ idx ];
+
+    bgcache->used -= entry->size;
+    cleanup_pa_image( &entry->image );
+    (free)( entry->filename );
+
+    bgcache->cnt--;
+    bgcache->entries[ idx ] = bgcache->entries[ bgcache->cnt ];
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+void cleanup_pa_bgcache( pa_bgcache_t **p_bgcache )
+{
+    pa_bgcache_t *bgcache = *p_bgcache;
+
+    if ( NULL != bgcache ) {
+        if ( bgcache->pf.running ) {
+            pthread_mutex_lock( &bgcache->lock );
+            bgcache->pf.quit = 1;
+            pthread_cond_broadcast( &bgcache->pf.cond );
+            pthread_mutex_unlock( &bgcache->lock );
+            pthread_join( bgcache->pf.thread, NULL );
+
+            while ( bgcache->pf.slot_cnt > 0 ) {
+                drop_pf_slot( bgcache, bgcache->pf.slot_cnt - 1 );
+            }
+            (free)( bgcache->pf.slots );
+            cleanup_strptrary( &bgcache->pf.filenames );
+            pthread_cond_destroy( &bgcache->pf.cond );
+        }
+
+        while ( bgcache->cnt > 0 ) {
+            evict_bg_entry( bgcache, bgcache->cnt - 1 );
+        }
+        (free)( bgcache->entries );
+
+        for ( unsigned int idx = 0; idx < bgcache->cm_cnt; idx++ ) {
+            (free)( bgcache->cm_entries[ idx ].filename );
+            cleanup_comments( &bgcache->cm_entries[ idx ].comments );
+            (free)( bgcache->cm_entries[ idx ].err_desc );
+        }
+        (free)( bgcache->cm_entries );
+        (free)( bgcache->raw_dir );
+        pthread_mutex_destroy( &bgcache->lock );
+
+        free( *p_bgcache );
+    }
+
+    return ;
+}
@@ -0,0 +1,77 @@
+#ifndef PA_BGCACHE_H
+#define PA_BGCACHE_H
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ *******************************************************************************
+ * The decoded background image cache.
+ *
+ * The pages cycle through the same handful of background images, so rather
+ * than inflating the PNG for every page, keep the decoded image and give each
+ * page a copy of it to blend into (see 'clone_pa_image()').  The cache holds
+ * up to 'budget_mb' of decoded pixels and evicts the least recently used
+ * image when it needs the room.
+ *
+ * It also keeps the comments of the '--original-dir' images (by path, for the
+ * whole run), so an original is only read once however many pages use it.
+ *
+ * The '--background-filter' is applied as an image is read, so the cached
+ * image is already filtered and each background is only filtered once.
+ *
+ * With a '--bg-cache-dir', each decoded (and filtered) background is also
+ * saved there as a raw RGB24 frame file, keyed by the background's path,
+ * size, mtime and the filter.  Later runs mmap() the frame instead of
+ * decoding the background again.  Nothing in the directory is ever removed,
+ * a frame of an edited background just isn't used anymore.
+ *
+ * With a '--prefetch', a helper thread decodes the backgrounds of the next
+ * few pages (the render sequence is known, see 'prefetch_bgcache()') while
+ * the current page is rendered, for when there are too many backgrounds to
+ * cache them all.
+ */
+#include <ass/ass.h>
+
+#include "pa_misc.h"       /* for 'rc_e' */
+#include "rw_arrays.h"
+#include "rw_imagefile.h"
+
+#undef PA_BGCACHE_DEFAULT_MB
+#define PA_BGCACHE_DEFAULT_MB  (256)  /* about 40 1080p backgrounds */
+
+#undef PA_PREFETCH_DEFAULT_MB
+#define PA_PREFETCH_DEFAULT_MB  (128)  /* about 5 4K backgrounds */
+
+typedef struct pa_bgcache_t pa_bgcache_t;
+
+/**
+ *******************************************************************************
+ * '--background-filter=colorize=COLOUR:PERCENT%', see 'colorize_pa_image()'.
+ */
+typedef struct bg_filter_t {
+    unsigned       colorize;   /* percent, 0 :: no filter */
+    unsigned char  rgb[ 3 ];
+} bg_filter_t;
+
+pa_bgcache_t *new_pa_bgcache    ( size_t budget_mb, bg_filter_t const *filter, char const *const raw_dir );
+rc_e          get_bgcache_image ( pa_bgcache_t *, char const *const filename, char const *const *keys, pa_image_t **imagep );
+rc_e          get_bgcache_comments( pa_bgcache_t *, char const *const filename, char const *const *keys,
+                                    comments_t **commentsp, char **err_descp );
+size_t        get_bgcache_bytes_read( pa_bgcache_t * );
+void          start_bgcache_prefetch( pa_bgcache_t *, char const *const *filenames, size_t cnt, unsigned depth, size_t budget_mb );
+void          prefetch_bgcache  ( pa_bgcache_t *, size_t seq );
+void          cleanup_pa_bgcache( pa_bgcache_t ** );
+
+#endif  /* PA_BGCACHE_H */
@@ -61,11 +61,27 @@
 #endif
 
 
-static char  *do_pair_substitution(char *in_buf, unsigned int idx, unsigned short r_level,
+/**
+ *******************************************************************************
+ * The edits are written to one of these as it's built, so that an edit costs
+ * (at most) a move of the rest of the current line, NOT the rest of the text.
+ * Always '\0' terminated, 'len' doesn't include it.
+ */
+typedef struct edit_buf_t {
+    char   *str;
+    size_t  len;
+    size_t  sz;
+} edit_buf_t;
+
+static void   edit_reserve (edit_buf_t *, size_t len);
+static void   edit_append  (edit_buf_t *, char const *str, size_t len);
+static void   edit_replace (edit_buf_t *, size_t idx, size_t old_len, char const *val, size_t len);
+
+static void   do_pair_substitution(edit_buf_t *, size_t idx, unsigned short r_level,
                                    key_values_t const *const, int *const);
 #undef do_pair_substitution
-#define       do_pair_substitution( root,   idx,      kv,   p_cnt )  \
-              do_pair_substitution((root), (idx), 0, (kv), (p_cnt))
+#define       do_pair_substitution( buf,   idx,      kv,   p_cnt )  \
+              do_pair_substitution((buf), (idx), 0, (kv), (p_cnt))
 
 static char  *apply_two_spaces    (char *, char const *const ends, char const *const *exceptions, int *const);
 static char  *do_quote_urban_words(char *, key_values_t const *const, size_t idx, int *const);
@@ -74,6 +90,51 @@ static rc_e   srch_fchrs(char const *const key, char const *const *keys, char co
 static rc_e   srch_bchrs(char const *const key, char const *const *keys, char const *const str, size_t idx);
 static size_t strfchars(char const *const *keys, char const *const str, size_t idx);
 
+/**
+ *******************************************************************************
+ * The line by line rules, in the order that they're applied (which matters,
+ * e.g., the SINGLE quote pairs have to be found before the contractions).
+ */
+typedef struct line_rule_t {
+    attr_edits_e        bit;
+    key_values_t const *kv;
+} line_rule_t;
+
+static line_rule_t const line_rules[] = {
+      /*
+       * Wide SPACEs are a nuisance since libass won't split the line on them
+       * (which are _different_ than a non-breaking SPACE).
+       */
+    { AE_WIDE_SPACE,        &replace_wide_space },
+    { AE_DOUBLE_DASH,       &replace_double_dash },      /* '--' :: a heavier dash (aesthetic) */
+    { AE_SQUOTE_SPACING,    &fix_squotes_spacing },      /* "','" -> "', '" */
+    { AE_SQUOTE_PAIRS,      &single_quote_pairs },
+    { AE_YOU_KNOW,          &y_know_apostrophe },        /* y'can  n'all  d'ya  s'long  yarr'~  y'hear? */
+    { AE_DQUOTE_PAIRS,      &double_quote_pairs },
+    { AE_DQUOTE_PAIRS,      &double_quote_pairs_2 },
+    { AE_CONTRACTIONS,      &most_contractions },        /* don't, can't, they're, etc. */
+    { AE_PLURAL_POSSESSIVE, &plural_possessive_noun },
+    { AE_URBAN_OTHER,       &hafta_yappin_apostrophe },  /* hafta'  ta'  eno'  tru'  eh'  yer'  yappin'! */
+    { AE_EMOJI,             &emoji_happy },              /* (this is incomplete at this point) */
+    { AE_EMOJI,             &emoji_sad },
+};
+
+#undef LINE_RULES_CNT
+#define LINE_RULES_CNT  (sizeof (line_rules) / sizeof (line_rules[ 0 ]))
+
+/**
+ *******************************************************************************
+ * The enabled 'line_rules[]' keys, by their first byte.  'stops' is all of
+ * those first bytes (and '\n'), for strcspn() to skip everything else.
+ */
+typedef struct line_keys_t {
+    uint32_t  first[ 256 ];
+    char      stops[ LINE_RULES_CNT + 2 ];
+} line_keys_t;
+
+static void     build_line_keys(line_keys_t *, attr_edits_e);
+static uint32_t scan_line_keys (line_keys_t const *, char const *line);
+
 #pragma GCC diagnostic ignored "-Wunused-function"  // TODO :: remove later ...
 
 
@@ -96,9 +157,15 @@ char * O0 apply_attr_edits(char *ptr_root, attr_edits_e attr_edits, attr_stats_t
         char         *ptr_end;
         unsigned int  idx;
         int           cnt;
+        uint32_t      line_mask;  /* the 'line_rules[]' to apply to the line */
+        line_keys_t   line_keys;
+        edit_buf_t    out;
+        size_t        line;       /* where the line starts in 'out' */
+        size_t        len;
     } w = {
         .idx       = 0,
         .ptr_root  = ptr_root,
+        .out       = { .str = NULL, .len = 0, .sz = 0 },
     };
 
 
@@ -117,108 +184,145 @@ char * O0 apply_attr_edits(char *ptr_root, attr_edits_e attr_edits, attr_stats_t
     }
 
 
+    /*
+     ***************************************************************************
+     * The rest are done line by line, in 'line_rules[]' order.  Each line is
+     * scanned once for all of the rules' keys, and a rule is only applied to
+     * the lines that have its key (the others would be a no-op anyways).
+     *
+     * The lines are copied to 'out' one at a time (with their '\n'), and the
+     * rules edit the last line there.  A rule never looks past its line's
+     * '\n', so it sees the same text as it would in the whole (edited) text.
+     */
+    build_line_keys( &w.line_keys, attr_edits );
+    if ( '\0' == w.line_keys.stops[ 1 ] ) {
+        return ( w.ptr_root );  /* No line rules */
+    }
+
+    w.len = strlen( w.ptr_root );
+    edit_reserve( &w.out, w.len + (w.len / 16) );
+
     while ( '\0' != *(w.ptr_root + w.idx) ) {
-        /*
-         ***********************************************************************
-         * Wide SPACEs are a nuisance since libass won't split the line on them
-         * (which are _different_ than a non-breaking SPACE).
-         */
-        if ( attr_edits & AE_WIDE_SPACE )
-          w.ptr_root = do_pair_substitution( w.ptr_root, w.idx, &replace_wide_space, ATTR_CNT(AE_WIDE_SPACE) );
+        w.ptr_end = strchr((w.ptr_root + w.idx), '\n');
+        w.len  = (NULL == w.ptr_end) ? strlen(w.ptr_root + w.idx) : (size_t) (w.ptr_end - (w.ptr_root + w.idx)) + 1;
+        w.line = w.out.len;
+        edit_append( &w.out, w.ptr_root + w.idx, w.len );
 
-        /*
-         ***********************************************************************
-         * Replace '--' with a heavier dash character (aesthetic).
-         */
-        if ( attr_edits & AE_DOUBLE_DASH )
-          w.ptr_root = do_pair_substitution( w.ptr_root, w.idx, &replace_double_dash, ATTR_CNT(AE_DOUBLE_DASH) );
+        w.line_mask = scan_line_keys( &w.line_keys, w.out.str + w.line );
 
-        /*
-         ***********************************************************************
-         * Words:  'bout = about, 'fter = after, 'ning = morning, etc.
-         */
-        if ( attr_edits & AE_URBAN_WORDS )
-          if (0) w.ptr_root = do_quote_urban_words( w.ptr_root, &quote_and_urban_word, w.idx, ATTR_CNT(AE_URBAN_WORDS) );
+        for ( size_t rule = 0; w.line_mask && rule < LINE_RULES_CNT; rule++ ) {
+            if ( w.line_mask & (1u << rule) ) {
+                do_pair_substitution( &w.out, w.line, line_rules[ rule ].kv, ATTR_CNT(line_rules[ rule ].bit) );
+            }
+        }
 
-        /*
-         ***********************************************************************
-         * Words:  y'can  n'all  d'ya  s'long  d'ya  yarr'~  y'hear?  y'knooo~
-         */
-        if ( attr_edits & AE_YOU_KNOW )
-          if (0) w.ptr_root = do_pair_substitution( w.ptr_root, w.idx, &y_know_apostrophe, ATTR_CNT(AE_YOU_KNOW) );
+        w.idx += w.len;
+    }
 
-        /*
-         ***********************************************************************
-         * Replace ',' with a SPACE after the comma -> ', '.
-         */
-        if ( attr_edits & AE_SQUOTE_SPACING )
-          w.ptr_root = do_pair_substitution( w.ptr_root, w.idx, &fix_squotes_spacing, ATTR_CNT(AE_SQUOTE_SPACING) );
+    (free)( w.ptr_root );
 
-        /*
-         ***********************************************************************
-         * Match up SINGLE quote pairs.
-         */
-        if ( attr_edits & AE_SQUOTE_PAIRS )
-          w.ptr_root = do_pair_substitution( w.ptr_root, w.idx, &single_quote_pairs, ATTR_CNT(AE_SQUOTE_PAIRS) );
+    return ( w.out.str );
+}
 
-        /*
-         ***********************************************************************
-         * Words:  y'can  n'all  d'ya  s'long  d'ya  yarr'~  y'hear?  y'knooo~
-         */
-        if ( attr_edits & AE_YOU_KNOW )
-          if (1) w.ptr_root = do_pair_substitution( w.ptr_root, w.idx, &y_know_apostrophe, ATTR_CNT(AE_YOU_KNOW) );
 
-        /*
-         ***********************************************************************
-         * Match up DOUBLE quote pairs.
-         */
-        if ( attr_edits & AE_DQUOTE_PAIRS ) {
-          w.ptr_root = do_pair_substitution( w.ptr_root, w.idx, &double_quote_pairs, ATTR_CNT(AE_DQUOTE_PAIRS) );
-          w.ptr_root = do_pair_substitution( w.ptr_root, w.idx, &double_quote_pairs_2, ATTR_CNT(AE_DQUOTE_PAIRS) );
-        }
+/**
+ *******************************************************************************
+ * Index the enabled rules' keys by their first byte (a rule's bit is its index
+ * in 'line_rules[]').
+ */
+static void build_line_keys(line_keys_t *keys, attr_edits_e attr_edits)
+{
+    size_t  cnt = 0;
 
-        /*
-         ***********************************************************************
-         * Most contractions: don't, can't, they're, etc.
-         */
-        if ( attr_edits & AE_CONTRACTIONS )
-          w.ptr_root = do_pair_substitution( w.ptr_root, w.idx, &most_contractions, ATTR_CNT(AE_CONTRACTIONS) );
 
-        /*
-         ***********************************************************************
-         * Plural possessive nouns
-         */
-        if ( attr_edits & AE_PLURAL_POSSESSIVE )
-          w.ptr_root = do_pair_substitution( w.ptr_root, w.idx, &plural_possessive_noun, ATTR_CNT(AE_PLURAL_POSSESSIVE) );
+    memset(keys, '\0', sizeof (line_keys_t));
+    keys->stops[ cnt++ ] = '\n';
 
-        /*
-         ***********************************************************************
-         * Words:  hafta'  ta'  eno'  tru'  eh'  yer'  mockin'  yappin'!
-         */
-        if ( attr_edits & AE_URBAN_OTHER )
-          w.ptr_root = do_pair_substitution( w.ptr_root, w.idx, &hafta_yappin_apostrophe, ATTR_CNT(AE_URBAN_OTHER) );
+    for ( size_t rule = 0; rule < LINE_RULES_CNT; rule++ ) {
+        unsigned char ch = *line_rules[ rule ].kv->key.str;
 
-        /*
-         ***********************************************************************
-         * Emoji: :( (this is incomplete at this point)
-         */
-        if ( attr_edits & AE_EMOJI ) {
-          w.ptr_root = do_pair_substitution( w.ptr_root, w.idx, &emoji_happy, ATTR_CNT(AE_EMOJI) );
-          w.ptr_root = do_pair_substitution( w.ptr_root, w.idx, &emoji_sad, ATTR_CNT(AE_EMOJI) );
+        if ( attr_edits & line_rules[ rule ].bit ) {
+            if ( 0 == keys->first[ ch ] ) {
+                keys->stops[ cnt++ ] = ch;
+            }
+            keys->first[ ch ] |= (1u << rule);
         }
+    }
+
+    return ;
+}
 
 
-        w.ptr_end = strchr((w.ptr_root + w.idx), '\n');
-        if ( NULL == w.ptr_end ) {
-            break;
+/**
+ *******************************************************************************
+ * Which of the rules' keys are in the line (up to its '\n')?  Only the bytes
+ * that start a key are looked at, and only for the keys not yet found.
+ *
+ * This is exact because no rule's value makes a key that wasn't already in
+ * the line (they're multibyte characters, or "', '" for "','").
+ */
+static uint32_t scan_line_keys(line_keys_t const *keys, char const *line)
+{
+    uint32_t  mask = 0;
+    uint32_t  cands;
+
+
+    for ( line += strcspn(line, keys->stops); '\0' != *line && '\n' != *line; line += strcspn(line, keys->stops) ) {
+        cands = keys->first[ (unsigned char) *line ] & ~mask;
+        while ( cands ) {
+            int rule = __builtin_ctz(cands);
+
+            cands &= cands - 1;
+            if ( STR_MATCH == strncmp(line, line_rules[ rule ].kv->key.str, line_rules[ rule ].kv->key.len) ) {
+                mask |= (1u << rule);
+            }
         }
+        line++;
+    }
+
+    return ( mask );
+}
+
 
-        w.idx += w.ptr_end - (w.ptr_root + w.idx);
-        w.idx++;  /* Advance past the '\n' */
+/**
+ *******************************************************************************
+ * Make room for 'len' chars (and the '\0') in 'buf', doubling as it grows.
+ */
+static void edit_reserve(edit_buf_t *buf, size_t len)
+{
+    if ( len + 1 > buf->sz ) {
+        buf->sz = (buf->sz) ? buf->sz : 256;
+        while ( len + 1 > buf->sz ) {
+            buf->sz *= 2;
+        }
+        buf->str = realloc(buf->str, buf->sz);
+        *(buf->str + buf->len) = '\0';
     }
+}
+
 
+static void edit_append(edit_buf_t *buf, char const *str, size_t len)
+{
+    edit_reserve(buf, buf->len + len);
+    memcpy(buf->str + buf->len, str, len);
+    buf->len += len;
+    *(buf->str + buf->len) = '\0';
+}
 
-    return ( w.ptr_root );
+
+/**
+ *******************************************************************************
+ * Replace the 'old_len' chars at 'idx' with 'val' -- the rest of the text (in
+ * practise, the rest of the line) moves if they aren't the same length.
+ */
+static void edit_replace(edit_buf_t *buf, size_t idx, size_t old_len, char const *val, size_t len)
+{
+    if ( len != old_len ) {
+        edit_reserve(buf, buf->len - old_len + len);
+        memmove(buf->str + idx + len, buf->str + idx + old_len, buf->len - idx - old_len + 1);
+        buf->len = buf->len - old_len + len;
+    }
+    memcpy(buf->str + idx, val, len);
 }
 
 
@@ -263,6 +367,7 @@ char * O3 remove_dup_groups(char *const in_text, unsigned short line_depth, unsi
     typedef struct indice_t {  /* 1913 was a _good_ year :) */
        unsigned int idx;
        unsigned int len;
+       uint64_t     hash;      /**< of the line's 'len' bytes, '\n' included */
     } indice_t;
     struct {
         char   *in_text;
@@ -279,16 +384,19 @@ char * O3 remove_dup_groups(char *const in_text, unsigned short line_depth, unsi
 
         unsigned int   in_line_idx;
         unsigned int   in_lines_cnt;
+        unsigned int   gap;           /**< 'indices[ gap, gap_end )' are removed */
+        unsigned int   gap_end;
 
         int   rc;
 
         size_t  len;
+        char const *ptr;
         union {
-          char  *dbg_s1;
+          indice_t *dbg_s1;
           void  *dbg_dst;
         };
         union {
-          char  *dbg_s2;
+          indice_t *dbg_s2;
           void  *dbg_src;
         };
         unsigned int dups_found;
@@ -319,21 +427,20 @@ char * O3 remove_dup_groups(char *const in_text, unsigned short line_depth, unsi
 
     /*
      **************************************************************************
-     * Capture all of the line starts and their length ...
-     * (We'll get an "extra" array element, but it won't affect anything ...)
+     * Capture all of the line starts, their length and their hash, so that
+     * the groups are compared by the lines' hash (and only then their bytes).
      */
-    char  ch;
-    loop:
-      w.indices = realloc(w.indices, (w.in_lines_cnt + 1) * sizeof (indice_t));
-      w.indices[ w.in_lines_cnt ].idx = w.in_idx;
-      w.indices[ w.in_lines_cnt ].len = 0x00;    /* pedantic, for "extra". */
-      while ( (ch = *(w.in_text + w.in_idx)) ) {
-        w.in_idx++;
-        if ( '\n' == ch ) {
-            w.indices[ w.in_lines_cnt ].len = w.in_idx - w.indices[ w.in_lines_cnt ].idx;
-            w.in_lines_cnt++;
-            goto loop;
-        }
+    for ( w.ptr = w.in_text; NULL != (w.ptr = strchr(w.ptr, '\n')); w.ptr++ ) {
+        w.in_lines_cnt++;
+    }
+    w.indices = malloc(w.in_lines_cnt * sizeof (indice_t));
+
+    for ( w.in_line_idx = 0; w.in_line_idx < w.in_lines_cnt; w.in_line_idx++ ) {
+        w.ptr = strchr((w.in_text + w.in_idx), '\n');
+        w.indices[ w.in_line_idx ].idx  = w.in_idx;
+        w.indices[ w.in_line_idx ].len  = (w.ptr - (w.in_text + w.in_idx)) + 1;
+        w.indices[ w.in_line_idx ].hash = fnv1a_64(FNV1A_64_INIT, (w.in_text + w.in_idx), w.indices[ w.in_line_idx ].len);
+        w.in_idx += w.indices[ w.in_line_idx ].len;
     }
 
     /*
@@ -344,8 +451,16 @@ char * O3 remove_dup_groups(char *const in_text, unsigned short line_depth, unsi
      * It's difficult to think of a single linguistic example where duplicate
      * groups of lines would make sense.  As such, we keep track of the number
      * of groups we've compressed and note it in the image's comments.
+     *
+     * The removed lines are a gap in 'indices', that follows the removals
+     * (which only move forward), and 'LINE()' is the n'th line that's left.
+     * So a removal doesn't move the rest of the lines, only the gap does.
      */
+#undef LINE
+#define LINE(n_)  (w.indices[ ((n_) < w.gap) ? (n_) : ((n_) - w.gap + w.gap_end) ])
+
     for ( w.line_depth_idx = 1; w.line_depth_idx <= w.line_depth; w.line_depth_idx++ ) {
+        w.gap = w.gap_end = 0;
 
         for ( w.in_line_idx = 0; w.in_line_idx < w.in_lines_cnt; w.in_line_idx++ ) {
             /*
@@ -363,10 +478,10 @@ char * O3 remove_dup_groups(char *const in_text, unsigned short line_depth, unsi
                  */
                 w.skip_lines = 0;
                 if ( w.ign_empty ) {
-                    if ( '\n' != *(w.in_text + w.indices[ w.in_line_idx ].idx) ) {
+                    if ( '\n' != *(w.in_text + LINE(w.in_line_idx).idx) ) {
 
                         while ( (w.in_line_idx + w.line_depth_idx + w.skip_lines) < (w.in_lines_cnt - w.line_depth_idx) ) {
-                            if ( '\n' != *(w.in_text + w.indices[ w.in_line_idx + w.line_depth_idx + w.skip_lines ].idx) ) {
+                            if ( '\n' != *(w.in_text + LINE(w.in_line_idx + w.line_depth_idx + w.skip_lines).idx) ) {
                                 break;
                             }
                             w.skip_lines++;
@@ -382,17 +497,19 @@ char * O3 remove_dup_groups(char *const in_text, unsigned short line_depth, unsi
                  * Check each line of the group.
                  */
                 w.block_size = 0;
+                w.rc = STR_MATCH;
                 for ( unsigned short jj = 0; jj < w.line_depth_idx; jj++ ) {
-                    w.len    =             w.indices[ w.in_line_idx + jj ].len;
-                    w.dbg_s1 = w.in_text + w.indices[ w.in_line_idx + jj ].idx;
-
-                    w.dbg_s2 = w.in_text + w.indices[ w.in_line_idx + jj + w.line_depth_idx + w.skip_lines ].idx;
+                    w.dbg_s1 = &LINE(w.in_line_idx + jj);
+                    w.dbg_s2 = &LINE(w.in_line_idx + jj + w.line_depth_idx + w.skip_lines);
 
-                    w.rc = strncmp(w.dbg_s1, w.dbg_s2, w.len);
-                    if ( STR_MATCH != w.rc )
+                    if (   w.dbg_s1->hash != w.dbg_s2->hash
+                        || w.dbg_s1->len  != w.dbg_s2->len
+                        || STR_MATCH != memcmp((w.in_text + w.dbg_s1->idx), (w.in_text + w.dbg_s2->idx), w.dbg_s1->len) ) {
+                        w.rc = !STR_MATCH;
                         break;
+                    }
 
-                    w.block_size += w.len;
+                    w.block_size += w.dbg_s1->len;
                 }
 
                 /*
@@ -405,11 +522,19 @@ char * O3 remove_dup_groups(char *const in_text, unsigned short line_depth, unsi
                 if ( STR_MATCH == w.rc ) {
                     w.dups_found++;
 
-                    w.dbg_src = &w.indices[ w.in_line_idx + w.skip_lines + (w.line_depth_idx * 2) ];
-                    w.dbg_dst = &w.indices[ w.in_line_idx + w.line_depth_idx ];
-                    w.len = w.in_lines_cnt - (w.in_line_idx + w.skip_lines + (w.line_depth_idx * 2));
+                    /*
+                     **********************************************************
+                     * Move the gap up to the second group, and widen it over
+                     * the second group (and the EMPTY lines before it).
+                     */
+                    if ( w.gap == w.gap_end ) {
+                        w.gap = w.gap_end = w.in_line_idx + w.line_depth_idx;
+                    }
+                    while ( w.gap < w.in_line_idx + w.line_depth_idx ) {
+                        w.indices[ w.gap++ ] = w.indices[ w.gap_end++ ];
+                    }
+                    w.gap_end += w.line_depth_idx + w.skip_lines;
 
-                    memmove(w.dbg_dst, w.dbg_src, (w.len * sizeof (indice_t)));
                     w.in_lines_cnt -= w.line_depth_idx;
                     w.in_lines_cnt -= w.skip_lines;
                     goto loop2;
@@ -419,6 +544,14 @@ char * O3 remove_dup_groups(char *const in_text, unsigned short line_depth, unsi
                 else_break: break;  /* Clearer to goto this label from above */
             }
         }
+
+        /*
+         **********************************************************************
+         * Close the gap (once) for the next depth.
+         */
+        if ( w.gap != w.gap_end ) {
+            memmove(&w.indices[ w.gap ], &w.indices[ w.gap_end ], ((w.in_lines_cnt - w.gap) * sizeof (indice_t)));
+        }
     }
 
     if ( NULL != dups_found ) {
@@ -599,14 +732,21 @@ static char * O3 apply_two_spaces(char *in_buf, char const *const ends, char con
        size_t  idx;
        char    ch;  /* Could be 'int', but 'char' is easier in debugger. */
        size_t  len;
+       edit_buf_t out;  /* The lookbacks are done on the (edited) output. */
     } w = {
         .ptr = in_buf,
         .idx = 1,
-        .len = strlen(in_buf),  /* Note, we add the '\0' at the realloc() */
+        .len = strlen(in_buf),
+        .out = { .str = NULL, .len = 0, .sz = 0 },
     };
 
 
+    edit_reserve(&w.out, w.len + (w.len / 32));
+    edit_append(&w.out, w.ptr, 1);
+
     while ( (w.ch = *(w.ptr + w.idx++)) ) {  /* NOTE, 'w.idx' points to SPACE */
+        edit_append(&w.out, &w.ch, 1);
+
             /******************************************************************
              * Search for the four char sequence '[group][ends] [:upper:]'
              * where 'group' is a character in the set of :lower: or '~'.
@@ -615,23 +755,24 @@ static char * O3 apply_two_spaces(char *in_buf, char const *const ends, char con
         if (       strchr(ends, w.ch) != NULL
                 && isblank(*(w.ptr + w.idx))
                 && isupper(*(w.ptr + w.idx + 1))
-                && (islower(*(w.ptr + w.idx - 2)) || strchr("~", *(w.ptr + w.idx - 2)))
-                && RC_FALSE == srch_bchrs( NULL, exceptions, w.ptr, w.idx )
+                && (islower(*(w.out.str + w.out.len - 2)) || strchr("~", *(w.out.str + w.out.len - 2)))
+                && RC_FALSE == srch_bchrs( NULL, exceptions, w.out.str, w.out.len )
             ) {
 
-            w.ptr = realloc(w.ptr, ++w.len + 1);  /* Don't forget '\0'. */
-            *(w.ptr + w.idx) = ' ';  /* Ensure that the char is a SPACE. */
-            memmove(w.ptr + w.idx + 1, w.ptr + w.idx, w.len - w.idx);
+            edit_append(&w.out, "  ", 2);  /* Ensure that the chars are SPACEs. */
+            edit_append(&w.out, w.ptr + w.idx + 1, 1);
 
             /******************************************************************
              * Point to character _after_ the start of the next sentence.
              */
-            w.idx += 3;
+            w.idx += 2;
             (*p_cnt)++;
         }
     }
 
-    return ( w.ptr );
+    (free)(w.ptr);
+
+    return ( w.out.str );
 }
 
 
@@ -645,27 +786,27 @@ static char * O3 apply_two_spaces(char *in_buf, char const *const ends, char con
  * manages to do a pretty decent job anyway.
  */
 #undef do_pair_substitution
-static char * O3 do_pair_substitution(char *ptr_root, unsigned int idx, unsigned short r_level,
-                                      key_values_t const *const kv, int *const p_cnt)
+static void O3 do_pair_substitution(edit_buf_t *buf, size_t idx, unsigned short r_level,
+                                    key_values_t const *const kv, int *const p_cnt)
 {
 #undef NOT_END_OF_LINE
 #define NOT_END_OF_LINE(idx_)  \
-        ('\0' != *(w.ptr_root + (idx_)) && '\n' != *(w.ptr_root + (idx_)))
+        ('\0' != *(w.buf->str + (idx_)) && '\n' != *(w.buf->str + (idx_)))
 
     struct {
-       char   *ptr_root;         /* NOTE :: We treat this as a '* CONST'. */
+       edit_buf_t *buf;          /* NOTE :: 'buf->str' moves on an edit. */
        size_t  idx;
 
        size_t  next;
-       size_t  move_len;
-       size_t  new_size;         /* Only set if we need to do a memmove() */
        int     delta;            /* (Needs to be a signed type.) */
        int     open_ok;
+       char    stops[ 3 ];       /* the key's first byte, or the line's end */
 
        enum  { EX_NONE = 0, EX_SUBSTITUTE } ex_done;
     } w = {
-        .ptr_root = ptr_root,
+        .buf      = buf,
         .idx      = idx,
+        .stops    = { kv->key.str[ 0 ], '\n', '\0' },
         .ex_done  = EX_NONE,
     };
 
@@ -675,8 +816,9 @@ static char * O3 do_pair_substitution(char *ptr_root, unsigned int idx, unsigned
          **********************************************************************
          * Search for the 'key' string for the ST_OPEN state.
          */
-        if ( strncmp((w.ptr_root + w.idx), kv->key.str, kv->key.len) ) {
+        if ( strncmp((w.buf->str + w.idx), kv->key.str, kv->key.len) ) {
             w.idx++;
+            w.idx += strcspn((w.buf->str + w.idx), w.stops);
             continue;
         }
 
@@ -687,12 +829,12 @@ static char * O3 do_pair_substitution(char *ptr_root, unsigned int idx, unsigned
          * requirement.  If that test fails and <idx> != 0, then we'll return.
          * Otherwise, we'll keep looking for a valid ST_OPEN state.
          */
-        if (   RC_FALSE == srch_bchrs( kv->key.open_chars, kv->key.open_utf8s, w.ptr_root, w.idx )
+        if (   RC_FALSE == srch_bchrs( kv->key.open_chars, kv->key.open_utf8s, w.buf->str, w.idx )
              || (NULL != kv->key.open_exclc
-                 && RC_TRUE == srch_fchrs( kv->key.open_exclc, NULL, w.ptr_root, w.next ))
+                 && RC_TRUE == srch_fchrs( kv->key.open_exclc, NULL, w.buf->str, w.next ))
            ) {
             if ( r_level ) {
-                return ( w.ptr_root );
+                return;
             }
             w.idx += kv->key.len;
             continue;
@@ -707,20 +849,21 @@ static char * O3 do_pair_substitution(char *ptr_root, unsigned int idx, unsigned
          * perform a substitution for this key.
          */
         if ( NULL == kv->vals[ ST_CLOSE ].str ) {
-            if ( RC_FALSE == srch_fchrs( kv->key.close_chars, kv->key.close_strs, w.ptr_root, w.next ) ) {
+            if ( RC_FALSE == srch_fchrs( kv->key.close_chars, kv->key.close_strs, w.buf->str, w.next ) ) {
                 w.idx = w.next;
                 continue;
             }
             w.open_ok = 1;
         }
         else while ( NOT_END_OF_LINE(w.next) ) {
-            if ( STR_MATCH != strncmp((w.ptr_root + w.next), kv->key.str, kv->key.len) ) {
+            if ( STR_MATCH != strncmp((w.buf->str + w.next), kv->key.str, kv->key.len) ) {
                   /*
                    *************************************************************
                    * Note, we can't advance by 'kv->key.len' because that
                    * may / probably put us beyond the end of the string.
                    */
                 w.next++;
+                w.next += strcspn((w.buf->str + w.next), w.stops);
                 continue;
             }
 
@@ -731,9 +874,9 @@ static char * O3 do_pair_substitution(char *ptr_root, unsigned int idx, unsigned
                * was replaced by the call to do_pair_substitution()).
                */
             if ( kv->recurse ) {        //  TODO :: WORKS, cleanup amd make more "formal"
-                w.ptr_root = (do_pair_substitution)(w.ptr_root, w.next, r_level + 1, kv, p_cnt);
+                (do_pair_substitution)(w.buf, w.next, r_level + 1, kv, p_cnt);
 
-                if ( STR_MATCH != strncmp((w.ptr_root + w.next), kv->key.str, kv->key.len) ) {
+                if ( STR_MATCH != strncmp((w.buf->str + w.next), kv->key.str, kv->key.len) ) {
                     w.next += kv->vals[ ST_OPEN ].len;
                     continue;  /* The original match is no longer there ... */
                 }
@@ -746,27 +889,13 @@ static char * O3 do_pair_substitution(char *ptr_root, unsigned int idx, unsigned
              * searching for the ST_CLOSE until we exhaust the string.
              */
             if ( NOT_END_OF_LINE(w.next + kv->key.len) ) {
-                if ( RC_FALSE == srch_fchrs( kv->key.close_chars, kv->key.close_strs, w.ptr_root, (w.next + kv->key.len) ) ) {
+                if ( RC_FALSE == srch_fchrs( kv->key.close_chars, kv->key.close_strs, w.buf->str, (w.next + kv->key.len) ) ) {
                     w.next += kv->key.len;
                     continue;
                 }
             }
 
-            w.delta = kv->vals[ ST_CLOSE ].len - kv->key.len;
-            if ( w.delta > 0 ) {
-
-                /***************************************************************
-                 * (Note, the 'new_size' includes the string's '\0'.)
-                 */
-                w.new_size = 1 + strlen(w.ptr_root) + w.delta;
-                w.ptr_root = realloc(w.ptr_root, w.new_size);
-            }
-
-            w.move_len = 1 + strlen(w.ptr_root + w.next + kv->key.len);
-            if ( w.delta ) {
-                memmove((w.ptr_root + w.next + kv->vals[ ST_CLOSE ].len), (w.ptr_root + w.next + kv->key.len), w.move_len);
-            }
-            strncpy((w.ptr_root + w.next), kv->vals[ ST_CLOSE ].str, kv->vals[ ST_CLOSE ].len);
+            edit_replace(w.buf, w.next, kv->key.len, kv->vals[ ST_CLOSE ].str, kv->vals[ ST_CLOSE ].len);
             w.ex_done = EX_SUBSTITUTE;
             (*p_cnt)++;
 
@@ -791,21 +920,7 @@ static char * O3 do_pair_substitution(char *ptr_root, unsigned int idx, unsigned
         w.delta = 0;
         if ( kv->vals[ ST_OPEN ].str != NULL ) {
             w.delta = kv->vals[ ST_OPEN ].len - kv->key.len;
-
-            w.move_len = 1 + strlen(w.ptr_root + w.idx + kv->key.len);
-            if ( w.delta > 0 ) {
-
-                /***************************************************************
-                 * (Note, 'w.new_size' includes the string's '\0' terminator.)
-                 */
-                w.new_size = 1 + strlen(w.ptr_root) + w.delta;
-                w.ptr_root = realloc(w.ptr_root, w.new_size);
-            }
-
-            if ( w.delta ) {
-                memmove((w.ptr_root + w.idx + kv->vals[ ST_OPEN ].len), (w.ptr_root + w.idx + kv->key.len), w.move_len);
-            }
-            strncpy((w.ptr_root + w.idx), kv->vals[ ST_OPEN ].str, kv->vals[ ST_OPEN ].len);
+            edit_replace(w.buf, w.idx, kv->key.len, kv->vals[ ST_OPEN ].str, kv->vals[ ST_OPEN ].len);
             w.ex_done = EX_SUBSTITUTE;
             (*p_cnt)++;
         }
@@ -820,8 +935,6 @@ static char * O3 do_pair_substitution(char *ptr_root, unsigned int idx, unsigned
 
         w.idx = w.next + w.delta;
     }
-
-    return ( w.ptr_root );
 }
 
 
@@ -833,28 +946,36 @@ static char * O3 do_quote_urban_words(char *ptr_root, key_values_t const *const
 #undef NOT_END_OF_LINE
 #define NOT_END_OF_LINE(idx_)  ('\0' != *(w.ptr_root + (idx_)))
     struct {
-       char   *ptr_root;        /* NOTE, we treat this as '* const buf'. */
+       char   *ptr_root;        /* The lookaheads are done on the input ... */
+       edit_buf_t out;          /* ... and the lookbacks on the output. */
        size_t  idx;
        size_t  nxt;
-       size_t  move_len;
-       size_t  new_size;        /* Only set if we need to do a memmove() */
-       int     delta;           /* Needs to be a signed type. */
+       size_t  skip;
 
        size_t  len;
        rc_e    rc;
+       char    stops[ 2 ];      /* the key's first byte */
     } w = {
         .idx      = idx,
         .ptr_root = ptr_root,
+        .out      = { .str = NULL, .len = 0, .sz = 0 },
+        .stops    = { kv->key.str[ 0 ], '\0' },
     };
 
 
+    w.len = strlen(w.ptr_root);
+    edit_reserve(&w.out, w.len + (w.len / 32));
+    edit_append(&w.out, w.ptr_root, w.idx);
+
     while ( NOT_END_OF_LINE(w.idx) ) {
         /*
          ***********************************************************************
          * Search for the 'key' string for the ST_OPEN state.
          */
         if ( strncmp((w.ptr_root + w.idx), kv->key.str, kv->key.len) ) {
-            w.idx++;
+            w.skip = 1 + strcspn((w.ptr_root + w.idx + 1), w.stops);
+            edit_append(&w.out, (w.ptr_root + w.idx), w.skip);
+            w.idx += w.skip;
             continue;
         }
 
@@ -864,45 +985,37 @@ static char * O3 do_quote_urban_words(char *ptr_root, key_values_t const *const
          * prerequisites.  If that test fails and <idx> != 0, then we'll return.
          * Otherwise, we'll keep looking for a valid ST_OPEN state.
          */
-        if ( w.idx && kv->key.open_chars != NULL ) {
-            if ( NULL == strchr( kv->key.open_chars, *(w.ptr_root + w.idx - 1)) ) {
+        if ( w.out.len && kv->key.open_chars != NULL ) {
+            if ( NULL == strchr( kv->key.open_chars, *(w.out.str + w.out.len - 1)) ) {
+                edit_append(&w.out, (w.ptr_root + w.idx), kv->key.len);
                 w.idx += kv->key.len;
                 continue;
             }
         }
 
-        if ( 0 == (w.len = strfchars( kv->key.close_strs, w.ptr_root, w.idx + kv->key.len )) ) {
+        if (   0 == (w.len = strfchars( kv->key.close_strs, w.ptr_root, w.idx + kv->key.len ))
+            || 0 == (w.nxt = strfchars( WORD_END_STRINGS, w.ptr_root, w.idx + kv->key.len + w.len )) ) {
+            edit_append(&w.out, (w.ptr_root + w.idx), kv->key.len);
             w.idx += kv->key.len;
             continue;
         }
 
-        if ( 0 == (w.nxt = strfchars( WORD_END_STRINGS, w.ptr_root, w.idx + kv->key.len + w.len )) ) {
-            w.idx += kv->key.len;
-            continue;
-        }
-
-        w.delta = 0;
         if ( kv->vals[ ST_OPEN ].str != NULL ) {
-            w.delta = kv->vals[ ST_OPEN ].len - kv->key.len;
-
-            w.move_len = 1 + strlen(w.ptr_root + w.idx + kv->key.len);
-            if ( w.delta > 0 ) {
-
-                w.new_size = 1 + strlen(w.ptr_root) + w.delta;
-                w.ptr_root = realloc(w.ptr_root, w.new_size);
-            }
-
-            if ( w.delta ) {
-                memmove((w.ptr_root + w.idx + kv->vals[ ST_OPEN ].len), (w.ptr_root + w.idx + kv->key.len), w.move_len);
-            }
-            strncpy((w.ptr_root + w.idx), kv->vals[ ST_OPEN ].str, kv->vals[ ST_OPEN ].len);
+            edit_append(&w.out, kv->vals[ ST_OPEN ].str, kv->vals[ ST_OPEN ].len);
             (*p_cnt)++;
         }
+        else {
+            edit_append(&w.out, (w.ptr_root + w.idx), kv->key.len);
+        }
+        w.idx += kv->key.len;
 
-        w.idx += (kv->key.len + w.len + w.nxt + w.delta);
+        edit_append(&w.out, (w.ptr_root + w.idx), (w.len + w.nxt));
+        w.idx += (w.len + w.nxt);
     }
 
-    return ( w.ptr_root );
+    (free)(w.ptr_root);
+
+    return ( w.out.str );
 }
 
 
@@ -1098,6 +1211,329 @@ char *build_attr_stats(attr_stats_t *attr_stats)
 #endif
 
 
+/*
+ ******************************************************************************
+ ******************************************************************************
+ * Regression test for 'remove_dup_groups()' ...
+ *
+ *   make test-edits
+ *
+ * Compares it with the original (line by line 'strncmp()', and 'memmove()'
+ * of the rest of the 'indices' for every group removed) on a generated corpus
+ * of short lines, with lots of duplicates and EMPTY lines, for every depth
+ * up to 6, with and without 'ign_empty'.  Both must return the same text and
+ * the same # of duplicate groups.
+ */
+#ifdef TESTING  /* { */
+
+/**
+ ******************************************************************************
+ * The original 'remove_dup_groups()', kept as the reference.
+ */
+static char * O3 old_remove_dup_groups(char *const in_text, unsigned short line_depth, unsigned short ign_empty, unsigned int *dups_found)
+{
+    typedef struct indice_t {  /* 1913 was a _good_ year :) */
+       unsigned int idx;
+       unsigned int len;
+    } indice_t;
+    struct {
+        char   *in_text;
+        int     in_idx;
+        char   *out_text;
+        size_t  out_text_sz;
+
+        indice_t *indices;
+        unsigned short line_depth;
+        unsigned short ign_empty;     /**< Ignore EMPTY lines between groups */
+        unsigned short block_size;    /**< # of bytes in the current group */
+        unsigned short skip_lines;    /**< # of lines to skip between groups */
+        unsigned int   line_depth_idx;
+
+        unsigned int   in_line_idx;
+        unsigned int   in_lines_cnt;
+
+        int   rc;
+
+        size_t  len;
+        union {
+          char  *dbg_s1;
+          void  *dbg_dst;
+        };
+        union {
+          char  *dbg_s2;
+          void  *dbg_src;
+        };
+        unsigned int dups_found;
+    } w = {
+        .in_idx     = 0,
+        .in_text    = in_text,
+
+        .line_depth = line_depth,
+        .ign_empty  = ign_empty,
+
+        .indices    = NULL,
+    };
+
+
+    /*
+     **************************************************************************
+     * First, ensure that the file has a final '\n', even if it's EMPTY.
+     */
+    w.len = strlen(w.in_text);
+    if ( 0 == w.len
+        || ('\n' != *(w.in_text + (w.len - 1))) ) {
+
+        w.in_text = realloc(w.in_text, w.len + 2);
+        *(w.in_text + w.len) = '\n';
+        w.len++;
+        *(w.in_text + w.len) = '\0';
+    }
+
+    /*
+     **************************************************************************
+     * Capture all of the line starts and their length ...
+     * (We'll get an "extra" array element, but it won't affect anything ...)
+     */
+    char  ch;
+    loop:
+      w.indices = realloc(w.indices, (w.in_lines_cnt + 1) * sizeof (indice_t));
+      w.indices[ w.in_lines_cnt ].idx = w.in_idx;
+      w.indices[ w.in_lines_cnt ].len = 0x00;    /* pedantic, for "extra". */
+      while ( (ch = *(w.in_text + w.in_idx)) ) {
+        w.in_idx++;
+        if ( '\n' == ch ) {
+            w.indices[ w.in_lines_cnt ].len = w.in_idx - w.indices[ w.in_lines_cnt ].idx;
+            w.in_lines_cnt++;
+            goto loop;
+        }
+    }
+
+    /*
+     **************************************************************************
+     * Starting with the smallest depth, search for and remove adjacent
+     * duplicate line groups.  Repeat the steps until 'line_depth' is reached.
+     *
+     * It's difficult to think of a single linguistic example where duplicate
+     * groups of lines would make sense.  As such, we keep track of the number
+     * of groups we've compressed and note it in the image's comments.
+     */
+    for ( w.line_depth_idx = 1; w.line_depth_idx <= w.line_depth; w.line_depth_idx++ ) {
+
+        for ( w.in_line_idx = 0; w.in_line_idx < w.in_lines_cnt; w.in_line_idx++ ) {
+            /*
+             ******************************************************************
+             * If the remaining # of lines is less than the depth, we're done
+             * with this depth group.
+             */
+            loop2:
+            if ( (w.in_line_idx + (w.line_depth_idx * 2)) < w.in_lines_cnt ) {
+
+                /*
+                 **************************************************************
+                 * If enabled and the first line of the source group is NOT
+                 * EMPTY, skip all BLANK lines between the groups ...
+                 */
+                w.skip_lines = 0;
+                if ( w.ign_empty ) {
+                    if ( '\n' != *(w.in_text + w.indices[ w.in_line_idx ].idx) ) {
+
+                        while ( (w.in_line_idx + w.line_depth_idx + w.skip_lines) < (w.in_lines_cnt - w.line_depth_idx) ) {
+                            if ( '\n' != *(w.in_text + w.indices[ w.in_line_idx + w.line_depth_idx + w.skip_lines ].idx) ) {
+                                break;
+                            }
+                            w.skip_lines++;
+                        }
+                        if ( (w.in_line_idx + w.skip_lines + (w.line_depth_idx * 2)) >= w.in_lines_cnt ) {
+                            goto else_break;
+                        }
+                    }
+                }
+
+                /*
+                 **************************************************************
+                 * Check each line of the group.
+                 */
+                w.block_size = 0;
+                for ( unsigned short jj = 0; jj < w.line_depth_idx; jj++ ) {
+                    w.len    =             w.indices[ w.in_line_idx + jj ].len;
+                    w.dbg_s1 = w.in_text + w.indices[ w.in_line_idx + jj ].idx;
+
+                    w.dbg_s2 = w.in_text + w.indices[ w.in_line_idx + jj + w.line_depth_idx + w.skip_lines ].idx;
+
+                    w.rc = strncmp(w.dbg_s1, w.dbg_s2, w.len);
+                    if ( STR_MATCH != w.rc )
+                        break;
+
+                    w.block_size += w.len;
+                }
+
+                /*
+                 **************************************************************
+                 * DON'T COMPRESS EMPTY LINES!  So, if the group size is equal
+                 * to the line depth, we know they're all EMPTY lines and we
+                 * won't compress them.  This algorithm seems to work well ...
+                 */
+                if ( w.block_size > w.line_depth_idx )
+                if ( STR_MATCH == w.rc ) {
+                    w.dups_found++;
+
+                    w.dbg_src = &w.indices[ w.in_line_idx + w.skip_lines + (w.line_depth_idx * 2) ];
+                    w.dbg_dst = &w.indices[ w.in_line_idx + w.line_depth_idx ];
+                    w.len = w.in_lines_cnt - (w.in_line_idx + w.skip_lines + (w.line_depth_idx * 2));
+
+                    memmove(w.dbg_dst, w.dbg_src, (w.len * sizeof (indice_t)));
+                    w.in_lines_cnt -= w.line_depth_idx;
+                    w.in_lines_cnt -= w.skip_lines;
+                    goto loop2;
+                }
+            }
+            else {
+                else_break: break;  /* Clearer to goto this label from above */
+            }
+        }
+    }
+
+    if ( NULL != dups_found ) {
+        *dups_found = w.dups_found;
+    }
+
+    /*
+     **************************************************************************
+     * If we didn't compress anything, just return the text block passed to us.
+     */
+    if ( w.dups_found ) {
+        w.out_text_sz = 1;
+        for ( w.in_line_idx = 0; w.in_line_idx < w.in_lines_cnt; w.in_line_idx++ ) {
+            w.out_text_sz += w.indices[ w.in_line_idx ].len;
+        }
+
+        w.out_text = malloc(w.out_text_sz);
+
+        w.len = 0;
+        w.dbg_dst = w.out_text;
+        for ( w.in_line_idx = 0; w.in_line_idx < w.in_lines_cnt; w.in_line_idx++ ) {
+            w.len     =             w.indices[ w.in_line_idx ].len;
+            w.dbg_src = w.in_text + w.indices[ w.in_line_idx ].idx;
+            memmove(w.dbg_dst, w.dbg_src, w.len);
+
+            w.dbg_dst += w.len;
+        }
+        *(char *)w.dbg_dst = '\0';
+
+        (free)( w.in_text );
+    }
+    else w.out_text = w.in_text;
+
+    (free)( w.indices );
+
+    return ( w.out_text );
+}
+
+
+/**
+ ******************************************************************************
+ * DEPRECATED :: Remove adjacent duplicate lines.
+ *
+ * Rather than explain, here's an example -->
+ *
+ * ln#
+ *   1    A line in the text input file\n
+ *   2    This is a test duplicate line\n
+ *   3     << 0 or any number of blank lines >>
+ *   n    This is a test duplicate line\n
+ *   n+1  Next line in text input file ...\n
+ *
+ * So, the idea is to "compress" the input by replacing line 2 with line 'n'
+ * and continuing on from there; in practice line #3 will be replaced by 'n+1'.
+ *
+ * Right now, it will handle 0 or more EMPTY lines between the duplicates,
+ * but does not hanle BLANK lines; these will be seen as "unique" and not
+ * remove those lines.  Example -->
+ *
+ * ln#
+ *   1   'a duplicate line'
+ *   2   '\n'  EMPTY line
+ *   3   ' \n' BLANK line that s/b treated as EMPTY, but it's not.
+ *   4   'a duplicate line'
+ *
+ * For the most part, this has not been an issue.
+ *
+ ******************************************************************************
+ */
+
+
+/**
+ ******************************************************************************
+ * A small LCG, so that the corpus is the same on every run.
+ */
+static unsigned int test_rand(unsigned int *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return ( (*seed >> 16) & 0x7fff );
+}
+
+int main(UNUSED_ARG int argc, UNUSED_ARG char *argv[])
+{
+    static char const *const lines[] = {  /* the "c" is an unterminated last line */
+        "a\n", "b\n", "\n", "\n", "Is a test\n", "1957\n", "c", "ab\n", " \n",
+    };
+    struct {
+        char          text[ 40 * 16 ];
+        unsigned int  seed;
+        unsigned int  tests;
+        unsigned int  with_dups;
+        unsigned int  fails;
+    } w = {
+        .tests     = 0,
+        .with_dups = 0,
+        .fails     = 0,
+    };
+
+    for ( unsigned int ii = 0; ii < 200000; ii++ ) {
+        w.seed = ii * 7919 + 3;
+        w.text[ 0 ] = '\0';
+
+        unsigned int n_lines = test_rand( &w.seed ) % 40;
+        unsigned int n_kinds = 2 + test_rand( &w.seed ) % 7;
+        for ( unsigned int jj = 0; jj < n_lines; jj++ ) {
+            char const *line = lines[ test_rand( &w.seed ) % n_kinds ];
+
+            if ( STR_MATCH == strcmp( line, "c" ) && jj < n_lines - 1 ) {
+                line = "a\n";
+            }
+            strcat( w.text, line );
+        }
+
+        for ( unsigned short depth = 0; depth <= 6; depth++ ) {
+            for ( unsigned short ign_empty = 0; ign_empty < 2; ign_empty++ ) {
+                unsigned int  old_dups = 0;
+                unsigned int  new_dups = 0;
+                char         *old_text = old_remove_dup_groups( strdup( w.text ), depth, ign_empty, &old_dups );
+                char         *new_text = remove_dup_groups( strdup( w.text ), depth, ign_empty, &new_dups );
+
+                w.tests++;
+                w.with_dups += (0 != old_dups);
+                if ( old_dups != new_dups || STR_MATCH != strcmp( old_text, new_text ) ) {
+                    if ( w.fails++ < 8 ) {
+                        fprintf(stderr, "FAIL :: depth %u, ign_empty %u, %u vs %u dups for -->\n%s\n",
+                                        depth, ign_empty, old_dups, new_dups, w.text);
+                    }
+                }
+                (free)( old_text );
+                (free)( new_text );
+            }
+        }
+    }
+
+    fprintf(stderr, "remove_dup_groups() :: %u of %u tests failed (%u with duplicates).\n",
+                    w.fails, w.tests, w.with_dups);
+
+    return ( w.fails ? 1 : 0 );
+}
+
+#endif  /* } */
+
+
 /*
  ******************************************************************************
  ******************************************************************************
@@ -0,0 +1,310 @@
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "pa_misc.h"
+#include "pa_encoder.h"
+
+#ifndef realloc
+#warning "realloc() is not a macro..."
+#endif
+
+/**
+ *******************************************************************************
+ * A finished page waiting for an encoder.  The job owns the image and the
+ * filename.
+ */
+typedef struct encode_job_t {
+    pa_page_id_t id;
+    char        *filename;
+    pa_image_t  *image;
+    char         image_type[ sizeof ("jpg") ];  /* a copy, the caller's may not outlive the job */
+} encode_job_t;
+
+/**
+ *******************************************************************************
+ * A page that's been written, but not yet reported (a page before it is still
+ * being encoded).  A NULL 'filename' is a page that's not done yet.
+ */
+typedef struct encode_done_t {
+    char        *filename;
+    int          rc;
+} encode_done_t;
+
+struct pa_encoder_t {
+    pthread_mutex_t lock;
+    pthread_cond_t  not_empty;  /* for the encoders */
+    pthread_cond_t  not_full;   /* for 'queue_image_file()' */
+    pthread_cond_t  idle;       /* for 'drain_pa_encoder()' */
+
+    encode_job_t   *jobs;       /* a ring of 'max' jobs */
+    unsigned int    max;
+    unsigned int    head;
+    unsigned int    cnt;
+    unsigned int    busy;       /* # of jobs being encoded */
+    int             quit;
+
+    pthread_t      *threads;
+    unsigned int    thread_cnt;
+
+    int             report;     /* report each page as it's written */
+    pa_stats_t     *stats;      /* NULL :: no '--stats-json' */
+    encode_done_t  *pages;      /* indexed by page */
+    size_t          pages_max;
+    size_t          next_page;  /* the next page to report */
+    size_t          failed;
+};
+
+static void *encoder_thread( void * );
+static void  report_page   ( pa_encoder_t *, size_t page, char *filename, int rc );
+static void  report_done   ( pa_encoder_t *, encode_done_t * );
+
+
+/**
+ *******************************************************************************
+ * Start 'threads' encoders with room for 'queue_max' pages waiting on them.
+ *
+ * Returns NULL if not one encoder could be started (the pages are then
+ * written on the render thread, see 'save_pa_image()').
+ */
+pa_encoder_t *new_pa_encoder( unsigned int threads, unsigned int queue_max, int report, pa_stats_t *stats )
+{
+    pa_encoder_t *encoder = calloc( 1, sizeof (pa_encoder_t) );
+
+    pthread_mutex_init( &encoder->lock, NULL );
+    pthread_cond_init( &encoder->not_empty, NULL );
+    pthread_cond_init( &encoder->not_full, NULL );
+    pthread_cond_init( &encoder->idle, NULL );
+
+    encoder->max       = (queue_max > 0) ? queue_max : 1;
+    encoder->jobs      = calloc( encoder->max, sizeof (encode_job_t) );
+    encoder->report    = report;
+    encoder->stats     = stats;
+    encoder->next_page = 1;  /* the global sequence numbers start at 1 */
+
+    encoder->thread_cnt = 0;
+    encoder->threads    = calloc( threads, sizeof (pthread_t) );
+    for ( unsigned int ii = 0; ii < threads; ii++ ) {
+        if ( 0 != pthread_create( &encoder->threads[ encoder->thread_cnt ], NULL, encoder_thread, encoder ) ) {
+            fprintf(stderr, "WARNING :: started %u of %u encoder threads.\n", encoder->thread_cnt, threads);
+            break;
+        }
+        encoder->thread_cnt++;
+    }
+
+    if ( 0 == encoder->thread_cnt ) {
+        cleanup_pa_encoder( &encoder );
+    }
+
+    return ( encoder );
+}
+
+
+/**
+ *******************************************************************************
+ * Hand the page to the encoders, waiting if the queue is full.  The encoder
+ * takes the image (it's NULL'd) and 'filename' (which must be free()-able).
+ */
+void queue_image_file( pa_encoder_t *encoder, pa_page_id_t id, char *filename, pa_image_t **imagep, char const *const image_type )
+{
+
+    pthread_mutex_lock( &encoder->lock );
+    while ( encoder->cnt == encoder->max ) {
+        pthread_cond_wait( &encoder->not_full, &encoder->lock );
+    }
+
+    encode_job_t *job = &encoder->jobs[ (encoder->head + encoder->cnt) % encoder->max ];
+
+    job->id       = id;
+    job->filename = filename;
+    job->image    = *imagep;
+    snprintf(job->image_type, sizeof (job->image_type), "%s", image_type);
+    encoder->cnt++;
+    *imagep = NULL;
+
+    pthread_cond_signal( &encoder->not_empty );
+    pthread_mutex_unlock( &encoder->lock );
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * Wait for all of the queued pages to be written, and report any that are
+ * still waiting on a page that was never queued.
+ *
+ * Returns the # of pages that couldn't be written (so far).
+ */
+size_t drain_pa_encoder( pa_encoder_t *encoder )
+{
+    size_t failed;
+
+    pthread_mutex_lock( &encoder->lock );
+    while ( encoder->cnt > 0 || encoder->busy > 0 ) {
+        pthread_cond_wait( &encoder->idle, &encoder->lock );
+    }
+
+    for ( ; encoder->next_page < encoder->pages_max; encoder->next_page++ ) {
+        report_done( encoder, &encoder->pages[ encoder->next_page ] );
+    }
+    failed = encoder->failed;
+    pthread_mutex_unlock( &encoder->lock );
+
+    return ( failed );
+}
+
+
+/**
+ *******************************************************************************
+ */
+static void *encoder_thread( void *arg )
+{
+    pa_encoder_t *encoder = (pa_encoder_t *) arg;
+    encode_job_t  job;
+    image_io_t    io;
+    int           rc;
+
+
+    pthread_mutex_lock( &encoder->lock );
+    while ( 1 ) {
+        while ( 0 == encoder->cnt && 0 == encoder->quit ) {
+            pthread_cond_wait( &encoder->not_empty, &encoder->lock );
+        }
+        if ( 0 == encoder->cnt ) {
+            break;  /* 'quit' and nothing left */
+        }
+
+        job = encoder->jobs[ encoder->head ];
+        encoder->head = (encoder->head + 1) % encoder->max;
+        encoder->cnt--;
+        encoder->busy++;
+        pthread_cond_signal( &encoder->not_full );
+        pthread_mutex_unlock( &encoder->lock );
+
+        rc = write_image_file( job.filename, job.image, job.image_type, &io );
+        cleanup_pa_image( &job.image );
+
+        add_page_time( encoder->stats, job.id, PA_PHASE_ENCODE, io.encode_ns );
+        add_page_time( encoder->stats, job.id, PA_PHASE_WRITE, io.write_ns );
+        add_page_written( encoder->stats, job.id, job.filename, io.bytes );
+
+        pthread_mutex_lock( &encoder->lock );
+        encoder->busy--;
+        report_page( encoder, job.id.global, job.filename, rc );
+        if ( 0 == encoder->cnt && 0 == encoder->busy ) {
+            pthread_cond_broadcast( &encoder->idle );
+        }
+    }
+    pthread_mutex_unlock( &encoder->lock );
+
+    return ( NULL );
+}
+
+
+/**
+ *******************************************************************************
+ * Record the written page, then report all of the pages that are now done in
+ * page order.  Called with the lock held.
+ */
+static void report_page( pa_encoder_t *encoder, size_t page, char *filename, int rc )
+{
+
+    if ( page < encoder->next_page ) {  /* not a sequenced page */
+        encode_done_t done = { .filename = filename, .rc = rc };
+        report_done( encoder, &done );
+        return ;
+    }
+
+    if ( page >= encoder->pages_max ) {
+        size_t max = page + 64;
+        encoder->pages = realloc( encoder->pages, max * sizeof (encode_done_t) );
+        memset( &encoder->pages[ encoder->pages_max ], '\0', (max - encoder->pages_max) * sizeof (encode_done_t) );
+        encoder->pages_max = max;
+    }
+    encoder->pages[ page ] = (encode_done_t) { .filename = filename, .rc = rc };
+
+    while ( encoder->next_page < encoder->pages_max && NULL != encoder->pages[ encoder->next_page ].filename ) {
+        report_done( encoder, &encoder->pages[ encoder->next_page ] );
+        encoder->next_page++;
+    }
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+static void report_done( pa_encoder_t *encoder, encode_done_t *done )
+{
+
+    if ( NULL == done->filename ) {
+        return ;
+    }
+
+    if ( RC_TRUE != done->rc ) {
+        encoder->failed++;
+        fprintf(stderr, "ERROR :: '%s' was NOT written.\n", done->filename);
+    }
+    else if ( encoder->report ) {
+        fprintf(stderr, "Wrote :: '%s'\n", done->filename);
+    }
+
+    (free)( done->filename );
+    done->filename = NULL;
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * Write everything that's queued, then stop the encoders.
+ */
+void cleanup_pa_encoder( pa_encoder_t **p_encoder )
+{
+    pa_encoder_t *encoder = *p_encoder;
+
+    if ( NULL != encoder ) {
+        drain_pa_encoder( encoder );
+
+        pthread_mutex_lock( &encoder->lock );
+        encoder->quit = 1;
+        pthread_cond_broadcast( &encoder->not_empty );
+        pthread_mutex_unlock( &encoder->lock );
+
+        for ( unsigned int ii = 0; ii < encoder->thread_cnt; ii++ ) {
+            pthread_join( encoder->threads[ ii ], NULL );
+        }
+
+        pthread_cond_destroy( &encoder->idle );
+        pthread_cond_destroy( &encoder->not_full );
+        pthread_cond_destroy( &encoder->not_empty );
+        pthread_mutex_destroy( &encoder->lock );
+
+        (free)( encoder->threads );
+        (free)( encoder->jobs );
+        (free)( encoder->pages );
+
+        free( *p_encoder );
+    }
+
+    return ;
+}
@@ -0,0 +1,46 @@
+#ifndef PA_ENCODER_H
+#define PA_ENCODER_H
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ *******************************************************************************
+ * The output image encoders.
+ *
+ * Compressing a finished page (zlib or libjpeg) and writing it takes about as
+ * long as rendering the next one, so the pages are handed off to a few encoder
+ * threads instead.  The queue is bounded -- when it's full, 'queue_image_file()'
+ * waits (each queued page is a whole background sized image).
+ *
+ * The pages are reported in page order (by their global sequence number) no
+ * matter which encoder finishes first; see 'drain_pa_encoder()'.
+ */
+#include <ass/ass.h>
+#include "pa_misc.h"       /* for 'rc_e' */
+#include "rw_arrays.h"
+#include "rw_imagefile.h"
+#include "pa_stats.h"
+
+#undef PA_ENCODER_DEFAULT_THREADS
+#define PA_ENCODER_DEFAULT_THREADS  (2)
+
+typedef struct pa_encoder_t pa_encoder_t;
+
+pa_encoder_t *new_pa_encoder    ( unsigned int threads, unsigned int queue_max, int report, pa_stats_t * );
+void          queue_image_file  ( pa_encoder_t *, pa_page_id_t, char *filename, pa_image_t **imagep, char const *const image_type );
+size_t        drain_pa_encoder  ( pa_encoder_t * );
+void          cleanup_pa_encoder( pa_encoder_t ** );
+
+#endif  /* PA_ENCODER_H */
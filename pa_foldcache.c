@@ -0,0 +1,164 @@
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _GNU_SOURCE     /* asprintf() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "pa_misc.h"
+#include "pa_foldcache.h"
+
+#ifndef realloc
+#warning "realloc() is not a macro..."
+#endif
+
+/**
+ *******************************************************************************
+ * The file is this, then 'cnt' segments.  It's only ever read back on the
+ * same machine, so it's in the native byte order.
+ */
+typedef struct fold_header_t {
+    char      magic[ 8 ];  /* "PAFOLD" and the version */
+    uint64_t  key;
+    uint32_t  pages;
+    uint32_t  cnt;
+} fold_header_t;
+
+/**
+ *******************************************************************************
+ * What 'save_fold_cache()' hands to 'write_fold_cache()'.
+ */
+typedef struct fold_file_t {
+    fold_header_t         header;
+    fold_segment_t const *segments;
+    size_t                cnt;
+} fold_file_t;
+
+static void make_header     ( fold_header_t *, uint64_t key, size_t cnt, size_t pages );
+static rc_e write_fold_cache( FILE *, void * );
+
+
+/**
+ *******************************************************************************
+ * Returns RC_TRUE if there's a file for 'key' and it's whole.
+ */
+rc_e load_fold_cache( char const *const dir, uint64_t key, fold_segment_t *segments, size_t max, size_t *cnt, size_t *pages )
+{
+    struct {
+        char          *filename;
+        FILE          *file;
+        fold_header_t  expect;
+        fold_header_t  header;
+        rc_e           rc;
+    } w = {
+        .filename = NULL,
+        .rc       = RC_FALSE,
+    };
+
+
+    asprintf(&w.filename, "%s%s%016" PRIx64 ".fold", dir, PA_PATH_SEP, key);
+    if ( NULL == (w.file = fopen(w.filename, "rb")) ) {
+        (free)( w.filename );
+        return ( RC_FALSE );
+    }
+
+    if ( 1 == fread( &w.header, sizeof (fold_header_t), 1, w.file ) ) {
+        make_header( &w.expect, key, w.header.cnt, w.header.pages );
+        if (   0 == memcmp( &w.expect, &w.header, sizeof (fold_header_t) )
+            && w.header.cnt > 0 && w.header.cnt <= max
+            && w.header.cnt == fread( segments, sizeof (fold_segment_t), w.header.cnt, w.file )
+            && EOF == fgetc( w.file )
+           ) {
+            *cnt   = w.header.cnt;
+            *pages = w.header.pages;
+            w.rc   = RC_TRUE;
+        }
+    }
+    if ( RC_TRUE != w.rc ) {
+        fprintf(stderr, "WARNING :: ignoring '%s', it's not a valid fold cache file.\n", w.filename);
+    }
+
+    fclose( w.file );
+    (free)( w.filename );
+
+    return ( w.rc );
+}
+
+
+/**
+ *******************************************************************************
+ */
+rc_e save_fold_cache( char const *const dir, uint64_t key, fold_segment_t const *segments, size_t cnt, size_t pages )
+{
+    struct {
+        char          *filename;
+        fold_file_t    file;
+        rc_e           rc;
+    } w = {
+        .filename = NULL,
+        .file     = {
+            .segments = segments,
+            .cnt      = cnt,
+        },
+    };
+
+
+    asprintf(&w.filename, "%s%s%016" PRIx64 ".fold", dir, PA_PATH_SEP, key);
+
+    make_header( &w.file.header, key, cnt, pages );
+    w.rc = write_file_renamed( w.filename, write_fold_cache, &w.file );
+    if ( RC_TRUE != w.rc ) {
+        fprintf(stderr, "WARNING :: can't write the fold cache file '%s'.\n", w.filename);
+    }
+
+    (free)( w.filename );
+
+    return ( w.rc );
+}
+
+
+/**
+ *******************************************************************************
+ */
+static rc_e write_fold_cache( FILE *file, void *data )
+{
+    fold_file_t const *fold_file = data;
+
+    if (   1 == fwrite( &fold_file->header, sizeof (fold_header_t), 1, file )
+        && fold_file->cnt == fwrite( fold_file->segments, sizeof (fold_segment_t), fold_file->cnt, file )
+       ) {
+        return ( RC_TRUE );
+    }
+
+    return ( RC_FALSE );
+}
+
+
+/**
+ *******************************************************************************
+ */
+static void make_header( fold_header_t *header, uint64_t key, size_t cnt, size_t pages )
+{
+
+    memset( header, '\0', sizeof (fold_header_t) );
+    snprintf(header->magic, sizeof (header->magic), "PAFOLD%c", '0' + PA_FOLDCACHE_VERSION);
+    header->key   = key;
+    header->pages = pages;
+    header->cnt   = cnt;
+
+    return ;
+}
@@ -0,0 +1,49 @@
+#ifndef PA_FOLDCACHE_H
+#define PA_FOLDCACHE_H
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ *******************************************************************************
+ * The '--fold-cache=DIR' files.
+ *
+ * PASS 1 (fitting the text onto the pages) is most of the run, but the way a
+ * chapter folds only depends on its work text, the text templates, the frame
+ * sizes, the fonts and a few options (see 'get_fold_key()' in pngass.c).  So
+ * the chapter's text segments are saved under a hash of exactly those, and a
+ * later run with the same key skips straight to the final renders.
+ *
+ * A file is 'DIR/<key in hex>.fold', it's written to a temporary file and
+ * renamed so that a reader never sees a partial file.
+ */
+#include <stdint.h>
+
+#include "pa_misc.h"       /* for 'rc_e' */
+
+#undef PA_FOLDCACHE_VERSION
+#define PA_FOLDCACHE_VERSION  (2)  /* bump this if the fold itself changes (or its key) */
+
+typedef struct fold_segment_t {
+    uint32_t  text_start_idx;
+    uint32_t  work_text_delta;
+    int16_t   clipped;
+    int16_t   pieces;
+} fold_segment_t;
+
+rc_e  load_fold_cache( char const *const dir, uint64_t key, fold_segment_t *segments, size_t max, size_t *cnt, size_t *pages );
+rc_e  save_fold_cache( char const *const dir, uint64_t key, fold_segment_t const *segments, size_t cnt, size_t pages );
+
+#endif  /* PA_FOLDCACHE_H */
@@ -0,0 +1,743 @@
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _GNU_SOURCE     /* asprintf() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "pa_misc.h"
+#include "pa_measure.h"
+
+#if defined(ENABLE_FT_MEASURE)
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_ADVANCES_H
+#include FT_TRUETYPE_TABLES_H
+#include <fontconfig/fontconfig.h>
+#endif
+
+#ifndef realloc
+#warning "realloc() is not a macro..."
+#endif
+
+#if defined(ENABLE_FT_MEASURE)
+
+#undef PA_MEASURE_ADVANCES
+#define PA_MEASURE_ADVANCES  (0x2100)  /* cached code points, through General Punctuation */
+
+#undef VALIGN_TOP
+#define VALIGN_TOP           (4)       /* libass's (not the numpad) 'Alignment' */
+
+/**
+ *******************************************************************************
+ * A face in one of the '--fonts-dir's.  libass loads all of those as memory
+ * fonts, so they're found by their family name before fontconfig is asked.
+ */
+typedef struct dir_face_t {
+    char   *family;
+    int     bold;
+    int     italic;
+    char   *pathname;
+    long    index;
+} dir_face_t;
+
+/**
+ *******************************************************************************
+ * A face as it's named by a style or a '\fn' tag.  The advances are in font
+ * units, so they're good for any size.
+ */
+typedef struct measure_face_t {
+    char    *name;
+    int      bold;
+    int      italic;
+    FT_Face  face;          /* NULL :: no such font */
+    double   em_height;     /* font units per pixel of font size, see 'open_face()' */
+    int32_t *advances;      /* -1 :: not loaded yet */
+} measure_face_t;
+
+struct pa_measure_t {
+    FT_Library      ft_library;
+    FcConfig       *fc_config;  /* built for the first font NOT in a '--fonts-dir' */
+
+    size_t          dir_faces_cnt;
+    dir_face_t     *dir_faces;
+
+    unsigned int    faces_cnt;
+    measure_face_t  faces[ PA_MEASURE_MAX_FACES ];
+};
+
+/**
+ *******************************************************************************
+ * The layout of the event's Text so far.  The font is what the style and the
+ * override tags say it is right now.
+ */
+typedef struct layout_t {
+    pa_measure_t    *pa_measure;
+    ASS_Style const *style;
+    double           sx;            /* PlayRes to frame pixels */
+    double           sy;
+    double           max_w;         /* the wrap width */
+    double           bottom;
+    double           line_spacing;
+    int              align;         /* the numpad '\an' */
+    int              wrap_style;
+
+    measure_face_t  *face;          /* NULL :: look it up for the next glyph */
+    char             font_name[ 256 ];
+    int              bold;
+    int              italic;
+    double           size;
+    double           scale_x;
+    double           scale_y;
+    double           spacing;
+
+    double           y;             /* the top of the current line */
+    double           x;             /* ... and its width so far */
+    double           line_h;        /* its height, before the current word */
+    int              has_space;     /* a break before the current word is possible */
+    int              in_word;
+    double           word_x;        /* where the current word starts */
+    double           word_h;        /* ... and its height so far */
+    unsigned int     word_idx;
+
+    int              stopped;       /* the text crossed the bottom ... */
+    unsigned int     stop_idx;      /* ... with the word that starts here */
+} layout_t;
+
+static void            scan_font_dir( pa_measure_t *, char const *const dirname );
+static measure_face_t *get_face     ( pa_measure_t *, char const *const name, int bold, int italic );
+static rc_e            open_face    ( pa_measure_t *, measure_face_t *, char const *const pathname, long index );
+static int32_t         get_advance  ( measure_face_t *, uint32_t cp );
+static void            reset_style  ( layout_t * );
+static rc_e            parse_tags   ( layout_t *, char const *tags, char const *const end );
+static rc_e            layout_text  ( layout_t *, char const *const text, int counted );
+static uint32_t        next_utf8    ( char const **p_ptr );
+
+
+/**
+ *******************************************************************************
+ * FreeType and the faces in the '--fonts-dir's.  fontconfig is only set up
+ * if a font isn't found in those.
+ */
+pa_measure_t *new_pa_measure( strptrary_t *font_dirs )
+{
+    pa_measure_t *pa_measure = calloc( 1, sizeof (pa_measure_t) );
+
+    if ( 0 != FT_Init_FreeType( &pa_measure->ft_library ) ) {
+        fprintf(stderr, "WARNING :: 'FT_Init_FreeType()' failed, NOT measuring the text.\n");
+        free( pa_measure );
+        return ( NULL );
+    }
+
+    for ( size_t idx = 0; idx < font_dirs->cnt; idx++ ) {
+        scan_font_dir( pa_measure, font_dirs->pathnames[ idx ] );
+    }
+
+    return ( pa_measure );
+}
+
+
+/**
+ *******************************************************************************
+ * Lay out the event's Text (the template's tags) followed by 'text' in the
+ * track's style for a 'width' x 'height' frame, and set '*p_len' to the # of
+ * bytes of 'text' up to the first word that crosses 'bottom' (or all of it).
+ *
+ * Returns RC_FALSE if the layout can't be predicted -- no font, positioned
+ * or drawn text, or text that isn't top aligned (that grows upwards).
+ */
+rc_e measure_fold( pa_measure_t *pa_measure, ASS_Track const *track, int width, int height, int bottom, double line_spacing, char const *const text, unsigned int *p_len )
+{
+    struct {
+        ASS_Event const *event;
+        layout_t         lo;
+        int              margin_l;
+        int              margin_r;
+        int              margin_v;
+    } w;
+
+
+    if ( NULL == pa_measure || NULL == track || 1 != track->n_events || NULL == track->events[ 0 ].Text ) {
+        return ( RC_FALSE );
+    }
+    if ( track->events[ 0 ].Style < 0 || track->events[ 0 ].Style >= track->n_styles || track->PlayResX <= 0 || track->PlayResY <= 0 ) {
+        return ( RC_FALSE );
+    }
+
+    w.event    = &track->events[ 0 ];
+    w.margin_l = w.event->MarginL ? w.event->MarginL : track->styles[ w.event->Style ].MarginL;
+    w.margin_r = w.event->MarginR ? w.event->MarginR : track->styles[ w.event->Style ].MarginR;
+    w.margin_v = w.event->MarginV ? w.event->MarginV : track->styles[ w.event->Style ].MarginV;
+
+    w.lo = (layout_t) {
+        .pa_measure   = pa_measure,
+        .style        = &track->styles[ w.event->Style ],
+        .sx           = (double) width / track->PlayResX,
+        .sy           = (double) height / track->PlayResY,
+        .bottom       = bottom,
+        .line_spacing = line_spacing,
+        .align        = (track->styles[ w.event->Style ].Alignment & VALIGN_TOP) ? 7 : 2,
+        .wrap_style   = track->WrapStyle,
+    };
+    w.lo.max_w = (track->PlayResX - w.margin_l - w.margin_r) * w.lo.sx;
+    w.lo.y     = w.margin_v * w.lo.sy;
+    reset_style( &w.lo );
+
+    if ( RC_TRUE != layout_text( &w.lo, w.event->Text, 0 ) || w.lo.align < 7 || w.lo.align > 9 ) {
+        return ( RC_FALSE );
+    }
+    if ( w.lo.stopped ) {
+        *p_len = 0;  /* not even the template's own Text fits */
+        return ( RC_TRUE );
+    }
+
+    if ( RC_TRUE != layout_text( &w.lo, text, 1 ) ) {
+        return ( RC_FALSE );
+    }
+    *p_len = w.lo.stopped ? w.lo.stop_idx : strlen( text );
+
+    return ( RC_TRUE );
+}
+
+
+/**
+ *******************************************************************************
+ * Lay out 'text' from where the layout left off.  Only a 'counted' text's
+ * word offsets are the ones returned by 'measure_fold()'.
+ */
+static rc_e O3 layout_text( layout_t *lo, char const *const text, int counted )
+{
+    auto void new_line( double height );
+    char const *ptr = text;
+
+    while ( '\0' != *ptr && 0 == lo->stopped ) {
+        char const *start = ptr;
+
+        /*
+         ***********************************************************************
+         * An override block, or one of the backslash escapes.
+         */
+        if ( '{' == *ptr ) {
+            char const *end = strchr( ptr, '}' );
+
+            if ( NULL != end ) {
+                if ( RC_TRUE != parse_tags( lo, ptr + 1, end ) ) {
+                    return ( RC_FALSE );
+                }
+                ptr = end + 1;
+                continue;
+            }
+        }
+
+        uint32_t cp = next_utf8( &ptr );
+
+        if ( '\\' == cp && ('N' == *ptr || 'n' == *ptr || 'h' == *ptr) ) {
+            cp = *ptr++;
+            if ( 'N' == cp || ('n' == cp && 2 == lo->wrap_style) ) {
+                new_line( lo->size * lo->scale_y * lo->sy );
+                continue;
+            }
+            cp = ('h' == cp) ? 0xA0 : ' ';
+        }
+        else if ( '\n' == cp || '\t' == cp ) {
+            cp = ' ';
+        }
+
+        /*
+         ***********************************************************************
+         * The glyph.  Its height is the font's (that's what libass's line
+         * height is) even if it doesn't have an advance, see '--pad-paragraph'.
+         */
+        if ( NULL == lo->face ) {
+            lo->face = get_face( lo->pa_measure, lo->font_name, lo->bold, lo->italic );
+            if ( NULL == lo->face ) {
+                return ( RC_FALSE );
+            }
+        }
+
+        double h = lo->size * lo->scale_y * lo->sy;
+        double a = (get_advance( lo->face, cp ) * lo->size / lo->face->em_height + lo->spacing) * lo->scale_x * lo->sx;
+
+        if ( ' ' == cp ) {
+            if ( lo->in_word ) {
+                lo->line_h  = (lo->word_h > lo->line_h) ? lo->word_h : lo->line_h;
+                lo->in_word = 0;
+            }
+            lo->x        += a;
+            lo->line_h    = (h > lo->line_h) ? h : lo->line_h;
+            lo->has_space = 1;
+            continue;
+        }
+
+        if ( 0 == lo->in_word ) {
+            lo->in_word  = 1;
+            lo->word_x   = lo->x;
+            lo->word_h   = 0.0;
+            lo->word_idx = counted ? (unsigned int) (start - text) : 0;
+        }
+
+        /*
+         ***********************************************************************
+         * Wrap before the word (and after the SPACE) if this glyph doesn't
+         * fit.  A word that's wider than the line overflows it, like libass.
+         */
+        if ( lo->has_space && 2 != lo->wrap_style && (lo->x + a) > lo->max_w ) {
+            lo->y        += lo->line_h + lo->line_spacing;
+            lo->x        -= lo->word_x;
+            lo->word_x    = 0.0;
+            lo->line_h    = 0.0;
+            lo->has_space = 0;
+        }
+
+        lo->x     += a;
+        lo->word_h = (h > lo->word_h) ? h : lo->word_h;
+
+        if ( lo->y + ((lo->word_h > lo->line_h) ? lo->word_h : lo->line_h) > lo->bottom ) {
+            lo->stopped  = 1;
+            lo->stop_idx = lo->word_idx;
+        }
+    }
+
+    return ( RC_TRUE );
+
+
+    /**
+     ***************************************************************************
+     * A hard break ('\N').  An empty line is as tall as the current font.
+     */
+    void new_line( double height )
+    {
+        if ( lo->in_word ) {
+            lo->line_h = (lo->word_h > lo->line_h) ? lo->word_h : lo->line_h;
+        }
+        if ( 0.0 == lo->line_h ) {
+            lo->line_h = height;
+        }
+
+        lo->y        += lo->line_h + lo->line_spacing;
+        lo->x         = 0.0;
+        lo->line_h    = 0.0;
+        lo->has_space = 0;
+        lo->in_word   = 0;
+
+        return ;
+    }
+}
+
+
+/**
+ *******************************************************************************
+ * The tags in an override block that change the layout.  The rest (colours,
+ * borders, etc.) don't move anything and are skipped.
+ */
+static rc_e parse_tags( layout_t *lo, char const *tags, char const *const end )
+{
+    auto int    is_tag( char const *const name );
+    auto double arg_or( double dflt );
+
+    while ( tags < end ) {
+        if ( '\\' != *tags++ ) {
+            continue;
+        }
+
+        if ( is_tag( "pos" ) || is_tag( "move" ) || is_tag( "org" ) ) {
+            return ( RC_FALSE );  /* positioned, the margins don't apply */
+        }
+        else if ( is_tag( "fscx" ) ) {
+            lo->scale_x = arg_or( lo->style->ScaleX * 100.0 ) / 100.0;
+        }
+        else if ( is_tag( "fscy" ) ) {
+            lo->scale_y = arg_or( lo->style->ScaleY * 100.0 ) / 100.0;
+        }
+        else if ( is_tag( "fsp" ) ) {
+            lo->spacing = arg_or( lo->style->Spacing );
+        }
+        else if ( is_tag( "fs" ) && ('.' == *tags || ('0' <= *tags && *tags <= '9') || '\\' == *tags || tags == end) ) {
+            lo->size = arg_or( lo->style->FontSize );
+        }
+        else if ( is_tag( "fn" ) ) {
+            size_t len = strcspn( tags, "\\}" );
+
+            if ( 0 == len ) {
+                snprintf(lo->font_name, sizeof (lo->font_name), "%s", lo->style->FontName);
+            }
+            else {
+                snprintf(lo->font_name, sizeof (lo->font_name), "%.*s", (int) len, tags);
+            }
+            lo->face = NULL;
+        }
+        else if ( is_tag( "an" ) ) {
+            lo->align = (int) arg_or( 7 );
+        }
+        else if ( is_tag( "q" ) ) {
+            lo->wrap_style = (int) arg_or( lo->wrap_style );
+        }
+        else if ( is_tag( "r" ) ) {
+            reset_style( lo );
+        }
+        else if ( 'b' == *tags && (('0' <= tags[ 1 ] && tags[ 1 ] <= '9') || '\\' == tags[ 1 ] || '}' == tags[ 1 ]) ) {
+            tags++;
+            int bold = (int) arg_or( lo->style->Bold ? 1 : 0 );
+            lo->bold = (1 == bold || bold >= 700);
+            lo->face = NULL;
+        }
+        else if ( 'i' == *tags && (('0' <= tags[ 1 ] && tags[ 1 ] <= '9') || '\\' == tags[ 1 ] || '}' == tags[ 1 ]) ) {
+            tags++;
+            lo->italic = (0 != (int) arg_or( lo->style->Italic ? 1 : 0 ));
+            lo->face   = NULL;
+        }
+        else if ( 'p' == *tags && '0' <= tags[ 1 ] && tags[ 1 ] <= '9' ) {
+            tags++;
+            if ( 0 != (int) arg_or( 0 ) ) {
+                return ( RC_FALSE );  /* a drawing */
+            }
+        }
+    }
+
+    return ( RC_TRUE );
+
+
+    int is_tag( char const *const name )
+    {
+        size_t len = strlen( name );
+
+        if ( 0 == strncmp( tags, name, len ) ) {
+            tags += len;
+            return ( 1 );
+        }
+        return ( 0 );
+    }
+
+    double arg_or( double dflt )
+    {
+        char  *num_end;
+        double num = strtod( tags, &num_end );
+
+        if ( num_end == tags || num_end > end ) {
+            return ( dflt );
+        }
+        tags = num_end;
+        return ( num );
+    }
+}
+
+
+/**
+ *******************************************************************************
+ * Back to the event's style ('\r' and the start of the event).  libass keeps
+ * the scales as fractions (i.e., 100% is 1.0).
+ */
+static void reset_style( layout_t *lo )
+{
+    ASS_Style const *style = lo->style;
+
+    snprintf(lo->font_name, sizeof (lo->font_name), "%s", (NULL != style->FontName) ? style->FontName : "");
+    lo->face    = NULL;
+    lo->bold    = (0 != style->Bold);
+    lo->italic  = (0 != style->Italic);
+    lo->size    = style->FontSize;
+    lo->scale_x = (style->ScaleX > 0.0) ? style->ScaleX : 1.0;
+    lo->scale_y = (style->ScaleY > 0.0) ? style->ScaleY : 1.0;
+    lo->spacing = style->Spacing;
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * The face for a style's (or '\fn') font name, opened the first time it's
+ * asked for.  A '--fonts-dir' face with the same family name wins (with the
+ * same bold / italic if there is one), otherwise it's whatever fontconfig
+ * matches (which is what libass would use).
+ */
+static measure_face_t *get_face( pa_measure_t *pa_measure, char const *const name, int bold, int italic )
+{
+    struct {
+        measure_face_t *face;
+        dir_face_t     *dir_face;
+        FcPattern      *pattern;
+        FcPattern      *match;
+        FcResult        result;
+        FcChar8        *file;
+        int             index;
+    } w = {
+        .dir_face = NULL,
+    };
+
+
+    for ( unsigned int idx = 0; idx < pa_measure->faces_cnt; idx++ ) {
+        w.face = &pa_measure->faces[ idx ];
+        if ( 0 == strcmp( w.face->name, name ) && bold == w.face->bold && italic == w.face->italic ) {
+            return ( (NULL != w.face->face) ? w.face : NULL );
+        }
+    }
+    if ( pa_measure->faces_cnt >= PA_MEASURE_MAX_FACES ) {
+        return ( NULL );
+    }
+
+    w.face = &pa_measure->faces[ pa_measure->faces_cnt++ ];
+    *w.face = (measure_face_t) {
+        .name   = strdup( name ),
+        .bold   = bold,
+        .italic = italic,
+        .face   = NULL,
+    };
+
+    for ( size_t idx = 0; idx < pa_measure->dir_faces_cnt; idx++ ) {
+        dir_face_t *dir_face = &pa_measure->dir_faces[ idx ];
+
+        if ( 0 == strcasecmp( dir_face->family, name ) ) {
+            if ( NULL == w.dir_face || (bold == dir_face->bold && italic == dir_face->italic) ) {
+                w.dir_face = dir_face;
+            }
+        }
+    }
+    if ( NULL != w.dir_face ) {
+        open_face( pa_measure, w.face, w.dir_face->pathname, w.dir_face->index );
+        return ( (NULL != w.face->face) ? w.face : NULL );
+    }
+
+    if ( NULL == pa_measure->fc_config ) {
+        pa_measure->fc_config = FcInitLoadConfigAndFonts();
+        if ( NULL == pa_measure->fc_config ) {
+            return ( NULL );
+        }
+    }
+
+    w.pattern = FcPatternCreate();
+    FcPatternAddString( w.pattern, FC_FAMILY, (FcChar8 const *) name );
+    FcPatternAddInteger( w.pattern, FC_WEIGHT, bold ? FC_WEIGHT_BOLD : FC_WEIGHT_MEDIUM );
+    FcPatternAddInteger( w.pattern, FC_SLANT, italic ? FC_SLANT_ITALIC : FC_SLANT_ROMAN );
+    FcConfigSubstitute( pa_measure->fc_config, w.pattern, FcMatchPattern );
+    FcDefaultSubstitute( w.pattern );
+
+    w.match = FcFontMatch( pa_measure->fc_config, w.pattern, &w.result );
+    if ( NULL != w.match && FcResultMatch == FcPatternGetString( w.match, FC_FILE, 0, &w.file ) ) {
+        if ( FcResultMatch != FcPatternGetInteger( w.match, FC_INDEX, 0, &w.index ) ) {
+            w.index = 0;
+        }
+        open_face( pa_measure, w.face, (char const *) w.file, w.index );
+    }
+
+    if ( NULL != w.match ) {
+        FcPatternDestroy( w.match );
+    }
+    FcPatternDestroy( w.pattern );
+
+    return ( (NULL != w.face->face) ? w.face : NULL );
+}
+
+
+/**
+ *******************************************************************************
+ * libass sizes a face so that its (OS/2 Windows) ascent + descent is the font
+ * size (see 'ass_face_set_size()'), so that's the # of font units per pixel.
+ */
+static rc_e open_face( pa_measure_t *pa_measure, measure_face_t *face, char const *const pathname, long index )
+{
+    TT_OS2 *os2;
+
+    if ( 0 != FT_New_Face( pa_measure->ft_library, pathname, index, &face->face ) ) {
+        face->face = NULL;
+        return ( RC_FALSE );
+    }
+
+    os2 = FT_Get_Sfnt_Table( face->face, FT_SFNT_OS2 );
+    if ( NULL != os2 && (os2->usWinAscent + os2->usWinDescent) > 0 ) {
+        face->em_height = os2->usWinAscent + os2->usWinDescent;
+    }
+    else if ( (face->face->ascender - face->face->descender) > 0 ) {
+        face->em_height = face->face->ascender - face->face->descender;
+    }
+    else {
+        face->em_height = face->face->units_per_EM ? face->face->units_per_EM : 1000;
+    }
+
+    face->advances = malloc( PA_MEASURE_ADVANCES * sizeof (int32_t) );
+    memset( face->advances, 0xff, PA_MEASURE_ADVANCES * sizeof (int32_t) );
+
+    return ( RC_TRUE );
+}
+
+
+/**
+ *******************************************************************************
+ * The unscaled advance of 'cp'.  The format characters (like the ZERO WIDTH
+ * SPACE) don't advance even if the font has a glyph for them.
+ */
+static int32_t O3 get_advance( measure_face_t *face, uint32_t cp )
+{
+    FT_Fixed advance = 0;
+
+    if ( cp < PA_MEASURE_ADVANCES && face->advances[ cp ] >= 0 ) {
+        return ( face->advances[ cp ] );
+    }
+
+    if ( (cp >= 0x200B && cp <= 0x200F) || 0x2060 == cp || 0xFEFF == cp ) {
+        advance = 0;
+    }
+    else if ( 0 != FT_Get_Advance( face->face, FT_Get_Char_Index( face->face, cp ), FT_LOAD_NO_SCALE | FT_LOAD_NO_HINTING, &advance ) ) {
+        advance = 0;
+    }
+
+    if ( cp < PA_MEASURE_ADVANCES ) {
+        face->advances[ cp ] = (int32_t) advance;
+    }
+
+    return ( (int32_t) advance );
+}
+
+
+/**
+ *******************************************************************************
+ * Note the family and style of every face of every font file in 'dirname'.
+ * Anything FreeType can't open is skipped (like libass does).
+ */
+static void scan_font_dir( pa_measure_t *pa_measure, char const *const dirname )
+{
+    DIR           *dir = opendir( dirname );
+    struct dirent *ent;
+    struct stat    sb;
+    char          *path;
+    FT_Face        face;
+
+    while ( NULL != dir && NULL != (ent = readdir( dir )) ) {
+        asprintf(&path, "%s%s%s", dirname, PA_PATH_SEP, ent->d_name);
+
+        if ( 0 == stat( path, &sb ) && S_ISREG( sb.st_mode ) && 0 == FT_New_Face( pa_measure->ft_library, path, -1, &face ) ) {
+            long faces = face->num_faces;
+
+            FT_Done_Face( face );
+            for ( long index = 0; index < faces; index++ ) {
+                if ( 0 != FT_New_Face( pa_measure->ft_library, path, index, &face ) ) {
+                    continue;
+                }
+                if ( NULL != face->family_name ) {
+                    pa_measure->dir_faces = realloc( pa_measure->dir_faces, (pa_measure->dir_faces_cnt + 1) * sizeof (dir_face_t) );
+                    pa_measure->dir_faces[ pa_measure->dir_faces_cnt++ ] = (dir_face_t) {
+                        .family   = strdup( face->family_name ),
+                        .bold     = (0 != (face->style_flags & FT_STYLE_FLAG_BOLD)),
+                        .italic   = (0 != (face->style_flags & FT_STYLE_FLAG_ITALIC)),
+                        .pathname = strdup( path ),
+                        .index    = index,
+                    };
+                }
+                FT_Done_Face( face );
+            }
+        }
+        (free)( path );
+    }
+
+    if ( NULL != dir ) {
+        closedir( dir );
+    }
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * Decode the UTF-8 character at '*p_ptr' and step over it.  A bad byte is
+ * taken as is, it's just measured as whatever glyph that is.
+ */
+static uint32_t O3 next_utf8( char const **p_ptr )
+{
+    unsigned char const *ptr = (unsigned char const *) *p_ptr;
+    uint32_t cp = *ptr++;
+    int      more = 0;
+
+    if ( cp >= 0xF0 && cp < 0xF8 ) {
+        cp &= 0x07;
+        more = 3;
+    }
+    else if ( cp >= 0xE0 ) {
+        cp &= 0x0F;
+        more = 2;
+    }
+    else if ( cp >= 0xC0 ) {
+        cp &= 0x1F;
+        more = 1;
+    }
+
+    for ( ; more > 0 && 0x80 == (*ptr & 0xC0); more-- ) {
+        cp = (cp << 6) | (*ptr++ & 0x3F);
+    }
+
+    *p_ptr = (char const *) ptr;
+
+    return ( cp );
+}
+
+
+void cleanup_pa_measure( pa_measure_t **p_pa_measure )
+{
+    pa_measure_t *pa_measure = *p_pa_measure;
+
+    if ( NULL != pa_measure ) {
+        for ( unsigned int idx = 0; idx < pa_measure->faces_cnt; idx++ ) {
+            if ( NULL != pa_measure->faces[ idx ].face ) {
+                FT_Done_Face( pa_measure->faces[ idx ].face );
+            }
+            free( pa_measure->faces[ idx ].advances );
+            free( pa_measure->faces[ idx ].name );
+        }
+        for ( size_t idx = 0; idx < pa_measure->dir_faces_cnt; idx++ ) {
+            free( pa_measure->dir_faces[ idx ].family );
+            free( pa_measure->dir_faces[ idx ].pathname );
+        }
+        free( pa_measure->dir_faces );
+
+        if ( NULL != pa_measure->fc_config ) {
+            FcConfigDestroy( pa_measure->fc_config );
+        }
+        FT_Done_FreeType( pa_measure->ft_library );
+
+        free( *p_pa_measure );
+    }
+
+    return ;
+}
+
+#else  /* ENABLE_FT_MEASURE */
+
+/**
+ *******************************************************************************
+ * Built without FreeType -- nothing is ever measured.
+ */
+pa_measure_t *new_pa_measure( UNUSED_ARG strptrary_t *font_dirs )
+{
+    return ( NULL );
+}
+
+
+rc_e measure_fold( UNUSED_ARG pa_measure_t *pa_measure, UNUSED_ARG ASS_Track const *track, UNUSED_ARG int width, UNUSED_ARG int height, UNUSED_ARG int bottom, UNUSED_ARG double line_spacing, UNUSED_ARG char const *const text, UNUSED_ARG unsigned int *p_len )
+{
+    return ( RC_FALSE );
+}
+
+
+void cleanup_pa_measure( UNUSED_ARG pa_measure_t **p_pa_measure )
+{
+    return ;
+}
+
+#endif  /* ENABLE_FT_MEASURE */
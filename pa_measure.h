@@ -0,0 +1,49 @@
+#ifndef PA_MEASURE_H
+#define PA_MEASURE_H
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ *******************************************************************************
+ * The '--fold-measure' layout, the fitting pass WITHOUT rasterising anything.
+ *
+ * Lays out a template's text with FreeType's advances and the template's
+ * style (the font, its size and scale, the margins, '--line-spacing'), wraps
+ * it at the SPACEs like '{\q1}' does, and stacks the lines down from the top
+ * margin until one would cross the bottom margin.  That's a prediction of the
+ * break -- libass's shaping, kerning, smart wrapping and the glyphs' ink are
+ * not modelled -- so PASS 1 uses it to seed its search and libass still has
+ * the final say (see 'gallop_fold_search()' in pngass.c).
+ *
+ * Only built with -DENABLE_FT_MEASURE, otherwise 'new_pa_measure()' returns
+ * NULL and nothing is ever measured.  One per thread (FreeType's FT_Library
+ * and its faces are NOT shared between threads).
+ */
+#include <ass/ass.h>
+
+#include "pa_misc.h"    /* for 'rc_e' */
+#include "rw_arrays.h"  /* for 'strptrary_t' */
+
+#undef PA_MEASURE_MAX_FACES
+#define PA_MEASURE_MAX_FACES  (16)  /* # of distinct font name / bold / italic */
+
+typedef struct pa_measure_t pa_measure_t;
+
+pa_measure_t *new_pa_measure    ( strptrary_t *font_dirs );
+rc_e          measure_fold      ( pa_measure_t *, ASS_Track const *, int width, int height, int bottom, double line_spacing, char const *const text, unsigned int *p_len );
+void          cleanup_pa_measure( pa_measure_t ** );
+
+#endif  /* PA_MEASURE_H */
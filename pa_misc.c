@@ -22,6 +22,7 @@
 #include <sys/stat.h>
 #include <unistd.h>  /* getopt() */
 #include <libgen.h>
+#include <time.h>
 
 #include "pa_misc.h"
 
@@ -206,6 +207,87 @@ char const * O3 val_to_roman(size_t val, char /* ROMAN_STR_SIZE */ *ptr)
 }
 
 
+/**
+ *******************************************************************************
+ * A wall clock for timing things (it's not affected by changes to the date),
+ * in nanoseconds.
+ */
+uint64_t get_monotonic_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ( (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec );
+}
+
+
+/**
+ *******************************************************************************
+ * FNV-1a, 64 bits -- start with FNV1A_64_INIT and chain the calls to hash more
+ * than one thing.  It's for cache keys, NOT for anything that's security
+ * related.
+ */
+uint64_t fnv1a_64(uint64_t hash, void const *data, size_t len)
+{
+    unsigned char const *p = data;
+
+    for ( size_t idx = 0; idx < len; idx++ ) {
+        hash ^= p[ idx ];
+        hash *= 0x100000001b3ULL;  /* the FNV prime */
+    }
+
+    return ( hash );
+}
+
+
+/**
+ *******************************************************************************
+ * Write 'filename' with 'write_f' to a temporary file next to it and rename
+ * it, so that a reader (this or another pngass) never sees a partial file.
+ * 'write_f' returns RC_FALSE if it couldn't write everything.
+ *
+ * Returns RC_FALSE (and there's no file left behind) if it wasn't written.
+ */
+rc_e write_file_renamed(char const *const filename, write_file_f write_f, void *data)
+{
+    struct {
+        char  *tmpname;
+        FILE  *file;
+        int    fd;
+        rc_e   rc;
+    } w = {
+        .tmpname = NULL,
+        .file    = NULL,
+        .rc      = RC_FALSE,
+    };
+
+
+    asprintf(&w.tmpname, "%s.XXXXXX", filename);
+    if (   -1 != (w.fd = mkstemp( w.tmpname ))
+        && NULL != (w.file = fdopen( w.fd, "wb" ))
+       ) {
+        w.rc = write_f( w.file, data );
+    }
+
+    if ( NULL != w.file ) {
+        w.rc = (0 == fclose( w.file )) ? w.rc : RC_FALSE;
+    }
+    else if ( -1 != w.fd ) {
+        close( w.fd );
+    }
+
+    if ( RC_TRUE != w.rc || 0 != rename( w.tmpname, filename ) ) {
+        unlink( w.tmpname );
+        w.rc = RC_FALSE;
+    }
+
+    free( w.tmpname );
+
+    return ( w.rc );
+}
+
+
 /*******************************************************************************
  */
 // #pragma GCC diagnostic ignored "-Wunused-function"
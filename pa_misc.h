@@ -57,7 +57,9 @@ typedef enum { XY_PAGE_XofY = 0, XY_DECIMAL, XY_ROMAN } xy_format_e;
  *
  * The 'DBG_REALLOC' flag is set in the Makefile.
  */
+#include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <errno.h>
 
@@ -128,6 +130,15 @@ char const *zap_isspace(char const *arg);
 char const *build_page_X_of_Y(size_t xy_x, size_t xy_y, xy_format_e);
 char const *val_to_roman(size_t val, char *);
 
+uint64_t get_monotonic_ns(void);
+
+#undef FNV1A_64_INIT
+#define FNV1A_64_INIT (0xcbf29ce484222325ULL)  /* the FNV-1a offset basis */
+uint64_t fnv1a_64(uint64_t hash, void const *data, size_t len);
+
+typedef rc_e (*write_file_f)(FILE *, void *data);
+rc_e  write_file_renamed(char const *const filename, write_file_f, void *data);
+
 void break_me(char *str);
 
 /*
@@ -0,0 +1,192 @@
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pa_misc.h"
+#include "pa_render.h"
+
+#ifndef realloc
+#warning "realloc() is not a macro..."
+#endif
+
+/**
+ *******************************************************************************
+ * A renderer for a single frame size.
+ */
+typedef struct pa_renderer_t {
+    int           width;
+    int           height;
+    ASS_Renderer *ass_renderer;
+    unsigned long last_used;      /* 'clock' when it was last handed out */
+} pa_renderer_t;
+
+struct pa_render_t {
+    ASS_Library  *ass_library;
+
+    int           glyph_max;      /* 0 :: use the libass default */
+    int           bitmap_max_mb;  /* 0 :: use the libass default */
+
+    unsigned int  cnt;
+    unsigned long clock;
+    pa_renderer_t renderers[ PA_RENDER_MAX_SIZES ];
+};
+
+
+/**
+ *******************************************************************************
+ * Build the (single) ASS_Library for the run and register the font search
+ * directories and the message callback.  Renderers are built on demand.
+ */
+pa_render_t *new_pa_render( strptrary_t *font_dirs, pa_render_msg_cb msg_cb, void *data )
+{
+    pa_render_t *pa_render = calloc( 1, sizeof (pa_render_t) );
+
+    pa_render->ass_library = ass_library_init();
+    if ( NULL == pa_render->ass_library ) {
+        fprintf(stderr, "FATAL :: 'ass_library_init()' failed!\n");
+        abort();
+    }
+
+    for ( size_t idx = 0; idx < font_dirs->cnt; idx++ ) {
+        ass_set_fonts_dir( pa_render->ass_library, font_dirs->pathnames[ idx ] );
+    }
+
+    if ( NULL != msg_cb ) {
+        ass_set_message_cb( pa_render->ass_library, msg_cb, data );
+    }
+
+    return ( pa_render );
+}
+
+
+/**
+ *******************************************************************************
+ * Set the libass cache limits for all of the renderers, built or not.
+ * A value of 0 leaves the libass default in place.
+ */
+void set_render_cache_limits( pa_render_t *pa_render, int glyph_max, int bitmap_max_mb )
+{
+
+    pa_render->glyph_max     = glyph_max;
+    pa_render->bitmap_max_mb = bitmap_max_mb;
+
+    for ( unsigned int idx = 0; idx < pa_render->cnt; idx++ ) {
+        ass_set_cache_limits( pa_render->renderers[ idx ].ass_renderer, glyph_max, bitmap_max_mb );
+    }
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+ASS_Library *get_render_library( pa_render_t *pa_render )
+{
+    return ( pa_render->ass_library );
+}
+
+
+/**
+ *******************************************************************************
+ * Get the renderer for a 'width' x 'height' frame, building it if needed.
+ *
+ * The line spacing is a plain setting in libass (it doesn't flush any of the
+ * caches), so it's set on each call -- the header template uses 0.0 and the
+ * text templates use the '--line-spacing' value.
+ *
+ * If all of the renderers are built, the least recently used one is recycled.
+ * That's never the renderer from the call just before this one, so a caller
+ * can hold two renderers at once (the image's frame and the "tall" frame, see
+ * 'fold_probe_t').
+ */
+ASS_Renderer *get_render_renderer( pa_render_t *pa_render, int width, int height, double line_spacing )
+{
+    struct {
+        pa_renderer_t *renderer;
+        unsigned int   idx;
+        unsigned int   lru;
+    } w = {
+        .renderer = NULL,
+        .lru      = 0,
+    };
+
+
+    for ( w.idx = 0; w.idx < pa_render->cnt; w.idx++ ) {
+        if ( width == pa_render->renderers[ w.idx ].width && height == pa_render->renderers[ w.idx ].height ) {
+            w.renderer = &pa_render->renderers[ w.idx ];
+            break;
+        }
+    }
+
+    if ( NULL == w.renderer ) {
+        /*
+         ***********************************************************************
+         * Should never happen with a sane set of background images, but if it
+         * does, recycle the least recently used renderer rather than failing.
+         */
+        if ( PA_RENDER_MAX_SIZES == pa_render->cnt ) {
+            for ( w.idx = 1; w.idx < pa_render->cnt; w.idx++ ) {
+                if ( pa_render->renderers[ w.idx ].last_used < pa_render->renderers[ w.lru ].last_used ) {
+                    w.lru = w.idx;
+                }
+            }
+            ass_renderer_done( pa_render->renderers[ w.lru ].ass_renderer );
+            w.renderer = &pa_render->renderers[ w.lru ];
+        }
+        else {
+            w.renderer = &pa_render->renderers[ pa_render->cnt++ ];
+        }
+        w.renderer->width  = width;
+        w.renderer->height = height;
+        w.renderer->ass_renderer = ass_renderer_init( pa_render->ass_library );
+        if ( NULL == w.renderer->ass_renderer ) {
+            fprintf(stderr, "FATAL :: 'ass_renderer_init()' failed!\n");
+            abort();
+        }
+
+        ass_set_frame_size( w.renderer->ass_renderer, width, height );
+        ass_set_fonts( w.renderer->ass_renderer, NULL, "sans-serif", 1, NULL, 1 );
+        ass_set_cache_limits( w.renderer->ass_renderer, pa_render->glyph_max, pa_render->bitmap_max_mb );
+    }
+
+    w.renderer->last_used = ++pa_render->clock;
+    ass_set_line_spacing( w.renderer->ass_renderer, line_spacing );
+
+    return ( w.renderer->ass_renderer );
+}
+
+
+/**
+ *******************************************************************************
+ */
+void cleanup_pa_render( pa_render_t **p_pa_render )
+{
+    pa_render_t *pa_render = *p_pa_render;
+
+    if ( NULL != pa_render ) {
+        for ( unsigned int idx = 0; idx < pa_render->cnt; idx++ ) {
+            ass_renderer_done( pa_render->renderers[ idx ].ass_renderer );
+        }
+        ass_library_done( pa_render->ass_library );
+
+        free( *p_pa_render );
+    }
+
+    return ;
+}
@@ -0,0 +1,53 @@
+#ifndef PA_RENDER_H
+#define PA_RENDER_H
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ *******************************************************************************
+ * The libass render context.
+ *
+ * Setting up an ASS_Library / ASS_Renderer pair is expensive -- the font
+ * provider is (re)built by 'ass_set_fonts()', and the glyph, outline and
+ * bitmap caches live in the renderer.  So we build the pair ONCE per run and
+ * hand out a renderer keyed by its frame size (in practice, all of the
+ * background images are the same size so there's only ever one renderer).
+ *
+ * The ASS_Images returned by 'ass_render_frame()' are owned by the renderer
+ * and are only valid until the next render on that renderer.
+ */
+#include <stdarg.h>
+#include <ass/ass.h>
+
+#include "rw_arrays.h"  /* for 'strptrary_t' */
+
+/*
+ * '--fold-search=gallop' renders in a "tall" frame as well as the image's,
+ * so there's room for two frames per background size.
+ */
+#undef PA_RENDER_MAX_SIZES
+#define PA_RENDER_MAX_SIZES  (2 * 4)  /* # of distinct frame sizes we'll cache */
+
+typedef struct pa_render_t pa_render_t;
+
+typedef void (*pa_render_msg_cb)( int level, const char *fmt, va_list args, void *data );
+
+pa_render_t  *new_pa_render      ( strptrary_t *font_dirs, pa_render_msg_cb, void *data );
+void          set_render_cache_limits( pa_render_t *, int glyph_max, int bitmap_max_mb );
+ASS_Library  *get_render_library ( pa_render_t * );
+ASS_Renderer *get_render_renderer( pa_render_t *, int width, int height, double line_spacing );
+void          cleanup_pa_render  ( pa_render_t ** );
+
+#endif  /* PA_RENDER_H */
@@ -0,0 +1,851 @@
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _GNU_SOURCE     /* memmem(), REG_STARTEND */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <regex.h>
+
+#include "pa_misc.h"
+#include "pa_sed.h"
+#include "rw_textfile.h"
+
+#ifndef realloc
+#warning "realloc() is not a macro..."
+#endif
+
+#undef SED_MAX_GROUPS
+#define SED_MAX_GROUPS  (10)  /* '&' (and '\0'), then '\1' .. '\9' */
+
+#undef SED_REGEX_SPECIALS
+#define SED_REGEX_SPECIALS  "$*.[\\]^|?+(){}"
+
+/**
+ *******************************************************************************
+ * A piece of an 's' command's replacement :: either 'len' bytes of its 'text'
+ * from 'off', or (if 'group' isn't -1) whatever that group matched.
+ */
+typedef struct sed_piece_t {
+    int           group;
+    size_t        off;
+    size_t        len;
+} sed_piece_t;
+
+/**
+ *******************************************************************************
+ * One 's' command.  A 'literal' one (see 'add_sed_literal()') has no regexp,
+ * every 'find' is replaced by all of 'text'.
+ */
+typedef struct sed_cmd_t {
+    regex_t       re;
+    size_t        nmatch;    /* 1 + the highest group the replacement uses */
+    char         *find;      /* 'literal' only */
+    size_t        find_len;
+    char         *text;
+    size_t        text_len;
+    sed_piece_t  *pieces;
+    size_t        pieces_cnt;
+    unsigned int  nth;       /* the number flag, 1 if there's none */
+    int           global;    /* the 'g' flag */
+    int           literal;
+} sed_cmd_t;
+
+struct pa_sed_t {
+    sed_cmd_t    *cmds;
+    size_t        cnt;
+    int           slurp;     /* ':a;N;$!ba' :: the whole text is one cycle */
+};
+
+typedef struct sed_buf_t {
+    char         *str;
+    size_t        len;
+    size_t        sz;
+} sed_buf_t;
+
+/**
+ *******************************************************************************
+ * Where the parse of a script is, and why it stopped (if it did).  'slurp'
+ * is how much of the ':a;N;$!ba' idiom has been seen (all 3 :: done).
+ */
+typedef struct sed_parse_t {
+    char const   *script;
+    char const   *p;
+    char          why[ 128 ];
+    char          label[ 32 ];
+    int           slurp;
+} sed_parse_t;
+
+static rc_e  parse_script ( pa_sed_t *, sed_parse_t * );
+static rc_e  parse_subst  ( pa_sed_t *, sed_parse_t * );
+static rc_e  parse_escape ( sed_parse_t *, char c, char *out );
+static rc_e  parse_label  ( sed_parse_t *, char *label, size_t sz );
+static rc_e  end_of_cmd   ( sed_parse_t * );
+static void  add_piece    ( sed_cmd_t *, int group, char const *str, size_t len );
+static void  run_cmds     ( pa_sed_t const *, sed_buf_t *ps, sed_buf_t *tmp );
+static int   subst_regex  ( sed_cmd_t const *, sed_buf_t const *ps, sed_buf_t *out );
+static int   subst_literal( sed_cmd_t const *, sed_buf_t const *ps, sed_buf_t *out );
+static void  buf_add      ( sed_buf_t *, char const *str, size_t len );
+
+
+/**
+ *******************************************************************************
+ * Compile the '--script-file's, in order, as if they were one script (like
+ * sed does).  Returns NULL if any of them can't be run by the builtin sed.
+ */
+pa_sed_t *new_pa_sed( strptrary_t const *script_files )
+{
+    struct {
+        pa_sed_t     *sed;
+        sed_parse_t   ps;
+        char         *script;
+        unsigned int  line;
+    } w = {
+        .sed = calloc( 1, sizeof (pa_sed_t) ),
+        .ps  = { .why = "", .slurp = 0 },
+    };
+
+
+    for ( size_t idx = 0; idx < script_files->cnt; idx++ ) {
+        char const *pathname = script_files->pathnames[ idx ];
+
+        w.script = read_textfile( pathname, NULL );
+        if ( NULL == w.script ) {
+            fprintf(stderr, "WARNING :: the builtin sed can't read '%s'.\n", pathname);
+            cleanup_pa_sed( &w.sed );
+            break;
+        }
+
+        w.ps.script = w.ps.p = w.script;
+        if ( RC_FALSE == parse_script( w.sed, &w.ps ) ) {
+            w.line = 1;
+            for ( char const *s = w.script; s < w.ps.p; s++ ) {
+                w.line += ('\n' == *s);
+            }
+            fprintf(stderr, "WARNING :: the builtin sed can't run '%s' line %u, %s.\n", pathname, w.line, w.ps.why);
+            cleanup_pa_sed( &w.sed );
+        }
+        (free)( w.script );
+
+        if ( NULL == w.sed ) {
+            break;
+        }
+    }
+
+    if ( NULL != w.sed && 0 != w.ps.slurp && 3 != w.ps.slurp ) {
+        fprintf(stderr, "WARNING :: the builtin sed only does ':a;N;$!ba' on its own.\n");
+        cleanup_pa_sed( &w.sed );
+    }
+
+    return ( w.sed );
+}
+
+
+/**
+ *******************************************************************************
+ * Add an 's/find/replace/g' with NO regexp and NO escapes, after the scripts
+ * (e.g., the '@@1c@@' resets, that have the user's text face in them).
+ */
+void add_sed_literal( pa_sed_t *sed, char const *const find, char const *const replace )
+{
+    sed_cmd_t *cmd;
+
+
+    sed->cmds = realloc( sed->cmds, (sed->cnt + 1) * sizeof (sed_cmd_t) );
+    cmd = &sed->cmds[ sed->cnt++ ];
+    memset( cmd, '\0', sizeof (sed_cmd_t) );
+
+    cmd->literal  = 1;
+    cmd->global   = 1;
+    cmd->nth      = 1;
+    cmd->find     = strdup( find );
+    cmd->find_len = strlen( find );
+    add_piece( cmd, -1, replace, strlen( replace ) );
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * Run the scripts on 'text' (which is taken) and return the new text, just as
+ * 'sed --regexp-extended' would've written it.
+ *
+ * Like sed, each line is a cycle (a line's '\n' isn't part of its pattern
+ * space), unless the scripts start with ':a;N;$!ba' -- then the whole text is
+ * one cycle (except that GNU sed's 'N' quits on the last line, so a one line
+ * text comes back as is).
+ */
+char *run_pa_sed( pa_sed_t const *sed, char *text, size_t *p_len )
+{
+    struct {
+        size_t      len;
+        sed_buf_t   out;
+        sed_buf_t   ps;     /* the pattern space */
+        sed_buf_t   tmp;
+    } w = {
+        .out = { .str = NULL, .len = 0, .sz = 0 },
+        .ps  = { .str = NULL, .len = 0, .sz = 0 },
+        .tmp = { .str = NULL, .len = 0, .sz = 0 },
+    };
+
+
+    if ( NULL == text ) {
+        return ( NULL );
+    }
+    w.len = strlen( text );
+
+    if ( sed->slurp ) {
+        int has_nl = (w.len > 0 && '\n' == text[ w.len - 1 ]);
+
+        if ( NULL != memchr( text, '\n', w.len - has_nl ) ) {
+            buf_add( &w.ps, text, w.len - has_nl );
+            run_cmds( sed, &w.ps, &w.tmp );
+            buf_add( &w.ps, "\n", has_nl );
+
+            (free)( text );
+            text  = w.ps.str;
+            w.len = w.ps.len;
+            w.ps.str = NULL;
+        }
+    } else {
+        char const *line = text;
+        char const *end  = text + w.len;
+
+        buf_add( &w.out, "", 0 );
+        while ( line < end ) {
+            char const *nl = memchr( line, '\n', end - line );
+            size_t      n  = ((NULL != nl) ? nl : end) - line;
+
+            w.ps.len = 0;
+            buf_add( &w.ps, line, n );
+            run_cmds( sed, &w.ps, &w.tmp );
+
+            buf_add( &w.out, w.ps.str, w.ps.len );
+            buf_add( &w.out, "\n", (NULL != nl) );
+            line += n + (NULL != nl);
+        }
+
+        (free)( text );
+        text  = w.out.str;
+        w.len = w.out.len;
+    }
+
+    (free)( w.ps.str );
+    (free)( w.tmp.str );
+
+    if ( NULL != p_len ) {
+        *p_len = w.len;
+    }
+    return ( text );
+}
+
+
+/**
+ *******************************************************************************
+ */
+void cleanup_pa_sed( pa_sed_t **p_sed )
+{
+    pa_sed_t *sed = *p_sed;
+
+    if ( NULL != sed ) {
+        for ( size_t idx = 0; idx < sed->cnt; idx++ ) {
+            sed_cmd_t *cmd = &sed->cmds[ idx ];
+
+            if ( ! cmd->literal ) {
+                regfree( &cmd->re );
+            }
+            (free)( cmd->find );
+            (free)( cmd->text );
+            (free)( cmd->pieces );
+        }
+        (free)( sed->cmds );
+        (free)( sed );
+        *p_sed = NULL;
+    }
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * The commands of one script, separated by ';'s or '\n's.  Other than the 's'
+ * commands, only ':a', 'N' and '$!ba' (in that order, first) are understood.
+ */
+static rc_e parse_script( pa_sed_t *sed, sed_parse_t *ps )
+{
+    char label[ sizeof (ps->label) ];
+
+
+    if ( STR_MATCH == strncmp( ps->script, "#n", 2 ) && ('\n' == ps->script[ 2 ] || '\0' == ps->script[ 2 ]) ) {
+        snprintf(ps->why, sizeof (ps->why), "'#n' (i.e., --quiet)");
+        return ( RC_FALSE );
+    }
+
+    while ( 1 ) {
+        while ( isspace( (unsigned char) *ps->p ) || ';' == *ps->p ) {
+            ps->p++;
+        }
+
+        switch ( *ps->p ) {
+        case '\0':
+            return ( RC_TRUE );
+
+        case '#':
+            while ( '\0' != *ps->p && '\n' != *ps->p ) {
+                ps->p++;
+            }
+            break;
+
+        case ':':
+            ps->p++;
+            if ( 0 != ps->slurp || sed->cnt > 0 ) {
+                snprintf(ps->why, sizeof (ps->why), "a label that isn't ':a;N;$!ba'");
+                return ( RC_FALSE );
+            }
+            if ( RC_FALSE == parse_label( ps, ps->label, sizeof (ps->label) ) ) {
+                return ( RC_FALSE );
+            }
+            ps->slurp = 1;
+            break;
+
+        case 'N':
+            ps->p++;
+            if ( 1 != ps->slurp ) {
+                snprintf(ps->why, sizeof (ps->why), "an 'N' that isn't ':a;N;$!ba'");
+                return ( RC_FALSE );
+            }
+            ps->slurp = 2;
+            if ( RC_FALSE == end_of_cmd( ps ) ) {
+                return ( RC_FALSE );
+            }
+            break;
+
+        case '$':
+            if ( 2 != ps->slurp || STR_MATCH != strncmp( ps->p, "$!b", 3 ) ) {
+                snprintf(ps->why, sizeof (ps->why), "an address");
+                return ( RC_FALSE );
+            }
+            ps->p += 3;
+            if ( RC_FALSE == parse_label( ps, label, sizeof (label) ) ) {
+                return ( RC_FALSE );
+            }
+            if ( STR_MATCH != strcmp( label, ps->label ) ) {
+                snprintf(ps->why, sizeof (ps->why), "a branch that isn't ':a;N;$!ba'");
+                return ( RC_FALSE );
+            }
+            ps->slurp = 3;
+            sed->slurp = 1;
+            break;
+
+        case 's':
+            if ( 1 == ps->slurp || 2 == ps->slurp ) {
+                snprintf(ps->why, sizeof (ps->why), "an 's' inside of ':a;N;$!ba'");
+                return ( RC_FALSE );
+            }
+            if ( RC_FALSE == parse_subst( sed, ps ) ) {
+                return ( RC_FALSE );
+            }
+            break;
+
+        default:
+            if ( isdigit( (unsigned char) *ps->p ) || '/' == *ps->p || '\\' == *ps->p ) {
+                snprintf(ps->why, sizeof (ps->why), "an address");
+            } else {
+                snprintf(ps->why, sizeof (ps->why), "the '%c' command", *ps->p);
+            }
+            return ( RC_FALSE );
+        }
+    }
+}
+
+
+/**
+ *******************************************************************************
+ * 's' + delimiter + regexp + delimiter + replacement + delimiter + flags.  The
+ * regexp's GNU escapes are done here (regcomp() doesn't know '\n', etc.), and
+ * the replacement is split into its literal pieces and groups.
+ */
+static rc_e parse_subst( pa_sed_t *sed, sed_parse_t *ps )
+{
+    struct {
+        sed_cmd_t   cmd;
+        char        delim;
+        char       *re;
+        size_t      len;
+        char        c;
+        int         rc;
+        char        err[ 64 ];
+    } w = {
+        .cmd = { .nth = 0, .global = 0, .literal = 0, .nmatch = 1 },
+        .len = 0,
+    };
+
+
+    ps->p++;
+    w.delim = *ps->p;
+    if ( '\0' == w.delim || '\n' == w.delim || '\\' == w.delim ) {
+        snprintf(ps->why, sizeof (ps->why), "an unterminated 's' command");
+        return ( RC_FALSE );
+    }
+    ps->p++;
+
+    /*
+     ***************************************************************************
+     * The regexp.  Nothing in it gets longer, so it fits in the script's size.
+     */
+    w.re = malloc( strlen( ps->p ) + 1 );
+    while ( w.delim != *ps->p ) {
+        if ( '\0' == *ps->p || '\n' == *ps->p ) {
+            snprintf(ps->why, sizeof (ps->why), "an unterminated 's' command");
+            (free)( w.re );
+            return ( RC_FALSE );
+        }
+        if ( '\\' != *ps->p ) {
+            w.re[ w.len++ ] = *ps->p++;
+            continue;
+        }
+
+        ps->p++;
+        if ( w.delim == *ps->p ) {
+            if ( NULL != strchr( SED_REGEX_SPECIALS, w.delim ) ) {
+                w.re[ w.len++ ] = '\\';
+            }
+            w.re[ w.len++ ] = *ps->p++;
+            continue;
+        }
+        switch ( *ps->p ) {
+        case '\0':
+            continue;
+        case 'b': case 'B': case '<': case '>': case '`': case '\'': case 'c':
+            snprintf(ps->why, sizeof (ps->why), "the '\\%c' escape in a regexp", *ps->p);
+            (free)( w.re );
+            return ( RC_FALSE );
+        case '\n':
+            w.re[ w.len++ ] = '\n';
+            ps->p++;
+            continue;
+        }
+        if ( RC_TRUE == parse_escape( ps, *ps->p, &w.c ) ) {
+            if ( '\\' == w.c ) {
+                w.re[ w.len++ ] = '\\';
+            }
+            w.re[ w.len++ ] = w.c;
+        } else {
+            w.re[ w.len++ ] = '\\';
+            w.re[ w.len++ ] = *ps->p++;
+        }
+    }
+    ps->p++;
+    w.re[ w.len ] = '\0';
+
+    if ( 0 == w.len ) {
+        snprintf(ps->why, sizeof (ps->why), "an empty regexp (i.e., the last regexp)");
+        (free)( w.re );
+        return ( RC_FALSE );
+    }
+
+    w.rc = regcomp( &w.cmd.re, w.re, REG_EXTENDED );
+    (free)( w.re );
+    if ( 0 != w.rc ) {
+        regerror( w.rc, &w.cmd.re, w.err, sizeof (w.err) );
+        snprintf(ps->why, sizeof (ps->why), "regcomp() says '%s'", w.err);
+        return ( RC_FALSE );
+    }
+
+    /*
+     ***************************************************************************
+     * The replacement.
+     */
+    while ( w.delim != *ps->p ) {
+        if ( '\0' == *ps->p || '\n' == *ps->p ) {
+            snprintf(ps->why, sizeof (ps->why), "an unterminated 's' command");
+            goto fail;
+        }
+        if ( '&' == *ps->p ) {
+            add_piece( &w.cmd, 0, NULL, 0 );
+            ps->p++;
+            continue;
+        }
+        if ( '\\' != *ps->p ) {
+            add_piece( &w.cmd, -1, ps->p++, 1 );
+            continue;
+        }
+
+        ps->p++;
+        w.c = *ps->p;
+        if ( w.delim == w.c || '&' == w.c || '\\' == w.c || '\n' == w.c ) {
+            add_piece( &w.cmd, -1, ps->p++, 1 );
+            continue;
+        }
+        if ( isdigit( (unsigned char) w.c ) ) {
+            if ( (size_t) (w.c - '0') > w.cmd.re.re_nsub ) {
+                snprintf(ps->why, sizeof (ps->why), "an invalid reference '\\%c'", w.c);
+                goto fail;
+            }
+            add_piece( &w.cmd, w.c - '0', NULL, 0 );
+            ps->p++;
+            continue;
+        }
+        switch ( w.c ) {
+        case '\0':
+            continue;
+        case 'L': case 'U': case 'l': case 'u': case 'E': case 'c':
+            snprintf(ps->why, sizeof (ps->why), "the '\\%c' escape in a replacement", w.c);
+            goto fail;
+        }
+        if ( RC_FALSE == parse_escape( ps, w.c, &w.c ) ) {
+            ps->p++;   /* sed drops the '\' of the ones it doesn't know */
+        }
+        add_piece( &w.cmd, -1, &w.c, 1 );
+    }
+    ps->p++;
+
+    /*
+     ***************************************************************************
+     * The flags.
+     */
+    while ( 1 ) {
+        if ( 'g' == *ps->p && ! w.cmd.global ) {
+            w.cmd.global = 1;
+            ps->p++;
+        }
+        else if ( isdigit( (unsigned char) *ps->p ) && 0 == w.cmd.nth ) {
+            w.cmd.nth = strtoul( ps->p, (char **) &ps->p, 10 );
+            if ( 0 == w.cmd.nth ) {
+                snprintf(ps->why, sizeof (ps->why), "a '0' number flag");
+                goto fail;
+            }
+        }
+        else if ( isalpha( (unsigned char) *ps->p ) ) {
+            snprintf(ps->why, sizeof (ps->why), "the '%c' flag", *ps->p);
+            goto fail;
+        }
+        else break;
+    }
+    if ( 0 == w.cmd.nth ) {
+        w.cmd.nth = 1;
+    }
+    if ( RC_FALSE == end_of_cmd( ps ) ) {
+        goto fail;
+    }
+
+    sed->cmds = realloc( sed->cmds, (sed->cnt + 1) * sizeof (sed_cmd_t) );
+    sed->cmds[ sed->cnt++ ] = w.cmd;
+
+    return ( RC_TRUE );
+
+fail:
+    regfree( &w.cmd.re );
+    (free)( w.cmd.text );
+    (free)( w.cmd.pieces );
+    return ( RC_FALSE );
+}
+
+
+/**
+ *******************************************************************************
+ * GNU sed's escapes for a character (in both the regexp and the replacement),
+ * 'ps->p' is at the 'c' after the '\'.  RC_FALSE :: 'c' isn't one of them.
+ */
+static rc_e parse_escape( sed_parse_t *ps, char c, char *out )
+{
+    struct {
+        int           base;
+        int           digits;
+        unsigned int  val;
+        char const   *p;
+    } w = {
+        .base = 0,
+        .val  = 0,
+    };
+
+
+    switch ( c ) {
+    case 'n':  *out = '\n';  break;
+    case 't':  *out = '\t';  break;
+    case 'f':  *out = '\f';  break;
+    case 'v':  *out = '\v';  break;
+    case 'a':  *out = '\a';  break;
+    case 'r':  *out = '\r';  break;
+    case 'x':  w.base = 16;  w.digits = 2;  break;
+    case 'd':  w.base = 10;  w.digits = 3;  break;
+    case 'o':  w.base =  8;  w.digits = 3;  break;
+    default:
+        return ( RC_FALSE );
+    }
+
+    if ( 0 == w.base ) {
+        ps->p++;
+        return ( RC_TRUE );
+    }
+
+    /*
+     ***************************************************************************
+     * '\xHH', '\dNNN' and '\oNNN' -- without any digits, it's just the letter.
+     */
+    w.p = ps->p + 1;
+    for ( int idx = 0; idx < w.digits; idx++, w.p++ ) {
+        int d = (isdigit( (unsigned char) *w.p )) ? *w.p - '0'
+              : (isxdigit( (unsigned char) *w.p )) ? tolower( (unsigned char) *w.p ) - 'a' + 10
+              : 99;
+        if ( d >= w.base ) {
+            break;
+        }
+        w.val = w.val * w.base + d;
+    }
+    if ( w.p == ps->p + 1 ) {
+        *out = c;
+    } else {
+        *out = (char) w.val;
+    }
+    ps->p = w.p;
+
+    return ( RC_TRUE );
+}
+
+
+/**
+ *******************************************************************************
+ * A ':' or 'b' label, up to a ';' or the end of the line.
+ */
+static rc_e parse_label( sed_parse_t *ps, char *label, size_t sz )
+{
+    size_t len = 0;
+
+
+    while ( ' ' == *ps->p || '\t' == *ps->p ) {
+        ps->p++;
+    }
+    while ( '\0' != *ps->p && '\n' != *ps->p && ';' != *ps->p ) {
+        if ( len + 1 >= sz ) {
+            snprintf(ps->why, sizeof (ps->why), "a label that's too long");
+            return ( RC_FALSE );
+        }
+        label[ len++ ] = *ps->p++;
+    }
+    while ( len > 0 && isspace( (unsigned char) label[ len - 1 ] ) ) {
+        len--;
+    }
+    label[ len ] = '\0';
+
+    if ( 0 == len ) {
+        snprintf(ps->why, sizeof (ps->why), "a missing label");
+        return ( RC_FALSE );
+    }
+
+    return ( RC_TRUE );
+}
+
+
+/**
+ *******************************************************************************
+ */
+static rc_e end_of_cmd( sed_parse_t *ps )
+{
+    while ( ' ' == *ps->p || '\t' == *ps->p ) {
+        ps->p++;
+    }
+    if ( '\0' == *ps->p || '\n' == *ps->p || ';' == *ps->p || '#' == *ps->p ) {
+        return ( RC_TRUE );
+    }
+
+    snprintf(ps->why, sizeof (ps->why), "'%c' after a command", *ps->p);
+    return ( RC_FALSE );
+}
+
+
+/**
+ *******************************************************************************
+ * Runs of literal bytes are kept in one piece.
+ */
+static void add_piece( sed_cmd_t *cmd, int group, char const *str, size_t len )
+{
+    sed_piece_t *last = (cmd->pieces_cnt > 0) ? &cmd->pieces[ cmd->pieces_cnt - 1 ] : NULL;
+
+
+    if ( group >= 0 ) {
+        if ( (size_t) group >= cmd->nmatch ) {
+            cmd->nmatch = group + 1;
+        }
+    } else {
+        cmd->text = realloc( cmd->text, cmd->text_len + len + 1 );
+        memcpy( cmd->text + cmd->text_len, str, len );
+        cmd->text[ cmd->text_len + len ] = '\0';
+
+        if ( NULL != last && -1 == last->group ) {
+            last->len += len;
+            cmd->text_len += len;
+            return ;
+        }
+    }
+
+    cmd->pieces = realloc( cmd->pieces, (cmd->pieces_cnt + 1) * sizeof (sed_piece_t) );
+    cmd->pieces[ cmd->pieces_cnt++ ] = (sed_piece_t) {
+        .group = group,
+        .off   = cmd->text_len,
+        .len   = len,
+    };
+    cmd->text_len += len;
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * All of the commands on one pattern space (and 'tmp' for the edits).
+ */
+static void run_cmds( pa_sed_t const *sed, sed_buf_t *ps, sed_buf_t *tmp )
+{
+    for ( size_t idx = 0; idx < sed->cnt; idx++ ) {
+        sed_cmd_t const *cmd = &sed->cmds[ idx ];
+        int              edited = (cmd->literal) ? subst_literal( cmd, ps, tmp )
+                                                 : subst_regex( cmd, ps, tmp );
+        if ( edited ) {
+            sed_buf_t swap = *ps;
+            *ps  = *tmp;
+            *tmp = swap;
+        }
+    }
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * GNU sed's 'do_subst()' :: returns 0 if nothing was replaced ('out' is junk),
+ * else the pattern space's new text is in 'out'.
+ *
+ * The regexp always sees the whole pattern space (REG_STARTEND), so a '^' only
+ * matches at its start even for the 'g' flag's later matches.  An empty match
+ * right after the last match doesn't count (sed's "x*" on "xab" is "-a-b-").
+ */
+static int subst_regex( sed_cmd_t const *cmd, sed_buf_t const *ps, sed_buf_t *out )
+{
+    struct {
+        regmatch_t    m[ SED_MAX_GROUPS ];
+        size_t        start;
+        size_t        last_end;
+        unsigned int  count;
+        int           replaced;
+    } w = {
+        .start    = 0,
+        .last_end = (size_t) -1,
+        .count    = 0,
+        .replaced = 0,
+    };
+
+
+    out->len = 0;
+    while ( w.start <= ps->len ) {
+        w.m[ 0 ].rm_so = w.start;
+        w.m[ 0 ].rm_eo = ps->len;
+        if ( 0 != regexec( &cmd->re, ps->str, cmd->nmatch, w.m, REG_STARTEND ) ) {
+            break;
+        }
+
+        size_t so = w.m[ 0 ].rm_so;
+        size_t eo = w.m[ 0 ].rm_eo;
+
+        buf_add( out, ps->str + w.start, so - w.start );
+        if ( so == eo && so == w.last_end ) {
+            buf_add( out, ps->str + so, (so < ps->len) );
+            w.start = so + 1;
+            continue;
+        }
+
+        if ( ++w.count < cmd->nth ) {
+            buf_add( out, ps->str + so, eo - so );
+        } else {
+            for ( size_t idx = 0; idx < cmd->pieces_cnt; idx++ ) {
+                sed_piece_t const *piece = &cmd->pieces[ idx ];
+
+                if ( -1 == piece->group ) {
+                    buf_add( out, cmd->text + piece->off, piece->len );
+                }
+                else if ( -1 != w.m[ piece->group ].rm_so ) {
+                    buf_add( out, ps->str + w.m[ piece->group ].rm_so, w.m[ piece->group ].rm_eo - w.m[ piece->group ].rm_so );
+                }
+            }
+            w.replaced = 1;
+        }
+
+        w.start = w.last_end = eo;
+        if ( so == eo ) {
+            buf_add( out, ps->str + so, (so < ps->len) );
+            w.start++;
+        }
+        if ( w.replaced && ! cmd->global ) {
+            break;
+        }
+    }
+
+    if ( ! w.replaced ) {
+        return ( 0 );
+    }
+    if ( w.start < ps->len ) {
+        buf_add( out, ps->str + w.start, ps->len - w.start );
+    }
+
+    return ( 1 );
+}
+
+
+/**
+ *******************************************************************************
+ */
+static int subst_literal( sed_cmd_t const *cmd, sed_buf_t const *ps, sed_buf_t *out )
+{
+    char const *str = ps->str;
+    char const *end = ps->str + ps->len;
+    char const *hit;
+
+
+    out->len = 0;
+    while ( NULL != (hit = memmem( str, end - str, cmd->find, cmd->find_len )) ) {
+        buf_add( out, str, hit - str );
+        buf_add( out, cmd->text, cmd->text_len );
+        str = hit + cmd->find_len;
+    }
+
+    if ( str == ps->str ) {
+        return ( 0 );
+    }
+    buf_add( out, str, end - str );
+
+    return ( 1 );
+}
+
+
+/**
+ *******************************************************************************
+ * Always '\0' terminated (regexec() wants a C string, even w/REG_STARTEND).
+ */
+static void buf_add( sed_buf_t *buf, char const *str, size_t len )
+{
+    if ( buf->len + len + 1 > buf->sz ) {
+        buf->sz  = (buf->len + len + 1) * 2;
+        buf->str = realloc( buf->str, buf->sz );
+    }
+    memcpy( buf->str + buf->len, str, len );
+    buf->len += len;
+    buf->str[ buf->len ] = '\0';
+
+    return ;
+}
@@ -0,0 +1,46 @@
+#ifndef PA_SED_H
+#define PA_SED_H
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/**
+ *******************************************************************************
+ * The builtin sed, the '--script-file's WITHOUT a 'popen()' for each chapter.
+ *
+ * The scripts are compiled once at startup and run on the chapter's text in
+ * memory, the same way that 'sed --regexp-extended --file=...' would run them.
+ * Only the subset of sed that the '--script-file's need is done --
+ *  - 's' commands with any delimiter, the 'g' and number flags, '&' and the
+ *    '\1' .. '\9' back references, and GNU's '\n', '\t', '\xHH', etc. escapes;
+ *  - the ':a;N;$!ba' idiom at the very start, to edit the whole text at once.
+ * Anything else (addresses, other commands, 'I' or 'w' flags, '\U', ...) and
+ * 'new_pa_sed()' says why and returns NULL, so the caller uses sed instead.
+ *
+ * The regexps are matched by the C library's regexec() byte-by-byte, like sed
+ * with LC_ALL=C.  Compiled once, then shared (read-only) by all of the threads.
+ */
+#include <stddef.h>
+
+#include "rw_arrays.h"  /* for 'strptrary_t' */
+
+typedef struct pa_sed_t pa_sed_t;
+
+pa_sed_t *new_pa_sed     ( strptrary_t const *script_files );
+void      add_sed_literal( pa_sed_t *, char const *const find, char const *const replace );
+char     *run_pa_sed     ( pa_sed_t const *, char *text, size_t *p_len );
+void      cleanup_pa_sed ( pa_sed_t ** );
+
+#endif  /* PA_SED_H */
@@ -0,0 +1,526 @@
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "pa_misc.h"
+#include "pa_stats.h"
+
+#ifndef realloc
+#warning "realloc() is not a macro..."
+#endif
+
+/*
+ *******************************************************************************
+ * The JSON names of the phases, in 'pa_phase_e' order.
+ */
+static char const *const phase_names[ PA_PHASE_CNT ] = {
+    [ PA_PHASE_SED ]        = "sed",
+    [ PA_PHASE_DUP_GROUPS ] = "dup_groups",
+    [ PA_PHASE_ATTR_EDITS ] = "attr_edits",
+    [ PA_PHASE_WORK_TEXT ]  = "work_text",
+    [ PA_PHASE_BG_DECODE ]  = "bg_decode",
+    [ PA_PHASE_FOLD ]       = "fold",
+    [ PA_PHASE_RENDER ]     = "render",
+    [ PA_PHASE_BLEND ]      = "blend",
+    [ PA_PHASE_ENCODE ]     = "encode",
+    [ PA_PHASE_WRITE ]      = "write",
+};
+
+/*
+ *******************************************************************************
+ * ... and of the counters, in 'pa_count_e' order.
+ */
+static char const *const count_names[ PA_COUNT_CNT ] = {
+    [ PA_COUNT_TOKENS ]      = "tokens",
+    [ PA_COUNT_RENDERS ]     = "renders",
+    [ PA_COUNT_SANDBOX ]     = "sandbox_renders",
+    [ PA_COUNT_CLIPPED ]     = "clipped",
+    [ PA_COUNT_DROPPED ]     = "dropped",
+    [ PA_COUNT_READ_BYTES ]  = "read_bytes",
+    [ PA_COUNT_TEXT_BYTES ]  = "text_bytes",
+    [ PA_COUNT_PIECES ]      = "pieces",
+    [ PA_COUNT_MEASURED ]    = "measured",
+    [ PA_COUNT_MEASURE_HIT ] = "measure_hits",
+    [ PA_COUNT_MEASURE_OFF ] = "measure_tokens_off",
+};
+
+typedef struct page_stats_t {
+    size_t       global;
+    char        *filename;       /* the image written, NULL if not (yet) */
+    size_t       bytes_written;
+    uint64_t     ns[ PA_PHASE_CNT ];
+    pa_counts_t *counts;         /* for each template, NULL until there are some */
+} page_stats_t;
+
+typedef struct chapter_stats_t {
+    char const   *filename;      /* in_chapters.pathnames */
+    size_t        bytes_read;
+    uint64_t      ns[ PA_PHASE_CNT ];  /* NOT including its pages' */
+
+    page_stats_t *pages;         /* page N is 'pages[ N - 1 ]' */
+    size_t        cnt;
+    size_t        max;
+} chapter_stats_t;
+
+struct pa_stats_t {
+    uint64_t         start_ns;
+    size_t           bytes_read;  /* that's not a chapter's text */
+
+    chapter_stats_t *chapters;
+    size_t           cnt;
+
+    char const *const *templates;
+    size_t           templates_cnt;
+
+    pthread_mutex_t  lock;
+};
+
+static page_stats_t *get_page_stats ( pa_stats_t *, pa_page_id_t );
+static void          write_json_ns  ( FILE *, char const *const indent, uint64_t const ns[ PA_PHASE_CNT ] );
+static void          write_json_counts( FILE *, char const *const indent, pa_counts_t const * );
+
+
+/**
+ *******************************************************************************
+ * Start the report (and its clock) for the 'cnt' chapters.  The chapters' and
+ * templates' names aren't copied.
+ */
+pa_stats_t *new_pa_stats( char const *const *chapters, size_t cnt, char const *const *templates, size_t templates_cnt )
+{
+    pa_stats_t *stats = calloc( 1, sizeof (pa_stats_t) );
+
+    stats->start_ns = get_monotonic_ns();
+    stats->templates     = templates;
+    stats->templates_cnt = templates_cnt;
+    stats->cnt      = cnt;
+    stats->chapters = calloc( (cnt > 0) ? cnt : 1, sizeof (chapter_stats_t) );
+    for ( size_t idx = 0; idx < cnt; idx++ ) {
+        stats->chapters[ idx ].filename = chapters[ idx ];
+    }
+    pthread_mutex_init( &stats->lock, NULL );
+
+    return ( stats );
+}
+
+
+/**
+ *******************************************************************************
+ */
+void add_chapter_time( pa_stats_t *stats, size_t chapter, pa_phase_e phase, uint64_t ns )
+{
+
+    if ( NULL == stats || chapter >= stats->cnt ) {
+        return ;
+    }
+
+    pthread_mutex_lock( &stats->lock );
+    stats->chapters[ chapter ].ns[ phase ] += ns;
+    pthread_mutex_unlock( &stats->lock );
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+void add_chapter_read( pa_stats_t *stats, size_t chapter, size_t bytes )
+{
+
+    if ( NULL == stats || chapter >= stats->cnt ) {
+        return ;
+    }
+
+    pthread_mutex_lock( &stats->lock );
+    stats->chapters[ chapter ].bytes_read += bytes;
+    pthread_mutex_unlock( &stats->lock );
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+void add_page_time( pa_stats_t *stats, pa_page_id_t id, pa_phase_e phase, uint64_t ns )
+{
+    page_stats_t *page;
+
+    if ( NULL == stats ) {
+        return ;
+    }
+
+    pthread_mutex_lock( &stats->lock );
+    page = get_page_stats( stats, id );
+    if ( NULL != page ) {
+        page->ns[ phase ] += ns;
+    }
+    pthread_mutex_unlock( &stats->lock );
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+void add_page_written( pa_stats_t *stats, pa_page_id_t id, char const *const filename, size_t bytes )
+{
+    page_stats_t *page;
+
+    if ( NULL == stats ) {
+        return ;
+    }
+
+    pthread_mutex_lock( &stats->lock );
+    page = get_page_stats( stats, id );
+    if ( NULL != page ) {
+        (free)( page->filename );
+        page->filename       = strdup( filename );
+        page->bytes_written += bytes;
+    }
+    pthread_mutex_unlock( &stats->lock );
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * Add a template's fold counters for the page (both passes add to them).
+ */
+void add_page_counts( pa_stats_t *stats, pa_page_id_t id, size_t template, pa_counts_t const *counts )
+{
+    page_stats_t *page;
+
+    if ( NULL == stats || template >= stats->templates_cnt ) {
+        return ;
+    }
+
+    pthread_mutex_lock( &stats->lock );
+    page = get_page_stats( stats, id );
+    if ( NULL != page ) {
+        if ( NULL == page->counts ) {
+            page->counts = calloc( stats->templates_cnt, sizeof (pa_counts_t) );
+        }
+        add_counts( &page->counts[ template ], counts );
+    }
+    pthread_mutex_unlock( &stats->lock );
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+void add_counts( pa_counts_t *sum, pa_counts_t const *counts )
+{
+
+    for ( int cn = 0; cn < PA_COUNT_CNT; cn++ ) {
+        sum->n[ cn ] += counts->n[ cn ];
+    }
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * The bytes read for the backgrounds and such (not a chapter's text).
+ */
+void add_bytes_read( pa_stats_t *stats, size_t bytes )
+{
+
+    if ( NULL == stats ) {
+        return ;
+    }
+
+    pthread_mutex_lock( &stats->lock );
+    stats->bytes_read += bytes;
+    pthread_mutex_unlock( &stats->lock );
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * Return the page's stats, adding the page (and any before it) if it's new.
+ * Called with the lock held.
+ */
+static page_stats_t *get_page_stats( pa_stats_t *stats, pa_page_id_t id )
+{
+    chapter_stats_t *chapter;
+    page_stats_t    *page;
+
+
+    if ( id.chapter >= stats->cnt || 0 == id.page ) {
+        return ( NULL );
+    }
+    chapter = &stats->chapters[ id.chapter ];
+
+    if ( id.page > chapter->max ) {
+        size_t max = id.page + 32;
+        chapter->pages = realloc( chapter->pages, max * sizeof (page_stats_t) );
+        memset( &chapter->pages[ chapter->max ], '\0', (max - chapter->max) * sizeof (page_stats_t) );
+        chapter->max = max;
+    }
+    if ( id.page > chapter->cnt ) {
+        chapter->cnt = id.page;
+    }
+
+    page = &chapter->pages[ id.page - 1 ];
+    if ( 0 != id.global ) {
+        page->global = id.global;
+    }
+
+    return ( page );
+}
+
+
+/**
+ *******************************************************************************
+ * Write the report to 'filename' ("-" is stdout).  The times are in msec.
+ *
+ * A chapter's phases include its pages'.  The run's "cpu_ms" is the time for
+ * all of the threads, so with '--jobs' or the encoders it can be greater than
+ * its "wall_ms".
+ */
+rc_e write_pa_stats_json( pa_stats_t *stats, char const *const filename )
+{
+    struct {
+        FILE         *file;
+        struct rusage ru;
+        uint64_t      ns[ PA_PHASE_CNT ];     /* for the run */
+        uint64_t      c_ns[ PA_PHASE_CNT ];   /* for a chapter */
+        pa_counts_t   counts;                 /* for the run */
+        pa_counts_t   c_counts;               /* for a chapter */
+        pa_counts_t  *t_counts;               /* for each template */
+        size_t        bytes_read;
+        size_t        bytes_written;
+        size_t        c_written;
+        size_t        pages;
+        double        wall_ms;
+        double        cpu_ms;
+    } w = {
+        .ns            = { 0 },
+        .counts        = { { 0 } },
+        .bytes_read    = 0,
+        .bytes_written = 0,
+        .pages         = 0,
+    };
+
+
+    if ( NULL == stats ) {
+        return ( RC_FALSE );
+    }
+
+    w.file = (STR_MATCH == strcmp(filename, "-")) ? stdout : fopen(filename, "w");
+    if ( NULL == w.file ) {
+        fprintf(stderr, "ERROR :: can't write the stats to '%s' -- error %d, %s\n",
+                        filename, errno, strerror(errno));
+        return ( RC_FALSE );
+    }
+
+    w.wall_ms = (get_monotonic_ns() - stats->start_ns) / 1e6;
+    getrusage( RUSAGE_SELF, &w.ru );
+    w.cpu_ms  = (w.ru.ru_utime.tv_sec + w.ru.ru_stime.tv_sec) * 1e3
+              + (w.ru.ru_utime.tv_usec + w.ru.ru_stime.tv_usec) / 1e3;
+
+    pthread_mutex_lock( &stats->lock );
+
+    w.t_counts = calloc( (stats->templates_cnt) ? stats->templates_cnt : 1, sizeof (pa_counts_t) );
+
+    fprintf(w.file, "{\n  \"chapters\": [");
+    for ( size_t idx = 0; idx < stats->cnt; idx++ ) {
+        chapter_stats_t const *chapter = &stats->chapters[ idx ];
+
+        memcpy( w.c_ns, chapter->ns, sizeof (w.c_ns) );
+        memset( &w.c_counts, '\0', sizeof (w.c_counts) );
+        w.c_written = 0;
+
+        fprintf(w.file, "%s\n    {\n      \"chapter\": ", (idx) ? "," : "");
+        write_json_str( w.file, chapter->filename );
+        fprintf(w.file, ",\n      \"pages\": [");
+
+        for ( size_t jdx = 0; jdx < chapter->cnt; jdx++ ) {
+            page_stats_t const *page = &chapter->pages[ jdx ];
+
+            fprintf(w.file, "%s\n        {\n          \"page\": %zu,\n          \"global_page\": %zu,\n          \"image\": ",
+                            (jdx) ? "," : "", jdx + 1, page->global);
+            write_json_str( w.file, page->filename );
+            fprintf(w.file, ",\n          \"bytes_written\": %zu,\n          \"phases_ms\": ", page->bytes_written);
+            write_json_ns( w.file, "          ", page->ns );
+            fprintf(w.file, ",\n          \"fold_counts\": [");
+            for ( size_t tt = 0; tt < stats->templates_cnt && NULL != page->counts; tt++ ) {
+                fprintf(w.file, "%s\n            ", (tt) ? "," : "");
+                write_json_counts( w.file, "            ", &page->counts[ tt ] );
+                add_counts( &w.t_counts[ tt ], &page->counts[ tt ] );
+                add_counts( &w.c_counts, &page->counts[ tt ] );
+            }
+            fprintf(w.file, "%s]\n        }", (NULL != page->counts && stats->templates_cnt) ? "\n          " : "");
+
+            for ( int ph = 0; ph < PA_PHASE_CNT; ph++ ) {
+                w.c_ns[ ph ] += page->ns[ ph ];
+            }
+            w.c_written += page->bytes_written;
+        }
+
+        fprintf(w.file, "%s],\n      \"page_count\": %zu,\n      \"bytes_read\": %zu,\n      \"bytes_written\": %zu,\n      \"phases_ms\": ",
+                        (chapter->cnt) ? "\n      " : "", chapter->cnt, chapter->bytes_read, w.c_written);
+        write_json_ns( w.file, "      ", w.c_ns );
+        fprintf(w.file, ",\n      \"fold_counts\": ");
+        write_json_counts( w.file, "      ", &w.c_counts );
+        fprintf(w.file, "\n    }");
+        add_counts( &w.counts, &w.c_counts );
+
+        for ( int ph = 0; ph < PA_PHASE_CNT; ph++ ) {
+            w.ns[ ph ] += w.c_ns[ ph ];
+        }
+        w.bytes_read    += chapter->bytes_read;
+        w.bytes_written += w.c_written;
+        w.pages         += chapter->cnt;
+    }
+    w.bytes_read += stats->bytes_read;
+
+    fprintf(w.file, "%s],\n", (stats->cnt) ? "\n  " : "");
+    fprintf(w.file, "  \"page_count\": %zu,\n", w.pages);
+    fprintf(w.file, "  \"wall_ms\": %.3f,\n", w.wall_ms);
+    fprintf(w.file, "  \"cpu_ms\": %.3f,\n", w.cpu_ms);
+    fprintf(w.file, "  \"peak_rss_kb\": %ld,\n", w.ru.ru_maxrss);
+    fprintf(w.file, "  \"bytes_read\": %zu,\n", w.bytes_read);
+    fprintf(w.file, "  \"bytes_written\": %zu,\n", w.bytes_written);
+    fprintf(w.file, "  \"phases_ms\": ");
+    write_json_ns( w.file, "  ", w.ns );
+    fprintf(w.file, ",\n  \"fold_counts\": ");
+    write_json_counts( w.file, "  ", &w.counts );
+    fprintf(w.file, ",\n  \"templates\": [");
+    for ( size_t tt = 0; tt < stats->templates_cnt; tt++ ) {
+        fprintf(w.file, "%s\n    {\n      \"template\": ", (tt) ? "," : "");
+        write_json_str( w.file, stats->templates[ tt ] );
+        fprintf(w.file, ",\n      \"fold_counts\": ");
+        write_json_counts( w.file, "      ", &w.t_counts[ tt ] );
+        fprintf(w.file, "\n    }");
+    }
+    fprintf(w.file, "%s]\n}\n", (stats->templates_cnt) ? "\n  " : "");
+
+    pthread_mutex_unlock( &stats->lock );
+    (free)( w.t_counts );
+
+    if ( stdout != w.file ) {
+        fclose( w.file );
+    }
+    else {
+        fflush( w.file );
+    }
+
+    return ( RC_TRUE );
+}
+
+
+/**
+ *******************************************************************************
+ */
+static void write_json_ns( FILE *file, char const *const indent, uint64_t const ns[ PA_PHASE_CNT ] )
+{
+
+    fprintf(file, "{");
+    for ( int ph = 0; ph < PA_PHASE_CNT; ph++ ) {
+        fprintf(file, "%s\n%s  \"%s\": %.3f", (ph) ? "," : "", indent, phase_names[ ph ], ns[ ph ] / 1e6);
+    }
+    fprintf(file, "\n%s}", indent);
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+static void write_json_counts( FILE *file, char const *const indent, pa_counts_t const *counts )
+{
+
+    fprintf(file, "{");
+    for ( int cn = 0; cn < PA_COUNT_CNT; cn++ ) {
+        fprintf(file, "%s\n%s  \"%s\": %lu", (cn) ? "," : "", indent, count_names[ cn ], (unsigned long) counts->n[ cn ]);
+    }
+    fprintf(file, "\n%s}", indent);
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * Write 'str' as a JSON string (or 'null').  Also for '--paginate-only'.
+ */
+void write_json_str( FILE *file, char const *str )
+{
+
+    if ( NULL == str ) {
+        fputs("null", file);
+        return ;
+    }
+
+    fputc('"', file);
+    for ( ; *str; str++ ) {
+        unsigned char ch = *str;
+
+        if ( '"' == ch || '\\' == ch ) {
+            fprintf(file, "\\%c", ch);
+        }
+        else if ( ch < 0x20 ) {
+            fprintf(file, "\\u%04x", ch);
+        }
+        else {
+            fputc(ch, file);
+        }
+    }
+    fputc('"', file);
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+void cleanup_pa_stats( pa_stats_t **p_stats )
+{
+    pa_stats_t *stats = *p_stats;
+
+    if ( NULL != stats ) {
+        for ( size_t idx = 0; idx < stats->cnt; idx++ ) {
+            for ( size_t jdx = 0; jdx < stats->chapters[ idx ].cnt; jdx++ ) {
+                (free)( stats->chapters[ idx ].pages[ jdx ].filename );
+                (free)( stats->chapters[ idx ].pages[ jdx ].counts );
+            }
+            (free)( stats->chapters[ idx ].pages );
+        }
+        (free)( stats->chapters );
+        pthread_mutex_destroy( &stats->lock );
+
+        free( *p_stats );
+    }
+
+    return ;
+}
@@ -0,0 +1,102 @@
+#ifndef PA_STATS_H
+#define PA_STATS_H
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ *******************************************************************************
+ * The run report, see '--stats-json'.
+ *
+ * Where the (wall clock) time goes, by phase, for each chapter and for each of
+ * its pages, plus what was read and written.  The '--jobs' workers and the
+ * encoders all add to the same report, so it's locked.
+ *
+ * Along with the times, the fold engine's counters for each template on each
+ * page (see 'pa_counts_t').
+ *
+ * All of the 'add_*()' calls do nothing if the report is NULL (i.e., if there
+ * is no '--stats-json'), so the callers don't have to check.
+ */
+#include <stdio.h>
+#include <stdint.h>
+
+#include "pa_misc.h"       /* for 'rc_e' */
+
+typedef enum {
+    PA_PHASE_SED = 0,     /* reading the chapter's text (through sed) */
+    PA_PHASE_DUP_GROUPS,  /* 'remove_dup_groups()' */
+    PA_PHASE_ATTR_EDITS,  /* 'apply_attr_edits()' */
+    PA_PHASE_WORK_TEXT,   /* 'make_work_text()' */
+    PA_PHASE_BG_DECODE,   /* loading the page's background */
+    PA_PHASE_FOLD,        /* fitting the text (PASS 1) */
+    PA_PHASE_RENDER,      /* the page's final renders (with the header) */
+    PA_PHASE_BLEND,
+    PA_PHASE_ENCODE,
+    PA_PHASE_WRITE,
+    PA_PHASE_CNT
+} pa_phase_e;
+
+/**
+ *******************************************************************************
+ * What it took to fold the text for one template on one page.  These are the
+ * numbers that make a slow chapter stand out (long unbroken tokens, lots of
+ * tags from the sed scripts, etc.).
+ */
+typedef enum {
+    PA_COUNT_TOKENS = 0,  /* tokens consumed by the template */
+    PA_COUNT_RENDERS,     /* 'ass_render_frame()' calls (all of them) */
+    PA_COUNT_SANDBOX,     /* ... of those, ASS_TRY_SANDBOX_TOKEN renders */
+    PA_COUNT_CLIPPED,     /* ASS_LAST_IS_CLIPPED walk-backs */
+    PA_COUNT_DROPPED,     /* ASS_DROPPED */
+    PA_COUNT_READ_BYTES,  /* passed to 'ass_read_memory()' */
+    PA_COUNT_TEXT_BYTES,  /* set as the event's Text of a parsed track */
+    PA_COUNT_PIECES,      /* ASS_Images walked */
+    PA_COUNT_MEASURED,    /* '--fold-measure' :: breaks predicted */
+    PA_COUNT_MEASURE_HIT, /* ... that were the break libass found */
+    PA_COUNT_MEASURE_OFF, /* ... and by how many tokens the others missed */
+    PA_COUNT_CNT
+} pa_count_e;
+
+typedef struct pa_counts_t {
+    uint64_t  n[ PA_COUNT_CNT ];
+} pa_counts_t;
+
+/**
+ *******************************************************************************
+ * A page, by its chapter (the index into 'in_chapters'), its number in the
+ * chapter (from 1) and its global sequence number (0 until it's rendered).
+ */
+typedef struct pa_page_id_t {
+    size_t  chapter;
+    size_t  page;
+    size_t  global;
+} pa_page_id_t;
+
+typedef struct pa_stats_t pa_stats_t;
+
+pa_stats_t *new_pa_stats       ( char const *const *chapters, size_t cnt, char const *const *templates, size_t templates_cnt );
+void        add_chapter_time   ( pa_stats_t *, size_t chapter, pa_phase_e, uint64_t ns );
+void        add_chapter_read   ( pa_stats_t *, size_t chapter, size_t bytes );
+void        add_page_time      ( pa_stats_t *, pa_page_id_t, pa_phase_e, uint64_t ns );
+void        add_page_written   ( pa_stats_t *, pa_page_id_t, char const *const filename, size_t bytes );
+void        add_page_counts    ( pa_stats_t *, pa_page_id_t, size_t template, pa_counts_t const * );
+void        add_counts         ( pa_counts_t *, pa_counts_t const * );
+void        add_bytes_read     ( pa_stats_t *, size_t bytes );
+rc_e        write_pa_stats_json( pa_stats_t *, char const *const filename );
+void        cleanup_pa_stats   ( pa_stats_t ** );
+
+void        write_json_str     ( FILE *, char const * );
+
+#endif  /* PA_STATS_H */
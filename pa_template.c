@@ -0,0 +1,345 @@
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "pa_misc.h"
+#include "pa_template.h"
+
+#ifndef realloc
+#warning "realloc() is not a macro..."
+#endif
+
+/**
+ *******************************************************************************
+ * A literal run of the template followed by a typed slot (the last literal
+ * run, after the last slot, is the template's 'tail').
+ */
+typedef struct pa_slot_t {
+    char const *lit;       /* points into 'pa_template_t->text' */
+    size_t      lit_len;
+    char        type;      /* 'd', 'u', 's', or '*' */
+} pa_slot_t;
+
+struct pa_template_t {
+    char         *pathname;
+    char         *text;
+
+    pa_slot_t     slots[ PA_TEMPLATE_MAX_SLOTS ];
+    unsigned int  cnt;
+    unsigned int  dialogue_slot;  /* the first slot in the last 'Dialogue:' */
+
+    char const   *event_text;     /* the start of that 'Dialogue:'s Text field */
+    size_t        event_text_len; /* ... up to 'dialogue_slot', NULL if all of
+                                     the slots aren't in the Text field */
+    char const   *tail;
+    size_t        tail_len;
+};
+
+static size_t fill_slots ( pa_template_t const *, unsigned int first, char const *lit, size_t lit_len, char **p_buf, size_t *p_buf_max, va_list ap );
+static void   sbuf_append( char **p_buf, size_t *p_buf_max, size_t *p_len, char const *str, size_t len );
+
+
+/**
+ *******************************************************************************
+ * Verify a text template.
+ *
+ * Perform a rudimentary inspection of a text template.  We only verify that
+ * it has the correct number and type of printf tags, but nothing beyond that.
+ * It's really just designed to catch fat-fingered typos in the template file.
+ *
+ * Note, a typical template should NOT have a random / stray '%' character.
+ */
+rc_e O3 verify_template( char const *const template, char const *types, char const *const final_type )
+{
+    struct {
+        rc_e        rc;
+        char const *ptr;
+    } w = {
+        .rc  = RC_TRUE,
+        .ptr = template,
+    };
+
+
+    while ( *types ) {
+        w.ptr = strchr( w.ptr, '%' );
+        if ( NULL == w.ptr ) {
+            w.rc = RC_FALSE;
+            break;
+        }
+        if ( *types != *(++w.ptr) ) {
+            w.rc = RC_FALSE;
+            break;
+        }
+        ++types;
+    }
+
+    /*
+     ***************************************************************************
+     * Check: is there a final format START in the string;
+     *        does it match the 'final_type'; and
+     *        there should be no additional format STARTs in the string.
+     */
+    if ( RC_TRUE == w.rc )  /* (guard) */
+    if ( (NULL != final_type
+            && (NULL == (w.ptr = strchr( w.ptr, '%' )) || STR_MATCH != strncmp(++w.ptr, final_type, strlen(final_type))))
+         || NULL != strchr( w.ptr, '%' )
+       ) {
+
+        w.rc = RC_FALSE;
+    }
+
+    return ( w.rc );
+}
+
+
+/**
+ *******************************************************************************
+ * Verify and compile the template 'text' (read from 'pathname').
+ * Returns NULL if the template doesn't verify.
+ */
+pa_template_t *new_pa_template( char const *const pathname, char const *const text, char const *types, char const *const final_type )
+{
+    struct {
+        pa_template_t *tmpl;
+        char const    *ptr;
+        char const    *dialogue;
+    } w = {
+        .tmpl = NULL,
+    };
+
+
+    if ( NULL == text || RC_FALSE == verify_template( text, types, final_type ) ) {
+        return ( NULL );
+    }
+    if ( strlen(types) + (NULL != final_type) > PA_TEMPLATE_MAX_SLOTS ) {
+        return ( NULL );
+    }
+
+    w.tmpl = calloc( 1, sizeof (pa_template_t) );
+    w.tmpl->pathname = strdup( pathname );
+    w.tmpl->text     = strdup( text );
+
+    /*
+     ***************************************************************************
+     * The slots in the last 'Dialogue:' line are the ones that change from
+     * render to render, the ones before it are (mostly) the frame's.
+     */
+    w.dialogue = w.tmpl->text;
+    for ( char const *p = w.tmpl->text; NULL != (p = strstr(p, "\nDialogue:")); p++ ) {
+        w.dialogue = p;
+    }
+
+    w.ptr = w.tmpl->text;
+    for ( char const *p = w.ptr; NULL != (p = strchr(p, '%')); w.ptr = p ) {
+        pa_slot_t *slot = &w.tmpl->slots[ w.tmpl->cnt ];
+
+        if ( p < w.dialogue ) {
+            w.tmpl->dialogue_slot = w.tmpl->cnt + 1;
+        }
+
+        slot->lit     = w.ptr;
+        slot->lit_len = p - w.ptr;
+        if ( '.' == *(p + 1) ) {      /* ".*s" */
+            slot->type = '*';
+            p += 4;
+        }
+        else {
+            slot->type = *(p + 1);
+            p += 2;
+        }
+        w.tmpl->cnt++;
+    }
+    w.tmpl->tail     = w.ptr;
+    w.tmpl->tail_len = strlen( w.ptr );
+
+    /*
+     ***************************************************************************
+     * Find the Text field (after the 9th ',') of the last 'Dialogue:'.  If all
+     * of that line's slots are in it, the event's Text can be built on its own.
+     */
+    if ( w.tmpl->dialogue_slot < w.tmpl->cnt && w.dialogue != w.tmpl->text ) {
+        char const *slot_ptr = w.tmpl->slots[ w.tmpl->dialogue_slot ].lit
+                             + w.tmpl->slots[ w.tmpl->dialogue_slot ].lit_len;
+        char const *p = w.dialogue + sizeof ("\nDialogue:") - 1;
+        int         commas = 0;
+
+        for ( ; p < slot_ptr && commas < 9; p++ ) {
+            commas += (',' == *p);
+        }
+        if ( 9 == commas ) {
+            w.tmpl->event_text     = p;
+            w.tmpl->event_text_len = slot_ptr - p;
+        }
+    }
+
+    return ( w.tmpl );
+}
+
+
+/**
+ *******************************************************************************
+ * Can the last 'Dialogue:'s Text be built with 'fill_pa_template_text()'?
+ */
+rc_e has_template_text( pa_template_t const *tmpl )
+{
+    return ( (NULL != tmpl->event_text) ? RC_TRUE : RC_FALSE );
+}
+
+
+/**
+ *******************************************************************************
+ * Build the template's script in '*p_buf' (which is grown as needed, and can
+ * be reused from call to call) with the slots' values.  The arguments are the
+ * same as they'd be for 'asprintf()' and the template.
+ *
+ * Returns the script's length (it's also '\0' terminated).
+ */
+size_t O3 fill_pa_template( pa_template_t const *tmpl, char **p_buf, size_t *p_buf_max, ... )
+{
+    va_list ap;
+    size_t  len;
+
+    va_start( ap, p_buf_max );
+    len = fill_slots( tmpl, 0, tmpl->slots[ 0 ].lit, tmpl->slots[ 0 ].lit_len, p_buf, p_buf_max, ap );
+    va_end( ap );
+
+    return ( len );
+}
+
+
+/**
+ *******************************************************************************
+ * Build just the Text of the last 'Dialogue:' event, as libass would parse it
+ * out of the script from 'fill_pa_template()' (i.e., up to the end of its
+ * line).  The arguments are those for the slots in the Text field.
+ *
+ * This is for changing an event's Text in an already parsed ASS_Track, see
+ * 'has_template_text()'.
+ */
+size_t O3 fill_pa_template_text( pa_template_t const *tmpl, char **p_buf, size_t *p_buf_max, ... )
+{
+    va_list ap;
+    size_t  len;
+
+    va_start( ap, p_buf_max );
+    len = fill_slots( tmpl, tmpl->dialogue_slot, tmpl->event_text, tmpl->event_text_len, p_buf, p_buf_max, ap );
+    va_end( ap );
+
+    len = strcspn( *p_buf, "\r\n" );
+    *(*p_buf + len) = '\0';
+
+    return ( len );
+}
+
+
+/**
+ *******************************************************************************
+ * Copy 'lit', then the slots from 'first' on (with their literal runs), then
+ * the template's tail.
+ */
+static size_t O3 fill_slots( pa_template_t const *tmpl, unsigned int first, char const *lit, size_t lit_len, char **p_buf, size_t *p_buf_max, va_list ap )
+{
+    struct {
+        size_t       len;
+        char         num[ 24 ];
+        char const  *str;
+        int          prec;
+    } w = {
+        .len = 0,
+    };
+
+
+    for ( unsigned int idx = first; idx < tmpl->cnt; idx++ ) {
+        pa_slot_t const *slot = &tmpl->slots[ idx ];
+
+        if ( idx == first ) {
+            sbuf_append( p_buf, p_buf_max, &w.len, lit, lit_len );
+        }
+        else {
+            sbuf_append( p_buf, p_buf_max, &w.len, slot->lit, slot->lit_len );
+        }
+
+        switch ( slot->type ) {
+        case 'd':
+            sbuf_append( p_buf, p_buf_max, &w.len, w.num, snprintf(w.num, sizeof (w.num), "%d", va_arg(ap, int)) );
+            break;
+        case 'u':
+            sbuf_append( p_buf, p_buf_max, &w.len, w.num, snprintf(w.num, sizeof (w.num), "%u", va_arg(ap, unsigned int)) );
+            break;
+        case 's':
+            w.str = va_arg( ap, char const * );
+            sbuf_append( p_buf, p_buf_max, &w.len, w.str, strlen(w.str) );
+            break;
+        case '*':
+            w.prec = va_arg( ap, int );
+            w.str  = va_arg( ap, char const * );
+            sbuf_append( p_buf, p_buf_max, &w.len, w.str, strnlen(w.str, w.prec) );
+            break;
+        }
+    }
+    sbuf_append( p_buf, p_buf_max, &w.len, tmpl->tail, tmpl->tail_len );
+
+    return ( w.len );
+}
+
+
+/**
+ *******************************************************************************
+ */
+static void O3 sbuf_append( char **p_buf, size_t *p_buf_max, size_t *p_len, char const *str, size_t len )
+{
+
+    if ( *p_len + len + 1 > *p_buf_max ) {
+        *p_buf_max = (*p_len + len + 1) + 4096;
+        *p_buf = realloc( *p_buf, *p_buf_max );
+    }
+
+    memcpy( *p_buf + *p_len, str, len );
+    *p_len += len;
+    *(*p_buf + *p_len) = '\0';
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+char const *get_template_name( pa_template_t const *tmpl )
+{
+    return ( tmpl->pathname );
+}
+
+
+/**
+ *******************************************************************************
+ */
+void cleanup_pa_template( pa_template_t **p_tmpl )
+{
+    pa_template_t *tmpl = *p_tmpl;
+
+    if ( NULL != tmpl ) {
+        (free)( tmpl->pathname );
+        (free)( tmpl->text );
+
+        free( *p_tmpl );
+    }
+
+    return ;
+}
@@ -0,0 +1,49 @@
+#ifndef PA_TEMPLATE_H
+#define PA_TEMPLATE_H
+/*
+ *******************************************************************************
+ * Copyright (C) 2018
+ *
+ * This file is part of pngass.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/**
+ *******************************************************************************
+ * Compiled ASS templates.
+ *
+ * A template is a printf() format with a fixed set of conversions (see the
+ * TEMPLATEs directory).  It's read and verified once, then split into the
+ * literal runs between its conversions -- the '[Script Info]' / '[V4+ Styles]'
+ * part, the 'Dialogue:' prefix, etc. -- and typed slots.  Building the script
+ * for a render just copies the literals and formats the slots, without
+ * scanning the whole template as 'asprintf()' would.
+ *
+ * The slot types are the 'verify_template()' types --
+ *   'd' :: int, 'u' :: unsigned int, 's' :: char const *, and
+ *   '*' :: the final ".*s", an int and a char const *.
+ */
+#include "pa_misc.h"  /* for 'rc_e' */
+
+#undef PA_TEMPLATE_MAX_SLOTS
+#define PA_TEMPLATE_MAX_SLOTS  (12)
+
+typedef struct pa_template_t pa_template_t;
+
+rc_e           verify_template    ( char const *const template, char const *types, char const *const final_type );
+
+pa_template_t *new_pa_template    ( char const *const pathname, char const *const text, char const *types, char const *const final_type );
+size_t         fill_pa_template   ( pa_template_t const *, char **p_buf, size_t *p_buf_max, ... );
+rc_e           has_template_text  ( pa_template_t const * );
+size_t         fill_pa_template_text( pa_template_t const *, char **p_buf, size_t *p_buf_max, ... );
+char const    *get_template_name  ( pa_template_t const * );
+void           cleanup_pa_template( pa_template_t ** );
+
+#endif  /* PA_TEMPLATE_H */
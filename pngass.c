@@ -28,11 +28,15 @@
 #include <getopt.h>
 #include <unistd.h>  /* getopt() */
 #include <glob.h>
+#include <limits.h>
+#include <dirent.h>
+#include <inttypes.h>
 
 #include <fcntl.h>
 #include <errno.h>
 #include <libgen.h>
 #include <locale.h>
+#include <pthread.h>
 #include <ass/ass.h>
 
 #include "pa_misc.h"
@@ -40,6 +44,14 @@
 #include "rw_textfile.h"
 #include "rw_imagefile.h"
 #include "pa_edits.h"
+#include "pa_render.h"
+#include "pa_measure.h"
+#include "pa_bgcache.h"
+#include "pa_encoder.h"
+#include "pa_stats.h"
+#include "pa_template.h"
+#include "pa_foldcache.h"
+#include "pa_sed.h"
 
 #include "pngass.h"
 
@@ -232,12 +244,97 @@ typedef struct text_segments_t {
 } text_segments_t;
 
 
+/**
+ ******************************************************************************
+ * PASS 1 fits the text onto the pages and PASS 2 renders it, only so that the
+ * header's "Page X of Y" is known when it's drawn.  With '--single-pass', the
+ * text is fit and rendered in one pass and held until the chapter's page count
+ * is known, then the header and the text are composited (see 'held_page_t').
+ */
 typedef enum {
     FOLD_PASS_1 = 0,
     FOLD_PASS_2,
-    FOLD_PASS_END
+    FOLD_PASS_END,
+    FOLD_PASS_SINGLE,  /* '--single-pass' :: fit AND render */
+    FOLD_PASS_SINGLE_END
 } fold_pass_e;         /* In 'pa_opts' for 'ass_set_message_cb()' */
 
+#undef IS_FIT_PASS
+#define IS_FIT_PASS( pass_ )    ( FOLD_PASS_1 == (pass_) || FOLD_PASS_SINGLE == (pass_) )
+#undef IS_RENDER_PASS
+#define IS_RENDER_PASS( pass_ ) ( FOLD_PASS_2 == (pass_) || FOLD_PASS_SINGLE == (pass_) )
+
+/*
+ * The '--stats-json' id of the page that's being worked on (a page only has a
+ * global sequence number when it's rendered).
+ */
+#undef PAGE_ID
+#define PAGE_ID( pa_opts_ ) ((pa_page_id_t) {                                    \
+    .chapter = (pa_opts_)->details.chapter_idx,                                  \
+    .page    = (pa_opts_)->details.chapter_image_number,                         \
+    .global  = IS_RENDER_PASS( (pa_opts_)->fold_pass )                           \
+             ? (pa_opts_)->details.global_image_sequence_number : 0,             \
+})
+
+
+/**
+ ******************************************************************************
+ * How PASS 1 searches for the last token that fits in a template --
+ *  - GALLOP :: probe a growing # of tokens, then bisect back to the break
+ *              (a handful of renders per template, see 'gallop_fold_search()'
+ *              for where its break can differ, and it needs a top-aligned
+ *              template);
+ *  - LINEAR :: the original search, one render per token (the default).
+ */
+typedef enum {
+    FOLD_SEARCH_GALLOP = 0,
+    FOLD_SEARCH_LINEAR,
+} fold_search_e;
+
+
+/**
+ ******************************************************************************
+ * '--fold-measure' :: predict each template's break with the FreeType layout
+ * (see 'pa_measure.h') before PASS 1 renders anything --
+ *  - HINT   :: start the gallop search at the predicted break (only with
+ *              '--fold-search=gallop');
+ *  - VERIFY :: ... and report each prediction against the break libass
+ *              found (the "measure_*" counters, see 'pa_counts_t').
+ * libass always has the final say, so the pages are the same either way.
+ */
+typedef enum {
+    FOLD_MEASURE_OFF = 0,
+    FOLD_MEASURE_HINT,
+    FOLD_MEASURE_VERIFY,
+} fold_measure_e;
+
+
+/**
+ ******************************************************************************
+ * '--paginate-only' :: only fit the text (NO background decode, blend, or
+ * encode) and write each chapter's page map in one of these formats.
+ */
+typedef enum {
+    PAGE_MAP_NONE = 0,  /* a normal run */
+    PAGE_MAP_TSV,
+    PAGE_MAP_JSON,
+} page_map_e;
+
+
+/**
+ ******************************************************************************
+ * '--sed' :: how the '--script-file's are run --
+ *  - BUILTIN  :: compiled once and run on the text in memory (see 'pa_sed.h'),
+ *                or with sed if the scripts use what the builtin can't do;
+ *  - EXTERNAL :: 'popen()' sed for each chapter;
+ *  - VERIFY   :: both, and warn if the builtin's text isn't sed's (sed wins).
+ */
+typedef enum {
+    SED_ENGINE_BUILTIN = 0,
+    SED_ENGINE_EXTERNAL,
+    SED_ENGINE_VERIFY,
+} sed_engine_e;
+
 
 typedef struct details_t {
     char const *chapter_filename;  /* NOT free()-able, from 'basename()' */
@@ -250,6 +347,7 @@ typedef struct details_t {
         size_t  chapter_image_number;
         size_t  chapter_images;
         size_t  global_image_sequence_number;  /* for all of the chapters processed */
+        size_t  chapter_idx;                   /* in_chapters, for '--stats-json' */
 
         unsigned int dup_lines_found;   /* Initialized through its API */
         unsigned int dup_groups_found;  /* Initialized through its API */
@@ -324,15 +422,85 @@ typedef struct pa_opts {
 
     fold_pass_e fold_pass;
 
+    fold_search_e fold_search;
+    unsigned int  fold_hint;   /* # of tokens that fit the previous template */
+    fold_measure_e fold_measure;
+    double        fold_measure_scale;  /* actual / predicted, for the last template */
+    pa_measure_t *pa_measure;  /* per thread, like 'pa_render' */
+    int           single_pass; /* '--single-pass', see 'fold_pass_e' */
+    FILE         *held_text;   /* '--single-pass' :: the chapter's held pages' text */
+    page_map_e    paginate_only;
+
     details_t   details;
 
+            /**
+             ******************************************************************
+             * The libass library / renderer(s), built once for the whole run
+             * so that the font setup and libass's caches are NOT rebuilt for
+             * every template on every page.  See '--ass-cache'.
+             */
+    pa_render_t *pa_render;
+    int          ass_glyph_max;      /* 0 :: libass's default */
+    int          ass_bitmap_max_mb;  /* 0 :: libass's default */
+
+            /**
+             ******************************************************************
+             * The decoded background images, so that a background's PNG is
+             * only inflated once (not once per page).  See '--bg-cache'.
+             */
+    pa_bgcache_t *bgcache;
+    int           bg_cache_mb;       /* 0 :: decode for every page */
+    bg_filter_t   bg_filter;         /* '--background-filter', applied once per background */
+    char         *bg_cache_dir;      /* '--bg-cache-dir', the decoded frames across runs */
+    int           prefetch;          /* '--prefetch=K[,MB]', 0 :: decode on demand */
+    int           prefetch_mb;
+
+            /**
+             ******************************************************************
+             * '--jobs' :: the # of chapters folded at once, see
+             * 'run_chapter_jobs()'.
+             */
+    unsigned int  jobs;
+
+            /**
+             ******************************************************************
+             * The finished pages are compressed and written by these threads,
+             * see '--encode-threads' (0 :: on the rendering thread).
+             */
+    pa_encoder_t *encoder;
+    unsigned int  encode_threads;
+
+            /**
+             ******************************************************************
+             * '--stats-json' :: the run report, NULL if there's no report.
+             */
+    pa_stats_t   *stats;
+    char         *stats_json;
+
+            /**
+             ******************************************************************
+             * '--fold-cache' :: where the chapters' folds are saved, and the
+             * part of their keys that's the same for every chapter (see
+             * 'init_fold_key()').  NULL :: no cache.
+             */
+    char         *fold_cache_dir;
+    uint64_t      fold_key;
+    int           fold_frames_vary;  /* the backgrounds aren't all one size */
+
     strptrary_t in_chapters;
     strptrary_t templates;
     strptrary_t font_dirs;    /* See ass_set_fonts_dir(ASS_Library *, ...) */
     strptrary_t in_png_list;
+    pa_image_t **in_png_frames;  /* 'in_png_list's sizes (no pixels), see 'probe_backgrounds()' */
     strptrary_t sed_script_files;
     strptrary_t header_template;
 
+    sed_engine_e  sed_engine;
+    pa_sed_t     *pa_sed;     /* 'sed_script_files', compiled at startup */
+
+    pa_template_t **text_templates;   /* 'templates', compiled at startup */
+    pa_template_t  *header_compiled;  /* 'header_template', ditto */
+
     char pad_str[ sizeof (PAD_FMT) + 6 ];
 
     /**
@@ -390,6 +558,179 @@ typedef struct pa_ass_t {
     unsigned int   token_start_idx;
 } pa_ass_t;
 
+#undef PIECE_START_UNKNOWN
+#define PIECE_START_UNKNOWN (UINT_MAX)  /* skipped by 'gallop_fold_search()' */
+
+
+/**
+ ******************************************************************************
+ * A chapter's work text, tokenised once by 'make_work_text()' so that PASS 1
+ * never rescans its bytes for the token boundaries.  'ends[]' is the offset
+ * just past each token and its trailing white SPACE (see 'next_token_idx()')
+ * from the start of the work text, so the last one is the '\0'.  'pads[]' is
+ * where each '--pad-paragraph' string starts (see 'trim_work_text()').
+ */
+typedef struct work_index_t {
+    uint32_t     *ends;
+    size_t        cnt;
+    uint32_t     *pads;
+    size_t        pads_cnt;
+} work_index_t;
+
+
+/**
+ ******************************************************************************
+ * The token end offsets of the text remaining for a template, built as the
+ * fold searches need them.  'ends[ k ]' is the offset just past token 'k'
+ * (and its trailing SPACEs), and 'ends[ 0 ]' is 0.  They're copied from the
+ * chapter's 'work_index_t', starting at its 'first' token past 'start'.
+ */
+typedef struct fold_tokens_t {
+    unsigned int *ends;
+    unsigned int  cnt;     /* # of valid 'ends[]', including 'ends[ 0 ]' */
+    unsigned int  max;
+    int           done;    /* the '\0' was reached, 'cnt - 1' is the last token */
+
+    work_index_t const *index;  /* NULL :: find them with 'next_token_idx()' */
+    unsigned int  start;   /* the template's 'text_start_idx' */
+    size_t        first;
+} fold_tokens_t;
+
+
+/**
+ ******************************************************************************
+ * A template's script for one frame, parsed once.  The header and styles don't
+ * change from render to render, only the last 'Dialogue:' event's Text does,
+ * so after the first render the event's Text is rebuilt in place rather than
+ * re-reading the whole script.  If the template's Text can't be isolated (see
+ * 'has_template_text()'), then every render re-reads the script as before.
+ */
+typedef struct text_track_t {
+    pa_opts_t const     *pa_opts;
+    pa_template_t const *template;
+    ASS_Library         *ass_library;
+    int                  width;
+    int                  height;
+    ASS_Track           *ass_track;
+    int                  per_event;     /* just replace 'events[ 0 ].Text' */
+    size_t               text_max;      /* its allocated size */
+    char                *ass_text;      /* reused for each full script */
+    size_t               ass_text_max;
+    pa_counts_t         *counts;        /* the template's fold counters */
+} text_track_t;
+
+
+/**
+ ******************************************************************************
+ * Everything needed to render a trial prefix of the text for a template.
+ *
+ * The fit test is done in a "tall" frame -- the template's PlayResY and the
+ * frame are both twice the image's height, so the text's scale and layout
+ * are unchanged but nothing falls off of the bottom.  This makes the test
+ * for N tokens independent of the renders for N - 1 tokens (which is what
+ * the token-by-token search in 'cmpr_last_ASS_Image()' depends on).
+ *
+ * NOTE :: This assumes a top-aligned template, like all of the TEMPLATEs.
+ */
+#undef FOLD_TALL_FRAME
+#define FOLD_TALL_FRAME( height_ ) ( 2 * (height_) )
+
+typedef struct fold_probe_t {
+    pa_opts_t const *pa_opts;
+    pa_template_t const *template;
+    char const      *work_text_2;
+    ASS_Library     *ass_library;
+    ASS_Renderer    *ass_renderer;   /* the image's frame */
+    ASS_Renderer    *tall_renderer;  /* the "tall" frame */
+    text_track_t     tall;           /* the tall render's ASS_Images are valid
+                                        until the next render or this is freed */
+    ASS_Image       *tall_img;       /* ... and those are of 'tall_len' bytes */
+    unsigned int     tall_len;
+    int              tall_fit;       /* 'fits()' accepted the 'tall_img' */
+    int              width;
+    int              height;
+    int              bottom;         /* 'height' less the bottom margin */
+} fold_probe_t;
+
+
+/**
+ ******************************************************************************
+ * A '--single-pass' page that's been fit, waiting on the chapter's page count
+ * for its header.  Only its text is held (its ASS_Images, in 'held_text'
+ * between 'text_start' and 'text_end', see 'hold_text_layer()'), so that the
+ * header goes under the text like PASS 2, and a page costs a file offset and
+ * not a decoded background.  'elapsed' is the page's time so far (for the "PA
+ * Render Time" comment), NOT including the time it's held.
+ */
+typedef struct held_page_t {
+    size_t       png_idx;
+    size_t       png_filename_idx;  /* for '--prefetch' */
+    char const  *in_png_name;
+    size_t       chapter_image_number;
+    size_t       global_image_sequence_number;
+    long         text_start;
+    long         text_end;          /* -1 :: the text couldn't be held */
+    clock_t      elapsed;
+} held_page_t;
+
+/**
+ ******************************************************************************
+ * A held ASS_Image, its 'w * h' bitmap follows it (the stride is 'w').
+ */
+typedef struct held_piece_t {
+    int          w;
+    int          h;
+    int          dst_x;
+    int          dst_y;
+    uint32_t     color;
+} held_piece_t;
+
+
+/**
+ ******************************************************************************
+ * A chapter's work text and how it folds onto its pages.  Each chapter's fold
+ * is independent of the others, only its first background image and its first
+ * "global" sequence number depend on the page counts of the chapters before
+ * it (see '--jobs' and 'run_chapter_jobs()').
+ */
+typedef struct chapter_t {
+    char const      *chapter_filename;  /* in_chapters.pathnames */
+    size_t           chapter_idx;       /* ... its index */
+    char            *work_text;
+    work_index_t     work_index;
+    char            *png_Title;
+    unsigned int     dup_groups_found;  /* from 'process_textfile()' */
+    off_t            text_size;         /* for the '--jobs' scheduling */
+
+    text_segments_t *text_segments;     /* MAX_TEMPLATE_STEPS of these */
+    unsigned int     template_pass;
+    size_t           chapter_images;    /* set by its PASS 1 */
+    pa_counts_t      counts;            /* its fold counters, both passes */
+
+    size_t           png_filename_idx;  /* of its first page */
+    size_t           global_image_sequence_number;  /* before its first page */
+
+    uint64_t         fold_key;          /* '--fold-cache' */
+    int              fold_cached;       /* its fold was loaded, NO PASS 1 */
+
+    uint32_t        *in_map;            /* '--paginate-only', see 'make_work_text()' */
+} chapter_t;
+
+
+/**
+ ******************************************************************************
+ * The '--jobs' work queue, for one pass over all of the chapters.  'order' is
+ * the chapters, longest first, and 'next' is the next one to take from it.
+ */
+typedef struct chapter_jobs_t {
+    pa_opts_t const *pa_opts;
+    chapter_t      **order;
+    size_t           cnt;
+    size_t           next;
+    fold_pass_e      fold_pass;
+    pthread_mutex_t  lock;
+} chapter_jobs_t;
+
 
 /******************************************************************************/
 static rc_e   pa_parse_cmdline ( pa_opts_t *pa_opts, int argc, char **argv );
@@ -399,25 +740,53 @@ static void   post_opt_defaults( pa_opts_t *pa_opts );
 static void   cleanup_pa_opts  ( pa_opts_t **pa_opts );
 static char  *get_Software     ( void );
 
-static size_t add_font_search_dirs( ASS_Library *ass_library, strptrary_t *font_dirs );
-
-static pa_image_t *load_pa_image( pa_opts_t const *pa_opts, char const *const filename );
-static rc_e      save_pa_image( pa_image_t *pa_image, pa_opts_t *pa_opts, clock_t );
+static pa_image_t *load_pa_image( pa_opts_t const *pa_opts, size_t png_idx, int decode );
+static rc_e      save_pa_image( pa_image_t **pa_imagep, pa_opts_t *pa_opts, clock_t );
+static int       hold_text_layer( FILE *, ASS_Image * );
+static int       blend_held_text( pa_image_t *, FILE *, long start, long end );
+static void      save_held_pages( held_page_t *, size_t cnt, pa_opts_t * );
+
+static void  load_chapter    ( pa_opts_t *, chapter_t * );
+static void  fold_chapter    ( pa_opts_t *, chapter_t * );
+static void  debug_chapter   ( pa_opts_t const *, chapter_t const * );
+static void  cleanup_chapter ( chapter_t * );
+static rc_e  init_fold_key   ( pa_opts_t * );
+static rc_e  load_chapter_fold( pa_opts_t const *, chapter_t * );
+static void  save_chapter_fold( pa_opts_t const *, chapter_t const * );
+static void  write_page_map  ( pa_opts_t const *, chapter_t const * );
+static rc_e  probe_backgrounds( pa_opts_t * );
+static rc_e  same_background_sizes( pa_opts_t const * );
+static void  run_chapter_jobs( pa_opts_t * );
+static void *chapter_worker  ( void * );
+static int   by_text_size     ( void const *, void const * );
+static int   by_chapter_images( void const *, void const * );
 
 static char *process_textfile( char const *const filename, pa_opts_t * );
 static void  write_debug_text( char const *const filename, char const *const str, pa_opts_t * );
-static char *make_work_text  ( char const *const in_text, char const *const pad );
-static void  trim_work_text  ( pa_opts_t const *, char const *const work_text, text_segments_t *const, unsigned int template_pass );
+static char *make_work_text  ( char const *const in_text, char const *const pad, uint32_t **p_in_map, work_index_t * );
+static void  index_work_text ( char const *const work_text, work_index_t * );
+static void  trim_work_text  ( pa_opts_t const *, work_index_t const *, text_segments_t *const, unsigned int template_pass );
 static char *debug_work_text ( char const *const work_text, char const *const dir, char const *const chapter_filename );
 
-static void   apply_template_complex( pa_image_t *, pa_opts_t *, char const *const template, char *const work_text_2, text_segments_t *const );
+static void   apply_template_complex( pa_image_t *, pa_opts_t *, pa_template_t const *const, char *const work_text_2, work_index_t const *, text_segments_t *const, size_t template_idx, pa_counts_t * );
+static void   print_fold_counts     ( char const *const what, pa_counts_t const * );
 static size_t apply_template_simple ( pa_image_t *, pa_opts_t * );
 
 static size_t skip_non_text_tokens(char const *const in_text, size_t in_idx, int, int );
+static unsigned int next_token_idx( char const *const work_text_2, unsigned int idx );
 
-static ass_cmpr_e cmpr_last_ASS_Image( pa_ass_t *const dst, ASS_Image *src, int height, short, char const *const );
+static void         fold_tokens_init    ( fold_tokens_t *, work_index_t const *, unsigned int start );
+static unsigned int fold_tokens_ensure  ( fold_tokens_t *, char const *const work_text_2, unsigned int k );
+static unsigned int fold_tokens_count   ( fold_tokens_t *, char const *const work_text_2, unsigned int len );
+static ASS_Track   *set_text_track      ( text_track_t *, unsigned int len, char const *const text );
+static void         cleanup_text_track  ( text_track_t * );
+static ASS_Image   *render_fold_probe   ( fold_probe_t *, unsigned int len );
+static unsigned int gallop_fold_search  ( fold_probe_t *, fold_tokens_t *, pa_ass_t *const, unsigned int measured );
+static rc_e         measure_fold_tokens ( text_track_t *, fold_tokens_t *, char const *const work_text_2, unsigned int *p_k );
+static void         resolve_piece_starts( fold_probe_t *, fold_tokens_t *, pa_ass_t *const, ASS_Image *, short, unsigned int k_lo );
+static void         cleanup_fold_probe  ( fold_probe_t * );
 
-static int      verify_template( char const *const template, char const *types, char const *const final_type );
+static ass_cmpr_e cmpr_last_ASS_Image( pa_ass_t *const dst, ASS_Image *src, int height, short, char const *const, pa_counts_t * );
 
 static char const *get_chapter_title( char *const ptr, size_t max );
 static void        cleanup_details( details_t *details );
@@ -440,7 +809,6 @@ static void libass_msg_callback( int level, const char *fmt, va_list args, void
  */
 int main(int argc, char *argv[])
 {
-    auto void cleanup_text_segments( text_segments_t ** );
     pa_opts_t *pa_opts = calloc( 1, sizeof (pa_opts_t) );
 
     pa_parse_cmdline( pa_opts, argc, argv );
@@ -470,28 +838,30 @@ int main(int argc, char *argv[])
         append_a_pathname( &pa_opts->in_chapters, READ_STDIN );
     }
 
-    if ( pa_opts->templates.cnt > 0 ) {
-        struct {
-            size_t    image_page_total;
-            unsigned int  template_pass;
-            unsigned int  png_filename_idx;
-            unsigned int  save_png_filename_idx;
-
-            char     *work_text;
-
-            unsigned int  text_start_idx;
-            unsigned int  work_text_delta;
-
-            char     *in_text;
-
-            clock_t   my_clock;
-        } w = {
-            .text_start_idx = 0
-        };
-
-        text_segments_t *text_segments __attribute__ ((__cleanup__ (cleanup_text_segments))) = NULL;
-        text_segments = realloc(text_segments, (MAX_TEMPLATE_STEPS * sizeof (text_segments_t)));
+    /*
+     ***************************************************************************
+     * Compile the '--script-file's once, with the "reset"s after them as plain
+     * strings (see 'process_textfile()').  NULL :: sed runs the scripts.
+     */
+    if ( pa_opts->sed_script_files.cnt > 0 && SED_ENGINE_EXTERNAL != pa_opts->sed_engine ) {
+        pa_opts->pa_sed = new_pa_sed( &pa_opts->sed_script_files );
+        if ( NULL == pa_opts->pa_sed ) {
+            fprintf(stderr, "WARNING :: running the '--script-file's with '%s' instead.\n", PA_SED_EXEC);
+        } else {
+            char  reset[ 32 + strlen(pa_opts->text_face) ];
+
+            snprintf(reset, sizeof (reset), "\\1a&H%s", pa_opts->alpha_1a);
+            add_sed_literal( pa_opts->pa_sed, "@@1a@@", reset );
+            snprintf(reset, sizeof (reset), "\\1c&H%s&", pa_opts->colour_1c);
+            add_sed_literal( pa_opts->pa_sed, "@@1c@@", reset );
+            snprintf(reset, sizeof (reset), "\\fn%s", pa_opts->text_face);
+            add_sed_literal( pa_opts->pa_sed, "@@face@@", reset );
+            snprintf(reset, sizeof (reset), "\\fs%d", pa_opts->text_size);
+            add_sed_literal( pa_opts->pa_sed, "@@size@@", reset );
+        }
+    }
 
+    if ( pa_opts->templates.cnt > 0 ) {
         /*
          ***************************************************************************
          * Build the paragraph pad string, if needed, else, it's an EMPTY string.
@@ -500,132 +870,147 @@ int main(int argc, char *argv[])
             snprintf(pa_opts->pad_str, sizeof (pa_opts->pad_str), PAD_FMT, pa_opts->pad_paragraph, pa_opts->text_size);
         }
 
-        for ( size_t chapter_idx = 0; chapter_idx < pa_opts->in_chapters.cnt; chapter_idx++ ) {
+        /*
+         ***************************************************************************
+         * One libass library / renderer for all of the pages of all chapters.
+         */
+        pa_opts->pa_render = new_pa_render( &pa_opts->font_dirs, libass_msg_callback, pa_opts );
+        set_render_cache_limits( pa_opts->pa_render, pa_opts->ass_glyph_max, pa_opts->ass_bitmap_max_mb );
 
-            /*
-             *******************************************************************
-             * We rely on 'text_segments_t->text_start_idx' being ZERO.
-             */
-            memset(text_segments, '\0', (MAX_TEMPLATE_STEPS * sizeof (text_segments_t)));
+        if ( FOLD_MEASURE_OFF != pa_opts->fold_measure ) {
+            pa_opts->pa_measure = new_pa_measure( &pa_opts->font_dirs );
+        }
 
-            w.in_text = process_textfile( pa_opts->in_chapters.pathnames[ chapter_idx ], pa_opts );
+        pa_opts->bgcache = new_pa_bgcache( pa_opts->bg_cache_mb, &pa_opts->bg_filter, pa_opts->bg_cache_dir );
 
-            pa_opts->details.chapter_filename = pa_opts->in_chapters.pathnames[ chapter_idx ];
-            if ( pa_opts->verbose_level > VERBOSE_QUIET ) {
-                fprintf(stderr, "Adding :: '%s' ...\n", pa_opts->details.chapter_filename);
-            }
-            free ( pa_opts->details.png_Title );
+        if ( NULL != pa_opts->stats_json ) {
+            pa_opts->stats = new_pa_stats( (char const *const *) pa_opts->in_chapters.pathnames, pa_opts->in_chapters.cnt,
+                                           (char const *const *) pa_opts->templates.pathnames, pa_opts->templates.cnt );
+        }
+
+        if ( RC_TRUE != probe_backgrounds( pa_opts ) ) {
+            goto quit;
+        }
 
-            w.work_text = make_work_text( w.in_text, pa_opts->pad_str );
-            debug_work_text( w.work_text, pa_opts->debug_work_dir, pa_opts->details.chapter_filename );
-            free ( w.in_text );
+        if ( pa_opts->encode_threads > 0 && PAGE_MAP_NONE == pa_opts->paginate_only ) {
+            pa_opts->encoder = new_pa_encoder( pa_opts->encode_threads,
+                                               pa_opts->encode_threads * 2,
+                                               pa_opts->verbose_level >= VERBOSE_2,
+                                               pa_opts->stats );
+        }
 
-            pa_opts->details.png_Title = get_chapter_title( w.work_text, MAX_CHAPTER_TITLE_SZ );
-            //g BREAK_STR(pa_opts->details.png_Title, "1-6. The Marketplace");
+        /*
+         ***************************************************************************
+         * Read, verify and compile the templates once, not for every page.
+         */
+        pa_opts->text_templates = calloc( pa_opts->templates.cnt, sizeof (pa_template_t *) );
+        for ( size_t idx = 0; idx < pa_opts->templates.cnt; idx++ ) {
+            char *template = read_textfile_sz( pa_opts->templates.pathnames[ idx ], NULL, 1280 );
+
+            pa_opts->text_templates[ idx ] = new_pa_template( pa_opts->templates.pathnames[ idx ], template, "ddsdss", ".*s" );
+            if ( NULL == pa_opts->text_templates[ idx ] ) {
+               fprintf(stderr, "\nFATAL :: invalid template '%s'\n", pa_opts->templates.pathnames[ idx ]);
+               _exit( 1 );
+            }
+            free (template);
+        }
+        if ( 1 == pa_opts->header_template.cnt ) {
+            pa_opts->header_compiled = new_pa_template( pa_opts->header_template.pathnames[ 0 ], pa_opts->header_template.data[ 0 ], "ddsssu", NULL );
+        }
 
-            w.save_png_filename_idx = w.png_filename_idx;
+        if ( NULL != pa_opts->fold_cache_dir && RC_TRUE != init_fold_key( pa_opts ) ) {
+            fprintf(stderr, "WARNING :: can't build the '--fold-cache' keys, NOT using the cache.\n");
+            free (pa_opts->fold_cache_dir);
+        }
 
-            for ( pa_opts->fold_pass = FOLD_PASS_1; pa_opts->fold_pass < FOLD_PASS_END; pa_opts->fold_pass++ ) {
+        if ( pa_opts->jobs > 1 && pa_opts->in_chapters.cnt > 1 && RC_FALSE == same_background_sizes( pa_opts ) ) {
+            if ( pa_opts->verbose_level > VERBOSE_QUIET ) {
+                fprintf(stderr, "WARNING :: '--jobs' needs all of the images to be the same size, using 1 job.\n");
+            }
+            pa_opts->jobs = 1;
+        }
 
-                w.png_filename_idx = w.save_png_filename_idx;
-                w.template_pass = 0;
-                w.text_start_idx = 0;
-                pa_opts->details.chapter_image_number = 0;
+        if ( pa_opts->jobs > 1 && pa_opts->in_chapters.cnt > 1 ) {
+            run_chapter_jobs( pa_opts );
+        }
+        else {
+            /*
+             *******************************************************************
+             * One chapter at a time, so the pages' backgrounds are in order
+             * and can be prefetched (the '--jobs' chapters aren't).
+             */
+            if ( PAGE_MAP_NONE == pa_opts->paginate_only ) {
+                start_bgcache_prefetch( pa_opts->bgcache, (char const *const *) pa_opts->in_png_list.pathnames,
+                                        pa_opts->in_png_list.cnt, pa_opts->prefetch, pa_opts->prefetch_mb );
+            }
 
-                while ( *(w.work_text + w.text_start_idx) ) {
+            /*
+             *******************************************************************
+             * '--single-pass' holds its pages' text in a temporary file (which
+             * stays in the page cache unless memory's short), see 'held_page_t'.
+             */
+            if ( pa_opts->single_pass && NULL == (pa_opts->held_text = tmpfile()) ) {
+                fprintf(stderr, "WARNING :: can't make a temporary file for '--single-pass', using two passes.\n");
+                pa_opts->single_pass = 0;
+            }
 
-                    pa_opts->details.chapter_image_number++;
+            struct {
+                size_t       png_filename_idx;
+                size_t       global_image_sequence_number;
+                fold_pass_e  fold_pass_end;
+            } w = {
+                .png_filename_idx             = 0,
+                .global_image_sequence_number = 0,
+            };
 
-                    if ( FOLD_PASS_2 == pa_opts->fold_pass ) {
-                        pa_opts->details.global_image_sequence_number++;
-                    }
+            for ( size_t chapter_idx = 0; chapter_idx < pa_opts->in_chapters.cnt; chapter_idx++ ) {
+                chapter_t chapter = {
+                    .chapter_filename             = pa_opts->in_chapters.pathnames[ chapter_idx ],
+                    .chapter_idx                  = chapter_idx,
+                    .png_filename_idx             = w.png_filename_idx,
+                    .global_image_sequence_number = w.global_image_sequence_number,
+                };
 
-                    size_t jdx = w.png_filename_idx % pa_opts->in_png_list.cnt;
-                    pa_opts->details.in_png_name = pa_opts->in_png_list.pathnames[ jdx ];
-                    w.png_filename_idx++;
+                load_chapter( pa_opts, &chapter );
 
-                    w.my_clock = clock();
-                    pa_image_t *pa_image = load_pa_image( pa_opts, pa_opts->details.in_png_name );
+                pa_opts->fold_pass = (pa_opts->single_pass) ? FOLD_PASS_SINGLE     : FOLD_PASS_1;
+                w.fold_pass_end    = (pa_opts->single_pass) ? FOLD_PASS_SINGLE_END : FOLD_PASS_END;
 
-                    /*
-                     ***************************************************************
-                     * Apply the header template now before the "text" template(s).
-                     */
-                    if ( FOLD_PASS_2 == pa_opts->fold_pass && 1 == pa_opts->header_template.cnt ) {
-                        apply_template_simple( pa_image, pa_opts );
-                    }
+                if ( pa_opts->paginate_only ) {
+                    pa_opts->fold_pass = FOLD_PASS_1;
+                    w.fold_pass_end    = FOLD_PASS_2;
+                }
 
-                    /*
-                     ***************************************************************
-                     * Iterate through and apply all of the "text" templates.
-                     */
-                    for ( size_t idx = 0; idx < pa_opts->templates.cnt; idx++ ) {
-                        size_t      template_len;
-                        char const *template = read_textfile_sz( pa_opts->templates.pathnames[ idx ], &template_len, 1280 );
-
-                        if ( RC_FALSE == verify_template( template, "ddsdss", ".*s" ) ) {
-                           fprintf(stderr, "\nFATAL :: invalid template '%s'\n", pa_opts->templates.pathnames[ idx ]);
-                           _exit( 1 );
-                        }
-
-                        trim_work_text( pa_opts, w.work_text, text_segments, w.template_pass );
-                        apply_template_complex( pa_image,
-                                                pa_opts,
-                                                template,
-                                                w.work_text,
-                                               &text_segments[ w.template_pass ]
-                                              );
-                        free (template);
-
-                        /*
-                         ***********************************************************
-                         * Calculate the next start in the string.  If we're at the
-                         * end, then quite the 'pa_opts->templates.cnt' loop.
-                         */
-                        w.text_start_idx = text_segments[ w.template_pass ].text_start_idx
-                                         + text_segments[ w.template_pass ].work_text_delta;
-                        if ( '\0' == *(w.work_text + w.text_start_idx) ) {
-                            break;
-                        }
-
-                        w.template_pass++;
-                        text_segments[ w.template_pass ].text_start_idx = w.text_start_idx;
-                    }
+                if ( RC_TRUE == load_chapter_fold( pa_opts, &chapter ) ) {
+                    pa_opts->fold_pass = FOLD_PASS_2;  /* the fold is known, just render it */
+                    w.fold_pass_end    = (pa_opts->paginate_only) ? FOLD_PASS_2 : FOLD_PASS_END;
+                }
 
-                          // TODO :: TEST :: will we ever get here w/nothing to render?
-                    if ( FOLD_PASS_2 == pa_opts->fold_pass ) {
-                        save_pa_image( pa_image,
-                                       pa_opts,
-                                       w.my_clock
-                                     );
+                for ( ; pa_opts->fold_pass < w.fold_pass_end; pa_opts->fold_pass++ ) {
+                    fold_chapter( pa_opts, &chapter );
+                    if ( IS_FIT_PASS( pa_opts->fold_pass ) ) {
+                        save_chapter_fold( pa_opts, &chapter );
                     }
-
-                    cleanup_pa_image( &pa_image );
                 }
 
-                /*
-                 ***************************************************************
-                 * All of that 2-pass stuff just to accurately calculate this -
-                 */
-                pa_opts->details.chapter_images = pa_opts->details.chapter_image_number;
-            } // end FOLD_PASS loop
+                w.png_filename_idx             += chapter.chapter_images;
+                w.global_image_sequence_number += chapter.chapter_images;
 
-            if ( pa_opts->verbose_level >= VERBOSE_MAX ) {
-                fprintf( stderr, "TEMPLATE PASSES = %u, CHAPTER IMAGES = %lu\n", w.template_pass, pa_opts->details.chapter_image_number);
-                for ( unsigned int ii = 0; ii < w.template_pass; ii++ ) {
-                    fprintf(stderr, "  TEMPLATE PASS #%-2u :: %4u -> %4u bytes\n", ii + 1, text_segments[ ii ].text_start_idx, text_segments[ ii ].work_text_delta);
+                if ( pa_opts->paginate_only ) {
+                    write_page_map( pa_opts, &chapter );
                 }
-                fflush(stderr);
+                debug_chapter( pa_opts, &chapter );
+                cleanup_chapter( &chapter );
             }
+        }
 
-            free (w.work_text);
+        if ( NULL != pa_opts->encoder ) {
+            drain_pa_encoder( pa_opts->encoder );
+        }
 
-            /*
-             *******************************************************************
-             * Even though we're "in-scope" here, the 'cleanup_text_segments()' is
-             * be called _before_ the terminating condition of the for-loop is
-             * tested (hope this is spec'd this way, gcc isn't very clear) ...
-             */
+        if ( NULL != pa_opts->stats ) {
+            add_bytes_read( pa_opts->stats, get_bgcache_bytes_read( pa_opts->bgcache ) );
+            write_pa_stats_json( pa_opts->stats, pa_opts->stats_json );
         }
     }
     else {
@@ -636,989 +1021,2674 @@ quit:
     cleanup_pa_opts( &pa_opts );
 
     return ( 0 );
+}
 
 
-    void cleanup_text_segments( text_segments_t **p )
-    {
-        (free)( (void *) *p );
+/**
+ *******************************************************************************
+ * Read and edit the chapter's text and build its work text and title.
+ */
+static void load_chapter( pa_opts_t *pa_opts, chapter_t *chapter )
+{
+    char     *in_text;
+    uint64_t  start_ns;
+
+
+    /*
+     ***************************************************************************
+     * We rely on 'text_segments_t->text_start_idx' being ZERO.
+     */
+    chapter->text_segments = calloc( MAX_TEMPLATE_STEPS, sizeof (text_segments_t) );
+
+    pa_opts->details.chapter_idx = chapter->chapter_idx;
+
+    in_text = process_textfile( chapter->chapter_filename, pa_opts );
+    chapter->dup_groups_found = pa_opts->details.dup_groups_found;
+
+    if ( pa_opts->verbose_level > VERBOSE_QUIET ) {
+        fprintf(stderr, "Adding :: '%s' ...\n", chapter->chapter_filename);
     }
+
+    start_ns = get_monotonic_ns();
+    chapter->work_text = make_work_text( in_text, pa_opts->pad_str, (pa_opts->paginate_only) ? &chapter->in_map : NULL, &chapter->work_index );
+    add_chapter_time( pa_opts->stats, chapter->chapter_idx, PA_PHASE_WORK_TEXT, get_monotonic_ns() - start_ns );
+    debug_work_text( chapter->work_text, pa_opts->debug_work_dir, chapter->chapter_filename );
+    free ( in_text );
+
+    chapter->png_Title = (char *) get_chapter_title( chapter->work_text, MAX_CHAPTER_TITLE_SZ );
+    //g BREAK_STR(chapter->png_Title, "1-6. The Marketplace");
+
+    return ;
 }
 
 
 /**
  *******************************************************************************
+ * Run 'pa_opts->fold_pass' over all of the chapter's pages.  PASS 1 sets the
+ * chapter's page count, which PASS 2 needs for the header.
  */
-static pa_image_t *load_pa_image(pa_opts_t const *pa_opts, char const *const filename)
+static void fold_chapter( pa_opts_t *pa_opts, chapter_t *chapter )
 {
-    auto void cleanup_pathname( char ** );
     struct {
-        pa_image_t   *image;
-        comments_t *comments;
-        char       *desc;
-        rc_e        rc;
+        unsigned int  template_pass;
+        size_t        png_filename_idx;
+        unsigned int  text_start_idx;
+        clock_t       my_clock;
+
+        held_page_t  *held;        /* '--single-pass' pages awaiting a header */
+        size_t        held_cnt;
+        size_t        held_max;
     } w = {
-        .image    = NULL,
-        .comments = NULL,
-        .rc       = RC_FALSE,
+        .template_pass    = 0,
+        .png_filename_idx = chapter->png_filename_idx,
+        .text_start_idx   = 0,
+        .held             = NULL,
+        .held_cnt         = 0,
+        .held_max         = 0,
     };
 
 
-    if ( FOLD_PASS_2 == pa_opts->fold_pass ) {
-        if ( NULL != pa_opts->original_dir ) {
-            char  *pathname __attribute__ ((__cleanup__ (cleanup_pathname))) = NULL;
+    pa_opts->details.chapter_filename = chapter->chapter_filename;
+    pa_opts->details.chapter_idx      = chapter->chapter_idx;
+    pa_opts->details.png_Title        = chapter->png_Title;
+    pa_opts->details.dup_groups_found = chapter->dup_groups_found;
+    pa_opts->details.chapter_images   = chapter->chapter_images;
+    pa_opts->details.chapter_image_number = 0;
+    pa_opts->details.global_image_sequence_number = chapter->global_image_sequence_number;
+
+    if ( FOLD_PASS_SINGLE == pa_opts->fold_pass ) {
+        rewind( pa_opts->held_text );
+        if ( 0 != ftruncate( fileno( pa_opts->held_text ), 0 ) ) {
+            /* not fatal, the last chapter's text is just written over */
+        }
+    }
+
+    while ( *(chapter->work_text + w.text_start_idx) ) {
+
+        pa_opts->details.chapter_image_number++;
+
+        if ( IS_RENDER_PASS( pa_opts->fold_pass ) ) {
+            pa_opts->details.global_image_sequence_number++;
+        }
+
+        size_t jdx = w.png_filename_idx % pa_opts->in_png_list.cnt;
+        pa_opts->details.in_png_name = pa_opts->in_png_list.pathnames[ jdx ];
+        if ( FOLD_PASS_2 == pa_opts->fold_pass ) {
+            prefetch_bgcache( pa_opts->bgcache, w.png_filename_idx );
+        }
+        w.png_filename_idx++;
+
+        w.my_clock = clock();
+        uint64_t start_ns = get_monotonic_ns();
+        pa_image_t *pa_image = load_pa_image( pa_opts, jdx, FOLD_PASS_2 == pa_opts->fold_pass );
+        add_page_time( pa_opts->stats, PAGE_ID( pa_opts ), PA_PHASE_BG_DECODE, get_monotonic_ns() - start_ns );
+
+        long text_start = (FOLD_PASS_SINGLE == pa_opts->fold_pass) ? ftell( pa_opts->held_text ) : 0;
+
+        /*
+         ***********************************************************************
+         * Apply the header template now before the "text" template(s).
+         */
+        if ( FOLD_PASS_2 == pa_opts->fold_pass && 1 == pa_opts->header_template.cnt ) {
+            apply_template_simple( pa_image, pa_opts );
+        }
+
+        /*
+         ***********************************************************************
+         * Iterate through and apply all of the "text" templates.
+         */
+        for ( size_t idx = 0; idx < pa_opts->templates.cnt; idx++ ) {
+            trim_work_text( pa_opts, &chapter->work_index, chapter->text_segments, w.template_pass );
+            apply_template_complex( pa_image,
+                                    pa_opts,
+                                    pa_opts->text_templates[ idx ],
+                                    chapter->work_text,
+                                   &chapter->work_index,
+                                   &chapter->text_segments[ w.template_pass ],
+                                    idx,
+                                   &chapter->counts
+                                  );
 
             /*
              *******************************************************************
-             * An original dir was specified, try to load those PNG comments.
+             * Calculate the next start in the string.  If we're at the end,
+             * then quite the 'pa_opts->templates.cnt' loop.
              */
-            if ( RC_TRUE == new_from_filename( &pathname, filename, pa_opts->original_dir ) ) {
-                w.rc = read_png_image( pathname, &w.image, IGNORE_KEYS, READ_ONLY_COMMENTS );
-                if ( RC_TRUE == w.rc ) {
-                    w.comments = dup_comments( get_png_comments( w.image ) );
-                }
-                else if ( NULL != w.image ) {
-                    if ( pa_opts->verbose_level >= VERBOSE_1 ) {
-                        w.desc = get_err_desc( w.image );
-                        fprintf(stderr, "WARNING :: can't access comments from '%s' in %s\n",
-                                        filename, w.desc);  /*+*/
-                    }
-                }
-            }
-            else if ( pa_opts->verbose_level >= VERBOSE_1 ) {
-                fprintf(stderr, "WARNING :: can't access comments in '%s' from '%s' -- error %d, %s\n",
-                                pathname, filename, errno, strerror(errno)); /*+*/
+            w.text_start_idx = chapter->text_segments[ w.template_pass ].text_start_idx
+                             + chapter->text_segments[ w.template_pass ].work_text_delta;
+            if ( '\0' == *(chapter->work_text + w.text_start_idx) ) {
+                break;
             }
-            cleanup_pa_image( &w.image );
-        }
 
-        w.rc = read_png_image( filename, &w.image, IGNORE_KEYS, READ_WHOLE_IMAGE );
-        if ( RC_TRUE != w.rc ) {
-            goto check_err_desc;
+            w.template_pass++;
+            chapter->text_segments[ w.template_pass ].text_start_idx = w.text_start_idx;
         }
-        if ( NULL != w.comments ) {
-            replace_png_comments( w.image, w.comments );
+
+              // TODO :: TEST :: will we ever get here w/nothing to render?
+        if ( FOLD_PASS_2 == pa_opts->fold_pass ) {
+            save_pa_image( &pa_image,
+                           pa_opts,
+                           w.my_clock
+                         );
         }
-    }
-    else {
-        w.rc = read_png_image( filename, &w.image, NULL, READ_ONLY_METADATA );
-        if ( RC_TRUE != w.rc ) {
-            goto check_err_desc;
+        else if ( FOLD_PASS_SINGLE == pa_opts->fold_pass ) {
+            /*
+             *******************************************************************
+             * Hold the page's text until we know how many pages there are.
+             */
+            if ( w.held_cnt == w.held_max ) {
+                w.held_max += 16;
+                w.held = realloc( w.held, w.held_max * sizeof (held_page_t) );
+            }
+            w.held[ w.held_cnt++ ] = (held_page_t) {
+                .png_idx          = jdx,
+                .png_filename_idx = w.png_filename_idx - 1,
+                .in_png_name      = pa_opts->details.in_png_name,
+                .chapter_image_number         = pa_opts->details.chapter_image_number,
+                .global_image_sequence_number = pa_opts->details.global_image_sequence_number,
+                .text_start       = text_start,
+                .text_end         = (0 == ferror( pa_opts->held_text )) ? ftell( pa_opts->held_text ) : -1,
+                .elapsed          = clock() - w.my_clock,
+            };
+            clearerr( pa_opts->held_text );
         }
+
+        cleanup_pa_image( &pa_image );
     }
 
-    return ( w.image );
+    /*
+     ***************************************************************************
+     * All of that 2-pass stuff just to accurately calculate this -
+     */
+    pa_opts->details.chapter_images = pa_opts->details.chapter_image_number;
+    chapter->chapter_images = pa_opts->details.chapter_images;
+    chapter->template_pass  = w.template_pass;
 
-    check_err_desc:
-    if ( NULL != w.image ) {
-        w.desc = get_err_desc( w.image );
-        fprintf(stderr, "[pngass] Error :: %s", w.desc);
-        cleanup_pa_image( &w.image );
+    if ( FOLD_PASS_SINGLE == pa_opts->fold_pass ) {
+        save_held_pages( w.held, w.held_cnt, pa_opts );
     }
+    (free)( w.held );
 
-    return ( w.image );
+    pa_opts->details.png_Title = NULL;  /* it's the chapter's */
 
-    void cleanup_pathname( char **ptr )
-    {
-        (free)( *ptr );
-    }
+    return ;
 }
 
 
 /**
- *******************************************************************************
- * Convert a text blob to a libass format that is TRIMMED up to the 1st line.
- *
- * This is one of the MAIN functions of this conversion program.
- *
- * We're going to use the libass layout engine (which does a pretty nice job),
- * but since we're using it in a non-conventional way, we have to present the
- * text in a predictable way.  If we want the text to be rendered in "order",
- * we have to combine all of the text into a single 'Dialogue:' line with the
- * "hard" line breaks identified by libass's '\N' sequence (and some other line
- * formatting options).  If we use multiple 'Dialogue:'s, the layout engine may
- * move things around when it looks for the best fit (remember, we're kind of
- * using it outside of its design specifications).
- *
- * Some of the things libass has difficulty performing are:
- *  - orphan word control,
- *  - no justified text (but who uses that nowadays - seriously),
- *  - only a single vertical margin,
- *  - no indication of clipping during rendering (has to be manually checked),
- *  - forcing a particular line height,
- *  - a few other minor items (e.g., won't hard-break a line).
- *
- * Despite the above, and this application's very, very unconventional use of
- * libass, it does a very nice job especially with automatic font substitution
- * for missing glyphs in a font (something that is missing w/other solutions).
- *
- * This performs a simple conversion of the input text to a single text blob,
- * that is, it:
- * - replaces all of the newlines with the character sequence '\N', which
- *   is the libass hard line-break character sequence;
- * - if there are multiple newlines, replaces the subsequent newlines with
- *   ' \N' so that they are not *ignored* by the libass layout engine (so
- *   that even if this changes in a future version of libass, the extra SPACE
- *   shouldn't have any affect).  For example, the sequence "\n\n\n" will
- *   be converted to '\N \N \N' (adding 5 characters total to the sequence,
- *   two of which are the "special" SPACEs).
- * - adds paragraph padding, if specified by the user using '--pad-paragraph'.
- * - TODO :: add a '--url' option.  This option will search for crowded
- *   characters and add a zero-width SPACE character after each.  I don't know
- *   if libass will break on those (have to test), but this is mainly for
- *   embedded URLs in the text (usually in TL notes) which tend to be long and
- *   will not naturally wrap (libass doesn't force-break lines).
- *
- * Footnotes -
- *   On Pango w/ImageMagick :: http://www.imagemagick.org/Usage/text/#pango
- *   "Pango is is not meant to be a whole scale text page formatting engine."
- *
- *   Even though libass is more of an annimation layout engine, libass has many
- *   interesting font features that'd be difficult to quickly implement, and it
- *   does a great job at rendering all of the glyphs in the 'Dialogue:'s Text.
- *
- *   The "definitive" Sub Station Alpha v4.00+ Script Format document defines
- *   the '\fs' style override code taking an argument; it does NOT indicate that
- *   this is an optional value.  However, in practice I've seen it used w/o an
- *   argument as a "reset" with the result that the default value / size for
- *   the corresponding 'Style:' is used (I think - I haven't tried using it as
- *   a stack - {\fsX}..{\fsY}..{\fs}..Font size X..{\fs}..Original font size).
- *   I always use the value.
- *   See --> http://moodub.free.fr/video/ass-specs.doc
  *******************************************************************************
  */
-static char *make_work_text(char const *const in_text, char const *const pad_str)
+static void debug_chapter( pa_opts_t const *pa_opts, chapter_t const *chapter )
 {
-#undef LIBASS_NL_FIX
-#define LIBASS_NL_FIX ' '
-#undef NL_BUMP_SZ
-#define NL_BUMP_SZ (320)  /**< This value reflects the number of NLs that may
-                               be in the input text file as an average for a
-                               typical chapter. */
-    struct {
-        char const *const in_text;
-        size_t            in_text_len;
-        size_t            in_idx;
 
-        char              ch;          /* This is *also* a flag / BUG fix */
-        size_t            nl_idx;
-        size_t            nl_max;
+    if ( pa_opts->verbose_level >= VERBOSE_1 ) {
+        print_fold_counts( chapter->chapter_filename, &chapter->counts );
+    }
 
-        unsigned short    pad_len;
+    if ( pa_opts->verbose_level >= VERBOSE_MAX ) {
+        fprintf( stderr, "TEMPLATE PASSES = %u, CHAPTER IMAGES = %lu\n", chapter->template_pass, chapter->chapter_images);
+        for ( unsigned int ii = 0; ii < chapter->template_pass; ii++ ) {
+            fprintf(stderr, "  TEMPLATE PASS #%-2u :: %4u -> %4u bytes\n", ii + 1, chapter->text_segments[ ii ].text_start_idx, chapter->text_segments[ ii ].work_text_delta);
+        }
+        fflush(stderr);
+    }
 
-        char             *out_text;
-        size_t            out_idx;
+    return ;
+}
 
-        size_t            dbg_sz;      /* realloc() size, w/b optimized out */
-    } w = {
-        .in_text     = in_text,
-        .in_text_len = 1 + strlen(in_text),
-        .in_idx      = 0,
 
-        .nl_idx      = 0,
-        .nl_max      = NL_BUMP_SZ,
+/**
+ *******************************************************************************
+ */
+static void cleanup_chapter( chapter_t *chapter )
+{
 
-        .pad_len     = strlen(pad_str),
+    (free)( chapter->work_text );
+    (free)( chapter->png_Title );
+    (free)( chapter->text_segments );
+    (free)( chapter->in_map );
+    (free)( chapter->work_index.ends );
+    (free)( chapter->work_index.pads );
+    chapter->work_text     = NULL;
+    chapter->work_index    = (work_index_t) { .ends = NULL, .pads = NULL };
+    chapter->png_Title     = NULL;
+    chapter->text_segments = NULL;
+    chapter->in_map        = NULL;
 
-        .out_text    = NULL,
-    };
+    return ;
+}
 
 
-    if ( w.in_text != NULL ) { // FIXME :: Do I need +1 here?
-        w.out_text = realloc( w.out_text, w.dbg_sz = (1 + w.in_text_len + w.nl_max) );  /*+*/
+/**
+ *******************************************************************************
+ * The '--fold-cache' key, the part that's the same for every chapter.
+ *
+ * It's everything that can change how the text folds, other than the work
+ * text itself --
+ *   - the libass version and the text templates,
+ *   - the fonts (the '--fonts-dir' files' names, sizes and times, and the
+ *     '--text-face'),
+ *   - the '--text-size', '--line-spacing', '--margin-bottom' and the pixel
+ *     fudge,
+ *   - the '--fold-search' and '--fold-measure' (the gallop search, and its
+ *     measured starting point, can break a page somewhere else),
+ *   - the backgrounds' sizes (the frames).
+ * The JPEG quality, the output directory, the header, etc., don't matter.
+ */
+static rc_e init_fold_key( pa_opts_t *pa_opts )
+{
+    auto void hash( void const *, size_t );
+    struct {
+        uint64_t    key;
+        uint64_t    fonts;  /* order-independent, it's a directory listing */
+        int         version;
+        int         width;
+        int         height;
+        rc_e        rc;
+    } w = {
+        .key     = FNV1A_64_INIT,
+        .fonts   = 0,
+        .version = PA_FOLDCACHE_VERSION,
+        .width   = -1,
+        .height  = -1,
+        .rc      = RC_TRUE,
+    };
 
-        /**
-         ***********************************************************************
-         * Skip over any SPACEs to get the the FIRST _real_ line of text.
-         * Note, this is the _only_ time we expect to deal with a raw '\n'.
-         */
-        w.in_idx = skip_non_text_tokens(w.in_text, w.in_idx, 1, 0);  /*+*/
+    void hash( void const *data, size_t len ) {
+        w.key = fnv1a_64( w.key, data, len );
     }
 
-    /*
-     ***************************************************************************
-     * Copy / convert the input text to be used with a libass 'Dialogue:'.
-     */
-    while ( (w.ch = (*(w.out_text + w.out_idx) = *(w.in_text + w.in_idx))) ) {
-
-        /*
-         ***********************************************************************
-         * See the FACTOID about libass and UTF8_ZERO_WIDTH_SPACE characters.
-         * So, the point is that these probably should just be removed, and NOT
-         * replaced with a SPACE, based on their usage in html documents.
-         */
-        if ( STR_MATCH == strncmp((w.in_text + w.in_idx), UTF8_ZERO_WIDTH_SPACE, sizeof (UTF8_ZERO_WIDTH_SPACE) - 1) ) {
-            w.in_idx += (sizeof (UTF8_ZERO_WIDTH_SPACE) - 1);
-            continue;
-        }
-
-        w.in_idx++;
 
-        if ( '\n' == w.ch ) {
-            /*
-             *******************************************************************
-             * This seems to be a *feature* in libass - consecutive newlines
-             * seem to be reduced by 1 (they're not all "rendered").  Padding
-             * a single SPACE before the '\N' sequence corrects this.
-             */
-            if ( (w.in_idx > 1) && '\n' == *(w.in_text + w.in_idx - 2) ) {
-                w.nl_idx++;
-                w.ch = LIBASS_NL_FIX;  /* ... prefix a SPACE character */
-            }
+    hash( &w.version, sizeof (w.version) );
+    w.version = ass_library_version();
+    hash( &w.version, sizeof (w.version) );
 
-            if ( w.nl_idx++ >= w.nl_max ) {
-                w.nl_max += NL_BUMP_SZ;
-                w.out_text = realloc( w.out_text, w.dbg_sz = (w.in_text_len + w.nl_max) );  /*+*/
-            }
+    for ( size_t idx = 0; idx < pa_opts->templates.cnt && RC_TRUE == w.rc; idx++ ) {
+        size_t len = 0;
+        char  *template = read_textfile( pa_opts->templates.pathnames[ idx ], &len );
 
-            if ( LIBASS_NL_FIX == w.ch ) {
-                *(w.out_text + w.out_idx) = ' ';
-                w.out_idx++;
-            }
-            *(w.out_text + w.out_idx) = '\\';
-            w.out_idx++;
-            *(w.out_text + w.out_idx) = 'N';
+        if ( NULL == template ) {
+            w.rc = RC_FALSE;
+            break;
+        }
+        hash( template, len + 1 );
+        free (template);
+    }
 
-            /*
-             *******************************************************************
-             * Okay, we want to "detect" a sequence like this - 'A\nA'.  It's
-             * a no-go if we had consecutive newlines OR the next character is
-             * a '\n'.  Note that 'w.in_idx' is pointing at the NEXT character
-             * which could be the '\0', but we don't care as that's NOT a '\n'.
-             */
-            if ( w.pad_len )
-            if ( '\n' == w.ch && '\n' != *(w.in_text + w.in_idx)
-                              && '\0' != *(w.in_text + w.in_idx) ) {
-                w.nl_idx += w.pad_len;
-                if ( w.nl_idx++ >= w.nl_max ) {
-                    w.nl_max += NL_BUMP_SZ;
-                    w.out_text = realloc( w.out_text, w.dbg_sz = (w.in_text_len + w.nl_max) );  /*+*/
-                }
-                strcpy((w.out_text + w.out_idx + 1), pad_str);
-                w.out_idx += w.pad_len;
+    for ( size_t idx = 0; idx < pa_opts->font_dirs.cnt; idx++ ) {
+        DIR           *dir = opendir( pa_opts->font_dirs.pathnames[ idx ] );
+        struct dirent *ent;
+        struct stat    sb;
+        char          *path;
+
+        while ( NULL != dir && NULL != (ent = readdir( dir )) ) {
+            asprintf(&path, "%s%s%s", pa_opts->font_dirs.pathnames[ idx ], PA_PATH_SEP, ent->d_name);
+            if ( 0 == stat( path, &sb ) && S_ISREG( sb.st_mode ) ) {
+                uint64_t file = fnv1a_64( FNV1A_64_INIT, path, strlen( path ) );
+                file = fnv1a_64( file, &sb.st_size, sizeof (sb.st_size) );
+                file = fnv1a_64( file, &sb.st_mtime, sizeof (sb.st_mtime) );
+                w.fonts += file;
             }
+            (free)( path );
+        }
+        if ( NULL != dir ) {
+            closedir( dir );
         }
-
-        w.out_idx++;
     }
+    hash( &w.fonts, sizeof (w.fonts) );
+    hash( pa_opts->text_face, strlen( pa_opts->text_face ) + 1 );
+    hash( &pa_opts->text_size, sizeof (pa_opts->text_size) );
+    hash( &pa_opts->line_spacing, sizeof (pa_opts->line_spacing) );
+    hash( &pa_opts->margin_bottom, sizeof (pa_opts->margin_bottom) );
+    hash( &pa_opts->pixel_fudge, sizeof (pa_opts->pixel_fudge) );
+    hash( &pa_opts->fold_search, sizeof (pa_opts->fold_search) );
+    hash( &pa_opts->fold_measure, sizeof (pa_opts->fold_measure) );
 
     /*
      ***************************************************************************
-     * Resize the text to its final size (including the '\0' string terminator).
+     * If the backgrounds aren't all the same size, then a chapter's fold also
+     * depends on which background it starts on (see 'load_chapter_fold()').
      */
-    w.out_text = realloc( w.out_text, ++w.out_idx );  /*+*/
+    hash( &pa_opts->in_png_list.cnt, sizeof (pa_opts->in_png_list.cnt) );
+    for ( size_t idx = 0; idx < pa_opts->in_png_list.cnt; idx++ ) {
+        int width  = get_image_width( pa_opts->in_png_frames[ idx ] );
+        int height = get_image_height( pa_opts->in_png_frames[ idx ] );
 
-    return ( w.out_text );
+        if ( idx && (width != w.width || height != w.height) ) {
+            pa_opts->fold_frames_vary = 1;
+        }
+        w.width  = width;
+        w.height = height;
+        hash( &w.width, sizeof (w.width) );
+        hash( &w.height, sizeof (w.height) );
+    }
+
+    pa_opts->fold_key = w.key;
+
+    return ( w.rc );
 }
 
 
 /**
  *******************************************************************************
- * Initially used to remove the '--pad-paragraph' option from the top of a page,
- * this function could perform other (future) edits as well.
+ * If the chapter's fold is in the '--fold-cache', then it's all set for its
+ * PASS 2 (its segments, page count and template passes).
+ *
+ * The fold is checked against the work text (it must end where the text
+ * ends), just in case.
  */
-static void trim_work_text( pa_opts_t const *pa_opts, UNUSED_ARG char const *const work_text, text_segments_t *const text_segments, unsigned int template_pass )
+static rc_e load_chapter_fold( pa_opts_t const *pa_opts, chapter_t *chapter )
 {
     struct {
-        char const *const  work_text_2;
-        unsigned int const len;
+        fold_segment_t *segments;
+        size_t          cnt;
+        size_t          pages;
+        size_t          start_idx;
+        size_t          len;
+        rc_e            rc;
     } w = {
-        .work_text_2 = work_text + text_segments[ template_pass ].text_start_idx,
-        .len         = strlen(pa_opts->pad_str),
+        .segments = NULL,
+        .cnt      = 0,
+        .rc       = RC_FALSE,
     };
 
-    if ( STR_MATCH == strncmp(w.work_text_2, pa_opts->pad_str, w.len) ) {
-        text_segments[ template_pass ].text_start_idx += w.len;
-        if ( template_pass ) {
-            text_segments[ template_pass - 1 ].work_text_delta += w.len;
+
+    if ( NULL == pa_opts->fold_cache_dir ) {
+        return ( RC_FALSE );
+    }
+
+    w.len = strlen( chapter->work_text );
+    chapter->fold_key = fnv1a_64( pa_opts->fold_key, chapter->work_text, w.len + 1 );
+    if ( pa_opts->fold_frames_vary ) {
+        w.start_idx = chapter->png_filename_idx % pa_opts->in_png_list.cnt;
+        chapter->fold_key = fnv1a_64( chapter->fold_key, &w.start_idx, sizeof (w.start_idx) );
+    }
+
+    w.segments = calloc( MAX_TEMPLATE_STEPS, sizeof (fold_segment_t) );
+    if (   RC_TRUE == load_fold_cache( pa_opts->fold_cache_dir, chapter->fold_key, w.segments, MAX_TEMPLATE_STEPS, &w.cnt, &w.pages )
+        && w.segments[ w.cnt - 1 ].text_start_idx + w.segments[ w.cnt - 1 ].work_text_delta == w.len
+       ) {
+        for ( size_t idx = 0; idx < w.cnt; idx++ ) {
+            chapter->text_segments[ idx ] = (text_segments_t) {
+                .text_start_idx  = w.segments[ idx ].text_start_idx,
+                .work_text_delta = w.segments[ idx ].work_text_delta,
+                .clipped         = w.segments[ idx ].clipped,
+                .pieces          = w.segments[ idx ].pieces,
+            };
+        }
+        chapter->template_pass  = w.cnt - 1;
+        chapter->chapter_images = w.pages;
+        chapter->fold_cached    = 1;
+        w.rc = RC_TRUE;
+
+        if ( pa_opts->verbose_level >= VERBOSE_1 ) {
+            fprintf(stderr, "FOLD CACHE :: '%s' is %lu pages (%016" PRIx64 ").\n", chapter->chapter_filename, w.pages, chapter->fold_key);
         }
     }
+    free (w.segments);
 
-    return ;
+    return ( w.rc );
 }
 
 
 /**
  *******************************************************************************
  */
-static char *debug_work_text(char const *const work_text, char const *const dir, char const *const chapter_filename)
+static void save_chapter_fold( pa_opts_t const *pa_opts, chapter_t const *chapter )
 {
 
-    if ( NULL != dir ) {
-
-        char *ptr;
-        char  str[ 1 + strlen(chapter_filename) ];
+    if ( NULL == pa_opts->fold_cache_dir || chapter->fold_cached ) {
+        return ;
+    }
 
-        strcpy(str, chapter_filename);
-        asprintf(&ptr, "%s%s%s.txt", dir, PA_PATH_SEP, basename(str));
+    size_t          cnt = chapter->template_pass + 1;
+    fold_segment_t *segments = calloc( cnt, sizeof (fold_segment_t) );
 
-        FILE *file = fopen(ptr, "w");
-        if ( NULL != file ) {
-            fprintf(file, "%s\n", work_text);
-            fclose(file);
-        }
-        (free)(ptr);
+    for ( size_t idx = 0; idx < cnt; idx++ ) {
+        segments[ idx ] = (fold_segment_t) {
+            .text_start_idx  = chapter->text_segments[ idx ].text_start_idx,
+            .work_text_delta = chapter->text_segments[ idx ].work_text_delta,
+            .clipped         = chapter->text_segments[ idx ].clipped,
+            .pieces          = chapter->text_segments[ idx ].pieces,
+        };
     }
+    save_fold_cache( pa_opts->fold_cache_dir, chapter->fold_key, segments, cnt, chapter->chapter_images );
+    free (segments);
 
-    return ( (char *) work_text );
+    return ;
 }
 
 
 /**
  *******************************************************************************
- * Read and process (through /bin/sed with 'popen()') an input text file.
- *
- * The /bin/sed stream editor is really powerful / flexible (duh) and it'd be
- * insane to try to recreate its functionality (or even a simple subset) here.
- * So we'll just call it directly instead!  This is happy code, and if all of
- * the pieces are in place, should be robust enough for this application.
- *
- * This functionality is provided so the used can use automation to add
- * character attributes (and possibly other markups) to an input text file.
- * For example, adding a bold attribute to a character's name in a light novel.
- * See the example sed scripts provided with the demo for some ideas.
+ * '--paginate-only' :: write where the chapter's pages (and their templates)
+ * break, to '<dest-dir>/<chapter>.pagemap.tsv' (or '.json').
  *
+ * Each segment is a template on a page, with its [start, end) byte offsets in
+ * the work text and in the chapter's text (as it was read, i.e., after the sed
+ * script(s) and the edits), and whether its last line was clipped.
  */
-static char *process_textfile( char const *const filename, pa_opts_t *pa_opts )
+static void write_page_map( pa_opts_t const *pa_opts, chapter_t const *chapter )
 {
-    auto char *remove_dups(char *);
     struct {
-        char         c1[ 16 ];       /* The libass primary fill colour */
-        char         a1[ 16 ];       /* The libass primary alpha value */
-    } w = { '\0' };
-
+        char        *filename;
+        FILE        *file;
+        size_t       cnt;
+        size_t       templates;
+        char const  *sep;
+    } w = {
+        .filename  = NULL,
+        .cnt       = chapter->template_pass + 1,
+        .templates = pa_opts->templates.cnt,
+        .sep       = "",
+    };
 
-    if ( 0 == pa_opts->sed_script_files.cnt ) {
-        char *str = read_textfile( filename, NULL );
 
-        str = remove_dups( str );
+    char name[ 1 + strlen(chapter->chapter_filename) ];
+    strcpy(name, chapter->chapter_filename);
+    asprintf(&w.filename, "%s%s%s.pagemap.%s", pa_opts->details.dest_dir, PA_PATH_SEP, basename(name),
+                          (PAGE_MAP_JSON == pa_opts->paginate_only) ? "json" : "tsv");
 
-        str = apply_attr_edits( str, pa_opts->attr_edits, NULL );
-        write_debug_text( filename, str, pa_opts );
+    if ( NULL == (w.file = fopen(w.filename, "w")) ) {
+        fprintf(stderr, "ERROR :: can't write the page map '%s' -- error %d, %s\n", w.filename, errno, strerror(errno));
+        (free)( w.filename );
+        return ;
+    }
 
-        return ( str );
+    if ( PAGE_MAP_JSON == pa_opts->paginate_only ) {
+        fprintf(w.file, "{\n  \"chapter\": ");
+        write_json_str( w.file, chapter->chapter_filename );
+        fprintf(w.file, ",\n  \"pages\": %zu,\n  \"templates\": %zu,\n  \"segments\": [", chapter->chapter_images, w.templates);
+    }
+    else {
+        fprintf(w.file, "# %s :: %zu pages\n", chapter->chapter_filename, chapter->chapter_images);
+        fprintf(w.file, "page\ttemplate\twork_start\twork_end\ttext_start\ttext_end\tclipped\n");
     }
 
-    snprintf(w.c1, sizeof (w.c1), "\\\\1c\\&H%s\\&", pa_opts->colour_1c);
-    snprintf(w.a1, sizeof (w.a1), "\\\\1a\\&H%s", pa_opts->alpha_1a);
+    for ( size_t idx = 0; idx < w.cnt; idx++ ) {
+        text_segments_t const *seg = &chapter->text_segments[ idx ];
+        unsigned int start = seg->text_start_idx;
+        unsigned int end   = seg->text_start_idx + seg->work_text_delta;
 
-    char *cmd;
-    char *s1;
+        if ( PAGE_MAP_JSON == pa_opts->paginate_only ) {
+            fprintf(w.file, "%s\n    { \"page\": %zu, \"template\": %zu, \"work_text\": [ %u, %u ], \"text\": [ %u, %u ], \"clipped\": %s }",
+                            w.sep, 1 + idx / w.templates, 1 + idx % w.templates, start, end,
+                            chapter->in_map[ start ], chapter->in_map[ end ], (seg->clipped) ? "true" : "false");
+            w.sep = ",";
+        }
+        else {
+            fprintf(w.file, "%zu\t%zu\t%u\t%u\t%u\t%u\t%d\n",
+                            1 + idx / w.templates, 1 + idx % w.templates, start, end,
+                            chapter->in_map[ start ], chapter->in_map[ end ], (seg->clipped) ? 1 : 0);
+        }
+    }
 
-    asprintf(&cmd, "%s", PA_SED_EXEC " --regexp-extended");
-    for ( size_t idx = 0; idx < pa_opts->sed_script_files.cnt; idx++ ) {
-        asprintf(&s1, "%s --file='%s'", cmd, pa_opts->sed_script_files.pathnames[ idx ]);
-        (free)( cmd );
-        cmd = s1;
+    if ( PAGE_MAP_JSON == pa_opts->paginate_only ) {
+        fprintf(w.file, "\n  ]\n}\n");
     }
 
-    /*
-     ***************************************************************************
-     * Put all of the "reset" regexps _after_ the scripts on the command line.
-     */
-    asprintf(&s1, "%s -e 's/@@1a@@/%s/g'", cmd, w.a1);
-    (free)( cmd );
-    cmd = s1;
+    if ( 0 != fclose( w.file ) ) {
+        fprintf(stderr, "ERROR :: can't write the page map '%s' -- error %d, %s\n", w.filename, errno, strerror(errno));
+    }
+    else if ( pa_opts->verbose_level > VERBOSE_QUIET ) {
+        fprintf(stderr, "Wrote :: '%s'\n", w.filename);
+    }
+    (free)( w.filename );
+
+    return ;
+}
 
-    asprintf(&s1, "%s -e 's/@@1c@@/%s/g'", cmd, w.c1);
-    (free)( cmd );
-    cmd = s1;
 
-    asprintf(&s1, "%s -e 's/@@face@@/\\\\fn%s/g'", cmd, pa_opts->text_face);
-    (free)( cmd );
-    cmd = s1;
+/**
+ *******************************************************************************
+ * The chapters can only be fit independently of each other if every page is
+ * the same size, whichever background image it lands on.
+ */
+static rc_e same_background_sizes( pa_opts_t const *pa_opts )
+{
+    pa_image_t *const *frames = pa_opts->in_png_frames;
 
-    asprintf(&s1, "%s -e 's/@@size@@/\\\\fs%d/g'", cmd, pa_opts->text_size);
-    (free)( cmd );
-    cmd = s1;
 
-    /*
-     ***************************************************************************
-     * And lastly, append the filename that all of these scripts are applied.
-     * If the file is 'stdin', then do nothing as sed will read from 'stdin'.
-     */
-    if ( 0 != strcmp(filename, READ_STDIN) ) {
-        asprintf(&s1, "%s \"%s\"", cmd, filename);
-        (free)( cmd );
-        cmd = s1;
+    for ( size_t idx = 1; idx < pa_opts->in_png_list.cnt; idx++ ) {
+        if (    get_image_width( frames[ idx ] )  != get_image_width( frames[ 0 ] )
+             || get_image_height( frames[ idx ] ) != get_image_height( frames[ 0 ] ) ) {
+            return ( RC_FALSE );
+        }
     }
 
-    fprintf(stderr, "%s\n", cmd);
-    FILE *file = popen(cmd, "r");
-    (free)( cmd );
+    return ( RC_TRUE );
+}
 
-    char *str = NULL;
-    if ( NULL != file ) {
-        str = read_stream( file, NULL );
-        pclose(file);
 
-        str = remove_dups( str );
+/**
+ *******************************************************************************
+ *******************************************************************************
+ * Read every background's size once, up front, and check that it's one that
+ * we can render into (a PNG or a JPEG, with a sane size -- it's converted to
+ * RGB24 when it's decoded).  So a bad background is reported before anything
+ * is rendered, and the fit doesn't read the images.
+ */
+static rc_e probe_backgrounds( pa_opts_t *pa_opts )
+{
+#undef PA_FRAME_MAX
+#define PA_FRAME_MAX  (32767)  /* libass' (and the blend's) limit on a side */
+    struct {
+        pa_image_t **frames;
+        char const  *pathname;
+        int          width;
+        int          height;
+        rc_e         rc;
+    } w = {
+        .frames = calloc( pa_opts->in_png_list.cnt, sizeof (pa_image_t *) ),
+        .rc     = RC_TRUE,
+    };
 
-        str = apply_attr_edits( str, pa_opts->attr_edits, NULL );
-        write_debug_text( filename, str, pa_opts );
+
+    for ( size_t idx = 0; idx < pa_opts->in_png_list.cnt; idx++ ) {
+        w.pathname = pa_opts->in_png_list.pathnames[ idx ];
+
+        if ( RC_TRUE != read_png_image( w.pathname, &w.frames[ idx ], NULL, READ_ONLY_METADATA ) ) {
+            fprintf(stderr, "ERROR - can't use the image %s\n", get_err_desc( w.frames[ idx ] ));
+            w.rc = RC_FALSE;
+            continue;
+        }
+        add_bytes_read( pa_opts->stats, get_image_file_bytes( w.frames[ idx ] ) );
+
+        w.width  = get_image_width( w.frames[ idx ] );
+        w.height = get_image_height( w.frames[ idx ] );
+        if ( w.width < 1 || w.height < 1 || w.width > PA_FRAME_MAX || w.height > PA_FRAME_MAX ) {
+            fprintf(stderr, "ERROR - can't use the image '%s' -- it's %dx%d\n", w.pathname, w.width, w.height);
+            w.rc = RC_FALSE;
+        }
     }
 
-    return ( str );
+    pa_opts->in_png_frames = w.frames;
 
+    return ( w.rc );
+}
 
-    /**
+
+/**
+ *******************************************************************************
+ * '--jobs N' :: fold the chapters on N worker threads.
+ *
+ * All of the chapters are fit (PASS 1) first, the longest chapters first so
+ * that a long one isn't started last.  Then, in chapter order, each chapter
+ * gets its first background image and sequence number (exactly as a single
+ * threaded run would), and then the chapters are rendered (PASS 2), the ones
+ * with the most pages first.  '--single-pass' doesn't apply here since the
+ * page counts are all known before any page is rendered.
+ *
+ * Each worker has its own libass library / renderer and its own copy of the
+ * options (for 'details' and the fold state); the templates, the background
+ * cache and the options' strings are shared, read-only or locked.  If no
+ * worker thread can be started, the pass is run on this thread.
+ */
+static void run_chapter_jobs( pa_opts_t *pa_opts )
+{
+    auto void run_workers( fold_pass_e );
+    struct {
+        chapter_t      *chapters;
+        size_t          cnt;
+        size_t          png_filename_idx;
+        size_t          global_image_sequence_number;
+        unsigned int    jobs;
+        pthread_t      *threads;
+        chapter_jobs_t  queue;
+        struct stat     sb;
+    } w = {
+        .cnt  = pa_opts->in_chapters.cnt,
+        .png_filename_idx             = 0,
+        .global_image_sequence_number = 0,
+    };
+
+
+    w.chapters = calloc( w.cnt, sizeof (chapter_t) );
+    w.jobs     = (pa_opts->jobs < w.cnt) ? pa_opts->jobs : w.cnt;
+    w.threads  = calloc( w.jobs, sizeof (pthread_t) );
+
+    w.queue = (chapter_jobs_t) {
+        .pa_opts  = pa_opts,
+        .order    = calloc( w.cnt, sizeof (chapter_t *) ),
+        .cnt      = w.cnt,
+    };
+    pthread_mutex_init( &w.queue.lock, NULL );
+
+    for ( size_t idx = 0; idx < w.cnt; idx++ ) {
+        w.chapters[ idx ].chapter_filename = pa_opts->in_chapters.pathnames[ idx ];
+        w.chapters[ idx ].chapter_idx      = idx;
+        if ( 0 == stat( w.chapters[ idx ].chapter_filename, &w.sb ) ) {
+            w.chapters[ idx ].text_size = w.sb.st_size;
+        }
+        w.queue.order[ idx ] = &w.chapters[ idx ];
+    }
+
+    /*
      ***************************************************************************
+     * PASS 1 :: load and fit all of the chapters.
+     */
+    qsort( w.queue.order, w.cnt, sizeof (chapter_t *), by_text_size );
+    run_workers( FOLD_PASS_1 );
+
+    for ( size_t idx = 0; idx < w.cnt; idx++ ) {
+        w.chapters[ idx ].png_filename_idx             = w.png_filename_idx;
+        w.chapters[ idx ].global_image_sequence_number = w.global_image_sequence_number;
+        w.png_filename_idx             += w.chapters[ idx ].chapter_images;
+        w.global_image_sequence_number += w.chapters[ idx ].chapter_images;
+    }
+
+    /*
      ***************************************************************************
-     *
+     * PASS 2 :: render all of the chapters.
      */
-    char *remove_dups( char *s2 ) {
-        if ( pa_opts->remove_dup_groups ) {
-            s2 = remove_dup_groups(s2, pa_opts->remove_dup_groups, pa_opts->remove_dup_group_spaces, &pa_opts->details.dup_groups_found);
-            if ( pa_opts->details.dup_groups_found )
-            if ( pa_opts->verbose_level > VERBOSE_QUIET ) {
-                fprintf(stderr, "DUPLICATE groups :: %u\n", pa_opts->details.dup_groups_found);
-            }
-            pa_opts->details.dup_groups_found -= pa_opts->details.dup_lines_found;   // HACK test, delete later
+    if ( PAGE_MAP_NONE == pa_opts->paginate_only ) {
+        qsort( w.queue.order, w.cnt, sizeof (chapter_t *), by_chapter_images );
+        run_workers( FOLD_PASS_2 );
+    }
+
+    for ( size_t idx = 0; idx < w.cnt; idx++ ) {
+        if ( pa_opts->paginate_only ) {
+            write_page_map( pa_opts, &w.chapters[ idx ] );
         }
+        debug_chapter( pa_opts, &w.chapters[ idx ] );
+        cleanup_chapter( &w.chapters[ idx ] );
+    }
 
-        if ( 0 == PA_BUILT_OPTIMIZED ) {
-            char *ptr, buf[ 1 + strlen(filename) ];
+    pthread_mutex_destroy( &w.queue.lock );
+    (free)( w.queue.order );
+    (free)( w.threads );
+    (free)( w.chapters );
 
-            strcpy(buf, filename);
-            asprintf(&ptr, "." PA_PATH_SEP "DEBUG%s%s", PA_PATH_SEP, basename(buf));
+    return ;
 
-            FILE *f = fopen(ptr, "w");
-            if ( NULL != f ) {
-                fprintf(f, "DUPLICATE lines :: %u\n", pa_opts->details.dup_lines_found);
-                fprintf(f, "DUPLICATE groups :: %u\n", pa_opts->details.dup_groups_found);
-                fprintf(f, "%s", s2);
-                fclose(f);
+    /*
+     ***************************************************************************
+     * Only the threads that started are joined.
+     */
+    void run_workers( fold_pass_e fold_pass )
+    {
+        unsigned int  started = 0;
+
+        w.queue.next      = 0;
+        w.queue.fold_pass = fold_pass;
+        for ( unsigned int ii = 0; ii < w.jobs; ii++ ) {
+            if ( 0 != pthread_create( &w.threads[ started ], NULL, chapter_worker, &w.queue ) ) {
+                fprintf(stderr, "WARNING :: started %u of %u chapter threads.\n", started, w.jobs);
+                break;
             }
-            (free)(ptr);
+            started++;
         }
 
-        return ( s2 );
+        if ( 0 == started ) {
+            chapter_worker( &w.queue );
+        }
+        for ( unsigned int ii = 0; ii < started; ii++ ) {
+            pthread_join( w.threads[ ii ], NULL );
+        }
     }
 }
 
 
 /**
  *******************************************************************************
- *
+ * The '--jobs' schedules :: longest first, ties in chapter order so that the
+ * schedule is repeatable.
  */
-static void write_debug_text(UNUSED_ARG char const *const filename, UNUSED_ARG char const *const str, UNUSED_ARG pa_opts_t *pa_opts)
+static int by_text_size( void const *p1, void const *p2 )
 {
-/*  pa_opts->debug_text */
-/*     if ( 0 != strcmp(filename, READ_STDIN) ) { */
+    chapter_t const *c1 = *(chapter_t *const *) p1;
+    chapter_t const *c2 = *(chapter_t *const *) p2;
 
-    return ;
+    if ( c1->text_size != c2->text_size ) {
+        return ( (c1->text_size > c2->text_size) ? -1 : 1 );
+    }
+    return ( (c1 < c2) ? -1 : (c1 > c2) );
+}
+
+static int by_chapter_images( void const *p1, void const *p2 )
+{
+    chapter_t const *c1 = *(chapter_t *const *) p1;
+    chapter_t const *c2 = *(chapter_t *const *) p2;
+
+    if ( c1->chapter_images != c2->chapter_images ) {
+        return ( (c1->chapter_images > c2->chapter_images) ? -1 : 1 );
+    }
+    return ( (c1 < c2) ? -1 : (c1 > c2) );
 }
 
 
 /**
  *******************************************************************************
- * getconf ARG_MAX == 2,097,152.  Anything more then the user should use xargs.
- *
- * TODO :: - a realpath option for the the input text filename in comments
- *         - a web site option to include the source's website.  maybe allow
- *           multiple - e.g. original and translated sites?
- *         - an option to specify the writer(s).
+ * A '--jobs' worker :: take the next chapter from the queue until it's empty.
  */
-static rc_e O0 pa_parse_cmdline(pa_opts_t *pa_opts, int argc, char **argv)
+static void *chapter_worker( void *arg )
 {
-    #undef WARNING
-    #define WARNING "WARNING ::"
-
-    /* TODO :: REWRITE :: I think there'a a better way using 'w.this_option_optind' ... */
-    #undef ERR_IGNORE   /* A couple of edge cases don't print properly... */
-    #define ERR_IGNORE( argv, ind, arg, fmt, ... )                           \
-    {                                               /* Super-crazy macro */  \
-        char *sp = " ";                                                      \
-        char *a_ = (arg);                                                    \
-        int   i_ = (ind);                                                    \
-        char *r_, p_[ 1 + strlen(argv[--i_]) ];                              \
-        strcpy(p_, argv[i_]);                                                \
-        char *q_ = strchr(p_, '=');                                          \
-        if ( NULL != q_ ) { r_ = p_; *++q_ = '\0'; } /* keep ' /=' char */   \
-        else {                                                               \
-            if ( '-' != argv[i_][0] ) {                                      \
-                i_--;                                                        \
-            }                                                                \
-            else {                                                           \
-                a_ = ""; sp = "";                                            \
-            }                                                                \
-            r_ = argv[i_];                                                   \
-        }  /* otherwise, get the actual option */                            \
-        fprintf(stderr, "%s option '%s%s%s' is invalid, IGNORED.\n",         \
-                        (0 == w.die) ? WARNING : "ERROR ::",                 \
-                        r_, (r_ == p_) ? "" : sp, a_);                       \
-        fprintf(stderr, "%*s", (int) strlen(WARNING), "");                   \
-        fprintf(stderr, (fmt), ##__VA_ARGS__);                               \
-    }
-    enum {
-        ARG_NO_COMMENTS     = 2,  /* 2 is NOT arbitrary ... */
-        ARG_INPUT_GLOB,
-        ARG_INPUT_FILE_LIST,
-        ARG_PNG_GLOB,
-        ARG_PNG_GLOB_NOSORT,
-        ARG_TEXT_SIZE,
-        ARG_SED_SCRIPT_FILE,
-        ARG_IMAGE_PREFIX,
-        ARG_CHOP_PREFIX,
-        ARG_CHOP_CHARS,
-        ARG_ORIGINAL_DIR,
-        ARG_XY_FORMAT,
-        ARG_REGRESSION,
-        ARG_ATTR_EDITS,
-        ARG_REMOVE_DUP_GROUPS,
-        ARG_REMOVE_DUP_GROUP_SPACES,
-        ARG_MARGIN_BOTTOM   = 'B',
-        ARG_TEXT_FACE       = 'F',
-        ARG_HEADER_TEMPLATE = 'H',
-        ARG_PAD_PARAGRAPH   = 'P',
-        ARG_DEBUG_SED       = 'S',  // TODO
-        ARG_DEBUG_TEXT      = 'T',
-        ARG_VERBOSE_QUIET   = 'Q',
-        ARG_VERSION         = 'V',
-        ARG_DEBUG_WORK      = 'W',
-        ARG_HYPHENATION     = 'Y',
-        ARG_1A_ALPHA        = 'a',
-        ARG_1C_COLOUR       = 'c',
-        ARG_DEST_DIR        = 'd',
-        ARG_FONTS_DIR       = 'f',
-        ARG_INPUT_TEXT      = 'i',
-        ARG_LINE_SPACING    = 'l',
-        ARG_JPEG_QUALITY    = 'q',
-        ARG_PNG_IMAGE_TYPE  = 'p',
-        ARG_TEMPLATE_FILE   = 't',
-        ARG_URL_ZWSP        = 'u',
-        ARG_VERBOSE_LEVEL   = 'v',
-    };
-    static char const short_options[] = "a:c:d:t:f:i:l:q:puv:B:F:H:P:S:T:QVWY";
-    static struct option const long_options[] = {
-        { "png",             no_argument,       0, ARG_PNG_IMAGE_TYPE },
-        { "image-prefix",    required_argument, 0, ARG_IMAGE_PREFIX },
-        { "template",        required_argument, 0, ARG_TEMPLATE_FILE },
-        { "fonts-dir",       required_argument, 0, ARG_FONTS_DIR },
-        { "line-spacing",    required_argument, 0, ARG_LINE_SPACING },
-        { "input-file",      required_argument, 0, ARG_INPUT_TEXT },
-        { "input-glob",      required_argument, 0, ARG_INPUT_GLOB },
-        { "input-file-list", required_argument, 0, ARG_INPUT_FILE_LIST },
-        { "png-glob",        required_argument, 0, ARG_PNG_GLOB },
-        { "png-glob-nosort", required_argument, 0, ARG_PNG_GLOB_NOSORT },
-        { "header-template", required_argument, 0, ARG_HEADER_TEMPLATE },
-        { "script-file",     required_argument, 0, ARG_SED_SCRIPT_FILE },
-        { "jpeg-quality",    required_argument, 0, ARG_JPEG_QUALITY },
-        { "pad-paragraph",   required_argument, 0, ARG_PAD_PARAGRAPH },
-        { "text-size",       required_argument, 0, ARG_TEXT_SIZE },
-          { "1a-alpha",      required_argument, 0, ARG_1A_ALPHA },
-          { "alpha",         required_argument, 0, ARG_1A_ALPHA },
-          { "1c-colour",     required_argument, 0, ARG_1C_COLOUR },
-          { "colour",        required_argument, 0, ARG_1C_COLOUR },
-        { "text-face",       required_argument, 0, ARG_TEXT_FACE },
-        { "dest-dir",        required_argument, 0, ARG_DEST_DIR },
-        { "chop-prefix",     required_argument, 0, ARG_CHOP_PREFIX },
-          { "chop-chars",    required_argument, 0, ARG_CHOP_CHARS },
-          { "chop-width",    required_argument, 0, ARG_CHOP_CHARS },
-        { "margin-bottom",   required_argument, 0, ARG_MARGIN_BOTTOM },
-        { "no-comments",     no_argument,       0, ARG_NO_COMMENTS },
-        { "regression",      no_argument,       0, ARG_REGRESSION },
-        { "original-dir",    required_argument, 0, ARG_ORIGINAL_DIR },
-        { "xy-format",       required_argument, 0, ARG_XY_FORMAT },
-        { "edits",           required_argument, 0, ARG_ATTR_EDITS },
-          { "remove-dup-groups", required_argument, 0, ARG_REMOVE_DUP_GROUPS },
-          { "remove-dup-group-spaces", no_argument, 0, ARG_REMOVE_DUP_GROUP_SPACES },
-        { "verbose",         required_argument, 0, ARG_VERBOSE_LEVEL },
-        { "hyphenation",     no_argument,       0, ARG_HYPHENATION },
-        { "debug-text",      required_argument, 0, ARG_DEBUG_TEXT },
-        { "debug-work",      required_argument, 0, ARG_DEBUG_WORK },
-        { "url",             optional_argument, 0, ARG_URL_ZWSP },
-        { "version",         no_argument,       0, ARG_VERSION },
-        { NULL, 0, 0, 0 },
-        // TODO :: FIXME :: TODO  Add '--help'
-    };
-    struct {
-        union {
-            int  c;
-            char ch;  /* DBG display only */
-        };
-        int  option_index;
-        int  this_option_optind;
-        int  die;
-    } w = {
-        .option_index = 0,
-        .die          = 0,  /* Set if an unrecoverable error occurred */
-    };
+    chapter_jobs_t *queue = (chapter_jobs_t *) arg;
+    pa_opts_t       pa_opts = *queue->pa_opts;  /* shallow, see 'run_chapter_jobs()' */
+    chapter_t      *chapter;
 
-    set_opt_defaults(pa_opts);
 
+    pa_opts.fold_pass = queue->fold_pass;
+    pa_opts.fold_hint = 0;
+    pa_opts.fold_measure_scale = 1.0;
+    pa_opts.pa_render = new_pa_render( &pa_opts.font_dirs, libass_msg_callback, &pa_opts );
+    set_render_cache_limits( pa_opts.pa_render, pa_opts.ass_glyph_max, pa_opts.ass_bitmap_max_mb );
+    pa_opts.pa_measure = (FOLD_MEASURE_OFF != pa_opts.fold_measure) ? new_pa_measure( &pa_opts.font_dirs ) : NULL;
 
-    /*
-     **************************************************************************
-     * https://stackoverflow.com/questions/1052746/getopt-does-not-parse-optional-arguments-to-parameters
-     * TODO :: for --remove-dup-blocks to be an 'optional_argument' option.
-     */
     while ( 1 ) {
-        w.this_option_optind = optind ? optind : 1;
+        pthread_mutex_lock( &queue->lock );
+        chapter = (queue->next < queue->cnt) ? queue->order[ queue->next++ ] : NULL;
+        pthread_mutex_unlock( &queue->lock );
 
-        w.c = getopt_long( argc, argv, short_options, long_options, &w.option_index );
-        if ( -1 == w.c ) {
+        if ( NULL == chapter ) {
             break;
         }
 
-        switch ( w.c ) {
-        case ARG_REGRESSION:
-            pa_opts->regression = 1;
-            break;
-        case ARG_NO_COMMENTS:
-            pa_opts->no_comments = 1;
-            break;
-        case ARG_TEMPLATE_FILE:
-            add_strptrary( &pa_opts->templates, optarg );
-            break;
-        case ARG_FONTS_DIR:
-            /* FIXME :: validate the directories */
-            add_strptrary( &pa_opts->font_dirs, optarg );
-            break;
-        case ARG_HEADER_TEMPLATE:
-            if ( NULL == add_single_template( &pa_opts->header_template, optarg ) ) {
-                int sv_errno = errno;
-                fprintf(stderr, "ERROR :: can't load header template '%s'", optarg);
-                fprintf(stderr, ", %d - '%s'\n", sv_errno, strerror(sv_errno));
-                _exit(2);
-            }
-            if ( RC_FALSE == verify_template( pa_opts->header_template.data[0], "ddsssu", NULL ) ) {
-                fprintf(stderr, "ERROR :: can't verify header template '%s'.\n", optarg);
-                _exit(2);
-            }
-            break;
-        case ARG_INPUT_TEXT:
-            append_a_pathname( &pa_opts->in_chapters, optarg );
-            break;
-        case ARG_PNG_IMAGE_TYPE:  /* "jpg" is the default output image type */
-            strcpy(pa_opts->details.image_type, "png");
-            break;
-        case ARG_INPUT_GLOB: {
-            int  rc = add_glob_files( &pa_opts->in_chapters, optarg, PA_GLOB_SORT );
-            if ( 0 == rc ) {
-               w.die = 1;
-               ERR_IGNORE( argv, optind, optarg, "No matching patterns were found\n" );
-            }
-            else if ( -1 == rc ) {
-               w.die = 1;
-               ERR_IGNORE( argv, optind, optarg, "An error was returned by 'glob()'\n" );
-            }
-            else if ( pa_opts->verbose_level >= VERBOSE_2 ) {
-               fprintf(stderr, "Added %d input files from '%s' ...\n", rc, optarg);
-            }
-            } break;
-        case ARG_INPUT_FILE_LIST: {
-            int  rc = add_file_list( &pa_opts->in_chapters, optarg );
-            if ( 0 == rc ) {
-               ERR_IGNORE( argv, optind, optarg, "No pathnames in file were found\n" );
-            }
-            else if ( -1 == rc ) {
-               ERR_IGNORE( argv, optind, optarg, "An I/O error occured'\n" );
-            }
-            else if ( pa_opts->verbose_level >= VERBOSE_2 ) {
-               fprintf(stderr, "Added %d input files from '%s' ...\n", rc, optarg);
-            }
-            } break;
-        case ARG_PNG_GLOB_NOSORT:
-        case ARG_PNG_GLOB: {
-            int  rc = add_glob_files( &pa_opts->in_png_list, optarg, (ARG_PNG_GLOB == w.c) );
-            if ( 0 == rc ) {
-               ERR_IGNORE( argv, optind, optarg, "No matching patterns were found\n" );
-            }
-            else if ( -1 == rc ) {
-               ERR_IGNORE( argv, optind, optarg, "An error was returned by 'glob()'\n" );
+        if ( FOLD_PASS_1 == pa_opts.fold_pass ) {
+            load_chapter( &pa_opts, chapter );
+            if ( RC_TRUE == load_chapter_fold( &pa_opts, chapter ) ) {
+                continue;
             }
-            } break;
-        case ARG_LINE_SPACING: {
-            char  *str = NULL;
-            double val;
-            if ( 1 == sscanf(optarg, "%lf%4mc", &val, &str) && val >= 0.0 && val <= 100.0 ) {
-                pa_opts->line_spacing = val;
-            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 0.0 to 100.0\n" );
-            (free)( str );
-            } break;
-        case ARG_VERBOSE_LEVEL: {
-            char  str[ 4 ];
-            int   val;
+        }
+        fold_chapter( &pa_opts, chapter );
+        if ( FOLD_PASS_1 == pa_opts.fold_pass ) {
+            save_chapter_fold( &pa_opts, chapter );
+        }
+    }
+
+    cleanup_pa_render( &pa_opts.pa_render );
+    cleanup_pa_measure( &pa_opts.pa_measure );
+
+    return ( NULL );
+}
+
+
+/**
+ *******************************************************************************
+ * Get the page's background 'png_idx' -- 'decode'd to render into, or (for
+ * the fit) just its size, which is already known (see 'probe_backgrounds()').
+ */
+static pa_image_t *load_pa_image(pa_opts_t const *pa_opts, size_t png_idx, int decode)
+{
+    auto void cleanup_pathname( char ** );
+    char const *const filename = pa_opts->in_png_list.pathnames[ png_idx ];
+    struct {
+        pa_image_t   *image;
+        comments_t *comments;
+        char       *desc;
+        rc_e        rc;
+    } w = {
+        .image    = NULL,
+        .comments = NULL,
+        .rc       = RC_FALSE,
+    };
+
+
+    if ( decode ) {
+        if ( NULL != pa_opts->original_dir ) {
+            char  *pathname __attribute__ ((__cleanup__ (cleanup_pathname))) = NULL;
+
             /*
              *******************************************************************
-             * Note, we don't bother w/checking MAX so the user can use
-             *       --verbose=99 to ensure everything is logged.
+             * An original dir was specified, try to load those PNG comments.
+             * Only the original's text chunks are read, and only once per run
+             * (they're kept in the background cache).
              */
-            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= VERBOSE_QUIET ) {
-                pa_opts->verbose_level = val & VERBOSE_MASK;
-            } else ERR_IGNORE( argv, optind, optarg, "Value should be from %d to %d.\n", VERBOSE_QUIET, VERBOSE_MAX );
-            } break;
-        case ARG_PAD_PARAGRAPH: {
-            char  str[ 4 ];
-            int   val;
-            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= 4 && val <= 100 ) {
-                pa_opts->pad_paragraph = val;
-            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 4 to 100.\n" );
-            } break;
-        case ARG_JPEG_QUALITY: {
-            char  str[ 4 ];
-            int   val;
-            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= 0 && val <= 100 ) {
-                pa_opts->jpeg_quality = val;
-            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 0 to 100 (where 100 is the best quality).\n" );
-            } break;
-        case ARG_MARGIN_BOTTOM: {
-            char  str[ 4 ];
-            int   val;
-            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= 0 && val <= (pa_opts->png_height / 2) ) {
-                pa_opts->margin_bottom = val;
-            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 0 to %d.\n", (pa_opts->png_height / 2) );
-            } break;
-        case ARG_TEXT_SIZE: {
-            char  str[ 4 ];
-            int   val;
-            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= 8 && val <= 120 ) {
-                pa_opts->text_size = val;
-            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 8 to 120.\n" );
-            } break;
-        case ARG_1A_ALPHA: {
-            char  alpha_1a[ sizeof ("00") ];
-            char  str[ 4 ];
-            if ( 1 == sscanf(optarg, "%2[0-9A-Fa-f]%3c", alpha_1a, str) && 2 == strlen(alpha_1a) ) {
-                for (size_t idx = 0; idx < (sizeof (alpha_1a) - 1); idx++ ) {
-                    alpha_1a[ idx ] = toupper(alpha_1a[ idx ]);
-                }
-                strcpy(pa_opts->alpha_1a, alpha_1a);
-            } else ERR_IGNORE( argv, optind, optarg, "String must be from '00' to 'FF'.\n" );
-            } break;
-        case ARG_1C_COLOUR: {
-            char  colour_1c[ sizeof ("080808") ];
-            char  str[ 4 ];
-            if ( 1 == sscanf(optarg, "%6[0-9A-Fa-f]%3c", colour_1c, str) && 6 == strlen(colour_1c) ) {
-                for (size_t idx = 0; idx < (sizeof (colour_1c) - 1); idx++ ) {
-                    colour_1c[ idx ] = toupper(colour_1c[ idx ]);
+            if ( RC_TRUE == new_from_filename( &pathname, filename, pa_opts->original_dir ) ) {
+                w.rc = get_bgcache_comments( pa_opts->bgcache, pathname, IGNORE_KEYS, &w.comments, &w.desc );
+                if ( RC_TRUE != w.rc ) {
+                    if ( pa_opts->verbose_level >= VERBOSE_1 ) {
+                        fprintf(stderr, "WARNING :: can't access comments from '%s' in %s\n",
+                                        filename, w.desc);  /*+*/
+                    }
+                    (free)( w.desc );
                 }
-                strcpy(pa_opts->colour_1c, colour_1c);
-            } else ERR_IGNORE( argv, optind, optarg, "String must be from '000000' to 'FFFFFF'.\n" );
-            } break;
-        case ARG_SED_SCRIPT_FILE:
-            if ( RC_FALSE == access_a_pathname( &pa_opts->sed_script_files, optarg ) ) {
-                fprintf(stderr, "ERROR :: can't access('%s').\n", optarg);
-                _exit(2);
-            }
-            break;
-        case ARG_IMAGE_PREFIX:
-            free (pa_opts->details.image_prefix);
-            pa_opts->details.image_prefix = strdup(optarg);
-            break;
-        case ARG_DEBUG_TEXT:
-            if ( RC_TRUE == is_a_directory( optarg, W_OK ) ) {
-                free (pa_opts->debug_text_dir);
-                pa_opts->debug_text_dir = strdup(optarg);
-            } else {
-                w.die = 1;
-                ERR_IGNORE( argv, optind, optarg, "Argument: is not a directory, does not exist, or write permission is denied.\n" );
             }
-            break;
-        case ARG_DEBUG_WORK:
-            if ( RC_TRUE == is_a_directory( optarg, W_OK ) ) {
-                free (pa_opts->debug_work_dir);
-                pa_opts->debug_work_dir = strdup(optarg);
-            } else {
-                w.die = 1;
-                ERR_IGNORE( argv, optind, optarg, "Argument: is not a directory, does not exist, or write permission is denied.\n" );
+            else if ( pa_opts->verbose_level >= VERBOSE_1 ) {
+                fprintf(stderr, "WARNING :: can't access comments in '%s' from '%s' -- error %d, %s\n",
+                                pathname, filename, errno, strerror(errno)); /*+*/
             }
-            break;
-        case ARG_DEST_DIR:
-            if ( RC_TRUE == is_a_directory( optarg, W_OK ) ) {
-                free (pa_opts->details.dest_dir);
-                pa_opts->details.dest_dir = strdup(optarg);
-            } else ERR_IGNORE( argv, optind, optarg, "Argument is not a directory, or write permission is denied.\n" );
-            break;
-        case ARG_CHOP_PREFIX:
-            free (pa_opts->chop_prefix);  /* SPACEs are okay in this option */
-            pa_opts->chop_prefix = strdup(optarg);
-            break;
-        case ARG_CHOP_CHARS: {
-            char  str[ 4 ];
-            int   val;
-            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= 0 && val <= 12 ) {
-                pa_opts->chop_chars = val;
-            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 0 to 12.\n" );
-            } break;
-        case ARG_ORIGINAL_DIR:
-            if ( RC_TRUE == is_a_directory( optarg, 0 ) ) {
-                free (pa_opts->original_dir);
-                pa_opts->original_dir = strdup(optarg);
-            } else ERR_IGNORE( argv, optind, optarg, "Argument is not a directory, or access is denied.\n" );
-            break;
-        case ARG_TEXT_FACE: {
-            char const *p;
-            if ( '\0' != *(p = zap_isspace( optarg )) ) {
-                free (pa_opts->text_face);
-                pa_opts->text_face = strdup(p);
-            } else ERR_IGNORE( argv, optind, optarg, "Font name is an EMPTY string.\n" );
-            } break;
+        }
 
-        case ARG_XY_FORMAT: {
-            pa_opts->xy_format = XY_PAGE_XofY;
-            enum { OPT_XY_PAGE_XofY = 0, OPT_XY_DECIMAL, OPT_XY_ROMAN };
-            static char *const token[] = {
-                [ OPT_XY_PAGE_XofY ] = "XofY",
-                [ OPT_XY_DECIMAL ]   = "decimal",
-                [ OPT_XY_ROMAN ]     = "roman",
-                NULL
-            };
-            int   errfnd = 0;  /* unused, for now */
-            char *value;
-            char *subopts = optarg;
-            while ( ('\0' != *subopts) && 0 == errfnd ) {
-                switch ( getsubopt(&subopts, token, &value) ) {
-                case OPT_XY_PAGE_XofY:
-                    pa_opts->xy_format = XY_PAGE_XofY;
-                    break;
-                case OPT_XY_DECIMAL:
-                    pa_opts->xy_format = XY_DECIMAL;
-                    break;
-                case OPT_XY_ROMAN:
-                    pa_opts->xy_format = XY_ROMAN;
-                    break;
-                default:
-                    ERR_IGNORE( argv, optind, optarg, "Unknown sub-option for argument.\n" );
-                }
-            }
-            } break;
+        w.rc = get_bgcache_image( pa_opts->bgcache, filename, IGNORE_KEYS, &w.image );
+        if ( RC_TRUE != w.rc ) {
+            goto check_err_desc;
+        }
+        if ( NULL != w.comments ) {
+            replace_png_comments( w.image, w.comments );
+        }
+    }
+    else {
+        w.image = clone_pa_image( pa_opts->in_png_frames[ png_idx ] );
+    }
 
-        case ARG_ATTR_EDITS: {
-            pa_opts->attr_edits = 0;
-            enum { OPT_AE_ALL = 0, OPT_AE_TWO_SPACES, OPT_AE_DOUBLE_DASH, OPT_AE_URBAN_WORDS,
-                   OPT_NO_ALL,     OPT_NO_TWO_SPACES, OPT_NO_DOUBLE_DASH, OPT_NO_URBAN_WORDS,
+    return ( w.image );
+
+    check_err_desc:
+    if ( NULL != w.image ) {
+        w.desc = get_err_desc( w.image );
+        fprintf(stderr, "[pngass] Error :: %s", w.desc);
+        cleanup_pa_image( &w.image );
+    }
+
+    return ( w.image );
+
+    void cleanup_pathname( char **ptr )
+    {
+        (free)( *ptr );
+    }
+}
+
+
+/**
+ *******************************************************************************
+ * Convert a text blob to a libass format that is TRIMMED up to the 1st line.
+ *
+ * This is one of the MAIN functions of this conversion program.
+ *
+ * We're going to use the libass layout engine (which does a pretty nice job),
+ * but since we're using it in a non-conventional way, we have to present the
+ * text in a predictable way.  If we want the text to be rendered in "order",
+ * we have to combine all of the text into a single 'Dialogue:' line with the
+ * "hard" line breaks identified by libass's '\N' sequence (and some other line
+ * formatting options).  If we use multiple 'Dialogue:'s, the layout engine may
+ * move things around when it looks for the best fit (remember, we're kind of
+ * using it outside of its design specifications).
+ *
+ * Some of the things libass has difficulty performing are:
+ *  - orphan word control,
+ *  - no justified text (but who uses that nowadays - seriously),
+ *  - only a single vertical margin,
+ *  - no indication of clipping during rendering (has to be manually checked),
+ *  - forcing a particular line height,
+ *  - a few other minor items (e.g., won't hard-break a line).
+ *
+ * Despite the above, and this application's very, very unconventional use of
+ * libass, it does a very nice job especially with automatic font substitution
+ * for missing glyphs in a font (something that is missing w/other solutions).
+ *
+ * This performs a simple conversion of the input text to a single text blob,
+ * that is, it:
+ * - replaces all of the newlines with the character sequence '\N', which
+ *   is the libass hard line-break character sequence;
+ * - if there are multiple newlines, replaces the subsequent newlines with
+ *   ' \N' so that they are not *ignored* by the libass layout engine (so
+ *   that even if this changes in a future version of libass, the extra SPACE
+ *   shouldn't have any affect).  For example, the sequence "\n\n\n" will
+ *   be converted to '\N \N \N' (adding 5 characters total to the sequence,
+ *   two of which are the "special" SPACEs).
+ * - adds paragraph padding, if specified by the user using '--pad-paragraph'.
+ * - TODO :: add a '--url' option.  This option will search for crowded
+ *   characters and add a zero-width SPACE character after each.  I don't know
+ *   if libass will break on those (have to test), but this is mainly for
+ *   embedded URLs in the text (usually in TL notes) which tend to be long and
+ *   will not naturally wrap (libass doesn't force-break lines).
+ *
+ * Footnotes -
+ *   On Pango w/ImageMagick :: http://www.imagemagick.org/Usage/text/#pango
+ *   "Pango is is not meant to be a whole scale text page formatting engine."
+ *
+ *   Even though libass is more of an annimation layout engine, libass has many
+ *   interesting font features that'd be difficult to quickly implement, and it
+ *   does a great job at rendering all of the glyphs in the 'Dialogue:'s Text.
+ *
+ *   The "definitive" Sub Station Alpha v4.00+ Script Format document defines
+ *   the '\fs' style override code taking an argument; it does NOT indicate that
+ *   this is an optional value.  However, in practice I've seen it used w/o an
+ *   argument as a "reset" with the result that the default value / size for
+ *   the corresponding 'Style:' is used (I think - I haven't tried using it as
+ *   a stack - {\fsX}..{\fsY}..{\fs}..Font size X..{\fs}..Original font size).
+ *   I always use the value.
+ *   See --> http://moodub.free.fr/video/ass-specs.doc
+ *
+ * If 'p_in_map' isn't NULL, it's set to a map of each work text byte (and the
+ * '\0') to the byte of 'in_text' that it came from (for '--paginate-only').
+ *
+ * The work text's tokens and '--pad-paragraph' strings are set in 'index'.
+ *******************************************************************************
+ */
+static char *make_work_text(char const *const in_text, char const *const pad_str, uint32_t **p_in_map, work_index_t *index)
+{
+#undef LIBASS_NL_FIX
+#define LIBASS_NL_FIX ' '
+#undef NL_BUMP_SZ
+#define NL_BUMP_SZ (320)  /**< This value reflects the number of NLs that may
+                               be in the input text file as an average for a
+                               typical chapter. */
+    struct {
+        char const *const in_text;
+        size_t            in_text_len;
+        size_t            in_idx;
+
+        char              ch;          /* This is *also* a flag / BUG fix */
+        size_t            nl_idx;
+        size_t            nl_max;
+
+        unsigned short    pad_len;
+
+        char             *out_text;
+        size_t            out_idx;
+        size_t            ch_out_idx;  /* where this 'in_text' char starts */
+        uint32_t         *in_map;      /* NULL :: no 'p_in_map' */
+        size_t            pads_max;
+
+        size_t            dbg_sz;      /* realloc() size, w/b optimized out */
+    } w = {
+        .in_text     = in_text,
+        .in_text_len = 1 + strlen(in_text),
+        .in_idx      = 0,
+
+        .nl_idx      = 0,
+        .nl_max      = NL_BUMP_SZ,
+
+        .pad_len     = strlen(pad_str),
+
+        .out_text    = NULL,
+        .in_map      = NULL,
+        .pads_max    = 0,
+    };
+
+    *index = (work_index_t) { .ends = NULL, .cnt = 0, .pads = NULL, .pads_cnt = 0 };
+
+
+    if ( w.in_text != NULL ) { // FIXME :: Do I need +1 here?
+        w.out_text = realloc( w.out_text, w.dbg_sz = (1 + w.in_text_len + w.nl_max) );  /*+*/
+        if ( NULL != p_in_map ) {
+            w.in_map = realloc( w.in_map, w.dbg_sz * sizeof (uint32_t) );
+        }
+
+        /**
+         ***********************************************************************
+         * Skip over any SPACEs to get the the FIRST _real_ line of text.
+         * Note, this is the _only_ time we expect to deal with a raw '\n'.
+         */
+        w.in_idx = skip_non_text_tokens(w.in_text, w.in_idx, 1, 0);  /*+*/
+    }
+
+    /*
+     ***************************************************************************
+     * Copy / convert the input text to be used with a libass 'Dialogue:'.
+     */
+    while ( (w.ch = (*(w.out_text + w.out_idx) = *(w.in_text + w.in_idx))) ) {
+        w.ch_out_idx = w.out_idx;
+
+        /*
+         ***********************************************************************
+         * See the FACTOID about libass and UTF8_ZERO_WIDTH_SPACE characters.
+         * So, the point is that these probably should just be removed, and NOT
+         * replaced with a SPACE, based on their usage in html documents.
+         */
+        if ( STR_MATCH == strncmp((w.in_text + w.in_idx), UTF8_ZERO_WIDTH_SPACE, sizeof (UTF8_ZERO_WIDTH_SPACE) - 1) ) {
+            w.in_idx += (sizeof (UTF8_ZERO_WIDTH_SPACE) - 1);
+            continue;
+        }
+
+        w.in_idx++;
+
+        if ( '\n' == w.ch ) {
+            /*
+             *******************************************************************
+             * This seems to be a *feature* in libass - consecutive newlines
+             * seem to be reduced by 1 (they're not all "rendered").  Padding
+             * a single SPACE before the '\N' sequence corrects this.
+             */
+            if ( (w.in_idx > 1) && '\n' == *(w.in_text + w.in_idx - 2) ) {
+                w.nl_idx++;
+                w.ch = LIBASS_NL_FIX;  /* ... prefix a SPACE character */
+            }
+
+            if ( w.nl_idx++ >= w.nl_max ) {
+                w.nl_max += NL_BUMP_SZ;
+                w.out_text = realloc( w.out_text, w.dbg_sz = (w.in_text_len + w.nl_max) );  /*+*/
+                if ( NULL != w.in_map ) {
+                    w.in_map = realloc( w.in_map, w.dbg_sz * sizeof (uint32_t) );
+                }
+            }
+
+            if ( LIBASS_NL_FIX == w.ch ) {
+                *(w.out_text + w.out_idx) = ' ';
+                w.out_idx++;
+            }
+            *(w.out_text + w.out_idx) = '\\';
+            w.out_idx++;
+            *(w.out_text + w.out_idx) = 'N';
+
+            /*
+             *******************************************************************
+             * Okay, we want to "detect" a sequence like this - 'A\nA'.  It's
+             * a no-go if we had consecutive newlines OR the next character is
+             * a '\n'.  Note that 'w.in_idx' is pointing at the NEXT character
+             * which could be the '\0', but we don't care as that's NOT a '\n'.
+             */
+            if ( w.pad_len )
+            if ( '\n' == w.ch && '\n' != *(w.in_text + w.in_idx)
+                              && '\0' != *(w.in_text + w.in_idx) ) {
+                w.nl_idx += w.pad_len;
+                if ( w.nl_idx++ >= w.nl_max ) {
+                    w.nl_max += NL_BUMP_SZ;
+                    w.out_text = realloc( w.out_text, w.dbg_sz = (w.in_text_len + w.nl_max) );  /*+*/
+                    if ( NULL != w.in_map ) {
+                        w.in_map = realloc( w.in_map, w.dbg_sz * sizeof (uint32_t) );
+                    }
+                }
+                strcpy((w.out_text + w.out_idx + 1), pad_str);
+                if ( index->pads_cnt == w.pads_max ) {
+                    w.pads_max += NL_BUMP_SZ;
+                    index->pads = realloc( index->pads, w.pads_max * sizeof (uint32_t) );
+                }
+                index->pads[ index->pads_cnt++ ] = w.out_idx + 1;
+                w.out_idx += w.pad_len;
+            }
+        }
+
+        for ( size_t idx = w.ch_out_idx; NULL != w.in_map && idx <= w.out_idx; idx++ ) {
+            w.in_map[ idx ] = w.in_idx - 1;
+        }
+        w.out_idx++;
+    }
+
+    if ( NULL != w.in_map ) {
+        w.in_map[ w.out_idx ] = w.in_idx;
+        *p_in_map = realloc( w.in_map, (1 + w.out_idx) * sizeof (uint32_t) );
+    }
+
+    /*
+     ***************************************************************************
+     * Resize the text to its final size (including the '\0' string terminator).
+     */
+    w.out_text = realloc( w.out_text, ++w.out_idx );  /*+*/
+
+    index_work_text( w.out_text, index );
+
+    return ( w.out_text );
+}
+
+
+/**
+ *******************************************************************************
+ * Find all of the work text's token ends, the same as stepping through it with
+ * 'next_token_idx()' (which is what PASS 1 did for every token of every page).
+ */
+static void index_work_text( char const *const work_text, work_index_t *index )
+{
+#undef WORK_INDEX_BUMP
+#define WORK_INDEX_BUMP (4096)
+    size_t       max = 0;
+    unsigned int idx = 0;
+
+    while ( '\0' != *(work_text + idx) ) {
+        if ( index->cnt == max ) {
+            max += WORK_INDEX_BUMP;
+            index->ends = realloc( index->ends, max * sizeof (uint32_t) );
+        }
+        idx = next_token_idx( work_text, idx );
+        index->ends[ index->cnt++ ] = idx;
+    }
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * Initially used to remove the '--pad-paragraph' option from the top of a page,
+ * this function could perform other (future) edits as well.  The pads are
+ * found in the work text's index (a bisection, NOT a compare).
+ */
+static void trim_work_text( pa_opts_t const *pa_opts, work_index_t const *index, text_segments_t *const text_segments, unsigned int template_pass )
+{
+    struct {
+        uint32_t const     start;
+        unsigned int const len;
+        size_t             lo;
+        size_t             hi;
+    } w = {
+        .start       = text_segments[ template_pass ].text_start_idx,
+        .len         = strlen(pa_opts->pad_str),
+        .lo          = 0,
+        .hi          = index->pads_cnt,
+    };
+
+    while ( w.lo < w.hi ) {
+        size_t mid = w.lo + (w.hi - w.lo) / 2;
+
+        if ( index->pads[ mid ] < w.start ) {
+            w.lo = mid + 1;
+        }
+        else {
+            w.hi = mid;
+        }
+    }
+
+    if ( w.lo < index->pads_cnt && w.start == index->pads[ w.lo ] ) {
+        text_segments[ template_pass ].text_start_idx += w.len;
+        if ( template_pass ) {
+            text_segments[ template_pass - 1 ].work_text_delta += w.len;
+        }
+    }
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+static char *debug_work_text(char const *const work_text, char const *const dir, char const *const chapter_filename)
+{
+
+    if ( NULL != dir ) {
+
+        char *ptr;
+        char  str[ 1 + strlen(chapter_filename) ];
+
+        strcpy(str, chapter_filename);
+        asprintf(&ptr, "%s%s%s.txt", dir, PA_PATH_SEP, basename(str));
+
+        FILE *file = fopen(ptr, "w");
+        if ( NULL != file ) {
+            fprintf(file, "%s\n", work_text);
+            fclose(file);
+        }
+        (free)(ptr);
+    }
+
+    return ( (char *) work_text );
+}
+
+
+/**
+ *******************************************************************************
+ * Read and process (with the '--script-file's) an input text file.
+ *
+ * The /bin/sed stream editor is really powerful / flexible (duh) and it'd be
+ * insane to try to recreate all of its functionality here.  But the scripts
+ * only need a small subset of it, so that's compiled once at startup and run
+ * in memory (see 'pa_sed.h') instead of a 'popen()' of sed for each chapter.
+ * If a script uses anything else, then /bin/sed is run just like it always
+ * was, and '--sed=verify' runs both to check the builtin against sed.
+ *
+ * This functionality is provided so the used can use automation to add
+ * character attributes (and possibly other markups) to an input text file.
+ * For example, adding a bold attribute to a character's name in a light novel.
+ * See the example sed scripts provided with the demo for some ideas.
+ *
+ */
+static char *process_textfile( char const *const filename, pa_opts_t *pa_opts )
+{
+    auto char *popen_sed(size_t *);
+    auto char *remove_dups(char *);
+    auto char *attr_edits(char *);
+    auto void  add_time(pa_phase_e, uint64_t);
+    struct {
+        char         c1[ 16 ];       /* The libass primary fill colour */
+        char         a1[ 16 ];       /* The libass primary alpha value */
+        char        *str;
+        size_t       len;            /* read, for '--stats-json' */
+        char        *sed_str;        /* '--sed=verify' :: sed's text */
+        size_t       sed_len;
+        uint64_t     start_ns;
+    } w = {
+        .str      = NULL,
+        .len      = 0,
+        .sed_str  = NULL,
+        .start_ns = get_monotonic_ns(),
+    };
+
+
+    if ( 0 == pa_opts->sed_script_files.cnt ) {
+        char *str = read_textfile( filename, &w.len );
+        add_time( PA_PHASE_SED, w.start_ns );
+
+        str = remove_dups( str );
+
+        str = attr_edits( str );
+        write_debug_text( filename, str, pa_opts );
+
+        return ( str );
+    }
+
+    if ( NULL != pa_opts->pa_sed ) {
+        w.str = run_pa_sed( pa_opts->pa_sed, read_textfile( filename, NULL ), &w.len );
+    }
+
+    /*
+     ***************************************************************************
+     * 'stdin' can only be read once, so there's nothing to verify it against.
+     */
+    if ( NULL == pa_opts->pa_sed ) {
+        w.str = popen_sed( &w.len );
+    }
+    else if ( SED_ENGINE_VERIFY == pa_opts->sed_engine && 0 != strcmp(filename, READ_STDIN) ) {
+        w.sed_str = popen_sed( &w.sed_len );
+        if ( NULL != w.sed_str && NULL != w.str ) {
+            size_t at = 0;
+            while ( at < w.len && at < w.sed_len && w.str[ at ] == w.sed_str[ at ] ) {
+                at++;
+            }
+            if ( at < w.len || at < w.sed_len ) {
+                fprintf(stderr, "WARNING :: '--sed=verify' :: the builtin sed's '%s' isn't %s's from byte %lu.\n",
+                        filename, PA_SED_EXEC, at);
+            }
+            else if ( pa_opts->verbose_level >= VERBOSE_2 ) {
+                fprintf(stderr, "'--sed=verify' :: the builtin sed's '%s' is %s's.\n", filename, PA_SED_EXEC);
+            }
+        }
+        (free)( w.str );
+        w.str = w.sed_str;
+        w.len = w.sed_len;
+    }
+
+    if ( NULL != w.str ) {
+        add_time( PA_PHASE_SED, w.start_ns );
+
+        w.str = remove_dups( w.str );
+
+        w.str = attr_edits( w.str );
+        write_debug_text( filename, w.str, pa_opts );
+    }
+
+    return ( w.str );
+
+
+    /**
+     ***************************************************************************
+     ***************************************************************************
+     * Run the scripts with /bin/sed, the "reset" regexps after them.
+     */
+    char *popen_sed( size_t *p_len ) {
+        snprintf(w.c1, sizeof (w.c1), "\\\\1c\\&H%s\\&", pa_opts->colour_1c);
+        snprintf(w.a1, sizeof (w.a1), "\\\\1a\\&H%s", pa_opts->alpha_1a);
+
+        char *cmd;
+        char *s1;
+
+        asprintf(&cmd, "%s", PA_SED_EXEC " --regexp-extended");
+        for ( size_t idx = 0; idx < pa_opts->sed_script_files.cnt; idx++ ) {
+            asprintf(&s1, "%s --file='%s'", cmd, pa_opts->sed_script_files.pathnames[ idx ]);
+            (free)( cmd );
+            cmd = s1;
+        }
+
+        /*
+         ***********************************************************************
+         * Put all of the "reset" regexps _after_ the scripts on the command line.
+         */
+        asprintf(&s1, "%s -e 's/@@1a@@/%s/g'", cmd, w.a1);
+        (free)( cmd );
+        cmd = s1;
+
+        asprintf(&s1, "%s -e 's/@@1c@@/%s/g'", cmd, w.c1);
+        (free)( cmd );
+        cmd = s1;
+
+        asprintf(&s1, "%s -e 's/@@face@@/\\\\fn%s/g'", cmd, pa_opts->text_face);
+        (free)( cmd );
+        cmd = s1;
+
+        asprintf(&s1, "%s -e 's/@@size@@/\\\\fs%d/g'", cmd, pa_opts->text_size);
+        (free)( cmd );
+        cmd = s1;
+
+        /*
+         ***********************************************************************
+         * And lastly, append the filename that all of these scripts are applied.
+         * If the file is 'stdin', then do nothing as sed will read from 'stdin'.
+         */
+        if ( 0 != strcmp(filename, READ_STDIN) ) {
+            asprintf(&s1, "%s \"%s\"", cmd, filename);
+            (free)( cmd );
+            cmd = s1;
+        }
+
+        fprintf(stderr, "%s\n", cmd);
+        FILE *file = popen(cmd, "r");
+        (free)( cmd );
+
+        char *str = NULL;
+        if ( NULL != file ) {
+            str = read_stream( file, p_len );
+            pclose(file);
+        }
+
+        return ( str );
+    }
+
+
+    /**
+     ***************************************************************************
+     ***************************************************************************
+     * The phases' times (and the bytes read) for '--stats-json'.
+     */
+    void add_time( pa_phase_e phase, uint64_t start_ns ) {
+        add_chapter_time( pa_opts->stats, pa_opts->details.chapter_idx, phase, get_monotonic_ns() - start_ns );
+        if ( PA_PHASE_SED == phase ) {
+            add_chapter_read( pa_opts->stats, pa_opts->details.chapter_idx, w.len );
+        }
+    }
+
+    char *attr_edits( char *s2 ) {
+        uint64_t start_ns = get_monotonic_ns();
+
+        s2 = apply_attr_edits( s2, pa_opts->attr_edits, NULL );
+        add_time( PA_PHASE_ATTR_EDITS, start_ns );
+
+        return ( s2 );
+    }
+
+
+    /**
+     ***************************************************************************
+     ***************************************************************************
+     *
+     */
+    char *remove_dups( char *s2 ) {
+        if ( pa_opts->remove_dup_groups ) {
+            uint64_t start_ns = get_monotonic_ns();
+
+            s2 = remove_dup_groups(s2, pa_opts->remove_dup_groups, pa_opts->remove_dup_group_spaces, &pa_opts->details.dup_groups_found);
+            add_time( PA_PHASE_DUP_GROUPS, start_ns );
+            if ( pa_opts->details.dup_groups_found )
+            if ( pa_opts->verbose_level > VERBOSE_QUIET ) {
+                fprintf(stderr, "DUPLICATE groups :: %u\n", pa_opts->details.dup_groups_found);
+            }
+            pa_opts->details.dup_groups_found -= pa_opts->details.dup_lines_found;   // HACK test, delete later
+        }
+
+        if ( 0 == PA_BUILT_OPTIMIZED ) {
+            char *ptr, buf[ 1 + strlen(filename) ];
+
+            strcpy(buf, filename);
+            asprintf(&ptr, "." PA_PATH_SEP "DEBUG%s%s", PA_PATH_SEP, basename(buf));
+
+            FILE *f = fopen(ptr, "w");
+            if ( NULL != f ) {
+                fprintf(f, "DUPLICATE lines :: %u\n", pa_opts->details.dup_lines_found);
+                fprintf(f, "DUPLICATE groups :: %u\n", pa_opts->details.dup_groups_found);
+                fprintf(f, "%s", s2);
+                fclose(f);
+            }
+            (free)(ptr);
+        }
+
+        return ( s2 );
+    }
+}
+
+
+/**
+ *******************************************************************************
+ *
+ */
+static void write_debug_text(UNUSED_ARG char const *const filename, UNUSED_ARG char const *const str, UNUSED_ARG pa_opts_t *pa_opts)
+{
+/*  pa_opts->debug_text */
+/*     if ( 0 != strcmp(filename, READ_STDIN) ) { */
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * getconf ARG_MAX == 2,097,152.  Anything more then the user should use xargs.
+ *
+ * TODO :: - a realpath option for the the input text filename in comments
+ *         - a web site option to include the source's website.  maybe allow
+ *           multiple - e.g. original and translated sites?
+ *         - an option to specify the writer(s).
+ */
+static rc_e O0 pa_parse_cmdline(pa_opts_t *pa_opts, int argc, char **argv)
+{
+    #undef WARNING
+    #define WARNING "WARNING ::"
+
+    /* TODO :: REWRITE :: I think there'a a better way using 'w.this_option_optind' ... */
+    #undef ERR_IGNORE   /* A couple of edge cases don't print properly... */
+    #define ERR_IGNORE( argv, ind, arg, fmt, ... )                           \
+    {                                               /* Super-crazy macro */  \
+        char *sp = " ";                                                      \
+        char *a_ = (arg);                                                    \
+        int   i_ = (ind);                                                    \
+        char *r_, p_[ 1 + strlen(argv[--i_]) ];                              \
+        strcpy(p_, argv[i_]);                                                \
+        char *q_ = strchr(p_, '=');                                          \
+        if ( NULL != q_ ) { r_ = p_; *++q_ = '\0'; } /* keep ' /=' char */   \
+        else {                                                               \
+            if ( '-' != argv[i_][0] ) {                                      \
+                i_--;                                                        \
+            }                                                                \
+            else {                                                           \
+                a_ = ""; sp = "";                                            \
+            }                                                                \
+            r_ = argv[i_];                                                   \
+        }  /* otherwise, get the actual option */                            \
+        fprintf(stderr, "%s option '%s%s%s' is invalid, IGNORED.\n",         \
+                        (0 == w.die) ? WARNING : "ERROR ::",                 \
+                        r_, (r_ == p_) ? "" : sp, a_);                       \
+        fprintf(stderr, "%*s", (int) strlen(WARNING), "");                   \
+        fprintf(stderr, (fmt), ##__VA_ARGS__);                               \
+    }
+    enum {
+        ARG_NO_COMMENTS     = 2,  /* 2 is NOT arbitrary ... */
+        ARG_INPUT_GLOB,
+        ARG_INPUT_FILE_LIST,
+        ARG_PNG_GLOB,
+        ARG_PNG_GLOB_NOSORT,
+        ARG_TEXT_SIZE,
+        ARG_SED_SCRIPT_FILE,
+        ARG_IMAGE_PREFIX,
+        ARG_CHOP_PREFIX,
+        ARG_CHOP_CHARS,
+        ARG_ORIGINAL_DIR,
+        ARG_XY_FORMAT,
+        ARG_REGRESSION,
+        ARG_ATTR_EDITS,
+        ARG_REMOVE_DUP_GROUPS,
+        ARG_REMOVE_DUP_GROUP_SPACES,
+        ARG_ASS_CACHE,
+        ARG_FOLD_SEARCH,
+        ARG_SINGLE_PASS,
+        ARG_BG_CACHE,
+        ARG_JOBS,
+        ARG_ENCODE_THREADS,
+        ARG_STATS_JSON,
+        ARG_FOLD_CACHE,
+        ARG_PAGINATE_ONLY,
+        ARG_FOLD_MEASURE,
+        ARG_SED,
+        ARG_BACKGROUND_FILTER,
+        ARG_BG_CACHE_DIR,
+        ARG_PREFETCH,
+        ARG_MARGIN_BOTTOM   = 'B',
+        ARG_TEXT_FACE       = 'F',
+        ARG_HEADER_TEMPLATE = 'H',
+        ARG_PAD_PARAGRAPH   = 'P',
+        ARG_DEBUG_SED       = 'S',  // TODO
+        ARG_DEBUG_TEXT      = 'T',
+        ARG_VERBOSE_QUIET   = 'Q',
+        ARG_VERSION         = 'V',
+        ARG_DEBUG_WORK      = 'W',
+        ARG_HYPHENATION     = 'Y',
+        ARG_1A_ALPHA        = 'a',
+        ARG_1C_COLOUR       = 'c',
+        ARG_DEST_DIR        = 'd',
+        ARG_FONTS_DIR       = 'f',
+        ARG_INPUT_TEXT      = 'i',
+        ARG_LINE_SPACING    = 'l',
+        ARG_JPEG_QUALITY    = 'q',
+        ARG_PNG_IMAGE_TYPE  = 'p',
+        ARG_TEMPLATE_FILE   = 't',
+        ARG_URL_ZWSP        = 'u',
+        ARG_VERBOSE_LEVEL   = 'v',
+    };
+    static char const short_options[] = "a:c:d:t:f:i:l:q:puv:B:F:H:P:S:T:QVWY";
+    static struct option const long_options[] = {
+        { "png",             no_argument,       0, ARG_PNG_IMAGE_TYPE },
+        { "image-prefix",    required_argument, 0, ARG_IMAGE_PREFIX },
+        { "template",        required_argument, 0, ARG_TEMPLATE_FILE },
+        { "fonts-dir",       required_argument, 0, ARG_FONTS_DIR },
+        { "line-spacing",    required_argument, 0, ARG_LINE_SPACING },
+        { "input-file",      required_argument, 0, ARG_INPUT_TEXT },
+        { "input-glob",      required_argument, 0, ARG_INPUT_GLOB },
+        { "input-file-list", required_argument, 0, ARG_INPUT_FILE_LIST },
+        { "png-glob",        required_argument, 0, ARG_PNG_GLOB },
+        { "png-glob-nosort", required_argument, 0, ARG_PNG_GLOB_NOSORT },
+        { "header-template", required_argument, 0, ARG_HEADER_TEMPLATE },
+        { "script-file",     required_argument, 0, ARG_SED_SCRIPT_FILE },
+        { "jpeg-quality",    required_argument, 0, ARG_JPEG_QUALITY },
+        { "pad-paragraph",   required_argument, 0, ARG_PAD_PARAGRAPH },
+        { "text-size",       required_argument, 0, ARG_TEXT_SIZE },
+          { "1a-alpha",      required_argument, 0, ARG_1A_ALPHA },
+          { "alpha",         required_argument, 0, ARG_1A_ALPHA },
+          { "1c-colour",     required_argument, 0, ARG_1C_COLOUR },
+          { "colour",        required_argument, 0, ARG_1C_COLOUR },
+        { "text-face",       required_argument, 0, ARG_TEXT_FACE },
+        { "dest-dir",        required_argument, 0, ARG_DEST_DIR },
+        { "chop-prefix",     required_argument, 0, ARG_CHOP_PREFIX },
+          { "chop-chars",    required_argument, 0, ARG_CHOP_CHARS },
+          { "chop-width",    required_argument, 0, ARG_CHOP_CHARS },
+        { "margin-bottom",   required_argument, 0, ARG_MARGIN_BOTTOM },
+        { "no-comments",     no_argument,       0, ARG_NO_COMMENTS },
+        { "regression",      no_argument,       0, ARG_REGRESSION },
+        { "original-dir",    required_argument, 0, ARG_ORIGINAL_DIR },
+        { "xy-format",       required_argument, 0, ARG_XY_FORMAT },
+        { "edits",           required_argument, 0, ARG_ATTR_EDITS },
+          { "remove-dup-groups", required_argument, 0, ARG_REMOVE_DUP_GROUPS },
+          { "remove-dup-group-spaces", no_argument, 0, ARG_REMOVE_DUP_GROUP_SPACES },
+        { "ass-cache",       required_argument, 0, ARG_ASS_CACHE },
+        { "fold-search",     required_argument, 0, ARG_FOLD_SEARCH },
+        { "single-pass",     no_argument,       0, ARG_SINGLE_PASS },
+        { "bg-cache",        required_argument, 0, ARG_BG_CACHE },
+        { "jobs",            required_argument, 0, ARG_JOBS },
+        { "encode-threads",  required_argument, 0, ARG_ENCODE_THREADS },
+        { "stats-json",      required_argument, 0, ARG_STATS_JSON },
+        { "fold-cache",      required_argument, 0, ARG_FOLD_CACHE },
+        { "paginate-only",   optional_argument, 0, ARG_PAGINATE_ONLY },
+        { "fold-measure",    required_argument, 0, ARG_FOLD_MEASURE },
+        { "sed",             required_argument, 0, ARG_SED },
+        { "background-filter", required_argument, 0, ARG_BACKGROUND_FILTER },
+        { "bg-cache-dir",    required_argument, 0, ARG_BG_CACHE_DIR },
+        { "prefetch",        required_argument, 0, ARG_PREFETCH },
+        { "verbose",         required_argument, 0, ARG_VERBOSE_LEVEL },
+        { "hyphenation",     no_argument,       0, ARG_HYPHENATION },
+        { "debug-text",      required_argument, 0, ARG_DEBUG_TEXT },
+        { "debug-work",      required_argument, 0, ARG_DEBUG_WORK },
+        { "url",             optional_argument, 0, ARG_URL_ZWSP },
+        { "version",         no_argument,       0, ARG_VERSION },
+        { NULL, 0, 0, 0 },
+        // TODO :: FIXME :: TODO  Add '--help'
+    };
+    struct {
+        union {
+            int  c;
+            char ch;  /* DBG display only */
+        };
+        int  option_index;
+        int  this_option_optind;
+        int  die;
+    } w = {
+        .option_index = 0,
+        .die          = 0,  /* Set if an unrecoverable error occurred */
+    };
+
+    set_opt_defaults(pa_opts);
+
+
+    /*
+     **************************************************************************
+     * https://stackoverflow.com/questions/1052746/getopt-does-not-parse-optional-arguments-to-parameters
+     * TODO :: for --remove-dup-blocks to be an 'optional_argument' option.
+     */
+    while ( 1 ) {
+        w.this_option_optind = optind ? optind : 1;
+
+        w.c = getopt_long( argc, argv, short_options, long_options, &w.option_index );
+        if ( -1 == w.c ) {
+            break;
+        }
+
+        switch ( w.c ) {
+        case ARG_REGRESSION:
+            pa_opts->regression = 1;
+            break;
+        case ARG_NO_COMMENTS:
+            pa_opts->no_comments = 1;
+            break;
+        case ARG_TEMPLATE_FILE:
+            add_strptrary( &pa_opts->templates, optarg );
+            break;
+        case ARG_FONTS_DIR:
+            /* FIXME :: validate the directories */
+            add_strptrary( &pa_opts->font_dirs, optarg );
+            break;
+        case ARG_HEADER_TEMPLATE:
+            if ( NULL == add_single_template( &pa_opts->header_template, optarg ) ) {
+                int sv_errno = errno;
+                fprintf(stderr, "ERROR :: can't load header template '%s'", optarg);
+                fprintf(stderr, ", %d - '%s'\n", sv_errno, strerror(sv_errno));
+                _exit(2);
+            }
+            if ( RC_FALSE == verify_template( pa_opts->header_template.data[0], "ddsssu", NULL ) ) {
+                fprintf(stderr, "ERROR :: can't verify header template '%s'.\n", optarg);
+                _exit(2);
+            }
+            break;
+        case ARG_INPUT_TEXT:
+            append_a_pathname( &pa_opts->in_chapters, optarg );
+            break;
+        case ARG_PNG_IMAGE_TYPE:  /* "jpg" is the default output image type */
+            strcpy(pa_opts->details.image_type, "png");
+            break;
+        case ARG_INPUT_GLOB: {
+            int  rc = add_glob_files( &pa_opts->in_chapters, optarg, PA_GLOB_SORT );
+            if ( 0 == rc ) {
+               w.die = 1;
+               ERR_IGNORE( argv, optind, optarg, "No matching patterns were found\n" );
+            }
+            else if ( -1 == rc ) {
+               w.die = 1;
+               ERR_IGNORE( argv, optind, optarg, "An error was returned by 'glob()'\n" );
+            }
+            else if ( pa_opts->verbose_level >= VERBOSE_2 ) {
+               fprintf(stderr, "Added %d input files from '%s' ...\n", rc, optarg);
+            }
+            } break;
+        case ARG_INPUT_FILE_LIST: {
+            int  rc = add_file_list( &pa_opts->in_chapters, optarg );
+            if ( 0 == rc ) {
+               ERR_IGNORE( argv, optind, optarg, "No pathnames in file were found\n" );
+            }
+            else if ( -1 == rc ) {
+               ERR_IGNORE( argv, optind, optarg, "An I/O error occured'\n" );
+            }
+            else if ( pa_opts->verbose_level >= VERBOSE_2 ) {
+               fprintf(stderr, "Added %d input files from '%s' ...\n", rc, optarg);
+            }
+            } break;
+        case ARG_PNG_GLOB_NOSORT:
+        case ARG_PNG_GLOB: {
+            int  rc = add_glob_files( &pa_opts->in_png_list, optarg, (ARG_PNG_GLOB == w.c) );
+            if ( 0 == rc ) {
+               ERR_IGNORE( argv, optind, optarg, "No matching patterns were found\n" );
+            }
+            else if ( -1 == rc ) {
+               ERR_IGNORE( argv, optind, optarg, "An error was returned by 'glob()'\n" );
+            }
+            } break;
+        case ARG_LINE_SPACING: {
+            char  *str = NULL;
+            double val;
+            if ( 1 == sscanf(optarg, "%lf%4mc", &val, &str) && val >= 0.0 && val <= 100.0 ) {
+                pa_opts->line_spacing = val;
+            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 0.0 to 100.0\n" );
+            (free)( str );
+            } break;
+        case ARG_VERBOSE_LEVEL: {
+            char  str[ 4 ];
+            int   val;
+            /*
+             *******************************************************************
+             * Note, we don't bother w/checking MAX so the user can use
+             *       --verbose=99 to ensure everything is logged.
+             */
+            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= VERBOSE_QUIET ) {
+                pa_opts->verbose_level = val & VERBOSE_MASK;
+            } else ERR_IGNORE( argv, optind, optarg, "Value should be from %d to %d.\n", VERBOSE_QUIET, VERBOSE_MAX );
+            } break;
+        case ARG_PAD_PARAGRAPH: {
+            char  str[ 4 ];
+            int   val;
+            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= 4 && val <= 100 ) {
+                pa_opts->pad_paragraph = val;
+            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 4 to 100.\n" );
+            } break;
+        case ARG_JPEG_QUALITY: {
+            char  str[ 4 ];
+            int   val;
+            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= 0 && val <= 100 ) {
+                pa_opts->jpeg_quality = val;
+            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 0 to 100 (where 100 is the best quality).\n" );
+            } break;
+        case ARG_MARGIN_BOTTOM: {
+            char  str[ 4 ];
+            int   val;
+            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= 0 && val <= (pa_opts->png_height / 2) ) {
+                pa_opts->margin_bottom = val;
+            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 0 to %d.\n", (pa_opts->png_height / 2) );
+            } break;
+        case ARG_BG_CACHE: {
+            char  str[ 4 ];
+            int   val;
+            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= 0 && val <= 65536 ) {
+                pa_opts->bg_cache_mb = val;
+            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 0 to 65536 (MB of decoded images, 0 is no cache).\n" );
+            } break;
+        case ARG_PREFETCH: {
+            char  str[ 4 ];
+            int   val;
+            int   mb = PA_PREFETCH_DEFAULT_MB;
+            if (   (1 == sscanf(optarg, "%d%3c", &val, str) || 2 == sscanf(optarg, "%d,%d%3c", &val, &mb, str))
+                && val >= 0 && val <= 64 && mb >= 1 && mb <= 65536 ) {
+                pa_opts->prefetch    = val;
+                pa_opts->prefetch_mb = mb;
+            } else ERR_IGNORE( argv, optind, optarg, "Value must be K[,MB], K from 0 to 64 (the pages ahead, 0 is off) and MB from 1 to 65536.\n" );
+            } break;
+        case ARG_JOBS: {
+            char  str[ 4 ];
+            int   val;
+            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= 1 && val <= 256 ) {
+                pa_opts->jobs = val;
+            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 1 to 256 (chapters rendered at once).\n" );
+            } break;
+        case ARG_ENCODE_THREADS: {
+            char  str[ 4 ];
+            int   val;
+            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= 0 && val <= 64 ) {
+                pa_opts->encode_threads = val;
+            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 0 to 64 (0 writes the images on the rendering thread).\n" );
+            } break;
+        case ARG_STATS_JSON:
+            free (pa_opts->stats_json);  /* "-" is stdout */
+            pa_opts->stats_json = strdup(optarg);
+            break;
+        case ARG_FOLD_CACHE:
+            if ( RC_TRUE == is_a_directory( optarg, W_OK ) ) {
+                free (pa_opts->fold_cache_dir);
+                pa_opts->fold_cache_dir = strdup(optarg);
+            } else {
+                w.die = 1;
+                ERR_IGNORE( argv, optind, optarg, "Argument: is not a directory, does not exist, or write permission is denied.\n" );
+            }
+            break;
+        case ARG_BG_CACHE_DIR:
+            if ( RC_TRUE == is_a_directory( optarg, W_OK ) ) {
+                free (pa_opts->bg_cache_dir);
+                pa_opts->bg_cache_dir = strdup(optarg);
+            } else {
+                w.die = 1;
+                ERR_IGNORE( argv, optind, optarg, "Argument: is not a directory, does not exist, or write permission is denied.\n" );
+            }
+            break;
+        case ARG_TEXT_SIZE: {
+            char  str[ 4 ];
+            int   val;
+            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= 8 && val <= 120 ) {
+                pa_opts->text_size = val;
+            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 8 to 120.\n" );
+            } break;
+        case ARG_1A_ALPHA: {
+            char  alpha_1a[ sizeof ("00") ];
+            char  str[ 4 ];
+            if ( 1 == sscanf(optarg, "%2[0-9A-Fa-f]%3c", alpha_1a, str) && 2 == strlen(alpha_1a) ) {
+                for (size_t idx = 0; idx < (sizeof (alpha_1a) - 1); idx++ ) {
+                    alpha_1a[ idx ] = toupper(alpha_1a[ idx ]);
+                }
+                strcpy(pa_opts->alpha_1a, alpha_1a);
+            } else ERR_IGNORE( argv, optind, optarg, "String must be from '00' to 'FF'.\n" );
+            } break;
+        case ARG_1C_COLOUR: {
+            char  colour_1c[ sizeof ("080808") ];
+            char  str[ 4 ];
+            if ( 1 == sscanf(optarg, "%6[0-9A-Fa-f]%3c", colour_1c, str) && 6 == strlen(colour_1c) ) {
+                for (size_t idx = 0; idx < (sizeof (colour_1c) - 1); idx++ ) {
+                    colour_1c[ idx ] = toupper(colour_1c[ idx ]);
+                }
+                strcpy(pa_opts->colour_1c, colour_1c);
+            } else ERR_IGNORE( argv, optind, optarg, "String must be from '000000' to 'FFFFFF'.\n" );
+            } break;
+        case ARG_SED_SCRIPT_FILE:
+            if ( RC_FALSE == access_a_pathname( &pa_opts->sed_script_files, optarg ) ) {
+                fprintf(stderr, "ERROR :: can't access('%s').\n", optarg);
+                _exit(2);
+            }
+            break;
+        case ARG_IMAGE_PREFIX:
+            free (pa_opts->details.image_prefix);
+            pa_opts->details.image_prefix = strdup(optarg);
+            break;
+        case ARG_DEBUG_TEXT:
+            if ( RC_TRUE == is_a_directory( optarg, W_OK ) ) {
+                free (pa_opts->debug_text_dir);
+                pa_opts->debug_text_dir = strdup(optarg);
+            } else {
+                w.die = 1;
+                ERR_IGNORE( argv, optind, optarg, "Argument: is not a directory, does not exist, or write permission is denied.\n" );
+            }
+            break;
+        case ARG_DEBUG_WORK:
+            if ( RC_TRUE == is_a_directory( optarg, W_OK ) ) {
+                free (pa_opts->debug_work_dir);
+                pa_opts->debug_work_dir = strdup(optarg);
+            } else {
+                w.die = 1;
+                ERR_IGNORE( argv, optind, optarg, "Argument: is not a directory, does not exist, or write permission is denied.\n" );
+            }
+            break;
+        case ARG_DEST_DIR:
+            if ( RC_TRUE == is_a_directory( optarg, W_OK ) ) {
+                free (pa_opts->details.dest_dir);
+                pa_opts->details.dest_dir = strdup(optarg);
+            } else ERR_IGNORE( argv, optind, optarg, "Argument is not a directory, or write permission is denied.\n" );
+            break;
+        case ARG_CHOP_PREFIX:
+            free (pa_opts->chop_prefix);  /* SPACEs are okay in this option */
+            pa_opts->chop_prefix = strdup(optarg);
+            break;
+        case ARG_CHOP_CHARS: {
+            char  str[ 4 ];
+            int   val;
+            if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val >= 0 && val <= 12 ) {
+                pa_opts->chop_chars = val;
+            } else ERR_IGNORE( argv, optind, optarg, "Value must be from 0 to 12.\n" );
+            } break;
+        case ARG_ORIGINAL_DIR:
+            if ( RC_TRUE == is_a_directory( optarg, 0 ) ) {
+                free (pa_opts->original_dir);
+                pa_opts->original_dir = strdup(optarg);
+            } else ERR_IGNORE( argv, optind, optarg, "Argument is not a directory, or access is denied.\n" );
+            break;
+        case ARG_TEXT_FACE: {
+            char const *p;
+            if ( '\0' != *(p = zap_isspace( optarg )) ) {
+                free (pa_opts->text_face);
+                pa_opts->text_face = strdup(p);
+            } else ERR_IGNORE( argv, optind, optarg, "Font name is an EMPTY string.\n" );
+            } break;
+
+        case ARG_XY_FORMAT: {
+            pa_opts->xy_format = XY_PAGE_XofY;
+            enum { OPT_XY_PAGE_XofY = 0, OPT_XY_DECIMAL, OPT_XY_ROMAN };
+            static char *const token[] = {
+                [ OPT_XY_PAGE_XofY ] = "XofY",
+                [ OPT_XY_DECIMAL ]   = "decimal",
+                [ OPT_XY_ROMAN ]     = "roman",
+                NULL
+            };
+            int   errfnd = 0;  /* unused, for now */
+            char *value;
+            char *subopts = optarg;
+            while ( ('\0' != *subopts) && 0 == errfnd ) {
+                switch ( getsubopt(&subopts, token, &value) ) {
+                case OPT_XY_PAGE_XofY:
+                    pa_opts->xy_format = XY_PAGE_XofY;
+                    break;
+                case OPT_XY_DECIMAL:
+                    pa_opts->xy_format = XY_DECIMAL;
+                    break;
+                case OPT_XY_ROMAN:
+                    pa_opts->xy_format = XY_ROMAN;
+                    break;
+                default:
+                    ERR_IGNORE( argv, optind, optarg, "Unknown sub-option for argument.\n" );
+                }
+            }
+            } break;
+
+        case ARG_ATTR_EDITS: {
+            pa_opts->attr_edits = 0;
+            enum { OPT_AE_ALL = 0, OPT_AE_TWO_SPACES, OPT_AE_DOUBLE_DASH, OPT_AE_URBAN_WORDS,
+                   OPT_NO_ALL,     OPT_NO_TWO_SPACES, OPT_NO_DOUBLE_DASH, OPT_NO_URBAN_WORDS,
                    };
             static char *const token[] = {
-                [ OPT_AE_ALL         ] = "all",
-                [ OPT_AE_TWO_SPACES  ] = "two-spaces",
-                [ OPT_AE_DOUBLE_DASH ] = "double-dash",
-                [ OPT_AE_URBAN_WORDS ] = "urban-words",
+                [ OPT_AE_ALL         ] = "all",
+                [ OPT_AE_TWO_SPACES  ] = "two-spaces",
+                [ OPT_AE_DOUBLE_DASH ] = "double-dash",
+                [ OPT_AE_URBAN_WORDS ] = "urban-words",
+
+                [ OPT_NO_ALL         ] = "none",
+                [ OPT_NO_TWO_SPACES  ] = "!two-spaces",
+                [ OPT_NO_DOUBLE_DASH ] = "!double-dash",
+                [ OPT_NO_URBAN_WORDS ] = "!urban-words",
+                NULL
+            };
+            static unsigned short ae_vals[] = {
+                    AE_ALL,
+                      AE_TWO_SPACES,  AE_DOUBLE_DASH,  AE_URBAN_WORDS,
+                    0,
+                     ~AE_TWO_SPACES, ~AE_DOUBLE_DASH, ~AE_URBAN_WORDS,
+                };
+            int   errfnd = 0;  /* unused, for now */
+            char *value;
+            char *subopts = optarg;
+            while ( ('\0' != *subopts) && 0 == errfnd ) {
+                int subopt = getsubopt(&subopts, token, &value);
+                switch ( subopt ) {
+                case OPT_AE_ALL:
+                case OPT_AE_TWO_SPACES:
+                case OPT_AE_DOUBLE_DASH:
+                case OPT_AE_URBAN_WORDS:
+                    pa_opts->attr_edits |= ae_vals[ subopt ];
+                    break;
+                case OPT_NO_ALL:
+                case OPT_NO_TWO_SPACES:
+                case OPT_NO_DOUBLE_DASH:
+                case OPT_NO_URBAN_WORDS:
+                    pa_opts->attr_edits &= ae_vals[ subopt ];
+                    break;
+                default:
+                    ERR_IGNORE( argv, optind, optarg, "Unknown sub-option for argument.\n" );
+                }
+            }
+            } break;
+
+        case ARG_ASS_CACHE: {
+            /*
+             *******************************************************************
+             * --ass-cache=glyphs=N,bitmaps=MB :: the libass glyph cache count
+             * and bitmap cache size (in MB).  A 0 uses the libass default.
+             */
+            enum { OPT_AC_GLYPHS = 0, OPT_AC_BITMAPS };
+            static char *const token[] = {
+                [ OPT_AC_GLYPHS  ] = "glyphs",
+                [ OPT_AC_BITMAPS ] = "bitmaps",
+                NULL
+            };
+            int   errfnd = 0;  /* unused, for now */
+            char *value;
+            char *subopts = optarg;
+            while ( ('\0' != *subopts) && 0 == errfnd ) {
+                char  str[ 4 ];
+                int   val;
+                int   subopt = getsubopt(&subopts, token, &value);
+                switch ( subopt ) {
+                case OPT_AC_GLYPHS:
+                    if ( NULL != value && 1 == sscanf(value, "%d%3c", &val, str) && val >= 0 && val <= 1000000 ) {
+                        pa_opts->ass_glyph_max = val;
+                    } else ERR_IGNORE( argv, optind, optarg, "'glyphs' must be from 0 to 1000000.\n" );
+                    break;
+                case OPT_AC_BITMAPS:
+                    if ( NULL != value && 1 == sscanf(value, "%d%3c", &val, str) && val >= 0 && val <= 4096 ) {
+                        pa_opts->ass_bitmap_max_mb = val;
+                    } else ERR_IGNORE( argv, optind, optarg, "'bitmaps' must be from 0 to 4096 (MB).\n" );
+                    break;
+                default:
+                    ERR_IGNORE( argv, optind, optarg, "Unknown sub-option for argument.\n" );
+                }
+            }
+            } break;
+
+        case ARG_FOLD_SEARCH: {
+            enum { OPT_FS_GALLOP = 0, OPT_FS_LINEAR };
+            static char *const token[] = {
+                [ OPT_FS_GALLOP ] = "gallop",
+                [ OPT_FS_LINEAR ] = "linear",
+                NULL
+            };
+            int   errfnd = 0;  /* unused, for now */
+            char *value;
+            char *subopts = optarg;
+            while ( ('\0' != *subopts) && 0 == errfnd ) {
+                switch ( getsubopt(&subopts, token, &value) ) {
+                case OPT_FS_GALLOP:
+                    pa_opts->fold_search = FOLD_SEARCH_GALLOP;
+                    break;
+                case OPT_FS_LINEAR:
+                    pa_opts->fold_search = FOLD_SEARCH_LINEAR;
+                    break;
+                default:
+                    ERR_IGNORE( argv, optind, optarg, "Unknown sub-option for argument.\n" );
+                }
+            }
+            } break;
+
+        case ARG_SINGLE_PASS:
+            pa_opts->single_pass = 1;
+            break;
+
+        case ARG_PAGINATE_ONLY:
+            if ( NULL == optarg || STR_MATCH == strcmp(optarg, "tsv") ) {
+                pa_opts->paginate_only = PAGE_MAP_TSV;
+            }
+            else if ( STR_MATCH == strcmp(optarg, "json") ) {
+                pa_opts->paginate_only = PAGE_MAP_JSON;
+            } else ERR_IGNORE( argv, optind, optarg, "The page map format must be 'tsv' or 'json'.\n" );
+            break;
+
+        case ARG_FOLD_MEASURE:
+            if ( STR_MATCH == strcmp(optarg, "off") ) {
+                pa_opts->fold_measure = FOLD_MEASURE_OFF;
+            }
+            else if ( STR_MATCH == strcmp(optarg, "hint") ) {
+                pa_opts->fold_measure = FOLD_MEASURE_HINT;
+            }
+            else if ( STR_MATCH == strcmp(optarg, "verify") ) {
+                pa_opts->fold_measure = FOLD_MEASURE_VERIFY;
+            } else ERR_IGNORE( argv, optind, optarg, "The fold measure must be 'off', 'hint' or 'verify'.\n" );
+#if !defined(ENABLE_FT_MEASURE)
+            if ( FOLD_MEASURE_OFF != pa_opts->fold_measure ) {
+                pa_opts->fold_measure = FOLD_MEASURE_OFF;
+                ERR_IGNORE( argv, optind, optarg, "Not built with -DENABLE_FT_MEASURE.\n" );
+            }
+#endif
+            break;
+
+        case ARG_SED:
+            if ( STR_MATCH == strcmp(optarg, "builtin") ) {
+                pa_opts->sed_engine = SED_ENGINE_BUILTIN;
+            }
+            else if ( STR_MATCH == strcmp(optarg, "external") ) {
+                pa_opts->sed_engine = SED_ENGINE_EXTERNAL;
+            }
+            else if ( STR_MATCH == strcmp(optarg, "verify") ) {
+                pa_opts->sed_engine = SED_ENGINE_VERIFY;
+            } else ERR_IGNORE( argv, optind, optarg, "The sed must be 'builtin', 'external' or 'verify'.\n" );
+            break;
+
+        case ARG_BACKGROUND_FILTER: {
+                /**************************************************************
+                 * 'none' or 'colorize=COLOUR:PERCENT%' (the '%' is optional),
+                 * where COLOUR is 'grey' (X11's, like ImageMagick's), 'white',
+                 * 'black' or 'RRGGBB'.  The demo's 'colorize=grey:85%' is
+                 * 'convert -fill grey -colorize 85%'.
+                 */
+            char      colour[ sizeof ("080808") ];
+            unsigned  val;
+            unsigned  rgb;
+            int       len = 0;
+            if ( STR_MATCH == strcmp(optarg, "none") ) {
+                pa_opts->bg_filter.colorize = 0;
+            }
+            else if ( 2 == sscanf(optarg, "colorize=%6[0-9A-Za-z]:%u%n", colour, &val, &len)
+                   && (STR_MATCH == strcmp(optarg + len, "") || STR_MATCH == strcmp(optarg + len, "%")) ) {
+                if ( STR_MATCH == strcasecmp(colour, "grey") || STR_MATCH == strcasecmp(colour, "gray") ) {
+                    rgb = 0xBEBEBE;
+                }
+                else if ( STR_MATCH == strcasecmp(colour, "white") ) {
+                    rgb = 0xFFFFFF;
+                }
+                else if ( STR_MATCH == strcasecmp(colour, "black") ) {
+                    rgb = 0x000000;
+                }
+                else if ( 6 == strlen(colour) && 6 == strspn(colour, "0123456789ABCDEFabcdef") ) {
+                    rgb = strtoul(colour, NULL, 16);
+                }
+                else {
+                    ERR_IGNORE( argv, optind, optarg, "The colour must be 'grey', 'white', 'black' or from '000000' to 'FFFFFF'.\n" );
+                    break;
+                }
+                if ( val > 100 ) {
+                    ERR_IGNORE( argv, optind, optarg, "The percent must be from 0 to 100.\n" );
+                    break;
+                }
+                pa_opts->bg_filter = (bg_filter_t) {
+                    .colorize = val,
+                    .rgb      = { rgb >> 16, (rgb >> 8) & 0xFF, rgb & 0xFF },
+                };
+            } else ERR_IGNORE( argv, optind, optarg, "The filter must be 'none' or 'colorize=COLOUR:PERCENT%%'.\n" );
+            } break;
+
+        case ARG_URL_ZWSP:
+                /**************************************************************
+                 * TODO :: The optional argument is a list of characters to
+                 *         add a "zero-width" SPACE _after_.  Note too, that
+                 *         libass doesn't fully support the ZWSP character,
+                 *         so what we actually insert is '{\fs1} {\fs}'.
+                 *         The default character is '/'.
+                 */
+            pa_opts->url_zwsp = 1;
+            break;
+        case ARG_REMOVE_DUP_GROUP_SPACES:
+            pa_opts->remove_dup_group_spaces = 1;
+            break;
+        case ARG_REMOVE_DUP_GROUPS: {
+            char  str[ 4 ];
+            int   val;
+            if ( NULL != optarg ) {
+                if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val > 0 && val <= 12 ) {
+                    pa_opts->remove_dup_groups = val;
+                } else ERR_IGNORE( argv, optind, optarg, "Value must be from 1 to 12 (inclusive).\n" );
+            }
+            else pa_opts->remove_dup_groups = 3;  // TODO :: "default" not implemented.
+            } break;
+        case ARG_VERBOSE_QUIET:
+            pa_opts->verbose_level = VERBOSE_QUIET;
+            break;
+        case ARG_VERSION:
+            fprintf(stderr, "%s%s\n", pa_opts->png_Software,
+                   PA_BUILT_OPTIMIZED ? " (gcc optimizing compilation)" : " (unoptimized)"
+                );
+            _exit(0);
+        default:
+            fprintf(stderr, "ERROR - option '%s' NOT handled in switch.\n", argv[ optind - 1 ]);
+            _exit(2);
+        }
+
+    }
+
+    if ( 1 == w.die ) {
+        fprintf(stderr, "Exiting due to unrecoverable command line error(s)\n");
+        _exit( 1 );
+    }
+    post_opt_defaults( pa_opts );
+    pa_verify_opts( pa_opts );
+
+
+    return ( 0 );
+}
+
+
+/**
+ *******************************************************************************
+ */
+static void set_opt_defaults(pa_opts_t *pa_opts)
+{
+
+    /*
+     ***************************************************************************
+     * These are *probably* not needed; thinking I'll get them from PNG (iow,
+     * is there a value in using different values than indicated by the PNG)?
+     */
+    pa_opts->png_width = 1920;
+    pa_opts->png_height = 1080;
+
+    pa_opts->jpeg_quality = 95;  /* Set to write a high quality JPEG file */
+    pa_opts->line_spacing = 0.0;
+
+    pa_opts->verbose_level = VERBOSE_1;
+    pa_opts->xy_format = XY_PAGE_XofY;
+
+    pa_opts->text_size = 40;  /* text_size == 0 causes libass infinite loop */
+    pa_opts->text_face = strdup("Arial");
+    strcpy(pa_opts->alpha_1a, "00");       /* Default :: Opaque text */
+    strcpy(pa_opts->colour_1c, "080808");  /* Default :: Almost black text */
+
+    pa_opts->details.image_prefix = strdup("p");
+
+    pa_opts->details.dest_dir = NULL;      /* USER MUST PROVIDE */
+    strcpy(pa_opts->details.image_type, "jpg");
+
+    pa_opts->margin_bottom = PA_UNSET_VALUE;
+    pa_opts->pixel_fudge   = PA_UNSET_VALUE;
+
+    pa_opts->chop_prefix = NULL;
+    pa_opts->chop_chars = 0;
+    pa_opts->original_dir = NULL;
+    pa_opts->in_png_frames = NULL;         /* Probed once the options are known */
+
+    pa_opts->fold_search = FOLD_SEARCH_LINEAR;
+    pa_opts->fold_hint = 0;
+    pa_opts->fold_measure = FOLD_MEASURE_OFF;
+    pa_opts->fold_measure_scale = 1.0;
+    pa_opts->pa_measure = NULL;            /* Built once the options are known */
+    pa_opts->single_pass = 0;
+    pa_opts->held_text = NULL;             /* Opened once the options are known */
+    pa_opts->paginate_only = PAGE_MAP_NONE;
+
+    pa_opts->sed_engine = SED_ENGINE_BUILTIN;
+    pa_opts->pa_sed = NULL;                /* Built once the options are known */
+
+    pa_opts->pa_render = NULL;             /* Built once the options are known */
+    pa_opts->ass_glyph_max = 0;
+    pa_opts->ass_bitmap_max_mb = 0;
+
+    pa_opts->bgcache = NULL;               /* Built once the options are known */
+    pa_opts->bg_cache_mb = PA_BGCACHE_DEFAULT_MB;
+    pa_opts->bg_filter = (bg_filter_t) { .colorize = 0, };
+    pa_opts->bg_cache_dir = NULL;
+    pa_opts->prefetch = 0;
+    pa_opts->prefetch_mb = PA_PREFETCH_DEFAULT_MB;
+
+    pa_opts->jobs = 1;
+
+    pa_opts->encoder = NULL;               /* Built once the options are known */
+    pa_opts->encode_threads = PA_ENCODER_DEFAULT_THREADS;
+
+    pa_opts->stats = NULL;                 /* Built once the options are known */
+    pa_opts->stats_json = NULL;
+    pa_opts->fold_cache_dir = NULL;
+    pa_opts->fold_key = 0;
+    pa_opts->fold_frames_vary = 0;
+
+    pa_opts->png_Software = get_Software();
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * Set post-option defaults that depend on other command line options.
+ */
+static void O3 post_opt_defaults(pa_opts_t *pa_opts)
+{
+
+    if ( PA_UNSET_VALUE == pa_opts->margin_bottom ) {
+        double font_size = pa_opts->text_size;
+        double margin_bottom = font_size * 0.2;
+        pa_opts->margin_bottom = margin_bottom;
+    }
+
+    if ( pa_opts->verbose_level > VERBOSE_QUIET )
+    if ( NULL != pa_opts->original_dir ) {
+        fprintf(stderr, "Getting meta-data from matching images in '%s'.\n", pa_opts->original_dir);
+    }
+
+    if ( PA_UNSET_VALUE == pa_opts->pixel_fudge ) {
+        pa_opts->pixel_fudge = (pa_opts->text_size * 100) / 1000;
+        if ( pa_opts->pixel_fudge < ONE_PIXELs_FUDGE ) {
+            pa_opts->pixel_fudge = ONE_PIXELs_FUDGE;
+        }
+    }
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+static void cleanup_pa_opts( pa_opts_t **p_pa_opts )
+{
+    pa_opts_t *pa_opts = *p_pa_opts;
+
+    if ( NULL != pa_opts->text_templates ) {
+        for ( size_t idx = 0; idx < pa_opts->templates.cnt; idx++ ) {
+            cleanup_pa_template( &pa_opts->text_templates[ idx ] );
+        }
+        (free)( pa_opts->text_templates );
+    }
+    cleanup_pa_template( &pa_opts->header_compiled );
+
+    cleanup_strptrary( &pa_opts->templates );
+    cleanup_strptrary( &pa_opts->in_chapters );
+    cleanup_strptrary( &pa_opts->font_dirs );
+    if ( NULL != pa_opts->in_png_frames ) {
+        for ( size_t idx = 0; idx < pa_opts->in_png_list.cnt; idx++ ) {
+            cleanup_pa_image( &pa_opts->in_png_frames[ idx ] );
+        }
+        (free)( pa_opts->in_png_frames );
+    }
+    cleanup_strptrary( &pa_opts->in_png_list );
+    cleanup_strptrary( &pa_opts->header_template );
+    cleanup_strptrary( &pa_opts->sed_script_files );
+    cleanup_pa_sed( &pa_opts->pa_sed );
+
+    cleanup_details  ( &pa_opts->details );
+    cleanup_pa_render( &pa_opts->pa_render );
+    cleanup_pa_measure( &pa_opts->pa_measure );
+    cleanup_pa_encoder( &pa_opts->encoder );   /* before the image pool */
+    cleanup_pa_stats( &pa_opts->stats );       /* ... and after the encoders */
+    cleanup_pa_bgcache( &pa_opts->bgcache );
+    cleanup_image_pool();
+    if ( NULL != pa_opts->held_text ) {
+        fclose( pa_opts->held_text );
+        pa_opts->held_text = NULL;
+    }
+
+    (free)( (void *) pa_opts->chop_prefix );
+    (free)( (void *) pa_opts->original_dir );
+    (free)( (void *) pa_opts->text_face );
+
+    (free)( (void *) pa_opts->debug_text_dir );
+    (free)( (void *) pa_opts->debug_work_dir );
+    (free)( (void *) pa_opts->stats_json );
+    (free)( (void *) pa_opts->fold_cache_dir );
+    (free)( (void *) pa_opts->bg_cache_dir );
+
+    free( *p_pa_opts );
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+static void cleanup_details( details_t *details )
+{
 
-                [ OPT_NO_ALL         ] = "none",
-                [ OPT_NO_TWO_SPACES  ] = "!two-spaces",
-                [ OPT_NO_DOUBLE_DASH ] = "!double-dash",
-                [ OPT_NO_URBAN_WORDS ] = "!urban-words",
-                NULL
-            };
-            static unsigned short ae_vals[] = {
-                    AE_ALL,
-                      AE_TWO_SPACES,  AE_DOUBLE_DASH,  AE_URBAN_WORDS,
-                    0,
-                     ~AE_TWO_SPACES, ~AE_DOUBLE_DASH, ~AE_URBAN_WORDS,
-                };
-            int   errfnd = 0;  /* unused, for now */
-            char *value;
-            char *subopts = optarg;
-            while ( ('\0' != *subopts) && 0 == errfnd ) {
-                int subopt = getsubopt(&subopts, token, &value);
-                switch ( subopt ) {
-                case OPT_AE_ALL:
-                case OPT_AE_TWO_SPACES:
-                case OPT_AE_DOUBLE_DASH:
-                case OPT_AE_URBAN_WORDS:
-                    pa_opts->attr_edits |= ae_vals[ subopt ];
-                    break;
-                case OPT_NO_ALL:
-                case OPT_NO_TWO_SPACES:
-                case OPT_NO_DOUBLE_DASH:
-                case OPT_NO_URBAN_WORDS:
-                    pa_opts->attr_edits &= ae_vals[ subopt ];
-                    break;
-                default:
-                    ERR_IGNORE( argv, optind, optarg, "Unknown sub-option for argument.\n" );
-                }
-            }
-            } break;
+    free( details->png_Title );
+    free( details->dest_dir );
+    free( details->image_prefix );
 
-        case ARG_URL_ZWSP:
-                /**************************************************************
-                 * TODO :: The optional argument is a list of characters to
-                 *         add a "zero-width" SPACE _after_.  Note too, that
-                 *         libass doesn't fully support the ZWSP character,
-                 *         so what we actually insert is '{\fs1} {\fs}'.
-                 *         The default character is '/'.
-                 */
-            pa_opts->url_zwsp = 1;
-            break;
-        case ARG_REMOVE_DUP_GROUP_SPACES:
-            pa_opts->remove_dup_group_spaces = 1;
-            break;
-        case ARG_REMOVE_DUP_GROUPS: {
-            char  str[ 4 ];
-            int   val;
-            if ( NULL != optarg ) {
-                if ( 1 == sscanf(optarg, "%d%3c", &val, str) && val > 0 && val <= 12 ) {
-                    pa_opts->remove_dup_groups = val;
-                } else ERR_IGNORE( argv, optind, optarg, "Value must be from 1 to 12 (inclusive).\n" );
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * Gawd - I can't think of an easier way to solve this.  I'm trying to render
+ *        as much text as possible before splitting the string.  There doesn't
+ *        seem to be a trivial way to do this...
+ *
+ * We want to incrementally build a 'Events:Text' string that will change each
+ * time it is rendered by 'ass_render_frame()'.  For each successive render,
+ * if the current render matches the previous render, then we know the previous
+ * render is the maximum text that can be consumed for that template.
+ *
+ * For the previous render, we only need to save the position in 'work_text'
+ * (there may be other things like character attributes, but that complexity
+ * can be added at a later date).
+ *
+ * The 'work_text' blob has been pre-processed by 'make_work_text()' such
+ * that its initial state is TEXT token, and we call 'skip_non_text_tokens()'
+ * after each template iteration to ensure that the initial state is _always_
+ * TEXT token for the remaining text.
+ *
+ * The libass documentation is unclear (even if I look at the source that's
+ * no assurance that it wouldn't change between versions) about the lifetime
+ * of an ASS_Image from ass_render_frame().
+ *
+ * TODO :: We might split in the middle of a font attribute (bold, italic, etc.)
+ *         so we need a way to handle that (s/b pretty rare, but it can happen).
+ */
+static void O0 apply_template_complex( pa_image_t *pa_image, pa_opts_t *pa_opts, pa_template_t const *const template, char *const work_text, work_index_t const *work_index, text_segments_t *const text_segments, size_t template_idx, pa_counts_t *counts )
+{
+#undef IS_FOLD_PASS_1
+#define IS_FOLD_PASS_1  ( FOLD_PASS_1 == pa_opts->fold_pass )
+#undef IS_FOLD_PASS_2
+#define IS_FOLD_PASS_2  ( FOLD_PASS_2 == pa_opts->fold_pass )
+    struct {
+        text_track_t track;     /* the template's track in the image's frame */
+
+        pa_template_t const *const template;
+        char const  *work_text_2;
+        unsigned int work_text_idx;
+        unsigned int work_text_delta;
+        size_t       good_work_text_idx;  /* Start of last token, not SPACE */
+
+        ASS_Image   *img_curr;  /* returned from 'ass_render_frame()' */
+        pa_ass_t     img_prev;  /* saved fields from last ASS_Image in array */
+        int          clipped;   /* Set if the last ASS_Image was clipped. */
+
+        int          width;
+        int          height;
+        int          text_size;
+        int          folded;    /* Set when PASS 1 found the template's break */
+
+        fold_probe_t  probe;    /* '--fold-search=gallop' state */
+        fold_tokens_t tokens;
+        unsigned int  k_lo;     /* # of tokens the gallop search says fit */
+        unsigned int  k;        /* # of tokens in the token-by-token render */
+        unsigned int  measured; /* ... and that '--fold-measure' predicted */
+        rc_e          measured_rc;
+
+        int           fit_valid;  /* '--single-pass' :: the last render in the */
+        ASS_Image    *fit_img;    /* image's frame, while its ASS_Images are   */
+        unsigned int  fit_len;    /* still valid (i.e., 'fit_valid' is set)    */
+
+        short        dbg_pieces;
+        ass_cmpr_e   rc;
+        uint64_t     start_ns;  /* for '--stats-json' */
+        pa_counts_t  counts;    /* ditto, and the verbose output */
+    } w = {
+        .img_curr      = NULL,
+        .template      = template,
+        .counts        = { { 0 } },
+        .start_ns      = get_monotonic_ns(),
+
+        .work_text_idx = 0,                /*+*/
+        .width         = get_image_width( pa_image ),
+        .height        = get_image_height( pa_image ),
+        .text_size     = pa_opts->text_size,
+        .clipped       = 0,
+        .folded        = 0,
+        .k_lo          = 0,
+        .measured      = 0,
+        .measured_rc   = RC_FALSE,
+
+        .img_prev.pieces       = 0,
+        .img_prev.piece_starts = NULL,
+
+        .tokens.ends   = NULL,
+
+        .fit_valid     = 0,
+        .probe.tall.ass_track = NULL,
+    };
+
+
+    ASS_Library  *ass_library  = get_render_library( pa_opts->pa_render );
+    ASS_Renderer *ass_renderer = get_render_renderer( pa_opts->pa_render, w.width, w.height, pa_opts->line_spacing );  /* Works as expected :) */
+
+    w.track = (text_track_t) {
+        .pa_opts     = pa_opts,
+        .template    = w.template,
+        .ass_library = ass_library,
+        .width       = w.width,
+        .height      = w.height,
+        .counts      = &w.counts,
+    };
+
+    /*
+     ***************************************************************************
+     * This is the FIRST PASS of folding / fitting the text onto one or more
+     * PNG images.  We'll start at the "top" of the page, so we'll skip any
+     * SPACE above the first printable string.
+     */
+    w.work_text_2 = work_text + text_segments->text_start_idx;
+
+    if ( IS_FIT_PASS( pa_opts->fold_pass ) ) {
+
+    fold_tokens_init( &w.tokens, work_index, text_segments->text_start_idx );
+
+    if ( NULL != pa_opts->pa_measure ) {
+        w.measured_rc = measure_fold_tokens( &w.track, &w.tokens, w.work_text_2, &w.measured );
+    }
+
+    /*
+     ***************************************************************************
+     * With '--fold-search=gallop', skip over the tokens that are known to fit
+     * and pick up the token-by-token search just before the break.  Note, the
+     * 'piece_starts' of the skipped ASS_Images are resolved on demand (only
+     * a clipped line's ASS_Images are ever walked back to).
+     */
+    if ( FOLD_SEARCH_GALLOP == pa_opts->fold_search ) {
+        w.probe = (fold_probe_t) {
+            .pa_opts       = pa_opts,
+            .template      = w.template,
+            .work_text_2   = w.work_text_2,
+            .ass_library   = ass_library,
+            .ass_renderer  = ass_renderer,
+            .tall_renderer = get_render_renderer( pa_opts->pa_render, w.width, FOLD_TALL_FRAME( w.height ), pa_opts->line_spacing ),
+            .tall          = (text_track_t) {
+                .pa_opts     = pa_opts,
+                .template    = w.template,
+                .ass_library = ass_library,
+                .width       = w.width,
+                .height      = FOLD_TALL_FRAME( w.height ),
+                .counts      = &w.counts,
+            },
+            .width         = w.width,
+            .height        = w.height,
+            .bottom        = w.height - pa_opts->margin_bottom,
+        };
+
+        w.k_lo = gallop_fold_search( &w.probe, &w.tokens, &w.img_prev,
+                                     (unsigned int) (w.measured * pa_opts->fold_measure_scale + 0.5) );
+        w.work_text_idx = w.good_work_text_idx = w.tokens.ends[ w.k_lo ];
+    }
+    w.k = w.k_lo;
+
+    while ( '\0' != *(w.work_text_2 + w.work_text_idx) ) {
+
+        w.img_prev.token_start_idx = w.work_text_idx;
+
+        //-g BREAK_STR((w.work_text_2 + w.work_text_idx), "If yo face");
+
+        /*
+         ***********************************************************************
+         * Add the next token, including any trailing white SPACE after it.
+         */
+        w.k = fold_tokens_ensure( &w.tokens, w.work_text_2, w.k + 1 );
+        w.work_text_idx = w.tokens.ends[ w.k ];
+
+        ASS_Track *ass_track = set_text_track( &w.track, w.work_text_idx, w.work_text_2 );
+        w.img_curr = ass_render_frame( ass_renderer, ass_track, 0LL, NULL );
+        w.counts.n[ PA_COUNT_RENDERS ]++;
+
+        w.dbg_pieces = COUNT_ASS_Images(w.img_curr);    /* DBG */
+        if ( w.k_lo ) {
+            resolve_piece_starts( &w.probe, &w.tokens, &w.img_prev, w.img_curr, pa_opts->pixel_fudge, w.k_lo );
+        }
+        w.rc = cmpr_last_ASS_Image( &w.img_prev, w.img_curr, w.height - pa_opts->margin_bottom, pa_opts->pixel_fudge, w.work_text_2, &w.counts );
+
+        /*
+         ***********************************************************************
+         * '--single-pass' :: this render may be exactly the text that fits.
+         */
+        w.fit_valid = 1;
+        w.fit_img   = w.img_curr;
+        w.fit_len   = w.work_text_idx;
+
+        /*
+         ***************************************************************************
+         * Okay, this time for sure.  There's no bullet proof way to handle this
+         * as I've done several buggy previous versions.  The basic problem is to
+         * detect when an added token is really off the page, or wholly consists of
+         * non-rendering characters.  The idea of watching the count of ASS_Images
+         * is close, except for this case -- I can't tell the difference between
+         * off image and not rendered for the last token added to the 'ass_track'.
+         *
+         * Trying to match up X and Y coordinates, width and height makes for a
+         * complex solution that may still have some issues given how libass
+         * renders its ASS_Images.
+         *
+         * So, the idea is this - if I see the ASS_TRY_SANDBOX_TOKEN result code,
+         * I'll perform a sample render with just that last token in a "sandbox."
+         * If it still produces no ASS_Image(s), then I'll _know_ that it's all
+         * non-rendering characters and will continue trudging along.  If it does
+         * render, then it's truly off the image and we're done with the template.
+         *
+         * I don't think this is fool-proof, but the results are much better.
+         */
+        if ( ASS_TRY_SANDBOX_TOKEN == w.rc ) {
+            ass_track = set_text_track( &w.track, w.work_text_idx - w.good_work_text_idx, w.work_text_2 + w.good_work_text_idx );
+            w.img_curr = ass_render_frame( ass_renderer, ass_track, 0LL, NULL );
+            w.counts.n[ PA_COUNT_RENDERS ]++;
+            w.counts.n[ PA_COUNT_SANDBOX ]++;
+
+            w.fit_valid = 0;   /* its ASS_Images are gone now */
+
+            if ( NULL == w.img_curr ) {
+                w.rc = ASS_IN_IMAGE;
             }
-            else pa_opts->remove_dup_groups = 3;  // TODO :: "default" not implemented.
-            } break;
-        case ARG_VERBOSE_QUIET:
-            pa_opts->verbose_level = VERBOSE_QUIET;
+        }
+        else if ( ASS_DROPPED == w.rc ) {
+            /* FIXME :: Still need to do something ... TODO */
+            fprintf(stderr, "OOPS -- ASS_DROPPED returned!!!!!!!!\n");
+            w.counts.n[ PA_COUNT_DROPPED ]++;
+        }
+        else if ( ASS_LAST_IS_CLIPPED == w.rc ) {
+            w.counts.n[ PA_COUNT_CLIPPED ]++;
+        }
+
+        /**
+         ***************************************************************************
+         ***************************************************************************
+         * See if we've consumed the maximum amount of text for this template,
+         * and return the index for how far we advanced.  There are 3 cases:
+         *
+         * - the last segment did not render because it's completely off of the
+         *   PNG's bitmap field -- we'll blend the whole ASS_Image list;
+         * - the last segment in the ASS_Image list was clipped.  We'll blend
+         *   all but the last ASS_Image in the list, and continue on next page;
+         * - we exhausted the entire string (indicated by reaching the '\0'),
+         *   we'll blend the whole ASS_Image list.
+         * NOTE - The test order in this if(...) is important!  See 'git log'.
+         */
+        if (   (ASS_TRY_SANDBOX_TOKEN == w.rc)                             /*+*/
+            || (ASS_LAST_IS_CLIPPED == w.rc
+                 && (w.clipped = 1)
+                 && (w.good_work_text_idx = w.img_prev.token_start_idx))   /*+*/
+            || ('\0' == *(w.work_text_2 + w.work_text_idx)
+                 && (w.good_work_text_idx = w.work_text_idx))              /*+*/
+           ) {
+
+            fprintf(stderr, "PASS #1 :: %lu bytes comsumed ...\n", w.good_work_text_idx);
+
+            text_segments->work_text_delta = w.good_work_text_idx;
+            text_segments->clipped = w.clipped;
+            text_segments->pieces = w.img_prev.pieces;
+
+            w.folded = 1;
             break;
-        case ARG_VERSION:
-            fprintf(stderr, "%s%s\n", pa_opts->png_Software,
-                   PA_BUILT_OPTIMIZED ? " (gcc optimizing compilation)" : " (unoptimized)"
-                );
-            _exit(0);
-        default:
-            fprintf(stderr, "ERROR - option '%s' NOT handled in switch.\n", argv[ optind - 1 ]);
-            _exit(2);
         }
+        else if ( ASS_NO_IMAGE_ERROR == w.rc ) {
+            break_me("Detected :: ASS_NO_IMAGE_ERROR ...");
+        }
+
+        w.good_work_text_idx = w.work_text_idx;
+
+        //-g BREAK_STR((w.work_text_2 + w.work_text_idx), "[Magic] and [Skill] are blank");
+    }
+
+    /*
+     ***************************************************************************
+     * The gallop search can consume the whole remainder of the text on its own
+     * (usually the last page of a chapter), so there's no token-by-token step.
+     */
+    if ( 0 == w.folded ) {
+        fprintf(stderr, "PASS #1 :: %lu bytes comsumed ...\n", w.good_work_text_idx);
 
+        text_segments->work_text_delta = w.good_work_text_idx;
+        text_segments->clipped = 0;
+        text_segments->pieces = w.img_prev.pieces;
     }
+    add_page_time( pa_opts->stats, PAGE_ID( pa_opts ), PA_PHASE_FOLD, get_monotonic_ns() - w.start_ns );
 
-    if ( 1 == w.die ) {
-        fprintf(stderr, "Exiting due to unrecoverable command line error(s)\n");
-        _exit( 1 );
-    }
-    post_opt_defaults( pa_opts );
-    pa_verify_opts( pa_opts );
+    w.counts.n[ PA_COUNT_TOKENS ] += fold_tokens_count( &w.tokens, w.work_text_2, text_segments->work_text_delta );
 
+    if ( RC_TRUE == w.measured_rc ) {
+        int off = (int) w.measured - (int) w.counts.n[ PA_COUNT_TOKENS ];
 
-    return ( 0 );
-}
+        w.counts.n[ PA_COUNT_MEASURED ]++;
+        w.counts.n[ PA_COUNT_MEASURE_HIT ] += (0 == off);
+        w.counts.n[ PA_COUNT_MEASURE_OFF ] += (off < 0) ? -off : off;
 
+        /*
+         * The layout misses by about the same ratio from page to page (the
+         * kerning, the glyphs' ink, etc.), so the next hint is corrected.
+         */
+        if ( w.measured && w.counts.n[ PA_COUNT_TOKENS ] ) {
+            pa_opts->fold_measure_scale = (double) w.counts.n[ PA_COUNT_TOKENS ] / w.measured;
+        }
 
-/**
- *******************************************************************************
- */
-static void set_opt_defaults(pa_opts_t *pa_opts)
-{
+        if ( FOLD_MEASURE_VERIFY == pa_opts->fold_measure ) {
+            fprintf(stderr, "MEASURE :: PAGE %lu, TEMPLATE %lu :: %u tokens predicted, %lu fit (%+d)\n",
+                            pa_opts->details.chapter_image_number, template_idx + 1,
+                            w.measured, (unsigned long) w.counts.n[ PA_COUNT_TOKENS ], off);
+        }
+    }
 
     /*
      ***************************************************************************
-     * These are *probably* not needed; thinking I'll get them from PNG (iow,
-     * is there a value in using different values than indicated by the PNG)?
+     * With '--single-pass', hold the text that fits right now (it's blended
+     * once the header's on the page, see 'save_held_pages()').  If the last
+     * render in either frame was of exactly that text, then hold its
+     * ASS_Images (a tall frame render of text that fits is the same as the
+     * image's), otherwise render it one more time.  Only a tall render that
+     * 'fits()' accepted is held -- 'blend_pa_image()' doesn't clip, and the
+     * last probe could've been one that ran off of the bottom.
      */
-    pa_opts->png_width = 1920;
-    pa_opts->png_height = 1080;
+    if ( FOLD_PASS_SINGLE == pa_opts->fold_pass ) {
+        w.work_text_delta = text_segments->work_text_delta;
+        if ( w.fit_valid && w.fit_len == w.work_text_delta ) {
+            w.img_curr = w.fit_img;
+        }
+        else if ( NULL != w.probe.tall.ass_track && w.probe.tall_fit && w.probe.tall_len == w.work_text_delta ) {
+            w.img_curr = w.probe.tall_img;
+        }
+        else {
+            w.start_ns = get_monotonic_ns();
+            ASS_Track *ass_track = set_text_track( &w.track, w.work_text_delta, w.work_text_2 );
+            w.img_curr = ass_render_frame( ass_renderer, ass_track, 0LL, NULL );
+            w.counts.n[ PA_COUNT_RENDERS ]++;
+            add_page_time( pa_opts->stats, PAGE_ID( pa_opts ), PA_PHASE_RENDER, get_monotonic_ns() - w.start_ns );
+        }
 
-    pa_opts->jpeg_quality = 95;  /* Set to write a high quality JPEG file */
-    pa_opts->line_spacing = 0.0;
+        int  pieces = hold_text_layer( pa_opts->held_text, w.img_curr );
 
-    pa_opts->verbose_level = VERBOSE_1;
-    pa_opts->xy_format = XY_PAGE_XofY;
+        fprintf(stderr, "PASS #2 :: %u bytes for %d PIECES%s.\n", text_segments->work_text_delta,
+                        pieces, text_segments->clipped ? " (CLIPPED)" : "");
+        fprintf(stderr, "%.*s\n", (int) text_segments->work_text_delta, w.work_text_2);  fflush( stderr );
+    }
 
-    pa_opts->text_size = 40;  /* text_size == 0 causes libass infinite loop */
-    pa_opts->text_face = strdup("Arial");
-    strcpy(pa_opts->alpha_1a, "00");       /* Default :: Opaque text */
-    strcpy(pa_opts->colour_1c, "080808");  /* Default :: Almost black text */
+    if ( FOLD_SEARCH_GALLOP == pa_opts->fold_search ) {
+        pa_opts->fold_hint = w.k_lo;
+        cleanup_fold_probe( &w.probe );
+    }
+    free(w.img_prev.piece_starts);
+    (free)(w.tokens.ends);
+    }
 
-    pa_opts->details.image_prefix = strdup("p");
+    else {
+        /*
+         ***************************************************************************
+         * Take advantage of all of the work PASS 1 completed, and
+         * simply render and blend the appropriate chunk of text!
+         */
+        w.work_text_delta = text_segments->work_text_delta;
 
-    pa_opts->details.dest_dir = NULL;      /* USER MUST PROVIDE */
-    strcpy(pa_opts->details.image_type, "jpg");
+        ASS_Track *ass_track = set_text_track( &w.track, w.work_text_delta, w.work_text_2 );
+        w.img_curr = ass_render_frame( ass_renderer, ass_track, 0LL, NULL );
+        w.counts.n[ PA_COUNT_RENDERS ]++;
+        add_page_time( pa_opts->stats, PAGE_ID( pa_opts ), PA_PHASE_RENDER, get_monotonic_ns() - w.start_ns );
 
-    pa_opts->margin_bottom = PA_UNSET_VALUE;
-    pa_opts->pixel_fudge   = PA_UNSET_VALUE;
+        w.start_ns = get_monotonic_ns();
+        int  pieces = blend_pa_image( pa_image, w.img_curr, 0 );
+        add_page_time( pa_opts->stats, PAGE_ID( pa_opts ), PA_PHASE_BLEND, get_monotonic_ns() - w.start_ns );
 
-    pa_opts->chop_prefix = NULL;
-    pa_opts->chop_chars = 0;
-    pa_opts->original_dir = NULL;
+        fprintf(stderr, "PASS #2 :: %u bytes for %d PIECES%s.\n", text_segments->work_text_delta,
+                        pieces, text_segments->clipped ? " (CLIPPED)" : "");
+        fprintf(stderr, "%.*s\n", (int) text_segments->work_text_delta, w.work_text_2);  fflush( stderr );
+    }
 
-    pa_opts->png_Software = get_Software();
+    cleanup_text_track( &w.track );
+
+    /*
+     ***************************************************************************
+     * The counters are for this template on this page (and this pass).
+     */
+    add_page_counts( pa_opts->stats, PAGE_ID( pa_opts ), template_idx, &w.counts );
+    add_counts( counts, &w.counts );
+    if ( pa_opts->verbose_level >= VERBOSE_2 ) {
+        char what[ 64 ];
+
+        snprintf(what, sizeof (what), "PAGE %lu, TEMPLATE %lu, PASS %d",
+                       pa_opts->details.chapter_image_number, template_idx + 1, (IS_FOLD_PASS_2) ? 2 : 1);
+        print_fold_counts( what, &w.counts );
+    }
 
     return ;
 }
@@ -1626,373 +3696,539 @@ static void set_opt_defaults(pa_opts_t *pa_opts)
 
 /**
  *******************************************************************************
- * Set post-option defaults that depend on other command line options.
+ * The fold counters, see '--stats-json' for the same by page and template.
  */
-static void O3 post_opt_defaults(pa_opts_t *pa_opts)
+static void print_fold_counts( char const *const what, pa_counts_t const *counts )
 {
 
-    if ( PA_UNSET_VALUE == pa_opts->margin_bottom ) {
-        double font_size = pa_opts->text_size;
-        double margin_bottom = font_size * 0.2;
-        pa_opts->margin_bottom = margin_bottom;
+    fprintf(stderr, "FOLD :: %s :: %lu tokens, %lu renders (%lu sandbox), %lu clipped, %lu dropped, "
+                    "%lu bytes read, %lu bytes of text, %lu pieces walked\n", what,
+                    (unsigned long) counts->n[ PA_COUNT_TOKENS ],
+                    (unsigned long) counts->n[ PA_COUNT_RENDERS ],
+                    (unsigned long) counts->n[ PA_COUNT_SANDBOX ],
+                    (unsigned long) counts->n[ PA_COUNT_CLIPPED ],
+                    (unsigned long) counts->n[ PA_COUNT_DROPPED ],
+                    (unsigned long) counts->n[ PA_COUNT_READ_BYTES ],
+                    (unsigned long) counts->n[ PA_COUNT_TEXT_BYTES ],
+                    (unsigned long) counts->n[ PA_COUNT_PIECES ]);
+
+    if ( counts->n[ PA_COUNT_MEASURED ] ) {
+        fprintf(stderr, "FOLD :: %s :: %lu of %lu measured breaks were exact, %lu tokens off\n", what,
+                        (unsigned long) counts->n[ PA_COUNT_MEASURE_HIT ],
+                        (unsigned long) counts->n[ PA_COUNT_MEASURED ],
+                        (unsigned long) counts->n[ PA_COUNT_MEASURE_OFF ]);
     }
 
-    if ( pa_opts->verbose_level > VERBOSE_QUIET )
-    if ( NULL != pa_opts->original_dir ) {
-        fprintf(stderr, "Getting meta-data from matching images in '%s'.\n", pa_opts->original_dir);
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ * Return the index just past the token at 'idx' and its trailing white SPACE.
+ *
+ * See if we're at the start of a libass attribute.  We make a few
+ * assumptions: attributes are not nestable and the characters '{}'
+ * should NOT appear in an attribute, except the string "}" which
+ * is used to close the attribute.
+ */
+/**
+ * We intentionally do NOT guarantee the case where an attribute is
+ * applied over multiple words.  The complexity of managing a page
+ * split in the middle of a phrase is just too much for a hobby.
+ * However, there is a simple solution by simply applying the same
+ * attribute for each word in the sed script.  For example -->
+ *
+ *  s/Earl Pendragon/{\b1}Earl Pendragon{\b0}/     <<== error-prone
+ *  s/Earl Pendragon/{\b1}Earl{\b0} {\b1}Pendragon{\b0}/  <<== okay
+ *
+ * So now if Earl Pendragon is split across pages, both words will
+ * carry the desired character attribute(s).  Another possible
+ * solution is to replace the SPACE with a non-breaking SPACE so
+ * that the phrase is treated as a single word.  For example -->
+ *
+ *  s/Earl Pendragon/{\b1}Earl\xa0Pendragon{\b0}/  <<== single word
+ */
+static unsigned int O3 next_token_idx( char const *const work_text_2, unsigned int idx )
+{
+    char const *ptr;
+
+    while ( '\0' != *(work_text_2 + idx) && idx == skip_non_text_tokens(work_text_2, idx, 1, 0) ) {
+        if ( STR_MATCH == strncmp((work_text_2 + idx), ASS_ATTRIBUTE_START, sizeof (ASS_ATTRIBUTE_START) - 1) ) {
+            idx += (sizeof (ASS_ATTRIBUTE_START) - 1);
+            ptr = strstr((work_text_2 + idx), ASS_ATTRIBUTE_END);
+            if ( NULL != ptr ) {
+                idx += ptr - (work_text_2 + idx);
+                idx += (sizeof (ASS_ATTRIBUTE_END) - 1);
+            }
+        }
+        else {
+            idx++;
+        }
     }
 
-    if ( PA_UNSET_VALUE == pa_opts->pixel_fudge ) {
-        pa_opts->pixel_fudge = (pa_opts->text_size * 100) / 1000;
-        if ( pa_opts->pixel_fudge < ONE_PIXELs_FUDGE ) {
-            pa_opts->pixel_fudge = ONE_PIXELs_FUDGE;
+    /*
+     ***************************************************************************
+     * Include any trailing white SPACE after the current token.
+     */
+    return ( skip_non_text_tokens(work_text_2, idx, 1, 0) );
+}
+
+
+/**
+ *******************************************************************************
+ * Start the template's tokens at 'start' in the chapter's 'index', that's the
+ * first token that ends after it (a bisection).
+ */
+static void fold_tokens_init( fold_tokens_t *tokens, work_index_t const *index, unsigned int start )
+{
+    size_t lo = 0;
+    size_t hi = (NULL != index) ? index->cnt : 0;
+
+    while ( lo < hi ) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if ( index->ends[ mid ] <= start ) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
         }
     }
 
+    tokens->index = index;
+    tokens->start = start;
+    tokens->first = lo;
+
     return ;
 }
 
 
 /**
  *******************************************************************************
+ * Make sure that the end of token 'k' is known, if there is a token 'k'.
+ * Returns 'k', or the # of the last token if the text has fewer tokens.
  */
-static void cleanup_pa_opts( pa_opts_t **p_pa_opts )
+static unsigned int O3 fold_tokens_ensure( fold_tokens_t *tokens, char const *const work_text_2, unsigned int k )
 {
-    pa_opts_t *pa_opts = *p_pa_opts;
+#undef FOLD_TOKENS_BUMP
+#define FOLD_TOKENS_BUMP (512)
+
+    if ( NULL == tokens->ends ) {
+        tokens->max  = FOLD_TOKENS_BUMP;
+        tokens->ends = realloc( tokens->ends, tokens->max * sizeof (unsigned int) );
+        tokens->ends[ 0 ] = 0;
+        tokens->cnt  = 1;
+        tokens->done = 0;
+    }
 
-    cleanup_strptrary( &pa_opts->templates );
-    cleanup_strptrary( &pa_opts->in_chapters );
-    cleanup_strptrary( &pa_opts->font_dirs );
-    cleanup_strptrary( &pa_opts->in_png_list );
-    cleanup_strptrary( &pa_opts->header_template );
-    cleanup_strptrary( &pa_opts->sed_script_files );
+    while ( k >= tokens->cnt && 0 == tokens->done ) {
+        unsigned int idx = tokens->ends[ tokens->cnt - 1 ];
 
-    cleanup_details  ( &pa_opts->details );
+        if ( '\0' == *(work_text_2 + idx) ) {
+            tokens->done = 1;
+            break;
+        }
 
-    (free)( (void *) pa_opts->chop_prefix );
-    (free)( (void *) pa_opts->original_dir );
-    (free)( (void *) pa_opts->text_face );
+        if ( tokens->cnt == tokens->max ) {
+            tokens->max += FOLD_TOKENS_BUMP;
+            tokens->ends = realloc( tokens->ends, tokens->max * sizeof (unsigned int) );
+        }
+        if ( NULL != tokens->index ) {
+            tokens->ends[ tokens->cnt ] = tokens->index->ends[ tokens->first + tokens->cnt - 1 ] - tokens->start;
+            tokens->cnt++;
+        }
+        else {
+            tokens->ends[ tokens->cnt++ ] = next_token_idx( work_text_2, idx );
+        }
+    }
 
-    (free)( (void *) pa_opts->debug_text_dir );
-    (free)( (void *) pa_opts->debug_work_dir );
+    return ( (k < tokens->cnt) ? k : tokens->cnt - 1 );
+}
 
-    free( *p_pa_opts );
 
-    return ;
+/**
+ *******************************************************************************
+ * The # of tokens in the first 'len' bytes of the remaining text.
+ */
+static unsigned int O3 fold_tokens_count( fold_tokens_t *tokens, char const *const work_text_2, unsigned int len )
+{
+    unsigned int k = fold_tokens_ensure( tokens, work_text_2, 0 );
+    unsigned int next;
+
+    while ( tokens->ends[ k ] < len && (next = fold_tokens_ensure( tokens, work_text_2, k + 1 )) > k ) {
+        k = next;
+    }
+
+    return ( k );
 }
 
 
 /**
  *******************************************************************************
+ * Render the first 'len' bytes of the remaining text in the tall frame.
  */
-static void cleanup_details( details_t *details )
+static ASS_Image *render_fold_probe( fold_probe_t *probe, unsigned int len )
 {
+    ASS_Track *ass_track = set_text_track( &probe->tall, len, probe->work_text_2 );
 
-    free( details->png_Title );
-    free( details->dest_dir );
-    free( details->image_prefix );
+    probe->tall_len = len;
+    probe->tall_fit = 0;
+    probe->tall_img = ass_render_frame( probe->tall_renderer, ass_track, 0LL, NULL );
+    probe->tall.counts->n[ PA_COUNT_RENDERS ]++;
 
-    return ;
+    return ( probe->tall_img );
 }
 
 
 /**
  *******************************************************************************
- * Gawd - I can't think of an easier way to solve this.  I'm trying to render
- *        as much text as possible before splitting the string.  There doesn't
- *        seem to be a trivial way to do this...
- *
- * We want to incrementally build a 'Events:Text' string that will change each
- * time it is rendered by 'ass_render_frame()'.  For each successive render,
- * if the current render matches the previous render, then we know the previous
- * render is the maximum text that can be consumed for that template.
+ * '--fold-measure' :: the # of tokens of the remaining text that the FreeType
+ * layout says fit in the template.  The track is only parsed for its style
+ * (nothing's rendered), see 'measure_fold()'.
  *
- * For the previous render, we only need to save the position in 'work_text'
- * (there may be other things like character attributes, but that complexity
- * can be added at a later date).
+ * Returns RC_FALSE if there's no prediction for this template.
+ */
+static rc_e measure_fold_tokens( text_track_t *track, fold_tokens_t *tokens, char const *const work_text_2, unsigned int *p_k )
+{
+    pa_opts_t const *pa_opts = track->pa_opts;
+    ASS_Track       *ass_track = set_text_track( track, 0, work_text_2 );
+    unsigned int     len;
+    unsigned int     next;
+
+    if ( RC_TRUE != measure_fold( pa_opts->pa_measure, ass_track, track->width, track->height,
+                                  track->height - pa_opts->margin_bottom, pa_opts->line_spacing, work_text_2, &len ) ) {
+        return ( RC_FALSE );
+    }
+
+    *p_k = 0;
+    while ( (next = fold_tokens_ensure( tokens, work_text_2, *p_k + 1 )) > *p_k && tokens->ends[ next ] <= len ) {
+        *p_k = next;
+    }
+
+    return ( RC_TRUE );
+}
+
+
+/**
+ *******************************************************************************
+ * Find the most tokens that fit in the template without any rendering below
+ * the bottom margin, using as few renders as possible --
  *
- * The 'work_text' blob has been pre-processed by 'make_work_text()' such
- * that its initial state is TEXT token, and we call 'skip_non_text_tokens()'
- * after each template iteration to ensure that the initial state is _always_
- * TEXT token for the remaining text.
+ *  - if what's left is about a page (the last page of a chapter), see if it
+ *    all fits first;
+ *  - otherwise, start at the # of tokens that fit the last template (pages
+ *    tend to hold about the same amount of text) and gallop up or down by
+ *    doubling steps until the fit changes;
+ *  - with '--fold-measure', start at the 'measured' (predicted) # of tokens
+ *    instead, and gallop from smaller steps (it's usually close);
+ *  - bisect back to the last token that fits.
  *
- * The libass documentation is unclear (even if I look at the source that's
- * no assurance that it wouldn't change between versions) about the lifetime
- * of an ASS_Image from ass_render_frame().
+ * Returns that # of tokens, 'k_lo', and sets the 'prv' ASS_Image state as the
+ * token-by-token search would have after its render of those 'k_lo' tokens.
+ * The caller continues with the token-by-token search after 'k_lo', so the
+ * break (and the walk back to the start of a clipped line) is found the same
+ * way as '--fold-search=linear'.  Since the tall frame renders the text the
+ * same as the image's frame as long as it fits, that should be the same break.
  *
- * TODO :: We might split in the middle of a font attribute (bold, italic, etc.)
- *         so we need a way to handle that (s/b pretty rare, but it can happen).
+ * A couple of cases where this could differ from the linear search:
+ *  - a token that makes an ASS_Image that's already on the page taller (the
+ *    linear search doesn't see this, we see it as not fitting);
+ *  - ASS_DROPPED, see 'cmpr_last_ASS_Image()' (which is an OOPS anyways).
  */
-static void O0 apply_template_complex( pa_image_t *pa_image, pa_opts_t *pa_opts, char const *const template, char *const work_text, text_segments_t *const text_segments )
+static unsigned int O3 gallop_fold_search( fold_probe_t *probe, fold_tokens_t *tokens, pa_ass_t *const prv, unsigned int measured )
 {
-#undef IS_FOLD_PASS_1
-#define IS_FOLD_PASS_1  ( FOLD_PASS_1 == pa_opts->fold_pass )
-#undef IS_FOLD_PASS_2
-#define IS_FOLD_PASS_2  ( FOLD_PASS_2 == pa_opts->fold_pass )
+    auto int fits( unsigned int k );
     struct {
-        char        *ass_text;
-        size_t       ass_text_len;
+        unsigned int k_lo;       /* this many tokens fit ... */
+        unsigned int k_hi;       /* ... and this many don't (0 == unknown) */
+        unsigned int k;
+        unsigned int step;
+        unsigned int hint;
+
+        short        pieces;     /* from the last 'fits()' */
+        int          last_w;
+        short        lo_pieces;  /* from the 'fits()' for 'k_lo' */
+        int          lo_w;
+    } w = {
+        .k_lo      = 0,
+        .k_hi      = 0,
+        .hint      = measured ? measured : (probe->pa_opts->fold_hint ? probe->pa_opts->fold_hint : 32),
+        .lo_pieces = 0,
+        .lo_w      = 0,
+    };
 
-        char const  *const template;
-        char const  *work_text_2;
-        unsigned int work_text_idx;
-        unsigned int work_text_delta;
-        size_t       good_work_text_idx;  /* Start of last token, not SPACE */
 
-        ASS_Image   *img_curr;  /* returned from 'ass_render_frame()' */
-        pa_ass_t     img_prev;  /* saved fields from last ASS_Image in array */
-        int          clipped;   /* Set if the last ASS_Image was clipped. */
+    /*
+     ***************************************************************************
+     * Is what's left about a page?  Then try it all at once.
+     */
+    w.k = fold_tokens_ensure( tokens, probe->work_text_2, 2 * w.hint );
+    if ( tokens->done ) {
+        if ( fits( w.k ) ) {
+            w.k_lo = w.k;
+            w.lo_pieces = w.pieces;
+            w.lo_w = w.last_w;
+            goto found;
+        }
+        w.k_hi = w.k;
+    }
 
-        int          width;
-        int          height;
-        int          text_size;
+    /*
+     ***************************************************************************
+     * Gallop from the hint.  Up while it fits, otherwise down ...
+     */
+    w.step = (measured) ? ((w.hint / 32) ? (w.hint / 32) : 1) : ((w.hint / 8) ? (w.hint / 8) : 1);
+    w.k = fold_tokens_ensure( tokens, probe->work_text_2, w.hint );
+    if ( w.k_hi && w.k >= w.k_hi ) {
+        w.k = w.k_hi - 1;
+    }
 
-        size_t       advance_work_text_idx;  /* DBG helper */
-        char        *ptr;                    /* DBG helper, gcc will optimize out */
-        char        *ptr1;                   /* DBG helper, gcc will optimize out */
-        short        dbg_pieces;
-        ass_cmpr_e   rc;
-    } w = {
-        .img_curr      = NULL,
-        .template      = template,
+    while ( w.k > w.k_lo ) {
+        if ( fits( w.k ) ) {
+            w.k_lo = w.k;
+            w.lo_pieces = w.pieces;
+            w.lo_w = w.last_w;
 
-        .work_text_idx = 0,                /*+*/
-        .width         = get_image_width( pa_image ),
-        .height        = get_image_height( pa_image ),
-        .text_size     = pa_opts->text_size,
-        .clipped       = 0,
+            if ( w.k_hi ) {
+                break;
+            }
+            w.k = fold_tokens_ensure( tokens, probe->work_text_2, w.k + w.step );
+            if ( w.k == w.k_lo ) {
+                goto found;  /* all of the text fits */
+            }
+        }
+        else {
+            w.k_hi = w.k;
+            if ( w.k_lo ) {
+                break;
+            }
+            w.k = (w.k > w.step) ? (w.k - w.step) : 0;
+        }
+        w.step *= 2;
+    }
 
-        .img_prev.pieces       = 0,
-        .img_prev.piece_starts = NULL,
-    };
+    /*
+     ***************************************************************************
+     * ... and bisect between the two.
+     */
+    while ( w.k_hi - w.k_lo > 1 ) {
+        w.k = w.k_lo + (w.k_hi - w.k_lo) / 2;
+        if ( fits( w.k ) ) {
+            w.k_lo = w.k;
+            w.lo_pieces = w.pieces;
+            w.lo_w = w.last_w;
+        }
+        else {
+            w.k_hi = w.k;
+        }
+    }
 
+  found:
+    prv->pieces = w.lo_pieces;
+    prv->w      = w.lo_w;
+    prv->token_start_idx = tokens->ends[ w.k_lo ];
+    if ( w.lo_pieces ) {
+        prv->piece_starts = realloc( prv->piece_starts, w.lo_pieces * sizeof (unsigned int) );
+        for ( short ii = 0; ii < w.lo_pieces; ii++ ) {
+            prv->piece_starts[ ii ] = PIECE_START_UNKNOWN;
+        }
+    }
 
-    ASS_Library *ass_library = ass_library_init();
-    add_font_search_dirs( ass_library, &pa_opts->font_dirs );
-    ass_set_message_cb( ass_library, libass_msg_callback, pa_opts );
+    return ( w.k_lo );
 
-    ASS_Renderer *ass_renderer = ass_renderer_init( ass_library );
 
-    ass_set_frame_size( ass_renderer, w.width, w.height );
-    ass_set_fonts( ass_renderer, NULL, "sans-serif", 1, NULL, 1 );
+    /**
+     ***************************************************************************
+     * Do the first 'k' tokens fit?  Nothing may render at or below the bottom
+     * margin (the tall frame catches text that'd be off of the image).
+     */
+    int fits( unsigned int k )
+    {
+        ASS_Image *img = render_fold_probe( probe, tokens->ends[ k ] );
+
+        w.pieces = 0;
+        w.last_w = 0;
+        for ( ; NULL != img; img = img->next ) {
+            probe->tall.counts->n[ PA_COUNT_PIECES ]++;
+            if ( (img->dst_y + img->h) >= probe->bottom ) {
+                return ( 0 );
+            }
+            w.pieces++;
+            w.last_w = img->w;
+        }
+        probe->tall_fit = 1;
 
-    if ( pa_opts->line_spacing > 0.0 ) {
-        ass_set_line_spacing( ass_renderer, pa_opts->line_spacing );  /* Works as expected :) */
+        return ( 1 );
     }
+}
+
+
+/**
+ *******************************************************************************
+ * The token-by-token search walks back through the 'piece_starts' of the
+ * ASS_Images that are near the bottom when a line clips.  The gallop search
+ * skipped the renders that would've set those for the first 'k_lo' tokens,
+ * so find (bisect for) the first token that made each of those ASS_Images.
+ *
+ * These renders are in the tall frame, so the 'img' list (from the image's
+ * frame renderer) is still valid for 'cmpr_last_ASS_Image()'.
+ */
+static void O3 resolve_piece_starts( fold_probe_t *probe, fold_tokens_t *tokens, pa_ass_t *const prv, ASS_Image *img, short pixel_fudge, unsigned int k_lo )
+{
+    auto short pieces_for( unsigned int k );
+    struct {
+        ASS_Image   *cur;
+        short        ii;
+        int          clipped;
+        unsigned int k_lo;
+        unsigned int k_hi;
+        unsigned int k;
+    } w = {
+        .ii      = 0,
+        .clipped = 0,
+    };
+
 
     /*
      ***************************************************************************
-     * This is the FIRST PASS of folding / fitting the text onto one or more
-     * PNG images.  We'll start at the "top" of the page, so we'll skip any
-     * SPACE above the first printable string.
+     * Only bother if one of the new ASS_Images clipped (i.e., there'll be a
+     * walk back in 'cmpr_last_ASS_Image()').
      */
-    w.work_text_2 = work_text + text_segments->text_start_idx;
-
-    if ( IS_FOLD_PASS_1 )
-    while ( '\0' != *(w.work_text_2 + w.work_text_idx) ) {
-
-        w.img_prev.token_start_idx = w.work_text_idx;
+    for ( w.cur = img; NULL != w.cur; w.cur = w.cur->next, w.ii++ ) {
+        if ( w.ii >= prv->pieces && (w.cur->dst_y + w.cur->h) >= probe->bottom ) {
+            w.clipped = 1;
+        }
+    }
+    if ( 0 == w.clipped || w.ii <= prv->pieces ) {
+        return ;
+    }
 
-        //-g BREAK_STR((w.work_text_2 + w.work_text_idx), "If yo face");
+    for ( w.ii = 0; NULL != img && w.ii < prv->pieces; img = img->next, w.ii++ ) {
+        if ( PIECE_START_UNKNOWN != prv->piece_starts[ w.ii ] ) {
+            continue;
+        }
+        if ( (img->dst_y + img->h) < (probe->bottom - pixel_fudge) ) {
+            continue;
+        }
 
         /*
          ***********************************************************************
-         * See if we're at the start of a libass attribute.  We make a few
-         * assumptions: attributes are not nestable and the characters '{}'
-         * should NOT appear in an attribute, except the string "}" which
-         * is used to close the attribute.
+         * The first 'k' where there are more than 'ii' ASS_Images.
          */
-        /**
-         * We intentionally do NOT guarantee the case where an attribute is
-         * applied over multiple words.  The complexity of managing a page
-         * split in the middle of a phrase is just too much for a hobby.
-         * However, there is a simple solution by simply applying the same
-         * attribute for each word in the sed script.  For example -->
-         *
-         *  s/Earl Pendragon/{\b1}Earl Pendragon{\b0}/     <<== error-prone
-         *  s/Earl Pendragon/{\b1}Earl{\b0} {\b1}Pendragon{\b0}/  <<== okay
-         *
-         * So now if Earl Pendragon is split across pages, both words will
-         * carry the desired character attribute(s).  Another possible
-         * solution is to replace the SPACE with a non-breaking SPACE so
-         * that the phrase is treated as a single word.  For example -->
-         *
-         *  s/Earl Pendragon/{\b1}Earl\xa0Pendragon{\b0}/  <<== single word
-         */
-        next_char:
-        w.advance_work_text_idx = w.work_text_idx;
-        do {
-            if ( w.advance_work_text_idx == skip_non_text_tokens(w.work_text_2, w.work_text_idx, 1, 0) ) {
-                if ( 0 == strncmp((w.work_text_2 + w.work_text_idx), ASS_ATTRIBUTE_START, sizeof (ASS_ATTRIBUTE_START) - 1) ) {
-                    w.work_text_idx += (sizeof (ASS_ATTRIBUTE_START) - 1);
-                    w.ptr = strstr((w.work_text_2 + w.work_text_idx), ASS_ATTRIBUTE_END);
-                    if ( NULL != w.ptr ) {
-                        w.work_text_idx += w.ptr - (w.work_text_2 + w.work_text_idx);
-                        w.work_text_idx += (sizeof (ASS_ATTRIBUTE_END) - 1);
-                    }
-                }
-                else {
-                    w.work_text_idx++;
-                }
-                goto next_char;
+        w.k_lo = 0;
+        w.k_hi = k_lo;
+        while ( w.k_hi - w.k_lo > 1 ) {
+            w.k = w.k_lo + (w.k_hi - w.k_lo) / 2;
+            if ( pieces_for( w.k ) > w.ii ) {
+                w.k_hi = w.k;
+            }
+            else {
+                w.k_lo = w.k;
             }
-        } while ( 0 );
+        }
+        prv->piece_starts[ w.ii ] = tokens->ends[ w.k_hi - 1 ];
+    }
 
-        /*
-         ***********************************************************************
-         * Include any trailing white SPACE after the current token.
-         */
-        w.work_text_idx = skip_non_text_tokens(w.work_text_2, w.work_text_idx, 1, 0);
-
-        w.ass_text_len = asprintf(&w.ass_text,
-                                   w.template,
-                                   w.width,
-                                   w.height,
-                                   pa_opts->text_face,
-                                   w.text_size,
-                                   pa_opts->colour_1c,
-                                   "",  /* NOTE :: should persist for whole template */
-                                   w.work_text_idx,
-                                   w.work_text_2);
-
-        w.ptr  = w.ass_text + strlen(w.template);       /* DBG */
-        w.ptr1 = w.ass_text + strlen(w.ass_text) - 64;  /* DBG */
-
-        ASS_Track *ass_track = ass_read_memory( ass_library, w.ass_text, w.ass_text_len, NULL );
-        w.img_curr = ass_render_frame( ass_renderer, ass_track, 0LL, NULL );
+    return ;
 
-        w.dbg_pieces = COUNT_ASS_Images(w.img_curr);    /* DBG */
-        w.rc = cmpr_last_ASS_Image( &w.img_prev, w.img_curr, w.height - pa_opts->margin_bottom, pa_opts->pixel_fudge, w.work_text_2 );
 
-        ass_free_track(ass_track);
-        free ( w.ass_text );
+    short pieces_for( unsigned int k )
+    {
+        short pieces = 0;
 
-        /*
-         ***************************************************************************
-         * Okay, this time for sure.  There's no bullet proof way to handle this
-         * as I've done several buggy previous versions.  The basic problem is to
-         * detect when an added token is really off the page, or wholly consists of
-         * non-rendering characters.  The idea of watching the count of ASS_Images
-         * is close, except for this case -- I can't tell the difference between
-         * off image and not rendered for the last token added to the 'ass_track'.
-         *
-         * Trying to match up X and Y coordinates, width and height makes for a
-         * complex solution that may still have some issues given how libass
-         * renders its ASS_Images.
-         *
-         * So, the idea is this - if I see the ASS_TRY_SANDBOX_TOKEN result code,
-         * I'll perform a sample render with just that last token in a "sandbox."
-         * If it still produces no ASS_Image(s), then I'll _know_ that it's all
-         * non-rendering characters and will continue trudging along.  If it does
-         * render, then it's truly off the image and we're done with the template.
-         *
-         * I don't think this is fool-proof, but the results are much better.
-         */
-        if ( ASS_TRY_SANDBOX_TOKEN == w.rc ) {
-            w.ass_text_len = asprintf(&w.ass_text,
-                                       w.template,
-                                       w.width,
-                                       w.height,
-                                       pa_opts->text_face,
-                                       w.text_size,
-                                       pa_opts->colour_1c,
-                                       "",
-                                       w.work_text_idx - w.good_work_text_idx,
-                                       w.work_text_2 + w.good_work_text_idx);
-
-            w.ptr  = w.ass_text + strlen(w.template);       /* DBG */
-            w.ptr1 = w.ass_text + strlen(w.ass_text) - 64;  /* DBG */
-
-            ass_track = ass_read_memory( ass_library, w.ass_text, w.ass_text_len, NULL );
-            w.img_curr = ass_render_frame( ass_renderer, ass_track, 0LL, NULL );
+        for ( ASS_Image *i_ = render_fold_probe( probe, tokens->ends[ k ] ); NULL != i_; i_ = i_->next ) {
+            pieces++;
+        }
+        probe->tall.counts->n[ PA_COUNT_PIECES ] += pieces;
 
-            ass_free_track(ass_track);
-            free ( w.ass_text );
+        return ( pieces );
+    }
+}
 
-            if ( NULL == w.img_curr ) {
-                w.rc = ASS_IN_IMAGE;
-            }
-        }
-        else if ( ASS_DROPPED == w.rc ) {
-            /* FIXME :: Still need to do something ... TODO */
-            fprintf(stderr, "OOPS -- ASS_DROPPED returned!!!!!!!!\n");
-        }
 
-        /**
-         ***************************************************************************
-         ***************************************************************************
-         * See if we've consumed the maximum amount of text for this template,
-         * and return the index for how far we advanced.  There are 3 cases:
-         *
-         * - the last segment did not render because it's completely off of the
-         *   PNG's bitmap field -- we'll blend the whole ASS_Image list;
-         * - the last segment in the ASS_Image list was clipped.  We'll blend
-         *   all but the last ASS_Image in the list, and continue on next page;
-         * - we exhausted the entire string (indicated by reaching the '\0'),
-         *   we'll blend the whole ASS_Image list.
-         * NOTE - The test order in this if(...) is important!  See 'git log'.
-         */
-        if (   (ASS_TRY_SANDBOX_TOKEN == w.rc)                             /*+*/
-            || (ASS_LAST_IS_CLIPPED == w.rc
-                 && (w.clipped = 1)
-                 && (w.good_work_text_idx = w.img_prev.token_start_idx))   /*+*/
-            || ('\0' == *(w.work_text_2 + w.work_text_idx)
-                 && (w.good_work_text_idx = w.work_text_idx))              /*+*/
-           ) {
+/**
+ *******************************************************************************
+ * Return the track with its event's Text set to the first 'len' bytes of
+ * 'text'.  The track (and its ASS_Images from the last render) belong to
+ * 'track', so don't free it.
+ *
+ * libass 'free()'s the event's Text with the track, so it's grown in place
+ * with 'realloc()' (which is the same allocator, the macro only adds the
+ * abort on failure).
+ */
+static ASS_Track *set_text_track( text_track_t *track, unsigned int len, char const *const text )
+{
 
-            fprintf(stderr, "PASS #1 :: %lu bytes comsumed ...\n", w.good_work_text_idx);
+    if ( NULL != track->ass_track && track->per_event ) {
+        track->counts->n[ PA_COUNT_TEXT_BYTES ] +=
+        fill_pa_template_text(track->template,
+                              &track->ass_track->events[ 0 ].Text, &track->text_max,
+                              "",
+                              len,
+                              text);
 
-            text_segments->work_text_delta = w.good_work_text_idx;
-            text_segments->clipped = w.clipped;
-            text_segments->pieces = w.img_prev.pieces;
+        return ( track->ass_track );
+    }
 
-            free(w.img_prev.piece_starts);
-            break;
-        }
-        else if ( ASS_NO_IMAGE_ERROR == w.rc ) {
-            break_me("Detected :: ASS_NO_IMAGE_ERROR ...");
-        }
+    size_t ass_text_len = fill_pa_template(track->template,
+                                           &track->ass_text, &track->ass_text_max,
+                                           track->width,
+                                           track->height,
+                                           track->pa_opts->text_face,
+                                           track->pa_opts->text_size,
+                                           track->pa_opts->colour_1c,
+                                           "",
+                                           len,
+                                           text);
+
+    if ( NULL != track->ass_track ) {
+        ass_free_track( track->ass_track );
+    }
+    track->ass_track = ass_read_memory( track->ass_library, track->ass_text, ass_text_len, NULL );
+    track->counts->n[ PA_COUNT_READ_BYTES ] += ass_text_len;
 
-        w.good_work_text_idx = w.work_text_idx;
+    track->per_event = 0;
+    if ( NULL != track->ass_track
+      && RC_TRUE == has_template_text( track->template )
+      && 1 == track->ass_track->n_events
+      && NULL != track->ass_track->events[ 0 ].Text ) {
 
-        //-g BREAK_STR((w.work_text_2 + w.work_text_idx), "[Magic] and [Skill] are blank");
+        track->per_event = 1;
+        track->text_max  = strlen( track->ass_track->events[ 0 ].Text ) + 1;
     }
 
-    else {
-        /*
-         ***************************************************************************
-         * Take advantage of all of the work PASS 1 completed, and
-         * simply render and blend the appropriate chunk of text!
-         */
-        w.work_text_delta = text_segments->work_text_delta;
-        w.ass_text_len = asprintf(&w.ass_text,
-                                   w.template,
-                                   w.width,
-                                   w.height,
-                                   pa_opts->text_face,
-                                   w.text_size,
-                                   pa_opts->colour_1c,
-                                   "",
-                                   w.work_text_delta,
-                                   w.work_text_2);
-
-        w.ptr  = w.ass_text + strlen(w.template);       /* DBG */
-        w.ptr1 = w.ass_text + strlen(w.ass_text) - 32;  /* DBG */
-
-        ASS_Track *ass_track = ass_read_memory( ass_library, w.ass_text, w.ass_text_len, NULL );
-        w.img_curr = ass_render_frame( ass_renderer, ass_track, 0LL, NULL );
-        free(w.ass_text);
+    return ( track->ass_track );
+}
 
-        int  pieces = blend_pa_image( pa_image, w.img_curr, 0 );
-        ass_free_track(ass_track);
 
-        fprintf(stderr, "PASS #2 :: %u bytes for %d PIECES%s.\n", text_segments->work_text_delta,
-                        pieces, text_segments->clipped ? " (CLIPPED)" : "");
-        fprintf(stderr, "%.*s\n", (int) text_segments->work_text_delta, w.work_text_2);  fflush( stderr );
+/**
+ *******************************************************************************
+ */
+static void cleanup_text_track( text_track_t *track )
+{
+
+    if ( NULL != track->ass_track ) {
+        ass_free_track( track->ass_track );
+        track->ass_track = NULL;
     }
+    (free)( track->ass_text );
+    track->ass_text     = NULL;
+    track->ass_text_max = 0;
+
+    return ;
+}
+
+
+/**
+ *******************************************************************************
+ */
+static void cleanup_fold_probe( fold_probe_t *probe )
+{
 
-    ass_renderer_done( ass_renderer );
-    ass_library_done( ass_library );
+    cleanup_text_track( &probe->tall );
+    probe->tall_img = NULL;
+    probe->tall_fit = 0;
 
     return ;
 }
@@ -2011,11 +4247,16 @@ static size_t apply_template_simple( pa_image_t *pa_image, pa_opts_t *pa_opts )
         char        *png_Title;
         char        *ass_text;
         size_t       ass_text_len;
+        size_t       ass_text_max;
 
         int          width;
         int          height;
         unsigned int sequence;
+        uint64_t     start_ns;  /* for '--stats-json' */
     } w = {
+        .start_ns     = get_monotonic_ns(),
+        .ass_text     = NULL,
+        .ass_text_max = 0,
         .width     = get_image_width( pa_image ),
         .height    = get_image_height( pa_image ),
         .sequence  = pa_opts->details.global_image_sequence_number,
@@ -2030,24 +4271,18 @@ static size_t apply_template_simple( pa_image_t *pa_image, pa_opts_t *pa_opts )
 
     w.page_X_of_Y = build_page_X_of_Y(pa_opts->details.chapter_image_number, pa_opts->details.chapter_images, pa_opts->xy_format);
 
-    w.ass_text_len = asprintf(&w.ass_text,
-                               pa_opts->header_template.data[0],
-                               w.width,
-                               w.height,
-                               w.filename,
-                               w.png_Title,
-                               w.page_X_of_Y,
-                               w.sequence
-                             );
-
-    ASS_Library *ass_library = ass_library_init();
-    add_font_search_dirs( ass_library, &pa_opts->font_dirs );
-    ass_set_message_cb( ass_library, libass_msg_callback, pa_opts );
-
-    ASS_Renderer *ass_renderer = ass_renderer_init( ass_library );
+    w.ass_text_len = fill_pa_template(pa_opts->header_compiled,
+                                      &w.ass_text, &w.ass_text_max,
+                                      w.width,
+                                      w.height,
+                                      w.filename,
+                                      w.png_Title,
+                                      w.page_X_of_Y,
+                                      w.sequence
+                                     );
 
-    ass_set_frame_size( ass_renderer, w.width, w.height );
-    ass_set_fonts( ass_renderer, NULL, "sans-serif", 1, NULL, 1 );
+    ASS_Library  *ass_library  = get_render_library( pa_opts->pa_render );
+    ASS_Renderer *ass_renderer = get_render_renderer( pa_opts->pa_render, w.width, w.height, 0.0 );
 
     /**
      ***************************************************************************
@@ -2058,16 +4293,16 @@ static size_t apply_template_simple( pa_image_t *pa_image, pa_opts_t *pa_opts )
     long long now = (1 == pa_opts->details.chapter_image_number) ? 0 : 1000;
     ASS_Track *ass_track = ass_read_memory( ass_library, w.ass_text, w.ass_text_len, NULL );
     ASS_Image *img_curr  = ass_render_frame( ass_renderer, ass_track, now, NULL );
+    add_page_time( pa_opts->stats, PAGE_ID( pa_opts ), PA_PHASE_RENDER, get_monotonic_ns() - w.start_ns );
 
+    w.start_ns = get_monotonic_ns();
     int  pieces = blend_pa_image( pa_image, img_curr, 0 );
+    add_page_time( pa_opts->stats, PAGE_ID( pa_opts ), PA_PHASE_BLEND, get_monotonic_ns() - w.start_ns );
     ass_free_track(ass_track);
 
     fprintf(stderr, "HEADING :: %d PIECES.\n", pieces);
     fflush( stderr );
 
-    ass_renderer_done( ass_renderer );
-    ass_library_done( ass_library );
-
     (free)( w.ass_text );
     (free)( w.filename );
     (free)( w.png_Title );
@@ -2085,7 +4320,7 @@ static void libass_msg_callback(int level, const char *fmt, va_list args, void *
      pa_opts_t *pa_opts = (pa_opts_t *) vp;
 
      if ( pa_opts->verbose_level >= VERBOSE_MAX )
-     if ( FOLD_PASS_2 == pa_opts->fold_pass )
+     if ( IS_RENDER_PASS( pa_opts->fold_pass ) )
      if (   6 == level
          || 4 == level
          || 2 == level ) {
@@ -2198,7 +4433,7 @@ static size_t O0 skip_non_text_tokens(char const *const in_text, size_t in_idx,
  * the last to the first to see if it's clipped.
  ******************************************************************************
  */
-static ass_cmpr_e O3 cmpr_last_ASS_Image( pa_ass_t *const prv, ASS_Image *i_cur, int height, short pixel_fudge, char const *const work_text_2 )
+static ass_cmpr_e O3 cmpr_last_ASS_Image( pa_ass_t *const prv, ASS_Image *i_cur, int height, short pixel_fudge, char const *const work_text_2, pa_counts_t *counts )
 {
     struct {
         ASS_Image      *cur;
@@ -2227,6 +4462,7 @@ static ass_cmpr_e O3 cmpr_last_ASS_Image( pa_ass_t *const prv, ASS_Image *i_cur,
         while ( w.pieces++, NULL != w.cur->next ) {
             w.cur = w.cur->next;
         }
+        counts->n[ PA_COUNT_PIECES ] += w.pieces;
 
         /*
          **********************************************************************
@@ -2331,75 +4567,6 @@ static ass_cmpr_e O3 cmpr_last_ASS_Image( pa_ass_t *const prv, ASS_Image *i_cur,
 }
 
 
-/**
- *******************************************************************************
- * Set font search directories for libass.
- */
-static size_t add_font_search_dirs( ASS_Library *ass_library, strptrary_t *font_dirs )
-{
-    size_t idx = 0;
-
-    for ( ; idx < font_dirs->cnt; idx++ ) {
-        ass_set_fonts_dir(ass_library, font_dirs->pathnames[ idx ] );
-    }
-
-    return ( idx );
-}
-
-
-/**
- *******************************************************************************
- * Verify a text template.
- *
- * Perform a rudimentary inspection of a text template.  We only verify that
- * it has the correct number and type of printf tags, but nothing beyond that.
- * It's really just designed to catch fat-fingered typos in the template file.
- *
- * Note, a typical template should NOT have a random / stray '%' character.
- */
-static int O3 verify_template( char const *const template, char const *types, char const *const final_type )
-{
-    struct {
-        rc_e        rc;
-        char const *ptr;
-    } w = {
-        .rc  = RC_TRUE,
-        .ptr = template,
-    };
-
-
-    while ( *types ) {
-        w.ptr = strchr( w.ptr, '%' );
-        if ( NULL == w.ptr ) {
-            w.rc = RC_FALSE;
-            break;
-        }
-        if ( *types != *(++w.ptr) ) {
-            w.rc = RC_FALSE;
-            break;
-        }
-        ++types;
-    }
-
-    /*
-     ***************************************************************************
-     * Check: is there a final format START in the string;
-     *        does it match the 'final_type'; and
-     *        there should be no additional format STARTs in the string.
-     */
-    if ( RC_TRUE == w.rc )  /* (guard) */
-    if ( (NULL != final_type
-            && (NULL == (w.ptr = strchr( w.ptr, '%' )) || STR_MATCH != strncmp(++w.ptr, final_type, strlen(final_type))))
-         || NULL != strchr( w.ptr, '%' )
-       ) {
-
-        w.rc = RC_FALSE;
-    }
-
-    return ( w.rc );
-}
-
-
 /**
  *******************************************************************************
  * Get the chapter title, which is assumed to be the first real line of text.
@@ -2703,6 +4870,177 @@ static char O3 *get_Software()
 }
 
 
+/**
+ *******************************************************************************
+ * '--single-pass' :: append the ASS_Image list to 'fp' (see 'held_piece_t').
+ * Returns the number of pieces, or -1 if they couldn't all be written (and
+ * 'fp' has its error indicator set).
+ */
+static int hold_text_layer( FILE *fp, ASS_Image *img )
+{
+    int  cnt = 0;
+
+    for ( ; NULL != img; img = img->next ) {
+        held_piece_t piece = {
+            .w     = img->w,
+            .h     = img->h,
+            .dst_x = img->dst_x,
+            .dst_y = img->dst_y,
+            .color = img->color,
+        };
+
+        if ( 1 != fwrite( &piece, sizeof (piece), 1, fp ) ) {
+            return ( -1 );
+        }
+        for ( int y = 0; y < img->h; y++ ) {
+            if ( (size_t) img->w != fwrite( img->bitmap + y * img->stride, 1, img->w, fp ) ) {
+                return ( -1 );
+            }
+        }
+        ++cnt;
+    }
+
+    return ( cnt );
+}
+
+
+/**
+ *******************************************************************************
+ * '--single-pass' :: blend the pieces held in 'fp' between 'start' and 'end'
+ * (see 'hold_text_layer()') onto the image.  Returns the number of pieces, or
+ * -1 if they couldn't be read back.
+ */
+static int blend_held_text( pa_image_t *pa_image, FILE *fp, long start, long end )
+{
+    struct {
+        unsigned char *buf;
+        ASS_Image     *imgs;
+        size_t         cnt;
+        size_t         max;
+        size_t         len;
+        int            pieces;
+    } w = {
+        .buf    = NULL,
+        .imgs   = NULL,
+        .cnt    = 0,
+        .max    = 0,
+        .len    = end - start,
+        .pieces = -1,
+    };
+
+
+    if ( 0 == w.len ) {
+        return ( 0 );
+    }
+
+    w.buf = malloc( w.len );
+    if ( 0 != fseek( fp, start, SEEK_SET ) || 1 != fread( w.buf, w.len, 1, fp ) ) {
+        clearerr( fp );
+        goto cleanup;
+    }
+
+    /*
+     ***************************************************************************
+     * The bitmaps are used in place, they're 'w' wide so that's the stride.
+     */
+    for ( size_t off = 0; off < w.len; ) {
+        held_piece_t piece;
+
+        if ( w.len - off < sizeof (piece) ) {
+            goto cleanup;
+        }
+        memcpy( &piece, w.buf + off, sizeof (piece) );
+        off += sizeof (piece);
+        if ( w.len - off < (size_t) piece.w * piece.h ) {
+            goto cleanup;
+        }
+
+        if ( w.cnt == w.max ) {
+            w.max += 64;
+            w.imgs = realloc( w.imgs, w.max * sizeof (ASS_Image) );
+        }
+        w.imgs[ w.cnt++ ] = (ASS_Image) {
+            .w      = piece.w,
+            .h      = piece.h,
+            .stride = piece.w,
+            .bitmap = w.buf + off,
+            .color  = piece.color,
+            .dst_x  = piece.dst_x,
+            .dst_y  = piece.dst_y,
+            .next   = NULL,
+        };
+        off += (size_t) piece.w * piece.h;
+    }
+
+    for ( size_t idx = 1; idx < w.cnt; idx++ ) {
+        w.imgs[ idx - 1 ].next = &w.imgs[ idx ];
+    }
+    w.pieces = blend_pa_image( pa_image, w.imgs, 0 );
+
+    cleanup:
+    (free)( w.imgs );
+    (free)( w.buf );
+
+    return ( w.pieces );
+}
+
+
+/**
+ *******************************************************************************
+ * '--single-pass' :: now that the chapter's page count is known, decode each
+ * held page's background, apply the header, blend the held text over it (the
+ * same order as PASS 2) and save it.
+ */
+static void save_held_pages( held_page_t *held, size_t cnt, pa_opts_t *pa_opts )
+{
+
+    for ( size_t idx = 0; idx < cnt; idx++ ) {
+        pa_opts->details.in_png_name                  = held[ idx ].in_png_name;
+        pa_opts->details.chapter_image_number         = held[ idx ].chapter_image_number;
+        pa_opts->details.global_image_sequence_number = held[ idx ].global_image_sequence_number;
+        prefetch_bgcache( pa_opts->bgcache, held[ idx ].png_filename_idx );
+
+        clock_t my_clock = clock() - held[ idx ].elapsed;
+
+        if ( held[ idx ].text_start < 0 || held[ idx ].text_end < 0 ) {
+            fprintf(stderr, "[pngass] Error :: can't hold the text of page %lu of '%s', it's not saved\n",
+                            held[ idx ].chapter_image_number, pa_opts->details.chapter_filename);
+            continue;
+        }
+
+        uint64_t start_ns = get_monotonic_ns();
+        pa_image_t *pa_image = load_pa_image( pa_opts, held[ idx ].png_idx, 1 );
+        add_page_time( pa_opts->stats, PAGE_ID( pa_opts ), PA_PHASE_BG_DECODE, get_monotonic_ns() - start_ns );
+        if ( NULL == pa_image ) {
+            continue;
+        }
+
+        if ( 1 == pa_opts->header_template.cnt ) {
+            apply_template_simple( pa_image, pa_opts );
+        }
+
+        start_ns = get_monotonic_ns();
+        int  pieces = blend_held_text( pa_image, pa_opts->held_text, held[ idx ].text_start, held[ idx ].text_end );
+        add_page_time( pa_opts->stats, PAGE_ID( pa_opts ), PA_PHASE_BLEND, get_monotonic_ns() - start_ns );
+
+        if ( pieces < 0 ) {
+            fprintf(stderr, "[pngass] Error :: can't read back the text of page %lu of '%s', it's not saved\n",
+                            held[ idx ].chapter_image_number, pa_opts->details.chapter_filename);
+        }
+        else {
+            save_pa_image( &pa_image,
+                           pa_opts,
+                           my_clock
+                         );
+        }
+
+        cleanup_pa_image( &pa_image );
+    }
+
+    return ;
+}
+
+
 /**
  *******************************************************************************
  *
@@ -2710,8 +5048,9 @@ static char O3 *get_Software()
  * TODO :: add a command line arg to provide interesting command line settings
  *         in the comments (e.g., font side, bottom border, etc.)
  */
-static rc_e save_pa_image( pa_image_t *pa_image, pa_opts_t *pa_opts, clock_t my_clock )
+static rc_e save_pa_image( pa_image_t **pa_imagep, pa_opts_t *pa_opts, clock_t my_clock )
 {
+    pa_image_t *pa_image = *pa_imagep;
     struct {
         details_t  *details;
         comments_t *comments;
@@ -2719,9 +5058,11 @@ static rc_e save_pa_image( pa_image_t *pa_image, pa_opts_t *pa_opts, clock_t my_
         clock_t     diff;
         double      msec;
         time_t      now;
+        struct tm   tm;
         char        tmp_str[ sizeof ("2011-10-08T07:07:09Z") ];
         size_t      idx;
         char       *str;   /* working pointer */
+        image_io_t  io;
         rc_e        rc;
     } w = {
         .details  = &pa_opts->details,
@@ -2741,7 +5082,7 @@ static rc_e save_pa_image( pa_image_t *pa_image, pa_opts_t *pa_opts, clock_t my_
         add_comments( w.comments, "Software", get_Software() );
 
         if ( 0 == pa_opts->regression ) {
-            strftime(w.tmp_str, sizeof (w.tmp_str), "%FT%TZ", gmtime(&w.now));
+            strftime(w.tmp_str, sizeof (w.tmp_str), "%FT%TZ", gmtime_r(&w.now, &w.tm));
             add_comments( w.comments, "date:create", w.tmp_str );
             add_comments( w.comments, "PA Create", w.tmp_str );
 
@@ -2810,10 +5151,25 @@ static rc_e save_pa_image( pa_image_t *pa_image, pa_opts_t *pa_opts, clock_t my_
         replace_png_comments( pa_image, w.comments );
     }
 
+    /*
+     ***************************************************************************
+     * The encoder takes the image and the name, and reports any errors.
+     */
     w.str = build_name_from_details( w.details );
-    write_image_file( w.str, pa_image, w.details->image_type );
+    if ( NULL != pa_opts->encoder ) {
+        queue_image_file( pa_opts->encoder, PAGE_ID( pa_opts ), w.str, pa_imagep, w.details->image_type );
+        return ( w.rc );
+    }
+
+    w.rc = write_image_file( w.str, pa_image, w.details->image_type, &w.io );
+    if ( RC_TRUE != w.rc ) {
+        fprintf(stderr, "ERROR :: '%s' was NOT written.\n", w.str);
+    }
+    add_page_time( pa_opts->stats, PAGE_ID( pa_opts ), PA_PHASE_ENCODE, w.io.encode_ns );
+    add_page_time( pa_opts->stats, PAGE_ID( pa_opts ), PA_PHASE_WRITE, w.io.write_ns );
+    add_page_written( pa_opts->stats, PAGE_ID( pa_opts ), w.str, w.io.bytes );
     free (w.str);
 
-    return ( w.rc );  // FIXME it always returns RC_TRUE
+    return ( w.rc );
 }
 
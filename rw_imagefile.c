@@ -27,8 +27,10 @@
 #include <ctype.h>
 
 #include <errno.h>
+#include <pthread.h>
 #include <ass/ass.h>
 #include <png.h>
+#include <zlib.h>
 
 #include "pa_misc.h"
 #include "rw_arrays.h"
@@ -46,6 +48,19 @@
 #  define JPEG_ARGS_UNUSED __attribute__((unused))
 #endif
 
+#if defined(__x86_64__)
+#  include <immintrin.h>  /* SSE2 / AVX2 blend kernels */
+#endif
+
+/**
+ ******************************************************************************
+ * A JPEG file starts with an SOI marker and then another marker (an APPn,
+ * DQT, COM, ...).
+ */
+#undef IS_JPEG_SIGNATURE
+#define IS_JPEG_SIGNATURE( hdr_ ) \
+    (0xFF == (hdr_)[ 0 ] && 0xD8 == (hdr_)[ 1 ] && 0xFF == (hdr_)[ 2 ])
+
 
 typedef struct pa_image_t {
     png_byte    *image_data;  // RGB24
@@ -61,17 +76,48 @@ typedef struct pa_image_t {
 
     int          jpeg_quality;  /* JPEG support, range 0..100 */
     char        *err_desc;
+
+    size_t       file_bytes;    /* read from its file, 0 for a clone */
 } pa_image_t;
 
 
 static rc_e load_png_comments(png_struct *pngs_ptr, png_info *info_ptr, comments_t **, char const *const *keys);
+static rc_e read_png_text_chunks(char const *const filename, pa_image_t **imagep, char const *const *keys);
+static rc_e read_jpeg_file(FILE *file, pa_image_t *image, char const *const filename, char const *const *keys, read_opts_e);
+static int  is_ignored_key(char const *const key, char const *const *keys);
+static char *inflate_png_text(png_byte const *data, size_t len);
 
-static int save_pngfile(char const *const png_filename, pa_image_t *png_image);
-static int save_jpgfile(char const *const jpg_filename, pa_image_t *png_image);
+static int save_pngfile(FILE *file, pa_image_t *png_image);
+static int save_jpgfile(FILE *file, pa_image_t *png_image);
+static int save_buffer (char const *const filename, char const *buf, size_t len);
 
 static pa_image_t *alloc_png_image();
 static void prune_pa_image(pa_image_t **image);
 
+static png_byte *get_pooled_data(size_t size);
+static void      put_pooled_data(png_byte *data, size_t size);
+
+
+/**
+ ******************************************************************************
+ * A small pool of freed image buffers.  Every output page is a background
+ * sized buffer (6MB for 1080p), so rather than a malloc()/free() for each
+ * page, 'clone_pa_image()' reuses the buffer of a page that's been saved.
+ * It's locked since the '--jobs' workers share it.
+ */
+#undef PA_IMAGE_POOL_MAX
+#define PA_IMAGE_POOL_MAX (4)
+
+static struct {
+    png_byte     *data[ PA_IMAGE_POOL_MAX ];
+    size_t        size[ PA_IMAGE_POOL_MAX ];
+    unsigned int  cnt;
+    pthread_mutex_t lock;
+} image_pool = {
+    .cnt  = 0,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
 
 /**
  ******************************************************************************
@@ -86,6 +132,9 @@ static void prune_pa_image(pa_image_t **image);
  ******************************************************************************
  * Read a PNG file into memory and return a 'pa_image_t' in 'imagep'.
  *
+ * Any PNG (palette, grey, alpha or 16-bit) is read as RGB24, and a JPEG file
+ * (whatever its name) is handed off to 'read_jpeg_file()'.
+ *
  * There seems to be NO way to read pieces of a PNG file without producing
  * some sort of warning from libpng.  For example, if you are only interested
  * in the comments from the PNG image, you have to read everything else.
@@ -115,6 +164,10 @@ rc_e O0 read_png_image(char const *const filename, pa_image_t **imagep, char con
     pa_image_t *image = NULL;
 
 
+    if ( READ_ONLY_COMMENTS == read_opts ) {
+        return ( read_png_text_chunks( filename, imagep, keys ) );
+    }
+
     if ( NULL != (image = alloc_png_image()) )
     do {
         image->err_desc = NULL;
@@ -136,8 +189,15 @@ rc_e O0 read_png_image(char const *const filename, pa_image_t **imagep, char con
             break;
         }
         png_byte header[ PA_PNG_HEADER_SZ ];  /* 8 is the size to check */
-        if ( sizeof( header ) != fread( header, 1, sizeof (header), wr.png_file )
-                        || png_sig_cmp( header, 0, sizeof (header) ) ) {
+        if ( sizeof( header ) != fread( header, 1, sizeof (header), wr.png_file ) ) {
+            set_err_desc( image->err_desc, "'%s' -- is not a PNG file", filename ); /*+*/
+            break;
+        }
+        if ( IS_JPEG_SIGNATURE( header ) ) {
+            wr.rc = read_jpeg_file( wr.png_file, image, filename, keys, read_opts );
+            goto load_complete;
+        }
+        if ( png_sig_cmp( header, 0, sizeof (header) ) ) {
             set_err_desc( image->err_desc, "'%s' -- is not a PNG file", filename ); /*+*/
             break;
         }
@@ -181,15 +241,44 @@ rc_e O0 read_png_image(char const *const filename, pa_image_t **imagep, char con
          */
         png_read_info(wr.pngs_ptr, wr.info_ptr);
 
+        /*
+         **********************************************************************
+         * Have libpng hand back RGB24 whatever the image is -- a palette and
+         * grey are expanded, 16-bit channels are scaled down and the alpha
+         * channel is dropped (the pages are RGB24, there's nothing below the
+         * background to show through).  An RGB image is read as is.
+         */
+        image->color_type       = png_get_color_type(wr.pngs_ptr, wr.info_ptr);
+        image->bit_depth        = png_get_bit_depth(wr.pngs_ptr, wr.info_ptr);
+
+        if ( PNG_COLOR_TYPE_PALETTE == image->color_type ) {
+            png_set_palette_to_rgb(wr.pngs_ptr);
+        }
+        if ( 0 == (image->color_type & PNG_COLOR_MASK_COLOR) ) {
+            if ( image->bit_depth < 8 ) {
+                png_set_expand_gray_1_2_4_to_8(wr.pngs_ptr);
+            }
+            png_set_gray_to_rgb(wr.pngs_ptr);
+        }
+        if ( 16 == image->bit_depth ) {
+            png_set_scale_16(wr.pngs_ptr);
+        }
+        if ( (image->color_type & PNG_COLOR_MASK_ALPHA) || png_get_valid(wr.pngs_ptr, wr.info_ptr, PNG_INFO_tRNS) ) {
+            png_set_strip_alpha(wr.pngs_ptr);  /* ... a palette's tRNS is expanded to an alpha channel */
+        }
+
+        image->number_of_passes = png_set_interlace_handling(wr.pngs_ptr);
+        png_read_update_info(wr.pngs_ptr, wr.info_ptr);
+
         image->width            = png_get_image_width(wr.pngs_ptr, wr.info_ptr);
         image->height           = png_get_image_height(wr.pngs_ptr, wr.info_ptr);
         image->bit_depth        = png_get_bit_depth(wr.pngs_ptr, wr.info_ptr);
         image->row_bytes        = png_get_rowbytes(wr.pngs_ptr, wr.info_ptr);
-        image->number_of_passes = png_set_interlace_handling(wr.pngs_ptr);
         image->color_type       = png_get_color_type(wr.pngs_ptr, wr.info_ptr);
 
-        if ( image->color_type != PNG_COLOR_TYPE_RGB ) {
-            set_err_desc( image->err_desc, "'%s' -- unsupported PNG image (color_type = %d)", filename, image->color_type );
+        if ( image->color_type != PNG_COLOR_TYPE_RGB || 8 != image->bit_depth ) {
+            set_err_desc( image->err_desc, "'%s' -- unsupported PNG image (color_type = %d, bit_depth = %d)",
+                                           filename, image->color_type, image->bit_depth );
             goto load_complete;
         }
         if ( READ_ONLY_METADATA == read_opts ) {
@@ -197,14 +286,12 @@ rc_e O0 read_png_image(char const *const filename, pa_image_t **imagep, char con
             goto load_complete;
         }
 
-        png_read_update_info(wr.pngs_ptr, wr.info_ptr);
-
         if ( 1 || READ_WHOLE_IMAGE == read_opts ) {  /* I wish ... */
             /*
              ******************************************************************
              * Now, setup to read the PNG file into memory.
              */
-            image->image_data = malloc( image->height * image->row_bytes );
+            image->image_data = get_pooled_data( image->height * image->row_bytes );
             if( NULL == image->image_data ) {
                 set_err_desc( image->err_desc, "'%s' -- no memory for PNG image", filename );
                 break;
@@ -248,6 +335,11 @@ rc_e O0 read_png_image(char const *const filename, pa_image_t **imagep, char con
 
     load_complete:
     if ( wr.png_file != NULL ) {
+        long pos = ftell( wr.png_file );
+
+        if ( NULL != image && pos > 0 ) {
+            image->file_bytes = pos;
+        }
         fclose( wr.png_file );
     }
 
@@ -328,27 +420,412 @@ static rc_e O0 load_png_comments(png_struct *pngs_ptr, png_info *info_ptr, comme
 
         for ( ; w.idx < w.len; w.idx++ ) {
             w.key = w.texts[ w.idx ].key;
-            if ( NULL != keys )
-            for ( size_t ii = 0; NULL != keys[ ii ]; ii++ ) {
-                char const *const p = keys[ ii ];
-                if ( STR_MATCH == strncmp(w.key, p, strlen(p)) ) {
-                    goto label;
+            if ( 0 == is_ignored_key( w.key, keys ) ) {
+                add_comments(*comments, w.key, w.texts[ w.idx ].text);
+            }
+        }
+
+        w.rc = RC_TRUE;
+        break;
+    }
+
+    return ( w.rc );
+}
+
+
+/**
+ ******************************************************************************
+ * Is 'key' one of the comment 'keys' that we're NOT going to load / replicate?
+ */
+static int is_ignored_key(char const *const key, char const *const *keys)
+{
+    if ( NULL != keys )
+    for ( size_t ii = 0; NULL != keys[ ii ]; ii++ ) {
+        char const *const p = keys[ ii ];
+        if ( STR_MATCH == strncmp(key, p, strlen(p)) ) {
+            return ( 1 );
+        }
+    }
+
+    return ( 0 );
+}
+
+
+/**
+ ******************************************************************************
+ * READ_ONLY_COMMENTS :: get the comments by walking the PNG's chunks.
+ *
+ * libpng can't stop short of the image data (see 'rw_imagefile.h'), so we
+ * read only the signature, 'IHDR' and the 'tEXt', 'zTXt' and 'iTXt' chunks,
+ * and fseek() past everything else (i.e., the 'IDAT's).  The comments are in
+ * the file's order (the same as 'png_get_text()'), and like libpng, a text
+ * chunk with a bad CRC or keyword is dropped.  The image has NO image data,
+ * and its 'file_bytes' is what was actually read.
+ */
+static rc_e O0 read_png_text_chunks(char const *const filename, pa_image_t **imagep, char const *const *keys)
+{
+#undef PA_PNG_CHUNK_TYPE
+#define PA_PNG_CHUNK_TYPE( type_ )  (STR_MATCH == memcmp( (w.hdr + 4), (type_), 4 ))
+    struct {
+        FILE        *png_file;
+        png_byte     hdr[ 8 ];    /* the signature, then a chunk's length and type */
+        png_uint_32  len;
+        png_byte    *data;        /* the chunk's data, its CRC and a '\0' */
+        size_t       data_sz;
+        size_t       idx;
+        size_t       bytes;       /* read from the file */
+        char        *text;        /* the inflated text of a 'zTXt' or 'iTXt' */
+        int          ihdr;
+        rc_e         rc;
+    } w = {
+        .png_file = NULL,
+        .data     = NULL,
+        .bytes    = 0,
+        .ihdr     = 0,
+        .rc       = RC_FALSE,
+    };
+    pa_image_t *image = NULL;
+
+
+    if ( NULL != (image = alloc_png_image()) )
+    do {
+        image->err_desc = NULL;
+        image->comments = calloc(1, sizeof (comments_t));
+
+        if ( NULL == filename || '\0' == *filename ) {
+            set_err_desc( image->err_desc, "filename is empty or not provided" );
+            break;
+        }
+
+        w.png_file = fopen( filename, "rb" );
+        if( NULL == w.png_file ) {
+            set_err_desc( image->err_desc, "'%s' -- error %d, %s",
+                                           filename, errno, strerror(errno)); /*+*/
+            break;
+        }
+        if ( sizeof (w.hdr) != fread( w.hdr, 1, sizeof (w.hdr), w.png_file ) ) {
+            set_err_desc( image->err_desc, "'%s' -- is not a PNG file", filename ); /*+*/
+            break;
+        }
+        if ( IS_JPEG_SIGNATURE( w.hdr ) ) {  /* its COM markers are before the image data */
+            w.rc = read_jpeg_file( w.png_file, image, filename, keys, READ_ONLY_COMMENTS );
+            w.bytes = ftell( w.png_file );
+            break;
+        }
+        if ( png_sig_cmp( w.hdr, 0, sizeof (w.hdr) ) ) {
+            set_err_desc( image->err_desc, "'%s' -- is not a PNG file", filename ); /*+*/
+            break;
+        }
+        w.bytes += sizeof (w.hdr);
+
+        for ( ;; ) {
+            if ( sizeof (w.hdr) != fread( w.hdr, 1, sizeof (w.hdr), w.png_file ) ) {
+                set_err_desc( image->err_desc, "'%s' -- is truncated (no IEND chunk)", filename );
+                break;
+            }
+            w.bytes += sizeof (w.hdr);
+
+            w.len = png_get_uint_32( w.hdr );
+            if ( w.len > PNG_UINT_31_MAX || (0 == w.ihdr && !PA_PNG_CHUNK_TYPE( "IHDR" )) ) {
+                set_err_desc( image->err_desc, "'%s' -- is not a valid PNG file", filename );
+                break;
+            }
+
+            if ( PA_PNG_CHUNK_TYPE( "IEND" ) ) {
+                w.rc = RC_TRUE;
+                break;
+            }
+
+            if ( !PA_PNG_CHUNK_TYPE( "IHDR" ) && !PA_PNG_CHUNK_TYPE( "tEXt" )
+                    && !PA_PNG_CHUNK_TYPE( "zTXt" ) && !PA_PNG_CHUNK_TYPE( "iTXt" ) ) {
+                if ( fseek( w.png_file, (long) w.len + 4, SEEK_CUR ) ) {  /* and its CRC */
+                    set_err_desc( image->err_desc, "'%s' -- error %d, %s",
+                                                   filename, errno, strerror(errno)); /*+*/
+                    break;
+                }
+                continue;
+            }
+
+            /*
+             ******************************************************************
+             * Read the chunk and its CRC, and '\0' terminate it for the text.
+             */
+            if ( w.len + 5 > w.data_sz ) {
+                w.data_sz = w.len + 5;
+                w.data = realloc( w.data, w.data_sz );
+            }
+            if ( w.len + 4 != fread( w.data, 1, w.len + 4, w.png_file ) ) {
+                set_err_desc( image->err_desc, "'%s' -- is truncated (no IEND chunk)", filename );
+                break;
+            }
+            w.bytes += w.len + 4;
+
+            if ( png_get_uint_32( w.data + w.len )
+                    != crc32( crc32( 0, w.hdr + 4, 4 ), w.data, w.len ) ) {
+                if ( PA_PNG_CHUNK_TYPE( "IHDR" ) ) {
+                    set_err_desc( image->err_desc, "'%s' -- IHDR chunk has a bad CRC", filename );
+                    break;
+                }
+                continue;  /* libpng discards an ancillary chunk with a bad CRC */
+            }
+            *(w.data + w.len) = '\0';
+
+            if ( PA_PNG_CHUNK_TYPE( "IHDR" ) ) {
+                if ( 13 != w.len || w.ihdr++ ) {
+                    set_err_desc( image->err_desc, "'%s' -- is not a valid PNG file", filename );
+                    break;
                 }
+                image->width      = png_get_uint_32( w.data );
+                image->height     = png_get_uint_32( w.data + 4 );
+                image->bit_depth  = *(w.data + 8);
+                image->color_type = *(w.data + 9);
+                continue;
             }
 
-            add_comments(*comments, w.key, w.texts[ w.idx ].text);
+            /*
+             ******************************************************************
+             * The text chunks all start with a keyword and a '\0' (which
+             * libpng only checks for the 'zTXt' and 'iTXt' chunks).
+             */
+            w.idx  = strlen( (char *) w.data );
+            w.text = NULL;
+            if ( PA_PNG_CHUNK_TYPE( "tEXt" ) ) {
+                w.text = strdup( (char *) w.data + w.idx + (w.idx < w.len) );
+            }
+            else if ( 0 == w.idx || w.idx > 79 || w.idx++ == w.len ) {
+                continue;
+            }
+            else if ( PA_PNG_CHUNK_TYPE( "zTXt" ) ) {  /* method, then the text */
+                if ( w.idx < w.len && 0 == *(w.data + w.idx) ) {
+                    w.text = inflate_png_text( w.data + w.idx + 1, w.len - w.idx - 1 );
+                }
+            }
+            else if ( w.idx + 2 <= w.len ) {  /* 'iTXt' :: flag, method, language, translated key, then text */
+                int compressed = *(w.data + w.idx);
+                int method     = *(w.data + w.idx + 1);
+
+                w.idx += 2;
+                w.idx += strlen( (char *) w.data + w.idx ) + 1;
+                if ( w.idx < w.len ) {
+                    w.idx += strlen( (char *) w.data + w.idx ) + 1;
+                }
+                if ( w.idx <= w.len ) {
+                    if ( 0 == compressed ) {
+                        w.text = strdup( (char *) w.data + w.idx );
+                    }
+                    else if ( 1 == compressed && 0 == method ) {
+                        w.text = inflate_png_text( w.data + w.idx, w.len - w.idx );
+                    }
+                }
+            }
 
-            label: ;
+            if ( NULL != w.text && 0 == is_ignored_key( (char *) w.data, keys ) ) {
+                add_comments( image->comments, (char *) w.data, w.text );
+            }
+            (free)( w.text );
         }
+    } while ( 0 );
+    else {
+        /* This *simply* marks the case where memory allocation has failed */
+    }
 
-        w.rc = RC_TRUE;
-        break;
+    if ( w.png_file != NULL ) {
+        fclose( w.png_file );
+    }
+    (free)( w.data );
+
+    if ( NULL != image ) {
+        image->file_bytes = w.bytes;
     }
 
+    if ( NULL == imagep ) {
+        cleanup_pa_image( &image );
+    }
+    else *imagep = image;
+
     return ( w.rc );
 }
 
 
+/**
+ ******************************************************************************
+ * Inflate the text of a 'zTXt' or a compressed 'iTXt' chunk.  Like libpng,
+ * the text is limited to 8MB, and NULL is returned if it's not valid zlib.
+ */
+static char *inflate_png_text(png_byte const *data, size_t len)
+{
+#undef PA_PNG_TEXT_MAX
+#define PA_PNG_TEXT_MAX  (8000000)  /* libpng's PNG_USER_CHUNK_MALLOC_MAX */
+    struct {
+        z_stream  zs;
+        char     *text;
+        size_t    sz;
+        int       zrc;
+    } w = {
+        .zs   = { .next_in = (Bytef *) data, .avail_in = len, },
+        .sz   = 4 * len + 64,
+        .text = NULL,
+    };
+
+
+    if ( Z_OK != inflateInit( &w.zs ) ) {
+        return ( NULL );
+    }
+
+    w.text = malloc( w.sz );
+    do {
+        w.zs.next_out  = (Bytef *) w.text + w.zs.total_out;
+        w.zs.avail_out = w.sz - 1 - w.zs.total_out;
+        w.zrc = inflate( &w.zs, Z_NO_FLUSH );
+
+        if ( Z_OK == w.zrc && 0 == w.zs.avail_out ) {
+            if ( w.sz > PA_PNG_TEXT_MAX ) {
+                break;
+            }
+            w.sz *= 2;
+            w.text = realloc( w.text, w.sz );
+        }
+        else if ( Z_OK == w.zrc ) {
+            break;  /* the stream ends early */
+        }
+    } while ( Z_OK == w.zrc );
+
+    if ( Z_STREAM_END == w.zrc ) {
+        *(w.text + w.zs.total_out) = '\0';
+    }
+    else free( w.text );
+    inflateEnd( &w.zs );
+
+    return ( w.text );
+}
+
+
+/**
+ ******************************************************************************
+ * libjpeg's default error handler exit()s, so its 'error_exit' is replaced
+ * with a longjmp() back into 'read_jpeg_file()'.
+ */
+#if defined(ENABLE_JPEG_RW)
+typedef struct jpeg_err_t {
+    struct jpeg_error_mgr  mgr;
+    jmp_buf                jmp;
+} jpeg_err_t;
+
+static void jpeg_error_exit(j_common_ptr cinfo)
+{
+    longjmp( ((jpeg_err_t *) cinfo->err)->jmp, 1 );
+}
+#endif
+
+
+/**
+ ******************************************************************************
+ * Read a JPEG file (already opened by 'read_png_image()') as RGB24, so the
+ * backgrounds can be used as they're downloaded, without a PNG copy of each.
+ *
+ * The comments are from the file's COM markers, a 'key: value' per line (the
+ * way 'save_jpgfile()' writes them), and a line without a ': ' is kept whole
+ * as a 'Comment'.  The markers are all before the image data, so only the
+ * header is read for READ_ONLY_METADATA and READ_ONLY_COMMENTS.
+ *
+ * \callgraph
+ * \callergraph
+ */
+static rc_e O0 read_jpeg_file(JPEG_ARGS_UNUSED FILE *file, pa_image_t *image, char const *const filename,
+                              JPEG_ARGS_UNUSED char const *const *keys, JPEG_ARGS_UNUSED read_opts_e read_opts)
+{
+#if defined(ENABLE_JPEG_RW)
+    struct {
+        struct jpeg_decompress_struct cinfo;
+        jpeg_err_t                    jerr;
+        jpeg_saved_marker_ptr         marker;
+        JSAMPROW                      row;
+        char                         *text;
+        char                         *line;
+        char                         *save;
+        char                         *sep;
+        rc_e                          rc;
+    } VOLATILE wj = {
+        .rc = RC_FALSE,
+    };
+    char msg[ JMSG_LENGTH_MAX ];
+
+
+    if ( NULL == image->comments ) {
+        image->comments = calloc(1, sizeof (comments_t));
+    }
+
+    wj.cinfo.err = jpeg_std_error( &wj.jerr.mgr );
+    wj.jerr.mgr.error_exit = jpeg_error_exit;
+
+    if ( setjmp( wj.jerr.jmp ) ) {
+        (*wj.cinfo.err->format_message)( (j_common_ptr) &wj.cinfo, msg );
+        set_err_desc( image->err_desc, "'%s' -- %s", filename, msg ); /*+*/
+        goto jpeg_complete;
+    }
+
+    rewind( file );
+    jpeg_create_decompress( &wj.cinfo );
+    jpeg_stdio_src( &wj.cinfo, file );
+    jpeg_save_markers( &wj.cinfo, JPEG_COM, 0xFFFF );
+    jpeg_read_header( &wj.cinfo, TRUE );
+
+    for ( wj.marker = wj.cinfo.marker_list; NULL != wj.marker; wj.marker = wj.marker->next ) {
+        wj.text = strndup( (char const *) wj.marker->data, wj.marker->data_length );
+
+        for ( wj.line = strtok_r( wj.text, "\n", &wj.save ); NULL != wj.line; wj.line = strtok_r( NULL, "\n", &wj.save ) ) {
+            if ( NULL != (wj.sep = strstr( wj.line, ": " )) ) {
+                *wj.sep = '\0';
+                if ( 0 == is_ignored_key( wj.line, keys ) ) {
+                    add_comments( image->comments, wj.line, wj.sep + 2 );
+                }
+            }
+            else add_comments( image->comments, "Comment", wj.line );
+        }
+        (free)( wj.text );
+    }
+
+    if ( JCS_CMYK == wj.cinfo.jpeg_color_space || JCS_YCCK == wj.cinfo.jpeg_color_space ) {
+        set_err_desc( image->err_desc, "'%s' -- unsupported JPEG image (CMYK)", filename );
+        goto jpeg_complete;
+    }
+
+    image->width            = wj.cinfo.image_width;
+    image->height           = wj.cinfo.image_height;
+    image->color_type       = PNG_COLOR_TYPE_RGB;
+    image->bit_depth        = 8;
+    image->row_bytes        = image->width * 3;
+    image->number_of_passes = 1;
+
+    if ( READ_WHOLE_IMAGE == read_opts ) {
+        wj.cinfo.out_color_space = JCS_RGB;
+        jpeg_start_decompress( &wj.cinfo );
+
+        image->image_data = get_pooled_data( image->height * image->row_bytes );
+        if( NULL == image->image_data ) {
+            set_err_desc( image->err_desc, "'%s' -- no memory for JPEG image", filename );
+            goto jpeg_complete;
+        }
+        while ( wj.cinfo.output_scanline < wj.cinfo.output_height ) {
+            wj.row = image->image_data + wj.cinfo.output_scanline * image->row_bytes;
+            jpeg_read_scanlines( &wj.cinfo, &wj.row, 1 );
+        }
+        jpeg_finish_decompress( &wj.cinfo );
+    }
+    wj.rc = RC_TRUE;
+
+    jpeg_complete:
+    jpeg_destroy_decompress( &wj.cinfo );
+
+    return ( wj.rc );
+#else
+    set_err_desc( image->err_desc, "'%s' -- is a JPEG file, NOT COMPILED WITH libjpeg SUPPORT", filename );
+
+    return ( RC_FALSE );
+#endif
+}
+
+
 /**
  ******************************************************************************
  * \callgraph
@@ -419,6 +896,173 @@ static pa_image_t *alloc_png_image()
 }
 
 
+/**
+ ******************************************************************************
+ * Make a copy of an image (its pixels and comments) for a page to blend into.
+ * The pixel buffer comes from the buffer pool, if there's one that'll fit.
+ *
+ * Returns NULL if there's no memory for the pixels.
+ */
+pa_image_t *clone_pa_image(pa_image_t const *const src)
+{
+    pa_image_t *image = alloc_png_image();
+    size_t      size  = src->height * src->row_bytes;
+
+    *image = *src;
+    image->err_desc   = NULL;
+    image->comments   = dup_comments( src->comments );
+    image->file_bytes = 0;
+
+    if ( NULL != src->image_data ) {
+        image->image_data = get_pooled_data( size );
+        if ( NULL == image->image_data ) {
+            cleanup_comments( &image->comments );
+            (free)( image );
+            return ( NULL );
+        }
+        memcpy( image->image_data, src->image_data, size );
+    }
+
+    return ( image );
+}
+
+
+/**
+ ******************************************************************************
+ * Make an RGB24 image from 'data' (a copy, 'width * 3' bytes per row) that
+ * owns 'comments'.  This is how a '--bg-cache-dir' frame becomes an image,
+ * 'file_bytes' is the part of the frame's file that was used.
+ *
+ * Returns NULL (and 'comments' is freed) if there's no memory for the pixels.
+ */
+pa_image_t *new_rgb24_image(int width, int height, unsigned char const *data, comments_t *comments, size_t file_bytes)
+{
+    pa_image_t *image = alloc_png_image();
+
+    image->width            = width;
+    image->height           = height;
+    image->row_bytes        = width * 3;
+    image->color_type       = PNG_COLOR_TYPE_RGB;
+    image->bit_depth        = 8;
+    image->number_of_passes = 1;
+    image->comments         = comments;
+    image->file_bytes       = file_bytes;
+
+    image->image_data = get_pooled_data( height * image->row_bytes );
+    if ( NULL == image->image_data ) {
+        cleanup_comments( &image->comments );
+        (free)( image );
+        return ( NULL );
+    }
+    memcpy( image->image_data, data, height * image->row_bytes );
+
+    return ( image );
+}
+
+
+/**
+ ******************************************************************************
+ * The image's pixels, RGB24 and 'get_image_width() * 3' bytes per row (NULL
+ * if only its metadata was read).
+ */
+unsigned char const *get_image_data(pa_image_t const *const pa_image)
+{
+    return ( pa_image->image_data );
+}
+
+
+/**
+ ******************************************************************************
+ * The # of bytes read from the image's file (0 if it's a clone).
+ */
+size_t get_image_file_bytes(pa_image_t const *const pa_image)
+{
+    return ( pa_image->file_bytes );
+}
+
+
+/**
+ ******************************************************************************
+ * The # of bytes in the image's pixels (0 if only its metadata was read).
+ */
+size_t get_image_data_size(pa_image_t const *const pa_image)
+{
+
+    if ( NULL == pa_image->image_data ) {
+        return ( 0 );
+    }
+    return ( pa_image->height * pa_image->row_bytes );
+}
+
+
+/**
+ ******************************************************************************
+ */
+static png_byte *get_pooled_data(size_t size)
+{
+    png_byte *data = NULL;
+
+    pthread_mutex_lock( &image_pool.lock );
+    for ( unsigned int idx = 0; idx < image_pool.cnt; idx++ ) {
+        if ( size == image_pool.size[ idx ] ) {
+            data = image_pool.data[ idx ];
+
+            image_pool.cnt--;
+            image_pool.data[ idx ] = image_pool.data[ image_pool.cnt ];
+            image_pool.size[ idx ] = image_pool.size[ image_pool.cnt ];
+            break;
+        }
+    }
+    pthread_mutex_unlock( &image_pool.lock );
+
+    return ( (NULL != data) ? data : malloc(size) );
+}
+
+
+/**
+ ******************************************************************************
+ * If the pool's full, then the oldest buffer is freed (the sizes might have
+ * changed).
+ */
+static void put_pooled_data(png_byte *data, size_t size)
+{
+    png_byte *oldest = NULL;
+
+    pthread_mutex_lock( &image_pool.lock );
+    if ( PA_IMAGE_POOL_MAX == image_pool.cnt ) {
+        oldest = image_pool.data[ 0 ];
+        image_pool.cnt--;
+        memmove( &image_pool.data[ 0 ], &image_pool.data[ 1 ], image_pool.cnt * sizeof (png_byte *) );
+        memmove( &image_pool.size[ 0 ], &image_pool.size[ 1 ], image_pool.cnt * sizeof (size_t) );
+    }
+
+    image_pool.data[ image_pool.cnt ] = data;
+    image_pool.size[ image_pool.cnt ] = size;
+    image_pool.cnt++;
+    pthread_mutex_unlock( &image_pool.lock );
+
+    (free)( oldest );
+
+    return ;
+}
+
+
+/**
+ ******************************************************************************
+ * Free the pooled image buffers, at exit.
+ */
+void cleanup_image_pool(void)
+{
+
+    while ( image_pool.cnt > 0 ) {
+        image_pool.cnt--;
+        (free)( image_pool.data[ image_pool.cnt ] );
+    }
+
+    return ;
+}
+
+
 /**
  ******************************************************************************
  * \callgraph
@@ -443,35 +1087,102 @@ int get_image_height(pa_image_t *pa_image)
 
 /**
  ******************************************************************************
+ * Write the image to 'filename' as an 'image_type' image.  If 'io' isn't NULL,
+ * it's set to how long the encode and the write took, and the bytes written.
+ *
  * \callgraph
  * \callergraph
  */
-int O0 write_image_file(char const *const filename, pa_image_t *png_image, char const *const image_type)
+int O0 write_image_file(char const *const filename, pa_image_t *png_image, char const *const image_type, image_io_t *io)
 {
     struct {
-       int  rc;
+       int      rc;
+       FILE    *mem;
+       char    *buf;
+       size_t   len;
+       uint64_t start_ns;
+       uint64_t encoded_ns;
     } w = {
-       .rc = 0,
+       .rc  = RC_FALSE,
+       .buf = NULL,
+       .len = 0,
+       .start_ns = get_monotonic_ns(),
     };
 
 
+    /*
+     ***************************************************************************
+     * Encode into memory, then write the file in one go (the encoders write
+     * in small pieces, and this keeps a half written image off of the disk).
+     */
+    if ( NULL != io ) {
+        *io = (image_io_t) { 0 };
+    }
+
+    w.mem = open_memstream( &w.buf, &w.len );
+    if ( NULL == w.mem ) {
+        fprintf(stderr, "Error encoding %s! (%s)\n", filename, strerror( errno ));
+        return ( w.rc );
+    }
+
     do if ( 0 == strcmp(image_type, "png") ) {
-        w.rc = save_pngfile(filename, png_image);
+        w.rc = save_pngfile(w.mem, png_image);
         break;
     }
     else if ( 0 == strcmp(image_type, "jpg") ) {
-        w.rc = save_jpgfile(filename, png_image);
+        w.rc = save_jpgfile(w.mem, png_image);
         break;
     }
     else {
         fprintf(stderr, "UNSUPPORTED output type '%s' specified.\n", image_type);
     } while ( 0 );
 
+    fclose( w.mem );  /* this sets 'w.buf' and 'w.len' */
+    w.encoded_ns = get_monotonic_ns();
+
+    if ( RC_TRUE == w.rc ) {
+        w.rc = save_buffer(filename, w.buf, w.len);
+    }
+    (free)( w.buf );
+
+    if ( NULL != io ) {
+        io->encode_ns = w.encoded_ns - w.start_ns;
+        io->write_ns  = get_monotonic_ns() - w.encoded_ns;
+        io->bytes     = (RC_TRUE == w.rc) ? w.len : 0;
+    }
 
     return ( w.rc );
 }
 
 
+/**
+ ******************************************************************************
+ * Write an encoded image to its file.
+ */
+static int O0 save_buffer(char const *const filename, char const *buf, size_t len)
+{
+    FILE *file = fopen(filename, "wb");
+    int   rc   = RC_FALSE;
+
+    if ( NULL == file ) {
+        fprintf(stderr, "Error opening %s for writing! (%s)\n", filename, strerror( errno ));
+        return ( rc );
+    }
+
+    if ( len == fwrite(buf, 1, len, file) ) {
+        rc = RC_TRUE;
+    }
+    if ( 0 != fclose( file ) ) {
+        rc = RC_FALSE;
+    }
+    if ( RC_TRUE != rc ) {
+        fprintf(stderr, "Error writing %s! (%s)\n", filename, strerror( errno ));
+    }
+
+    return ( rc );
+}
+
+
 /**
  ******************************************************************************
  * Write the image to a JPG file using libjpeg.
@@ -482,7 +1193,7 @@ int O0 write_image_file(char const *const filename, pa_image_t *png_image, char
  *
  * https://github.com/LuaDist/libjpeg/blob/master/example.c
  */
-static int O0 save_jpgfile(JPEG_ARGS_UNUSED char const *const jpg_filename, JPEG_ARGS_UNUSED pa_image_t *png_image)
+static int O0 save_jpgfile(JPEG_ARGS_UNUSED FILE *file, JPEG_ARGS_UNUSED pa_image_t *png_image)
 {
     struct {
         int         rc;
@@ -490,7 +1201,6 @@ static int O0 save_jpgfile(JPEG_ARGS_UNUSED char const *const jpg_filename, JPEG
         int         height;
         int         row_bytes;
         int         quality;
-        char const *filename;
         JSAMPLE    *buf;
 
         struct jpeg_compress_struct cinfo;
@@ -503,10 +1213,10 @@ static int O0 save_jpgfile(JPEG_ARGS_UNUSED char const *const jpg_filename, JPEG
         .height    = png_image->height,
         .row_bytes = png_image->row_bytes,
         .quality   = png_image->jpeg_quality,
-        .filename  = jpg_filename,
         .buf       = png_image->image_data,
+        .jpg_file  = file,
 
-        .rc        = 0,
+        .rc        = RC_FALSE,
     };
     JSAMPROW row_pointer[1];
 
@@ -516,7 +1226,6 @@ static int O0 save_jpgfile(JPEG_ARGS_UNUSED char const *const jpg_filename, JPEG
 
     jpeg_create_compress( &wj.cinfo );
 
-    wj.jpg_file = fopen(wj.filename, "wb");  // FIXME Error check
     jpeg_stdio_dest( &wj.cinfo, wj.jpg_file );
 
     wj.cinfo.image_width = wj.width;
@@ -554,9 +1263,9 @@ static int O0 save_jpgfile(JPEG_ARGS_UNUSED char const *const jpg_filename, JPEG
     }
 
     jpeg_finish_compress( &wj.cinfo );
-    fclose( wj.jpg_file );
 
     jpeg_destroy_compress( &wj.cinfo );
+    wj.rc = RC_TRUE;
 
 #else
     fprintf(stderr, "NOT COMPILED WITH libjpeg SUPPORT.\n", image_type);
@@ -572,11 +1281,10 @@ static int O0 save_jpgfile(JPEG_ARGS_UNUSED char const *const jpg_filename, JPEG
  * \callgraph
  * \callergraph
  */
-static int O0 save_pngfile(char const *const png_filename, pa_image_t *png_image)
+static int O0 save_pngfile(FILE *file, pa_image_t *png_image)
 {
     png_struct *pngs_ptr;
     struct {
-        char const *const png_filename;
         pa_image_t *png_image;
 
         png_infop  info_ptr;
@@ -585,10 +1293,9 @@ static int O0 save_pngfile(char const *const png_filename, pa_image_t *png_image
     //-d  enum    { RC_FALSE = 0, RC_TRUE = 1 } rc;
     } volatile ww = {
         .png_image = png_image,
-        .png_filename = png_filename,
         .rc = RC_FALSE,
 
-        .file = NULL, .info_ptr = NULL,
+        .file = file, .info_ptr = NULL,
  };
 
 /*       ww.png_image->err_desc = NULL; */
@@ -614,12 +1321,6 @@ static int O0 save_pngfile(char const *const png_filename, pa_image_t *png_image
             break;
         }
 
-        ww.file = fopen(ww.png_filename, "wb");
-        if ( NULL == ww.file ) {
-            printf("Error opening %s for writing! (%s)\n", ww.png_filename, strerror( errno ));
-            break;
-        }
-
         png_init_io(pngs_ptr, ww.file);
         png_set_compression_level(pngs_ptr, 7);
 
@@ -653,10 +1354,6 @@ static int O0 save_pngfile(char const *const png_filename, pa_image_t *png_image
         ww.rc = RC_TRUE;
     } while ( 0 );
 
-    if( NULL != ww.file ) {
-        fclose( ww.file );
-    }
-
     if( pngs_ptr != NULL) {
         png_destroy_write_struct( &pngs_ptr, (png_infopp ) &ww.info_ptr );
     }
@@ -695,7 +1392,9 @@ static void prune_pa_image(pa_image_t **image)
 {
 
     if ( NULL != *image ) {
-        (free)((*image)->image_data);
+        if ( NULL != (*image)->image_data ) {
+            put_pooled_data((*image)->image_data, (*image)->height * (*image)->row_bytes);
+        }
         (free)((*image)->err_desc);
 
         cleanup_comments( &(*image)->comments );
@@ -705,6 +1404,205 @@ static void prune_pa_image(pa_image_t **image)
 }
 
 
+/**
+ *******************************************************************************
+ * Blending an ASS_Image row onto an RGB24 row.
+ *
+ * For each pixel, 'k' is the glyph's coverage scaled by the ASS_Image's
+ * opacity, and each channel becomes '(k * colour + (255 - k) * dst) / 255'.
+ * The numerators are at most 255 * 255, so the divides can be done exactly
+ * with '(x + 1 + (x >> 8)) >> 8' in 16-bit lanes.  'blend_row_scalar()' is
+ * the reference, the vector kernels must match it bit for bit (see the
+ * RW_IMAGEFILE_MAIN self-check at the end of this file).
+ *
+ * Most of an ASS_Image's bitmap is empty (a glyph's bounding box, or the
+ * space between the glyphs of a line), so the vector kernels skip runs of
+ * zero coverage without touching 'dst'.
+ */
+typedef void (*blend_row_f)( unsigned char *dst, unsigned char const *src, int w, unsigned opacity, unsigned char const rgb[ 3 ] );
+
+static void O3 blend_row_scalar( unsigned char *dst, unsigned char const *src, int w, unsigned opacity, unsigned char const rgb[ 3 ] )
+{
+
+    for ( int x = 0; x < w; x++ ) {
+        unsigned k = ((unsigned) src[ x ]) * opacity / 255;
+        *dst = (k * rgb[ 0 ] + (255 - k) * *dst) / 255;
+        dst++;
+        *dst = (k * rgb[ 1 ] + (255 - k) * *dst) / 255;
+        dst++;
+        *dst = (k * rgb[ 2 ] + (255 - k) * *dst) / 255;
+        dst++;
+    }
+
+    return ;
+}
+
+#if defined(__x86_64__)  /* { */
+
+/**
+ *******************************************************************************
+ * SSE2 :: 16 pixels (48 bytes of 'dst') at a time.  SSE2 is always there on
+ * x86-64.  Each pixel's 'k' is spread over its 3 channels with a small copy
+ * since SSE2 doesn't have a byte shuffle.
+ */
+#undef DIV_255_SSE2
+#define DIV_255_SSE2( x_ ) \
+    _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16( (x_), _mm_set1_epi16( 1 ) ), _mm_srli_epi16( (x_), 8 ) ), 8 )
+
+static inline __m128i blend_16_sse2( __m128i k, __m128i d, __m128i c )
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const ff   = _mm_set1_epi16( 255 );
+
+    __m128i k_lo = _mm_unpacklo_epi8( k, zero ), k_hi = _mm_unpackhi_epi8( k, zero );
+    __m128i d_lo = _mm_unpacklo_epi8( d, zero ), d_hi = _mm_unpackhi_epi8( d, zero );
+    __m128i c_lo = _mm_unpacklo_epi8( c, zero ), c_hi = _mm_unpackhi_epi8( c, zero );
+
+    __m128i x_lo = _mm_add_epi16( _mm_mullo_epi16( k_lo, c_lo ), _mm_mullo_epi16( _mm_sub_epi16( ff, k_lo ), d_lo ) );
+    __m128i x_hi = _mm_add_epi16( _mm_mullo_epi16( k_hi, c_hi ), _mm_mullo_epi16( _mm_sub_epi16( ff, k_hi ), d_hi ) );
+
+    return ( _mm_packus_epi16( DIV_255_SSE2( x_lo ), DIV_255_SSE2( x_hi ) ) );
+}
+
+static void O3 blend_row_sse2( unsigned char *dst, unsigned char const *src, int w, unsigned opacity, unsigned char const rgb[ 3 ] )
+{
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const op   = _mm_set1_epi16( opacity );
+    unsigned char pattern[ 48 ] __attribute__((aligned(16)));
+    unsigned char kk[ 16 ]      __attribute__((aligned(16)));
+    unsigned char k3[ 48 ]      __attribute__((aligned(16)));
+    int           x = 0;
+
+    for ( int ii = 0; ii < 48; ii++ ) {
+        pattern[ ii ] = rgb[ ii % 3 ];
+    }
+
+    for ( ; x + 16 <= w; x += 16 ) {
+        __m128i s = _mm_loadu_si128( (__m128i const *) (src + x) );
+        if ( 0xFFFF == _mm_movemask_epi8( _mm_cmpeq_epi8( s, zero ) ) ) {
+            continue;
+        }
+
+        __m128i s_lo = _mm_mullo_epi16( _mm_unpacklo_epi8( s, zero ), op );
+        __m128i s_hi = _mm_mullo_epi16( _mm_unpackhi_epi8( s, zero ), op );
+        _mm_store_si128( (__m128i *) kk, _mm_packus_epi16( DIV_255_SSE2( s_lo ), DIV_255_SSE2( s_hi ) ) );
+
+        for ( int ii = 0; ii < 16; ii++ ) {
+            k3[ 3 * ii ] = k3[ 3 * ii + 1 ] = k3[ 3 * ii + 2 ] = kk[ ii ];
+        }
+
+        unsigned char *p = dst + 3 * x;
+        for ( int jj = 0; jj < 48; jj += 16 ) {
+            __m128i d = _mm_loadu_si128( (__m128i const *) (p + jj) );
+            d = blend_16_sse2( _mm_load_si128( (__m128i const *) (k3 + jj) ), d,
+                               _mm_load_si128( (__m128i const *) (pattern + jj) ) );
+            _mm_storeu_si128( (__m128i *) (p + jj), d );
+        }
+    }
+
+    blend_row_scalar( dst + 3 * x, src + x, w - x, opacity, rgb );
+
+    return ;
+}
+
+/**
+ *******************************************************************************
+ * AVX2 :: 32 pixels (96 bytes of 'dst') at a time.  The unpacks and packs
+ * are both within the 128-bit lanes, so the bytes come back in order.
+ */
+#undef DIV_255_AVX2
+#define DIV_255_AVX2( x_ ) \
+    _mm256_srli_epi16( _mm256_add_epi16( _mm256_add_epi16( (x_), _mm256_set1_epi16( 1 ) ), _mm256_srli_epi16( (x_), 8 ) ), 8 )
+
+__attribute__((target("avx2")))
+static inline __m256i blend_32_avx2( __m256i k, __m256i d, __m256i c )
+{
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i const ff   = _mm256_set1_epi16( 255 );
+
+    __m256i k_lo = _mm256_unpacklo_epi8( k, zero ), k_hi = _mm256_unpackhi_epi8( k, zero );
+    __m256i d_lo = _mm256_unpacklo_epi8( d, zero ), d_hi = _mm256_unpackhi_epi8( d, zero );
+    __m256i c_lo = _mm256_unpacklo_epi8( c, zero ), c_hi = _mm256_unpackhi_epi8( c, zero );
+
+    __m256i x_lo = _mm256_add_epi16( _mm256_mullo_epi16( k_lo, c_lo ), _mm256_mullo_epi16( _mm256_sub_epi16( ff, k_lo ), d_lo ) );
+    __m256i x_hi = _mm256_add_epi16( _mm256_mullo_epi16( k_hi, c_hi ), _mm256_mullo_epi16( _mm256_sub_epi16( ff, k_hi ), d_hi ) );
+
+    return ( _mm256_packus_epi16( DIV_255_AVX2( x_lo ), DIV_255_AVX2( x_hi ) ) );
+}
+
+__attribute__((target("avx2")))
+static void O3 blend_row_avx2( unsigned char *dst, unsigned char const *src, int w, unsigned opacity, unsigned char const rgb[ 3 ] )
+{
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i const op   = _mm256_set1_epi16( opacity );
+    unsigned char pattern[ 96 ] __attribute__((aligned(32)));
+    unsigned char kk[ 32 ]      __attribute__((aligned(32)));
+    unsigned char k3[ 96 ]      __attribute__((aligned(32)));
+    int           x = 0;
+
+    for ( int ii = 0; ii < 96; ii++ ) {
+        pattern[ ii ] = rgb[ ii % 3 ];
+    }
+
+    for ( ; x + 32 <= w; x += 32 ) {
+        __m256i s = _mm256_loadu_si256( (__m256i const *) (src + x) );
+        if ( -1 == _mm256_movemask_epi8( _mm256_cmpeq_epi8( s, zero ) ) ) {
+            continue;
+        }
+
+        __m256i s_lo = _mm256_mullo_epi16( _mm256_unpacklo_epi8( s, zero ), op );
+        __m256i s_hi = _mm256_mullo_epi16( _mm256_unpackhi_epi8( s, zero ), op );
+        _mm256_store_si256( (__m256i *) kk, _mm256_packus_epi16( DIV_255_AVX2( s_lo ), DIV_255_AVX2( s_hi ) ) );
+
+        for ( int ii = 0; ii < 32; ii++ ) {
+            k3[ 3 * ii ] = k3[ 3 * ii + 1 ] = k3[ 3 * ii + 2 ] = kk[ ii ];
+        }
+
+        unsigned char *p = dst + 3 * x;
+        for ( int jj = 0; jj < 96; jj += 32 ) {
+            __m256i d = _mm256_loadu_si256( (__m256i const *) (p + jj) );
+            d = blend_32_avx2( _mm256_load_si256( (__m256i const *) (k3 + jj) ), d,
+                               _mm256_load_si256( (__m256i const *) (pattern + jj) ) );
+            _mm256_storeu_si256( (__m256i *) (p + jj), d );
+        }
+    }
+
+    blend_row_sse2( dst + 3 * x, src + x, w - x, opacity, rgb );
+
+    return ;
+}
+#endif  /* } __x86_64__ */
+
+
+/**
+ *******************************************************************************
+ * Pick the best blend kernel for this CPU, once.
+ */
+static blend_row_f blend_row_kernel = NULL;
+
+static void set_blend_row( void )
+{
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    blend_row_kernel = __builtin_cpu_supports( "avx2" ) ? blend_row_avx2 : blend_row_sse2;
+#else
+    blend_row_kernel = blend_row_scalar;
+#endif
+
+    return ;
+}
+
+static blend_row_f get_blend_row( void )
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+    pthread_once( &once, set_blend_row );
+
+    return ( blend_row_kernel );
+}
+
+
 /**
  *******************************************************************************
  * Render the ASS_Image list onto the png image.
@@ -724,30 +1622,22 @@ int O3 blend_pa_image(pa_image_t *png_image, ASS_Image *img, int skip_last)
 #define _g(c)  (((c) >> 16) & 0xFF)
 #define _b(c)  (((c) >>  8) & 0xFF)
 #define _a(c)   ((c)        & 0xFF)
+    blend_row_f blend_row = get_blend_row();
     int  cnt = 0;
 
     while( NULL != img ) {
-        unsigned char opacity = 255 - _a(img->color);
-        unsigned char r = _r(img->color);
-        unsigned char g = _g(img->color);
-        unsigned char b = _b(img->color);
+        unsigned      opacity  = 255 - _a(img->color);
+        unsigned char rgb[ 3 ] = { _r(img->color), _g(img->color), _b(img->color) };  /* RGB24 */
 
         unsigned char *src = img->bitmap;
         unsigned char *dst = png_image->image_data + img->dst_y * png_image->row_bytes + img->dst_x * 3;
 
-        for ( int y = 0; y < img->h; y++ ) {
-            unsigned char *p = dst;
-            for ( int x = 0; x < img->w; x++ ) {
-                unsigned k = ((unsigned) src[ x ]) * opacity / 255;
-                *p = (k * b + (255 - k) * *p) / 255;
-                p++;
-                *p = (k * g + (255 - k) * *p) / 255;
-                p++;
-                *p = (k * r + (255 - k) * *p) / 255;
-                p++;
+        if ( 0 != opacity ) {
+            for ( int y = 0; y < img->h; y++ ) {
+                blend_row( dst, src, img->w, opacity, rgb );
+                src += img->stride;
+                dst += png_image->row_bytes;
             }
-            src += img->stride;
-            dst += png_image->row_bytes;
         }
 
         ++cnt;
@@ -762,3 +1652,217 @@ int O3 blend_pa_image(pa_image_t *png_image, ASS_Image *img, int skip_last)
     return ( cnt );
 }
 
+
+/**
+ *******************************************************************************
+ * Colorize the whole image with 'rgb', 'percent' of the way (0 .. 100), the
+ * same as ImageMagick's 'convert -fill COLOUR -colorize PERCENT%'.  That's a
+ * blend of a solid colour at full coverage, so it's done by the blend kernels
+ * with every 'src' byte at 255 and the opacity at 'percent' of 255 (exactly
+ * 'k' in the blend's '(k * colour + (255 - k) * dst) / 255').
+ *
+ * A background is colorized once, when it's read (see 'pa_bgcache.c').
+ * Returns RC_FALSE (with the image's error description) if there's no
+ * memory for it.
+ */
+rc_e O3 colorize_pa_image(pa_image_t *image, unsigned char const rgb[ 3 ], unsigned percent)
+{
+    blend_row_f    blend_row = get_blend_row();
+    unsigned       opacity   = (percent * 255 + 50) / 100;
+    unsigned char *src;
+    unsigned char *dst       = image->image_data;
+
+    if ( 0 == opacity || NULL == dst ) {
+        return ( RC_TRUE );
+    }
+
+    src = malloc( image->width );
+    if ( NULL == src ) {
+        set_err_desc( image->err_desc, "no memory to colorize the image" );
+        return ( RC_FALSE );
+    }
+    memset( src, 255, image->width );
+
+    for ( int y = 0; y < image->height; y++ ) {
+        blend_row( dst, src, image->width, opacity, rgb );
+        dst += image->row_bytes;
+    }
+    free( src );
+
+    return ( RC_TRUE );
+}
+
+
+/*
+ ******************************************************************************
+ ******************************************************************************
+ * Testing section ...
+ *
+ *   gcc -O3 -DRW_IMAGEFILE_MAIN -I. rw_imagefile.c rw_arrays.c rw_textfile.c pa_misc.c -lpng -lz -ljpeg
+ *
+ * Checks the blend kernels against 'blend_row_scalar()', bit for bit, and
+ * that the PNGs that aren't RGB (palette, with and without a tRNS, grey,
+ * alpha, 16-bit) are all read as RGB24.
+ */
+#ifdef RW_IMAGEFILE_MAIN  /* { */
+
+#include <unistd.h>  /* unlink() */
+
+/**
+ ******************************************************************************
+ * Write a 4x2 PNG of 'color_type' and 'bit_depth' (with a tRNS if 'trns'),
+ * read it back, and check that each pixel is the RGB24 'expect' of it.
+ */
+static int check_png_read( char const *const name, int color_type, int bit_depth, int trns )
+{
+    struct {
+        char         filename[ sizeof ("/tmp/rw_imagefile-XXXXXX") ];
+        FILE        *file;
+        png_struct  *pngs_ptr;
+        png_info    *info_ptr;
+        png_color    palette[ 8 ];
+        png_byte     alpha[ 8 ];
+        png_byte     row[ 4 * 8 ];
+        png_byte     expect[ 2 * 4 * 3 ];
+        pa_image_t  *image;
+        int          errs;
+    } w = {
+        .filename = "/tmp/rw_imagefile-XXXXXX",
+        .image    = NULL,
+        .errs     = 0,
+    };
+
+
+    for ( int ii = 0; ii < 8; ii++ ) {
+        w.palette[ ii ] = (png_color) { 30 * ii, 255 - 30 * ii, 17 * ii };
+        w.alpha[ ii ]   = 32 * ii;
+    }
+
+    w.file     = fdopen( mkstemp( w.filename ), "wb" );
+    w.pngs_ptr = png_create_write_struct( PNG_LIBPNG_VER_STRING, NULL, NULL, NULL );
+    w.info_ptr = png_create_info_struct( w.pngs_ptr );
+    png_init_io( w.pngs_ptr, w.file );
+    png_set_IHDR( w.pngs_ptr, w.info_ptr, 4, 2, bit_depth, color_type, PNG_INTERLACE_NONE,
+                  PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT );
+    if ( PNG_COLOR_TYPE_PALETTE == color_type ) {
+        png_set_PLTE( w.pngs_ptr, w.info_ptr, w.palette, 8 );
+    }
+    if ( trns ) {
+        png_set_tRNS( w.pngs_ptr, w.info_ptr, w.alpha, 8, NULL );
+    }
+    png_write_info( w.pngs_ptr, w.info_ptr );
+
+    for ( int yy = 0; yy < 2; yy++ ) {
+        memset( w.row, 0, sizeof (w.row) );
+        for ( int xx = 0; xx < 4; xx++ ) {
+            int        px = 4 * yy + xx;          /* 0 .. 7 */
+            png_byte  *e  = w.expect + 3 * px;
+
+            if ( PNG_COLOR_TYPE_PALETTE == color_type ) {
+                w.row[ xx ] = px;
+                e[ 0 ] = w.palette[ px ].red, e[ 1 ] = w.palette[ px ].green, e[ 2 ] = w.palette[ px ].blue;
+            }
+            else if ( 1 == bit_depth ) {          /* grey */
+                w.row[ 0 ] |= (px & 1) << (7 - xx);
+                e[ 0 ] = e[ 1 ] = e[ 2 ] = (px & 1) ? 255 : 0;
+            }
+            else {                                /* each sample is 'v', or 'v' twice for 16-bit */
+                int  samples = ((color_type & PNG_COLOR_MASK_COLOR) ? 3 : 1) + ((color_type & PNG_COLOR_MASK_ALPHA) ? 1 : 0);
+                int  bytes   = bit_depth / 8;
+
+                for ( int ss = 0; ss < samples * bytes; ss++ ) {
+                    w.row[ (xx * samples * bytes) + ss ] = 31 * px + 10 * (ss / bytes);
+                }
+                for ( int cc = 0; cc < 3; cc++ ) {
+                    e[ cc ] = 31 * px + 10 * ((color_type & PNG_COLOR_MASK_COLOR) ? cc : 0);
+                }
+            }
+        }
+        png_write_row( w.pngs_ptr, w.row );
+    }
+    png_write_end( w.pngs_ptr, w.info_ptr );
+    png_destroy_write_struct( &w.pngs_ptr, &w.info_ptr );
+    fclose( w.file );
+
+    if ( RC_TRUE != read_png_image( w.filename, &w.image, NULL, READ_WHOLE_IMAGE ) ) {
+        fprintf(stdout, "%s :: FAILED, %s\n", name, get_err_desc( w.image ));
+        w.errs++;
+    }
+    else if ( 4 != w.image->width || 2 != w.image->height || 12 != w.image->row_bytes
+                || 0 != memcmp( w.image->image_data, w.expect, sizeof (w.expect) ) ) {
+        fprintf(stdout, "%s :: FAILED, not the expected RGB24\n", name);
+        w.errs++;
+    }
+    else fprintf(stdout, "%s :: read as RGB24\n", name);
+
+    cleanup_pa_image( &w.image );
+    unlink( w.filename );
+
+    return ( w.errs );
+}
+
+int main(UNUSED_ARG int argc, UNUSED_ARG char *argv[])
+{
+    struct {
+        char const  *name;
+        blend_row_f  blend_row;
+        int          ok;
+    } kernels[] = {
+#if defined(__x86_64__)
+        { "sse2", blend_row_sse2, 1 },
+        { "avx2", blend_row_avx2, 0 },
+#endif
+        { NULL,   NULL,           0 },
+    };
+    unsigned char src[ 300 ];
+    unsigned char ref[ 900 ];
+    unsigned char dst[ 900 ];
+    int           errs = 0;
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    kernels[ 1 ].ok = __builtin_cpu_supports( "avx2" );
+#endif
+    srandom( 65 );
+
+    for ( int kk = 0; NULL != kernels[ kk ].name; kk++ ) {
+        if ( ! kernels[ kk ].ok ) {
+            fprintf(stdout, "%s :: not supported, skipped\n", kernels[ kk ].name);
+            continue;
+        }
+
+        for ( int trial = 0; trial < 20000; trial++ ) {
+            int           w        = random() % 300;
+            unsigned      opacity  = (trial & 1) ? 255 : random() % 256;
+            unsigned char rgb[ 3 ] = { random(), random(), random() };
+
+            for ( int ii = 0; ii < w; ii++ ) {  /* mostly empty, like a glyph */
+                src[ ii ] = (random() % 3) ? 0 : (random() % 2) ? 255 : random();
+            }
+            for ( int ii = 0; ii < 3 * w; ii++ ) {
+                ref[ ii ] = dst[ ii ] = random();
+            }
+
+            blend_row_scalar( ref, src, w, opacity, rgb );
+            kernels[ kk ].blend_row( dst, src, w, opacity, rgb );
+
+            if ( 0 != memcmp( ref, dst, 3 * w ) ) {
+                fprintf(stdout, "%s :: MISMATCH, w=%d opacity=%u\n", kernels[ kk ].name, w, opacity);
+                errs++;
+                break;
+            }
+        }
+        fprintf(stdout, "%s :: %s\n", kernels[ kk ].name, errs ? "FAILED" : "bit-exact");
+    }
+
+    errs += check_png_read( "palette",        PNG_COLOR_TYPE_PALETTE,    8,  0 );
+    errs += check_png_read( "palette + tRNS", PNG_COLOR_TYPE_PALETTE,    8,  1 );
+    errs += check_png_read( "grey 1-bit",     PNG_COLOR_TYPE_GRAY,       1,  0 );
+    errs += check_png_read( "grey + alpha",   PNG_COLOR_TYPE_GRAY_ALPHA, 16, 0 );
+    errs += check_png_read( "RGBA",           PNG_COLOR_TYPE_RGBA,       8,  0 );
+    errs += check_png_read( "RGB 16-bit",     PNG_COLOR_TYPE_RGB,        16, 0 );
+
+    return ( 0 != errs );
+}
+
+#endif  /* } */
@@ -48,13 +48,17 @@
  *
  *    'libpng warning: IDAT: Too much image data'
  *
- * So these values are mainly markers for the caller's intent; only
- * READ_ONLY_METADATA is implemented since that data is available soon
- * after opening the PNG image.
+ * So READ_ONLY_METADATA stops after 'png_read_info()' (that data is
+ * available soon after opening the PNG image), and READ_ONLY_COMMENTS
+ * doesn't use libpng at all -- it walks the file's chunks for the text
+ * records and skips the image data (there's no image data returned).
+ *
+ * A JPEG background stops after its header for both, its COM markers (the
+ * comments) are before the image data.
  */
 typedef enum {
     READ_WHOLE_IMAGE    =    0,
-    READ_ONLY_COMMENTS  = 0x01,
+    READ_ONLY_COMMENTS  = 0x01,  /**< Only the 'IHDR' and the text chunks */
     READ_ONLY_METADATA  = 0x02,  /**< Stop reading after 'png_read_info()' */
 } read_opts_e;
 
@@ -64,13 +68,31 @@ typedef enum {
  */
 typedef struct pa_image_t pa_image_t;
 
+/**
+ *******************************************************************************
+ * What writing an image cost, see 'write_image_file()'.
+ */
+typedef struct image_io_t {
+    uint64_t    encode_ns;
+    uint64_t    write_ns;
+    size_t      bytes;       /* written to the file */
+} image_io_t;
+
 /**
  *******************************************************************************
  */
 rc_e        read_png_image(char const *const png_filename, pa_image_t **image, char const *const *keys, read_opts_e);
-int         write_image_file(char const *const filename, pa_image_t *, char const *const);
+int         write_image_file(char const *const filename, pa_image_t *, char const *const, image_io_t *io);
 
 int         blend_pa_image  (pa_image_t *png_image, ASS_Image *img, int skip_last);
+rc_e        colorize_pa_image(pa_image_t *image, unsigned char const rgb[ 3 ], unsigned percent);
+
+pa_image_t *clone_pa_image     (pa_image_t const *const src);
+pa_image_t *new_rgb24_image    (int width, int height, unsigned char const *data, comments_t *comments, size_t file_bytes);
+unsigned char const *get_image_data(pa_image_t const *const pa_image);
+size_t      get_image_data_size(pa_image_t const *const pa_image);
+size_t      get_image_file_bytes(pa_image_t const *const pa_image);
+void        cleanup_image_pool (void);
 
 int         get_image_width (pa_image_t *pa_image);
 int         get_image_height(pa_image_t *pa_image);
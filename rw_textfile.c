@@ -83,6 +83,7 @@ char * O3 read_textfile_sz(char const *const filename, size_t *len, size_t buf_s
 
         /* Shrink the returned memory, this should _always_ succeed. */
         w.buf = realloc( w.buf, w.idx + 1 );
+        w.buf[ w.idx ] = '\0';  /* fgets() never wrote to an empty file's */
     }
 
     return ( w.buf );
@@ -138,6 +139,7 @@ char * O3 read_stream_sz(FILE *file, size_t *len, size_t buf_size)
 
         /* Shrink the returned memory, this should _always_ succeed. */
         w.buf = realloc( w.buf, w.idx + 1 );
+        w.buf[ w.idx ] = '\0';  /* fgets() never wrote to an empty stream's */
     }
 
     return ( w.buf );